@@ -0,0 +1,472 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "tracker-mime-cache.h"
+
+/* Resolves content types the way GIO does, guessing first from the
+ * file name, and reading the head of the file only if that guess is
+ * uncertain. The results of the latter are kept on disk, keyed by
+ * device, inode and mtime, so files with unknown or ambiguous names
+ * are only sniffed again if they change.
+ *
+ * Entries for files that were deleted or changed are never looked up
+ * again, so each entry counts the runs it went unused through, and is
+ * dropped once that goes over MIME_CACHE_MAX_AGE.
+ */
+
+#define MIME_CACHE_HEADER "tracker-mime-cache 2"
+
+/* Runs an entry may go unused through before being dropped */
+#define MIME_CACHE_MAX_AGE 3
+
+/* Maximum number of entries, entries unused in
+ * this run are dropped to make room for new ones.
+ */
+#define MIME_CACHE_MAX_ENTRIES 200000
+
+typedef struct {
+	guint64 device;
+	guint64 inode;
+	guint64 mtime;
+} MimeCacheKey;
+
+typedef struct {
+	/* Interned string */
+	const gchar *content_type;
+	guint age;
+	gboolean used;
+} MimeCacheEntry;
+
+struct _TrackerMimeCache {
+	GMutex mutex;
+	gchar *filename;
+
+	/* MimeCacheKey -> MimeCacheEntry */
+	GHashTable *entries;
+	gboolean dirty;
+
+	guint n_guessed;
+	guint n_cached;
+	guint n_sniffed;
+};
+
+static guint
+mime_cache_key_hash (gconstpointer key)
+{
+	const MimeCacheKey *k = key;
+
+	return (guint) (k->inode ^ (k->inode >> 32) ^
+	                k->mtime ^ (k->mtime >> 32) ^
+	                k->device);
+}
+
+static gboolean
+mime_cache_key_equal (gconstpointer a,
+                      gconstpointer b)
+{
+	return memcmp (a, b, sizeof (MimeCacheKey)) == 0;
+}
+
+static MimeCacheKey *
+mime_cache_key_new (guint64 device,
+                    guint64 inode,
+                    guint64 mtime)
+{
+	MimeCacheKey *key;
+
+	key = g_slice_new (MimeCacheKey);
+	key->device = device;
+	key->inode = inode;
+	key->mtime = mtime;
+
+	return key;
+}
+
+static void
+mime_cache_key_free (MimeCacheKey *key)
+{
+	g_slice_free (MimeCacheKey, key);
+}
+
+static MimeCacheEntry *
+mime_cache_entry_new (const gchar *content_type,
+                      guint        age,
+                      gboolean     used)
+{
+	MimeCacheEntry *entry;
+
+	entry = g_slice_new (MimeCacheEntry);
+	entry->content_type = content_type;
+	entry->age = age;
+	entry->used = used;
+
+	return entry;
+}
+
+static void
+mime_cache_entry_free (MimeCacheEntry *entry)
+{
+	g_slice_free (MimeCacheEntry, entry);
+}
+
+/* Must be called with the mutex held */
+static void
+mime_cache_drop_unused (TrackerMimeCache *cache)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init (&iter, cache->entries);
+
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		MimeCacheEntry *entry = value;
+
+		if (!entry->used) {
+			g_hash_table_iter_remove (&iter);
+			cache->dirty = TRUE;
+		}
+	}
+}
+
+static void
+mime_cache_load (TrackerMimeCache *cache)
+{
+	gchar *contents, **lines;
+	GError *error = NULL;
+	guint i;
+
+	if (!g_file_get_contents (cache->filename, &contents, NULL, &error)) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+			g_message ("Could not load MIME cache '%s': %s",
+			           cache->filename, error->message);
+		}
+
+		g_error_free (error);
+		return;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+	g_free (contents);
+
+	if (g_strcmp0 (lines[0], MIME_CACHE_HEADER) != 0) {
+		g_message ("Ignoring MIME cache '%s' with unknown format",
+		           cache->filename);
+		g_strfreev (lines);
+		return;
+	}
+
+	for (i = 1; lines[i]; i++) {
+		guint64 device, inode, mtime, age;
+		gchar *str, *end;
+
+		/* "<device> <inode> <mtime> <age> <content type>" */
+		str = lines[i];
+		device = g_ascii_strtoull (str, &end, 10);
+		if (end == str || *end != ' ')
+			continue;
+
+		str = end + 1;
+		inode = g_ascii_strtoull (str, &end, 10);
+		if (end == str || *end != ' ')
+			continue;
+
+		str = end + 1;
+		mtime = g_ascii_strtoull (str, &end, 10);
+		if (end == str || *end != ' ')
+			continue;
+
+		str = end + 1;
+		age = g_ascii_strtoull (str, &end, 10);
+		if (end == str || *end != ' ' || end[1] == '\0')
+			continue;
+
+		/* One more run, until it's looked up, ages
+		 * changed so the cache is saved in any case.
+		 */
+		cache->dirty = TRUE;
+
+		if (++age > MIME_CACHE_MAX_AGE)
+			continue;
+
+		g_hash_table_insert (cache->entries,
+		                     mime_cache_key_new (device, inode, mtime),
+		                     mime_cache_entry_new (g_intern_string (end + 1),
+		                                           age, FALSE));
+	}
+
+	g_strfreev (lines);
+}
+
+/**
+ * tracker_mime_cache_new:
+ * @filename: file where the cache is persisted
+ *
+ * Creates a content type cache, loading @filename if it exists.
+ *
+ * Returns: a newly created #TrackerMimeCache, free with
+ *          tracker_mime_cache_free().
+ **/
+TrackerMimeCache *
+tracker_mime_cache_new (const gchar *filename)
+{
+	TrackerMimeCache *cache;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	cache = g_slice_new0 (TrackerMimeCache);
+	g_mutex_init (&cache->mutex);
+	cache->filename = g_strdup (filename);
+	cache->entries = g_hash_table_new_full (mime_cache_key_hash,
+	                                        mime_cache_key_equal,
+	                                        (GDestroyNotify) mime_cache_key_free,
+	                                        (GDestroyNotify) mime_cache_entry_free);
+	mime_cache_load (cache);
+
+	return cache;
+}
+
+/**
+ * tracker_mime_cache_free:
+ * @cache: a #TrackerMimeCache
+ *
+ * Frees @cache, without saving it.
+ **/
+void
+tracker_mime_cache_free (TrackerMimeCache *cache)
+{
+	g_return_if_fail (cache != NULL);
+
+	g_hash_table_unref (cache->entries);
+	g_free (cache->filename);
+	g_mutex_clear (&cache->mutex);
+	g_slice_free (TrackerMimeCache, cache);
+}
+
+/**
+ * tracker_mime_cache_save:
+ * @cache: a #TrackerMimeCache
+ * @error: return location for errors
+ *
+ * Writes @cache to disk if it changed since it was loaded or last saved.
+ * Entries that went unused for a few runs in a row are left out.
+ *
+ * Returns: %TRUE on success, %FALSE if @error is set.
+ **/
+gboolean
+tracker_mime_cache_save (TrackerMimeCache  *cache,
+                         GError           **error)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	gchar *dirname;
+	GString *str;
+	gboolean retval;
+
+	g_return_val_if_fail (cache != NULL, FALSE);
+
+	g_mutex_lock (&cache->mutex);
+
+	if (!cache->dirty) {
+		g_mutex_unlock (&cache->mutex);
+		return TRUE;
+	}
+
+	str = g_string_new (MIME_CACHE_HEADER "\n");
+	g_hash_table_iter_init (&iter, cache->entries);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		MimeCacheKey *k = key;
+		MimeCacheEntry *entry = value;
+
+		g_string_append_printf (str,
+		                        "%" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+		                        " %" G_GUINT64_FORMAT " %u %s\n",
+		                        k->device, k->inode, k->mtime,
+		                        entry->age, entry->content_type);
+	}
+
+	cache->dirty = FALSE;
+	g_mutex_unlock (&cache->mutex);
+
+	dirname = g_path_get_dirname (cache->filename);
+	g_mkdir_with_parents (dirname, 0700);
+	g_free (dirname);
+
+	retval = g_file_set_contents (cache->filename, str->str, str->len, error);
+	g_string_free (str, TRUE);
+
+	return retval;
+}
+
+/**
+ * tracker_mime_cache_get_content_type:
+ * @cache: a #TrackerMimeCache
+ * @file: a #GFile
+ * @info: a #GFileInfo for @file, containing at least
+ *        %TRACKER_MIME_CACHE_FILE_ATTRIBUTES
+ * @cancellable: optional #GCancellable
+ * @error: return location for errors
+ *
+ * Returns the content type of @file, as the
+ * %G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE attribute would. The file
+ * is only read if its name isn't enough to tell the content type,
+ * and it isn't in the cache already. May be called from any thread.
+ *
+ * Returns: an interned string with the content type, or %NULL
+ *          if @error is set.
+ **/
+const gchar *
+tracker_mime_cache_get_content_type (TrackerMimeCache  *cache,
+                                     GFile             *file,
+                                     GFileInfo         *info,
+                                     GCancellable      *cancellable,
+                                     GError           **error)
+{
+	const gchar *content_type = NULL;
+	MimeCacheEntry *entry;
+	GFileInfo *sniffed_info;
+	MimeCacheKey key;
+	GFileType file_type;
+	gboolean uncertain;
+	gchar *guess;
+
+	g_return_val_if_fail (cache != NULL, NULL);
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+	g_return_val_if_fail (G_IS_FILE_INFO (info), NULL);
+
+	file_type = g_file_info_get_file_type (info);
+
+	if (file_type == G_FILE_TYPE_DIRECTORY) {
+		return g_intern_static_string ("inode/directory");
+	}
+
+	if (file_type == G_FILE_TYPE_REGULAR) {
+		guess = g_content_type_guess (g_file_info_get_name (info),
+		                              NULL, 0, &uncertain);
+
+		if (!uncertain) {
+			content_type = g_intern_string (guess);
+		}
+
+		g_free (guess);
+
+		key.device = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_DEVICE);
+		key.inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+		key.mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+			g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+		g_mutex_lock (&cache->mutex);
+
+		if (content_type) {
+			cache->n_guessed++;
+		} else {
+			entry = g_hash_table_lookup (cache->entries, &key);
+
+			if (entry) {
+				if (entry->age > 0) {
+					entry->age = 0;
+					cache->dirty = TRUE;
+				}
+
+				entry->used = TRUE;
+				content_type = entry->content_type;
+				cache->n_cached++;
+			}
+		}
+
+		g_mutex_unlock (&cache->mutex);
+
+		if (content_type) {
+			return content_type;
+		}
+	}
+
+	/* Let GIO sniff the file contents, other file
+	 * types are resolved without reading the file.
+	 */
+	sniffed_info = g_file_query_info (file,
+	                                  G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE,
+	                                  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                                  cancellable, error);
+	if (!sniffed_info) {
+		return NULL;
+	}
+
+	content_type = g_intern_string (g_file_info_get_content_type (sniffed_info));
+	g_object_unref (sniffed_info);
+
+	if (file_type == G_FILE_TYPE_REGULAR && content_type) {
+		g_mutex_lock (&cache->mutex);
+
+		cache->n_sniffed++;
+
+		if (g_hash_table_size (cache->entries) >= MIME_CACHE_MAX_ENTRIES) {
+			/* Make room, dropping what this run didn't need */
+			mime_cache_drop_unused (cache);
+		}
+
+		if (g_hash_table_size (cache->entries) < MIME_CACHE_MAX_ENTRIES) {
+			g_hash_table_replace (cache->entries,
+			                      mime_cache_key_new (key.device, key.inode, key.mtime),
+			                      mime_cache_entry_new (content_type, 0, TRUE));
+			cache->dirty = TRUE;
+		}
+
+		g_mutex_unlock (&cache->mutex);
+	}
+
+	return content_type;
+}
+
+/**
+ * tracker_mime_cache_get_stats:
+ * @cache: a #TrackerMimeCache
+ * @n_guessed: (out) (allow-none): regular files resolved by name
+ * @n_cached: (out) (allow-none): regular files found in the cache
+ * @n_sniffed: (out) (allow-none): regular files whose contents were read
+ *
+ * Returns how content types of regular files were resolved so far.
+ **/
+void
+tracker_mime_cache_get_stats (TrackerMimeCache *cache,
+                              guint            *n_guessed,
+                              guint            *n_cached,
+                              guint            *n_sniffed)
+{
+	g_return_if_fail (cache != NULL);
+
+	g_mutex_lock (&cache->mutex);
+
+	if (n_guessed)
+		*n_guessed = cache->n_guessed;
+	if (n_cached)
+		*n_cached = cache->n_cached;
+	if (n_sniffed)
+		*n_sniffed = cache->n_sniffed;
+
+	g_mutex_unlock (&cache->mutex);
+}
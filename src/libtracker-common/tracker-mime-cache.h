@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_COMMON_MIME_CACHE_H__
+#define __LIBTRACKER_COMMON_MIME_CACHE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#if !defined (__LIBTRACKER_COMMON_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-common/tracker-common.h> must be included directly."
+#endif
+
+/* Attributes that must be present in the GFileInfo
+ * given to tracker_mime_cache_get_content_type().
+ */
+#define TRACKER_MIME_CACHE_FILE_ATTRIBUTES      \
+	G_FILE_ATTRIBUTE_STANDARD_NAME ","      \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE ","      \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED ","      \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC "," \
+	G_FILE_ATTRIBUTE_UNIX_DEVICE ","        \
+	G_FILE_ATTRIBUTE_UNIX_INODE
+
+typedef struct _TrackerMimeCache TrackerMimeCache;
+
+TrackerMimeCache * tracker_mime_cache_new              (const gchar       *filename);
+void               tracker_mime_cache_free             (TrackerMimeCache  *cache);
+gboolean           tracker_mime_cache_save             (TrackerMimeCache  *cache,
+                                                        GError           **error);
+
+const gchar *      tracker_mime_cache_get_content_type (TrackerMimeCache  *cache,
+                                                        GFile             *file,
+                                                        GFileInfo         *info,
+                                                        GCancellable      *cancellable,
+                                                        GError           **error);
+
+void               tracker_mime_cache_get_stats        (TrackerMimeCache  *cache,
+                                                        guint             *n_guessed,
+                                                        guint             *n_cached,
+                                                        guint             *n_sniffed);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_COMMON_MIME_CACHE_H__ */
@@ -350,6 +350,75 @@ tracker_memory_setrlimits (void)
 	return TRUE;
 }
 
+static guint64
+meminfo_get_value (const gchar *contents,
+                   const gchar *key)
+{
+	const gchar *p;
+
+	p = strstr (contents, key);
+
+	if (!p) {
+		return 0;
+	}
+
+	/* Values are given in kB */
+	return 1024 * (guint64) g_ascii_strtoull (p + strlen (key), NULL, 10);
+}
+
+/* Returns in @available the memory that may still be allocated by
+ * this process, this is the memory available in the system, further
+ * limited by the address space headroom left if there's a limit set
+ * (see tracker_memory_setrlimits()).
+ */
+gboolean
+tracker_memory_get_available (guint64 *available)
+{
+#ifdef __linux__
+	struct rlimit rl = { 0 };
+	gchar *contents = NULL;
+	guint64 value;
+
+	g_return_val_if_fail (available != NULL, FALSE);
+
+	if (!g_file_get_contents ("/proc/meminfo", &contents, NULL, NULL)) {
+		return FALSE;
+	}
+
+	value = meminfo_get_value (contents, "MemAvailable:");
+
+	if (value == 0) {
+		/* Kernels older than 3.14 */
+		value = meminfo_get_value (contents, "MemFree:") +
+			meminfo_get_value (contents, "Cached:");
+	}
+
+	g_free (contents);
+
+	if (value == 0) {
+		return FALSE;
+	}
+
+	if (getrlimit (RLIMIT_AS, &rl) == 0 &&
+	    rl.rlim_cur != RLIM_INFINITY &&
+	    g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL)) {
+		guint64 size, limit;
+
+		/* First field is the address space size in pages */
+		size = g_ascii_strtoull (contents, NULL, 10) * sysconf (_SC_PAGESIZE);
+		limit = rl.rlim_cur;
+		value = MIN (value, limit > size ? limit - size : 0);
+		g_free (contents);
+	}
+
+	*available = value;
+
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
 #ifndef HAVE_STRNLEN
 size_t
 strnlen (const char *str, size_t max)
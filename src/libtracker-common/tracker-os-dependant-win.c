@@ -180,3 +180,9 @@ tracker_memory_setrlimits (void)
 {
 	return TRUE;
 }
+
+gboolean
+tracker_memory_get_available (guint64 *available)
+{
+	return FALSE;
+}
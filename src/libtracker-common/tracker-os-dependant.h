@@ -48,7 +48,8 @@ void     tracker_spawn_child_func          (gpointer      user_data);
 gchar *  tracker_create_permission_string  (struct stat   finfo);
 
 /* Memory limits */
-gboolean tracker_memory_setrlimits (void);
+gboolean tracker_memory_setrlimits    (void);
+gboolean tracker_memory_get_available (guint64 *available);
 
 /* Compatibility functions */
 #ifndef HAVE_STRNLEN
@@ -4024,6 +4024,14 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 		}
 
 		tracker_data_manager_init_fts (iface, FALSE);
+
+#if HAVE_TRACKER_FTS
+		/* Recreate the index if the configured prefix
+		 * index lengths changed since it was created */
+		if (!read_only) {
+			tracker_db_interface_sqlite_fts_update_prefix_index (iface);
+		}
+#endif
 	}
 
 	if (check_ontology) {
@@ -52,6 +52,12 @@
 #define RDF_PROPERTY RDF_PREFIX "Property"
 #define RDF_TYPE RDF_PREFIX "type"
 
+/* FTS segments are merged in small steps while idle, each step
+ * writes at most FTS_MERGE_PAGES pages, merging the levels having
+ * at least FTS_MERGE_MIN_SEGMENTS segments */
+#define FTS_MERGE_PAGES 64
+#define FTS_MERGE_MIN_SEGMENTS 4
+
 typedef struct _TrackerDataUpdateBuffer TrackerDataUpdateBuffer;
 typedef struct _TrackerDataUpdateBufferResource TrackerDataUpdateBufferResource;
 typedef struct _TrackerDataUpdateBufferPredicate TrackerDataUpdateBufferPredicate;
@@ -164,6 +170,7 @@ static GPtrArray *commit_callbacks = NULL;
 static GPtrArray *rollback_callbacks = NULL;
 static gint max_service_id = 0;
 static gint max_ontology_id = 0;
+static gboolean fts_merge_pending = FALSE;
 
 static gint         ensure_resource_id         (const gchar      *uri,
                                                 gboolean         *create);
@@ -960,47 +967,11 @@ tracker_data_resource_buffer_flush (GError **error)
 
 #if HAVE_TRACKER_FTS
 	if (resource_buffer->fts_updated) {
-		TrackerProperty *prop;
-		GArray *values;
-		gboolean create = resource_buffer->create;
-		GPtrArray *properties, *text;
-
-		properties = text = NULL;
-		g_hash_table_iter_init (&iter, resource_buffer->predicates);
-		while (g_hash_table_iter_next (&iter, (gpointer*) &prop, (gpointer*) &values)) {
-			if (tracker_property_get_fulltext_indexed (prop)) {
-				GString *fts;
-
-				fts = g_string_new ("");
-				for (i = 0; i < values->len; i++) {
-					GValue *v = &g_array_index (values, GValue, i);
-					g_string_append (fts, g_value_get_string (v));
-					g_string_append_c (fts, ' ');
-				}
-
-				if (!properties && !text) {
-					properties = g_ptr_array_new ();
-					text = g_ptr_array_new_with_free_func ((GDestroyNotify) g_free);
-				}
-
-				g_ptr_array_add (properties, (gpointer) tracker_property_get_name (prop));
-				g_ptr_array_add (text, g_string_free (fts, FALSE));
-			}
-		}
-
-		if (properties && text) {
-			g_ptr_array_add (properties, NULL);
-			g_ptr_array_add (text, NULL);
-
-			tracker_db_interface_sqlite_fts_update_text (iface,
-			                                             resource_buffer->id,
-			                                             (gchar **) properties->pdata,
-			                                             (gchar **) text->pdata,
-			                                             create);
-			update_buffer.fts_ever_updated = TRUE;
-			g_ptr_array_free (properties, TRUE);
-			g_ptr_array_free (text, TRUE);
-		}
+		/* The text is read back from the property tables, any
+		 * previous row was deleted before they were modified */
+		tracker_db_interface_sqlite_fts_update_text (iface,
+		                                             resource_buffer->id);
+		update_buffer.fts_ever_updated = TRUE;
 	}
 #endif
 }
@@ -1477,21 +1448,15 @@ get_old_property_values (TrackerProperty  *property,
 
 					if (tracker_property_get_fulltext_indexed (prop)
 					    && check_property_domain (prop)) {
-						const gchar *property_name;
-						gint i;
-
-						old_values = get_property_values (prop);
-						property_name = tracker_property_get_name (prop);
-
-						/* delete old fts entries */
-						for (i = 0; i < old_values->len; i++) {
-							tracker_db_interface_sqlite_fts_delete_text (iface,
-							                                             resource_buffer->id,
-							                                             property_name);
-						}
+						get_property_values (prop);
 					}
 				}
 
+				/* delete old fts entries, while the property
+				 * tables still hold the indexed text */
+				tracker_db_interface_sqlite_fts_delete_text (iface,
+				                                             resource_buffer->id);
+
 				update_buffer.fts_ever_updated = TRUE;
 
 				old_values = g_hash_table_lookup (resource_buffer->predicates, property);
@@ -3410,6 +3375,7 @@ tracker_data_commit_transaction (GError **error)
 #if HAVE_TRACKER_FTS
 	if (update_buffer.fts_ever_updated) {
 		update_buffer.fts_ever_updated = FALSE;
+		fts_merge_pending = TRUE;
 	}
 #endif
 
@@ -3422,6 +3388,101 @@ tracker_data_commit_transaction (GError **error)
 	in_journal_replay = FALSE;
 }
 
+gboolean
+tracker_data_fts_merge_pending (void)
+{
+	return fts_merge_pending;
+}
+
+gboolean
+tracker_data_fts_merge_step (GError **error)
+{
+#if HAVE_TRACKER_FTS
+	TrackerDBInterface *iface;
+	GError *actual_error = NULL;
+	gboolean finished = TRUE;
+	gint n_segments, n_levels;
+
+	g_return_val_if_fail (!in_transaction, FALSE);
+
+	if (!fts_merge_pending) {
+		return FALSE;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+
+	tracker_db_interface_start_transaction (iface);
+
+	if (!tracker_db_interface_sqlite_fts_merge (iface,
+	                                            FTS_MERGE_PAGES,
+	                                            FTS_MERGE_MIN_SEGMENTS,
+	                                            &finished)) {
+		finished = TRUE;
+	}
+
+	if (!tracker_db_interface_end_db_transaction (iface, &actual_error)) {
+		tracker_db_interface_execute_query (iface, NULL, "ROLLBACK");
+		g_propagate_error (error, actual_error);
+		finished = TRUE;
+	}
+
+	if (finished) {
+		fts_merge_pending = FALSE;
+
+		if (tracker_db_interface_sqlite_fts_get_segment_count (iface, &n_segments, &n_levels)) {
+			g_debug ("FTS merge finished, %d segments in %d levels",
+			         n_segments, n_levels);
+		}
+	}
+
+	return fts_merge_pending;
+#else
+	return FALSE;
+#endif
+}
+
+void
+tracker_data_fts_optimize (GError **error)
+{
+#if HAVE_TRACKER_FTS
+	TrackerDBInterface *iface;
+	GError *actual_error = NULL;
+	gint n_segments, n_levels;
+
+	g_return_if_fail (!in_transaction);
+
+	iface = tracker_db_manager_get_db_interface ();
+
+	if (tracker_db_interface_sqlite_fts_get_segment_count (iface, &n_segments, &n_levels)) {
+		g_message ("Optimizing FTS index, %d segments in %d levels",
+		           n_segments, n_levels);
+	}
+
+	tracker_db_interface_start_transaction (iface);
+
+	if (!tracker_db_interface_sqlite_fts_optimize (iface)) {
+		tracker_db_interface_execute_query (iface, NULL, "ROLLBACK");
+		g_set_error (error, TRACKER_DB_INTERFACE_ERROR, TRACKER_DB_QUERY_ERROR,
+		             "Could not optimize FTS index");
+		return;
+	}
+
+	if (!tracker_db_interface_end_db_transaction (iface, &actual_error)) {
+		tracker_db_interface_execute_query (iface, NULL, "ROLLBACK");
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	/* Everything is merged at this point */
+	fts_merge_pending = FALSE;
+
+	if (tracker_db_interface_sqlite_fts_get_segment_count (iface, &n_segments, &n_levels)) {
+		g_message ("FTS index optimized, %d segments in %d levels",
+		           n_segments, n_levels);
+	}
+#endif
+}
+
 void
 tracker_data_notify_transaction (TrackerDataCommitType commit_type)
 {
@@ -98,6 +98,9 @@ void     tracker_data_load_turtle_file              (GFile                     *
                                                      GError                   **error);
 
 void     tracker_data_sync                          (void);
+gboolean tracker_data_fts_merge_pending             (void);
+gboolean tracker_data_fts_merge_step                (GError                   **error);
+void     tracker_data_fts_optimize                  (GError                   **error);
 void     tracker_data_replay_journal                (TrackerBusyCallback        busy_callback,
                                                      gpointer                   busy_user_data,
                                                      const gchar               *busy_status,
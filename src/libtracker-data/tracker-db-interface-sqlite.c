@@ -1196,33 +1196,18 @@ tracker_db_interface_sqlite_fts_alter_table (TrackerDBInterface  *db_interface,
 	}
 }
 
+/* The fts table has no content of its own, it reads the text from
+ * fts_view. So rows must be deleted before the property tables are
+ * modified, as the old text is needed to find the index entries to
+ * remove, and inserted again once the new values are in place.
+ */
 gboolean
 tracker_db_interface_sqlite_fts_update_text (TrackerDBInterface  *db_interface,
-                                             int                  id,
-                                             const gchar        **properties,
-                                             const char         **text,
-                                             gboolean             create)
+                                             int                  id)
 {
 	TrackerDBStatement *stmt;
 	GError *error = NULL;
 
-	if (!create) {
-		stmt = tracker_db_interface_create_statement (db_interface,
-							      TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE,
-							      &error,
-							      "DELETE FROM fts WHERE docid=?");
-		tracker_db_statement_bind_int (stmt, 0, id);
-
-		tracker_db_statement_execute (stmt, &error);
-		g_object_unref (stmt);
-
-		if (error) {
-			g_warning ("Could not update FTS text: %s", error->message);
-			g_error_free (error);
-			return FALSE;
-		}
-	}
-
 	stmt = tracker_db_interface_create_statement (db_interface,
 	                                              TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE,
 	                                              &error,
@@ -1253,8 +1238,7 @@ tracker_db_interface_sqlite_fts_update_text (TrackerDBInterface  *db_interface,
 
 gboolean
 tracker_db_interface_sqlite_fts_delete_text (TrackerDBInterface *db_interface,
-                                             int                 id,
-					     const gchar        *property)
+                                             int                 id)
 {
 	TrackerDBStatement *stmt;
 	GError *error = NULL;
@@ -1262,12 +1246,11 @@ tracker_db_interface_sqlite_fts_delete_text (TrackerDBInterface *db_interface,
 	stmt = tracker_db_interface_create_statement (db_interface,
 	                                              TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE,
 	                                              &error,
-	                                              "UPDATE fts SET \"%s\" = '' WHERE docid = ?",
-	                                              property);
+	                                              "DELETE FROM fts WHERE docid = ?");
 
 	if (!stmt || error) {
 		if (error) {
-			g_warning ("Could not create FTS update statement: %s\n",
+			g_warning ("Could not create FTS delete statement: %s\n",
 			           error->message);
 			g_error_free (error);
 		}
@@ -1279,7 +1262,7 @@ tracker_db_interface_sqlite_fts_delete_text (TrackerDBInterface *db_interface,
 	g_object_unref (stmt);
 
 	if (error) {
-		g_warning ("Could not execute FTS update: %s", error->message);
+		g_warning ("Could not delete FTS text: %s", error->message);
 		g_error_free (error);
 		return FALSE;
 	}
@@ -1287,6 +1270,56 @@ tracker_db_interface_sqlite_fts_delete_text (TrackerDBInterface *db_interface,
 	return TRUE;
 }
 
+gboolean
+tracker_db_interface_sqlite_fts_merge (TrackerDBInterface *db_interface,
+                                       gint                n_pages,
+                                       gint                min_segments,
+                                       gboolean           *finished)
+{
+	if (!tracker_fts_merge (db_interface->db, "fts",
+	                        n_pages, min_segments, finished)) {
+		g_warning ("Could not merge FTS segments: %s",
+		           sqlite3_errmsg (db_interface->db));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+gboolean
+tracker_db_interface_sqlite_fts_optimize (TrackerDBInterface *db_interface)
+{
+	if (!tracker_fts_optimize (db_interface->db, "fts")) {
+		g_warning ("Could not optimize FTS index: %s",
+		           sqlite3_errmsg (db_interface->db));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+void
+tracker_db_interface_sqlite_fts_update_prefix_index (TrackerDBInterface *db_interface)
+{
+	gboolean rebuilt;
+
+	if (!tracker_fts_update_prefix_index (db_interface->db, "fts", &rebuilt)) {
+		g_critical ("Failed to update FTS prefix index: %s",
+		            sqlite3_errmsg (db_interface->db));
+	} else if (rebuilt) {
+		g_message ("FTS index rebuilt with the new prefix index");
+	}
+}
+
+gboolean
+tracker_db_interface_sqlite_fts_get_segment_count (TrackerDBInterface *db_interface,
+                                                   gint               *n_segments,
+                                                   gint               *n_levels)
+{
+	return tracker_fts_get_segment_count (db_interface->db, "fts",
+	                                      n_segments, n_levels);
+}
+
 #endif
 
 void
@@ -53,14 +53,18 @@ void                tracker_db_interface_sqlite_fts_alter_table        (TrackerD
                                                                         GHashTable               *properties,
                                                                         GHashTable               *multivalued);
 int                 tracker_db_interface_sqlite_fts_update_text        (TrackerDBInterface       *interface,
-                                                                        int                       id,
-                                                                        const gchar             **properties,
-                                                                        const char              **text,
-                                                                        gboolean                  create);
-
+                                                                        int                       id);
 gboolean            tracker_db_interface_sqlite_fts_delete_text        (TrackerDBInterface       *db_interface,
-									int                       id,
-									const gchar              *property);
+                                                                        int                       id);
+gboolean            tracker_db_interface_sqlite_fts_merge              (TrackerDBInterface       *interface,
+                                                                        gint                      n_pages,
+                                                                        gint                      min_segments,
+                                                                        gboolean                 *finished);
+gboolean            tracker_db_interface_sqlite_fts_optimize           (TrackerDBInterface       *interface);
+void                tracker_db_interface_sqlite_fts_update_prefix_index (TrackerDBInterface      *interface);
+gboolean            tracker_db_interface_sqlite_fts_get_segment_count  (TrackerDBInterface       *interface,
+                                                                        gint                     *n_segments,
+                                                                        gint                     *n_levels);
 void                tracker_db_interface_sqlite_fts_update_commit      (TrackerDBInterface       *interface);
 void                tracker_db_interface_sqlite_fts_update_rollback    (TrackerDBInterface       *interface);
 #endif
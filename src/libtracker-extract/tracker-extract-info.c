@@ -48,6 +48,8 @@ struct _TrackerExtractInfo
 	gchar *mimetype;
 	gchar *graph;
 
+	GCancellable *cancellable;
+
 #ifdef HAVE_LIBMEDIAART
 	MediaArtProcess *media_art_process;
 #endif
@@ -143,6 +145,10 @@ tracker_extract_info_unref (TrackerExtractInfo *info)
 		g_object_unref (info->metadata);
 		g_free (info->where_clause);
 
+		if (info->cancellable) {
+			g_object_unref (info->cancellable);
+		}
+
 		g_slice_free (TrackerExtractInfo, info);
 	}
 }
@@ -305,6 +311,55 @@ tracker_extract_info_set_where_clause (TrackerExtractInfo *info,
 	info->where_clause = g_strdup (where);
 }
 
+/**
+ * tracker_extract_info_get_cancellable:
+ * @info: a #TrackerExtractInfo
+ *
+ * Returns the #GCancellable that gets cancelled once the extraction
+ * deadline of the module is reached. Modules doing lengthy work
+ * should check it every now and then, and stop early, keeping what
+ * was extracted so far.
+ *
+ * Returns: (transfer none) (allow-none): a #GCancellable, or %NULL
+ * if the module has no deadline.
+ *
+ * Since: 1.2
+ **/
+GCancellable *
+tracker_extract_info_get_cancellable (TrackerExtractInfo *info)
+{
+	g_return_val_if_fail (info != NULL, NULL);
+
+	return info->cancellable;
+}
+
+/**
+ * tracker_extract_info_set_cancellable:
+ * @info: a #TrackerExtractInfo
+ * @cancellable: (allow-none): a #GCancellable
+ *
+ * Sets the #GCancellable modules check to stop extraction early.
+ *
+ * Since: 1.2
+ **/
+void
+tracker_extract_info_set_cancellable (TrackerExtractInfo *info,
+                                      GCancellable       *cancellable)
+{
+	g_return_if_fail (info != NULL);
+	g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	if (cancellable) {
+		g_object_ref (cancellable);
+	}
+
+	if (info->cancellable) {
+		g_object_unref (info->cancellable);
+	}
+
+	info->cancellable = cancellable;
+}
+
 #ifdef HAVE_LIBMEDIAART
 
 /**
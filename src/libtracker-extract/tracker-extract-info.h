@@ -53,6 +53,9 @@ TrackerSparqlBuilder *tracker_extract_info_get_metadata_builder   (TrackerExtrac
 const gchar *         tracker_extract_info_get_where_clause       (TrackerExtractInfo *info);
 void                  tracker_extract_info_set_where_clause       (TrackerExtractInfo *info,
                                                                    const gchar        *where);
+GCancellable *        tracker_extract_info_get_cancellable        (TrackerExtractInfo *info);
+void                  tracker_extract_info_set_cancellable        (TrackerExtractInfo *info,
+                                                                   GCancellable       *cancellable);
 
 #ifdef HAVE_LIBMEDIAART
 
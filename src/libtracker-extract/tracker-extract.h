@@ -32,6 +32,7 @@
 #include "tracker-module-manager.h"
 #include "tracker-guarantee.h"
 #include "tracker-iptc.h"
+#include "tracker-segment-scanner.h"
 #include "tracker-utils.h"
 #include "tracker-xmp.h"
 
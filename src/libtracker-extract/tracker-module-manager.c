@@ -27,12 +27,6 @@
 #define INIT_FUNCTION      "tracker_extract_module_init"
 #define SHUTDOWN_FUNCTION  "tracker_extract_module_shutdown"
 
-typedef struct {
-	const gchar *module_path; /* intern string */
-	GList *patterns;
-	GStrv fallback_rdf_types;
-} RuleInfo;
-
 typedef struct {
 	GModule *module;
 	TrackerModuleThreadAwareness thread_awareness;
@@ -42,11 +36,32 @@ typedef struct {
 	guint initialized : 1;
 } ModuleInfo;
 
+typedef struct {
+	const gchar *module_path; /* intern string */
+	GStrv mimetypes;
+	GStrv fallback_rdf_types;
+	guint timeout; /* seconds, 0 if unlimited */
+	ModuleInfo *module_info; /* once loaded */
+	guint load_failed : 1; /* not tried again */
+} RuleInfo;
+
+typedef struct {
+	GPatternSpec *pattern;
+	RuleInfo *rule;
+} WildcardRule;
+
 static GHashTable *modules = NULL;
 static GHashTable *mimetype_map = NULL;
 static gboolean initialized = FALSE;
 static GArray *rules = NULL;
 
+/* Rules compiled once all are loaded, mimetypes without
+ * wildcards are looked up in a hashtable, only the others
+ * are matched one by one.
+ */
+static GHashTable *exact_rules = NULL;
+static GArray *wildcard_rules = NULL;
+
 struct _TrackerMimetypeInfo {
 	const GList *rules;
 	const GList *cur;
@@ -59,7 +74,7 @@ load_extractor_rule (GKeyFile  *key_file,
                      GError   **error)
 {
 	gchar *module_path, **mimetypes;
-	gsize n_mimetypes, i;
+	gsize n_mimetypes;
 	RuleInfo rule = { 0 };
 
 	module_path = g_key_file_get_string (key_file, "ExtractorRule", "ModulePath", error);
@@ -84,28 +99,65 @@ load_extractor_rule (GKeyFile  *key_file,
 	}
 
 	rule.fallback_rdf_types = g_key_file_get_string_list (key_file, "ExtractorRule", "FallbackRdfTypes", NULL, NULL);
+	rule.timeout = MAX (0, g_key_file_get_integer (key_file, "ExtractorRule", "Timeout", NULL));
 
 	/* Construct the rule */
 	rule.module_path = g_intern_string (module_path);
-
-	for (i = 0; i < n_mimetypes; i++) {
-		GPatternSpec *pattern;
-
-		pattern = g_pattern_spec_new (mimetypes[i]);
-		rule.patterns = g_list_prepend (rule.patterns, pattern);
-	}
+	rule.mimetypes = mimetypes;
 
 	if (G_UNLIKELY (!rules)) {
 		rules = g_array_new (FALSE, TRUE, sizeof (RuleInfo));
 	}
 
 	g_array_append_val (rules, rule);
-	g_strfreev (mimetypes);
 	g_free (module_path);
 
 	return TRUE;
 }
 
+/* Must be called once all rules are loaded, as these are
+ * referenced by pointer from here on.
+ */
+static void
+compile_rules (void)
+{
+	guint i, j;
+
+	exact_rules = g_hash_table_new (g_str_hash, g_str_equal);
+	wildcard_rules = g_array_new (FALSE, FALSE, sizeof (WildcardRule));
+
+	for (i = 0; rules && i < rules->len; i++) {
+		RuleInfo *rule;
+
+		rule = &g_array_index (rules, RuleInfo, i);
+
+		for (j = 0; rule->mimetypes[j]; j++) {
+			const gchar *mimetype = rule->mimetypes[j];
+
+			if (strpbrk (mimetype, "*?")) {
+				WildcardRule wildcard;
+
+				wildcard.pattern = g_pattern_spec_new (mimetype);
+				wildcard.rule = rule;
+				g_array_append_val (wildcard_rules, wildcard);
+			} else {
+				GList *list;
+
+				list = g_hash_table_lookup (exact_rules, mimetype);
+
+				if (!g_list_find (list, rule)) {
+					/* Keys are owned by the rule */
+					list = g_list_append (list, rule);
+					g_hash_table_insert (exact_rules, (gpointer) mimetype, list);
+				}
+			}
+		}
+	}
+
+	g_debug ("Compiled extractor rules, %u exact mimetypes and %u patterns",
+	         g_hash_table_size (exact_rules), wildcard_rules->len);
+}
+
 gboolean
 tracker_extract_module_manager_init (void)
 {
@@ -175,6 +227,8 @@ tracker_extract_module_manager_init (void)
 	g_list_free (files);
 	g_dir_close (dir);
 
+	compile_rules ();
+
 	/* Initialize miscellaneous data */
 	mimetype_map = g_hash_table_new_full (g_str_hash,
 	                                      g_str_equal,
@@ -185,49 +239,70 @@ tracker_extract_module_manager_init (void)
 	return TRUE;
 }
 
+static GList *
+add_rule (GList    *list,
+          RuleInfo *rule)
+{
+	/* Lists are short, and rules may match through
+	 * several of their mimetypes.
+	 */
+	if (g_list_find (list, rule)) {
+		return list;
+	}
+
+	return g_list_prepend (list, rule);
+}
+
 static GList *
 lookup_rules (const gchar *mimetype)
 {
-	GList *mimetype_rules = NULL;
-	RuleInfo *info;
+	GList *mimetype_rules = NULL, *exact;
+	gpointer cached;
 	gchar *reversed;
-	gint len, i;
+	gint len;
+	guint i;
 
 	if (!rules) {
 		return NULL;
 	}
 
-	if (mimetype_map) {
-		mimetype_rules = g_hash_table_lookup (mimetype_map, mimetype);
-
-		if (mimetype_rules) {
-			return mimetype_rules;
-		}
+	/* Mimetypes without rules are cached too */
+	if (g_hash_table_lookup_extended (mimetype_map, mimetype, NULL, &cached)) {
+		return cached;
 	}
 
+	exact = g_hash_table_lookup (exact_rules, mimetype);
 	reversed = g_strdup (mimetype);
 	g_strreverse (reversed);
 	len = strlen (mimetype);
 
-	/* Apply the rules! */
-	for (i = 0; i < rules->len; i++) {
-		GList *l;
+	/* Merge exact and wildcard matches in rule order, rules are
+	 * stored in order in the array, so pointers compare the same.
+	 */
+	for (i = 0; i < wildcard_rules->len; i++) {
+		WildcardRule *wildcard;
 
-		info = &g_array_index (rules, RuleInfo, i);
+		wildcard = &g_array_index (wildcard_rules, WildcardRule, i);
 
-		for (l = info->patterns; l; l = l->next) {
-			if (g_pattern_match (l->data, len, mimetype, reversed)) {
-				/* Match, store for future queries and return */
-				mimetype_rules = g_list_prepend (mimetype_rules, info);
-			}
+		if (!g_pattern_match (wildcard->pattern, len, mimetype, reversed)) {
+			continue;
 		}
+
+		while (exact && (RuleInfo *) exact->data < wildcard->rule) {
+			mimetype_rules = add_rule (mimetype_rules, exact->data);
+			exact = exact->next;
+		}
+
+		mimetype_rules = add_rule (mimetype_rules, wildcard->rule);
 	}
 
-	if (mimetype_rules) {
-		mimetype_rules = g_list_reverse (mimetype_rules);
-		g_hash_table_insert (mimetype_map, g_strdup (mimetype), mimetype_rules);
+	for (; exact; exact = exact->next) {
+		mimetype_rules = add_rule (mimetype_rules, exact->data);
 	}
 
+	mimetype_rules = g_list_reverse (mimetype_rules);
+	g_hash_table_insert (mimetype_map, g_strdup (mimetype), mimetype_rules);
+
 	g_free (reversed);
 
 	return mimetype_rules;
@@ -281,9 +356,14 @@ static ModuleInfo *
 load_module (RuleInfo *info,
              gboolean  initialize)
 {
-	ModuleInfo *module_info = NULL;
+	ModuleInfo *module_info = info->module_info;
+
+	if (info->load_failed) {
+		return NULL;
+	}
 
-	if (modules) {
+	if (!module_info && modules) {
+		/* Several rules may point to the same module */
 		module_info = g_hash_table_lookup (modules, info->module_path);
 	}
 
@@ -297,6 +377,7 @@ load_module (RuleInfo *info,
 			g_warning ("Could not load module '%s': %s",
 			           info->module_path,
 			           g_module_error ());
+			info->load_failed = TRUE;
 			return NULL;
 		}
 
@@ -309,6 +390,7 @@ load_module (RuleInfo *info,
 			g_warning ("Could not load module '%s': Function %s() was not found, is it exported?",
 			           g_module_name (module), EXTRACTOR_FUNCTION);
 			g_slice_free (ModuleInfo, module_info);
+			info->load_failed = TRUE;
 			return NULL;
 		}
 
@@ -326,6 +408,8 @@ load_module (RuleInfo *info,
 		g_hash_table_insert (modules, (gpointer) info->module_path, module_info);
 	}
 
+	info->module_info = module_info;
+
 	if (module_info && initialize &&
 	    !module_info->initialized) {
 		if (module_info->init_func) {
@@ -340,6 +424,7 @@ load_module (RuleInfo *info,
 					g_error_free (error);
 				}
 
+				info->load_failed = TRUE;
 				return NULL;
 			}
 		} else {
@@ -420,6 +505,77 @@ tracker_extract_module_manager_mimetype_is_handled (const gchar *mimetype)
 	return mimetype_rules != NULL;
 }
 
+/**
+ * tracker_extract_module_manager_get_module_path:
+ * @mimetype: a mimetype string
+ *
+ * Returns the path of the first module handling @mimetype, as
+ * given by the rule files. Modules are not loaded, this is meant
+ * for processes handing extractions to others.
+ *
+ * Returns: (allow-none): an interned string, or %NULL if no
+ * module handles @mimetype.
+ *
+ * Since: 1.2
+ **/
+const gchar *
+tracker_extract_module_manager_get_module_path (const gchar *mimetype)
+{
+	GList *mimetype_rules;
+	RuleInfo *rule;
+
+	g_return_val_if_fail (mimetype != NULL, NULL);
+
+	if (!initialized &&
+	    !tracker_extract_module_manager_init ()) {
+		return NULL;
+	}
+
+	mimetype_rules = lookup_rules (mimetype);
+
+	if (!mimetype_rules) {
+		return NULL;
+	}
+
+	rule = mimetype_rules->data;
+
+	return rule->module_path;
+}
+
+/**
+ * tracker_extract_module_manager_get_timeout:
+ * @mimetype: a mimetype string
+ *
+ * Returns the time it may take to try all modules handling @mimetype,
+ * as the sum of the Timeout keys of their rule files. Modules are not
+ * loaded.
+ *
+ * Returns: the deadline in seconds, or 0 if there is none.
+ *
+ * Since: 1.2
+ **/
+guint
+tracker_extract_module_manager_get_timeout (const gchar *mimetype)
+{
+	GList *l;
+	guint timeout = 0;
+
+	g_return_val_if_fail (mimetype != NULL, 0);
+
+	if (!initialized &&
+	    !tracker_extract_module_manager_init ()) {
+		return 0;
+	}
+
+	for (l = lookup_rules (mimetype); l; l = l->next) {
+		RuleInfo *rule = l->data;
+
+		timeout += rule->timeout;
+	}
+
+	return timeout;
+}
+
 static gboolean
 initialize_first_module (TrackerMimetypeInfo *info)
 {
@@ -519,6 +675,33 @@ tracker_mimetype_info_get_module (TrackerMimetypeInfo          *info,
 	return info->cur_module_info->module;
 }
 
+/**
+ * tracker_mimetype_info_get_timeout:
+ * @info: a #TrackerMimetypeInfo
+ *
+ * Returns the extraction deadline of the module @info is currently
+ * pointing to, as set through the Timeout key of its rule file.
+ *
+ * Returns: the deadline in seconds, or 0 if there is none.
+ *
+ * Since: 1.2
+ **/
+guint
+tracker_mimetype_info_get_timeout (TrackerMimetypeInfo *info)
+{
+	RuleInfo *rule;
+
+	g_return_val_if_fail (info != NULL, 0);
+
+	if (!info->cur) {
+		return 0;
+	}
+
+	rule = info->cur->data;
+
+	return rule->timeout;
+}
+
 /**
  * tracker_mimetype_info_iter_next:
  * @info: a #TrackerMimetypeInfo
@@ -75,6 +75,8 @@ GModule * tracker_extract_module_manager_get_for_mimetype    (const gchar
                                                               TrackerExtractMetadataFunc   *extract_func);
 
 gboolean  tracker_extract_module_manager_mimetype_is_handled (const gchar                *mimetype);
+const gchar * tracker_extract_module_manager_get_module_path (const gchar *mimetype);
+guint         tracker_extract_module_manager_get_timeout     (const gchar *mimetype);
 
 
 TrackerMimetypeInfo * tracker_extract_module_manager_get_mimetype_handlers  (const gchar *mimetype);
@@ -83,6 +85,7 @@ GStrv                 tracker_extract_module_manager_get_fallback_rdf_types (con
 GModule * tracker_mimetype_info_get_module (TrackerMimetypeInfo          *info,
                                             TrackerExtractMetadataFunc   *extract_func,
                                             TrackerModuleThreadAwareness *thread_awareness);
+guint     tracker_mimetype_info_get_timeout (TrackerMimetypeInfo         *info);
 gboolean  tracker_mimetype_info_iter_next  (TrackerMimetypeInfo          *info);
 void      tracker_mimetype_info_free       (TrackerMimetypeInfo          *info);
 
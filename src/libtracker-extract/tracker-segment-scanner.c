@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "tracker-segment-scanner.h"
+
+/**
+ * SECTION:tracker-segment-scanner
+ * @title: Segment scanner
+ * @short_description: Zero-copy access to image metadata segments
+ * @stability: Stable
+ * @include: libtracker-extract/tracker-extract.h
+ *
+ * Image formats store their metadata (EXIF, XMP, IPTC, comments and
+ * dimensions) in segments that can be found by following the length
+ * of each segment, without decoding any image data.
+ *
+ * #TrackerSegmentScanner maps the file in memory and walks through
+ * these segments, the data is handed as pointers into the mapping,
+ * so it can be fed to tracker_exif_new(), tracker_xmp_new() or
+ * tracker_iptc_new() without any copy. Only the pages actually
+ * holding the segments are read from disk.
+ **/
+
+#define JPEG_SOI        0xD8
+#define JPEG_EOI        0xD9
+#define JPEG_RST0       0xD0
+#define JPEG_RST7       0xD7
+#define JPEG_TEM        0x01
+
+#define GIF_HEADER_SIZE           13
+#define GIF_IMAGE_DESCRIPTOR_SIZE 9
+#define GIF_TRAILER               0x3B
+
+struct _TrackerSegmentScanner {
+	GMappedFile *mapped_file;
+	const guchar *data;
+	gsize length;
+	gsize pos;
+	TrackerSegmentFormat format;
+};
+
+/**
+ * tracker_segment_scanner_new:
+ * @filename: path to a local file
+ * @error: return location for a #GError, or %NULL
+ *
+ * Maps @filename in memory and detects its format from its contents.
+ * Files in formats that are not handled can be scanned as well, but
+ * no segments will be found.
+ *
+ * Returns: (transfer full): a new #TrackerSegmentScanner, or %NULL
+ * if the file could not be mapped.
+ *
+ * Since: 1.2
+ **/
+TrackerSegmentScanner *
+tracker_segment_scanner_new (const gchar  *filename,
+                             GError      **error)
+{
+	TrackerSegmentScanner *scanner;
+	GMappedFile *mapped_file;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	mapped_file = g_mapped_file_new (filename, FALSE, error);
+
+	if (!mapped_file) {
+		return NULL;
+	}
+
+	scanner = g_slice_new0 (TrackerSegmentScanner);
+	scanner->mapped_file = mapped_file;
+	scanner->data = (const guchar *) g_mapped_file_get_contents (mapped_file);
+	scanner->length = g_mapped_file_get_length (mapped_file);
+
+	if (scanner->length >= 2 &&
+	    scanner->data[0] == 0xFF && scanner->data[1] == JPEG_SOI) {
+		scanner->format = TRACKER_SEGMENT_FORMAT_JPEG;
+		scanner->pos = 2;
+	} else if (scanner->length >= GIF_HEADER_SIZE &&
+	           (memcmp (scanner->data, "GIF87a", 6) == 0 ||
+	            memcmp (scanner->data, "GIF89a", 6) == 0)) {
+		scanner->format = TRACKER_SEGMENT_FORMAT_GIF;
+		scanner->pos = GIF_HEADER_SIZE;
+
+		/* Skip the global color table */
+		if (scanner->data[10] & 0x80) {
+			scanner->pos += 3 * (1 << ((scanner->data[10] & 0x07) + 1));
+		}
+	} else {
+		scanner->format = TRACKER_SEGMENT_FORMAT_UNKNOWN;
+		scanner->pos = scanner->length;
+	}
+
+	return scanner;
+}
+
+/**
+ * tracker_segment_scanner_free:
+ * @scanner: a #TrackerSegmentScanner
+ *
+ * Frees @scanner and unmaps the file, the data of the segments
+ * found is no longer valid after this call.
+ *
+ * Since: 1.2
+ **/
+void
+tracker_segment_scanner_free (TrackerSegmentScanner *scanner)
+{
+	g_return_if_fail (scanner != NULL);
+
+	g_mapped_file_unref (scanner->mapped_file);
+	g_slice_free (TrackerSegmentScanner, scanner);
+}
+
+/**
+ * tracker_segment_scanner_get_format:
+ * @scanner: a #TrackerSegmentScanner
+ *
+ * Returns the format detected for the file.
+ *
+ * Returns: a #TrackerSegmentFormat
+ *
+ * Since: 1.2
+ **/
+TrackerSegmentFormat
+tracker_segment_scanner_get_format (TrackerSegmentScanner *scanner)
+{
+	g_return_val_if_fail (scanner != NULL, TRACKER_SEGMENT_FORMAT_UNKNOWN);
+
+	return scanner->format;
+}
+
+static gboolean
+scanner_next_jpeg (TrackerSegmentScanner *scanner,
+                   TrackerSegment        *segment)
+{
+	gsize length;
+	guchar marker;
+
+	while (scanner->pos < scanner->length) {
+		/* Skip garbage between segments, as libjpeg does */
+		while (scanner->pos < scanner->length &&
+		       scanner->data[scanner->pos] != 0xFF) {
+			scanner->pos++;
+		}
+
+		/* Markers may be preceded by any number of fill bytes */
+		while (scanner->pos < scanner->length &&
+		       scanner->data[scanner->pos] == 0xFF) {
+			scanner->pos++;
+		}
+
+		if (scanner->pos >= scanner->length) {
+			return FALSE;
+		}
+
+		marker = scanner->data[scanner->pos++];
+
+		if (marker == JPEG_SOI || marker == JPEG_TEM ||
+		    (marker >= JPEG_RST0 && marker <= JPEG_RST7)) {
+			/* Standalone markers */
+			continue;
+		}
+
+		if (marker == JPEG_EOI || scanner->pos + 2 > scanner->length) {
+			return FALSE;
+		}
+
+		/* The length includes the length field itself */
+		length = scanner->data[scanner->pos] << 8 | scanner->data[scanner->pos + 1];
+
+		if (length < 2 || scanner->pos + length > scanner->length) {
+			return FALSE;
+		}
+
+		segment->type = marker;
+		segment->data = &scanner->data[scanner->pos + 2];
+		segment->length = length - 2;
+
+		if (marker == TRACKER_SEGMENT_JPEG_SOS) {
+			/* Entropy coded data follows, nothing else to scan */
+			scanner->pos = scanner->length;
+		} else {
+			scanner->pos += length;
+		}
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Returns the position of the block terminator of the
+ * data sub-blocks starting at @pos, or 0 if truncated.
+ */
+static gsize
+gif_skip_sub_blocks (TrackerSegmentScanner *scanner,
+                     gsize                  pos)
+{
+	while (pos < scanner->length) {
+		if (scanner->data[pos] == 0) {
+			return pos;
+		}
+
+		pos += scanner->data[pos] + 1;
+	}
+
+	return 0;
+}
+
+static gboolean
+scanner_next_gif (TrackerSegmentScanner *scanner,
+                  TrackerSegment        *segment)
+{
+	gsize start, end;
+	guchar flags;
+
+	if (scanner->pos >= scanner->length) {
+		return FALSE;
+	}
+
+	start = scanner->pos + 1;
+
+	switch (scanner->data[scanner->pos]) {
+	case TRACKER_SEGMENT_GIF_EXTENSION:
+		/* Label, then data sub-blocks */
+		if (start >= scanner->length) {
+			return FALSE;
+		}
+
+		end = gif_skip_sub_blocks (scanner, start + 1);
+
+		if (end == 0) {
+			return FALSE;
+		}
+
+		segment->type = TRACKER_SEGMENT_GIF_EXTENSION;
+		segment->data = &scanner->data[start];
+		segment->length = end - start;
+		scanner->pos = end + 1;
+
+		return TRUE;
+	case TRACKER_SEGMENT_GIF_IMAGE:
+		end = start + GIF_IMAGE_DESCRIPTOR_SIZE;
+
+		if (end >= scanner->length) {
+			return FALSE;
+		}
+
+		/* Skip the local color table */
+		flags = scanner->data[end - 1];
+
+		if (flags & 0x80) {
+			end += 3 * (1 << ((flags & 0x07) + 1));
+		}
+
+		/* Skip the LZW minimum code size and the image data */
+		end = gif_skip_sub_blocks (scanner, end + 1);
+
+		if (end == 0) {
+			return FALSE;
+		}
+
+		segment->type = TRACKER_SEGMENT_GIF_IMAGE;
+		segment->data = &scanner->data[start];
+		segment->length = GIF_IMAGE_DESCRIPTOR_SIZE;
+		scanner->pos = end + 1;
+
+		return TRUE;
+	case GIF_TRAILER:
+	default:
+		return FALSE;
+	}
+}
+
+/**
+ * tracker_segment_scanner_next:
+ * @scanner: a #TrackerSegmentScanner
+ * @segment: (out caller-allocates): return location for the segment
+ *
+ * Fills in @segment with the next segment in the file. For JPEG
+ * files, the start of scan segment is the last one returned, as
+ * image data follows.
+ *
+ * Returns: %TRUE if a segment was found, %FALSE at the end of the
+ * metadata segments or if the file is truncated or corrupt.
+ *
+ * Since: 1.2
+ **/
+gboolean
+tracker_segment_scanner_next (TrackerSegmentScanner *scanner,
+                              TrackerSegment        *segment)
+{
+	gboolean found;
+
+	g_return_val_if_fail (scanner != NULL, FALSE);
+	g_return_val_if_fail (segment != NULL, FALSE);
+
+	switch (scanner->format) {
+	case TRACKER_SEGMENT_FORMAT_JPEG:
+		found = scanner_next_jpeg (scanner, segment);
+		break;
+	case TRACKER_SEGMENT_FORMAT_GIF:
+		found = scanner_next_gif (scanner, segment);
+		break;
+	default:
+		found = FALSE;
+		break;
+	}
+
+	if (!found) {
+		scanner->pos = scanner->length;
+	}
+
+	return found;
+}
+
+/**
+ * tracker_segment_gif_get_data:
+ * @segment: a GIF extension #TrackerSegment
+ * @length: (out) (allow-none): return location for the data length
+ *
+ * Merges the data sub-blocks of a GIF extension, leaving out the
+ * extension label and the sub-block lengths.
+ *
+ * Returns: (transfer full): the nul-terminated extension data,
+ * free with g_free().
+ *
+ * Since: 1.2
+ **/
+gchar *
+tracker_segment_gif_get_data (const TrackerSegment *segment,
+                              gsize                *length)
+{
+	GString *str;
+	gsize pos, len;
+
+	g_return_val_if_fail (segment != NULL, NULL);
+	g_return_val_if_fail (segment->type == TRACKER_SEGMENT_GIF_EXTENSION, NULL);
+
+	str = g_string_sized_new (segment->length);
+
+	/* Skip the extension label */
+	pos = 1;
+
+	while (pos < segment->length) {
+		len = MIN (segment->data[pos], segment->length - pos - 1);
+		g_string_append_len (str, (const gchar *) &segment->data[pos + 1], len);
+		pos += segment->data[pos] + 1;
+	}
+
+	if (length) {
+		*length = str->len;
+	}
+
+	return g_string_free (str, FALSE);
+}
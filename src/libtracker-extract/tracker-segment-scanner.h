@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_EXTRACT_SEGMENT_SCANNER_H__
+#define __LIBTRACKER_EXTRACT_SEGMENT_SCANNER_H__
+
+#if !defined (__LIBTRACKER_EXTRACT_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-extract/tracker-extract.h> must be included directly."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* JPEG markers */
+#define TRACKER_SEGMENT_JPEG_SOF0  0xC0
+#define TRACKER_SEGMENT_JPEG_SOF15 0xCF
+#define TRACKER_SEGMENT_JPEG_DHT   0xC4
+#define TRACKER_SEGMENT_JPEG_JPG   0xC8
+#define TRACKER_SEGMENT_JPEG_DAC   0xCC
+#define TRACKER_SEGMENT_JPEG_SOS   0xDA
+#define TRACKER_SEGMENT_JPEG_APP0  0xE0
+#define TRACKER_SEGMENT_JPEG_COM   0xFE
+
+/* GIF block introducers */
+#define TRACKER_SEGMENT_GIF_EXTENSION  0x21
+#define TRACKER_SEGMENT_GIF_IMAGE      0x2C
+
+/**
+ * TrackerSegmentFormat:
+ * @TRACKER_SEGMENT_FORMAT_UNKNOWN: The file format is not handled.
+ * @TRACKER_SEGMENT_FORMAT_JPEG: JPEG/JFIF/EXIF file, segments are
+ * the markers up to the first scan.
+ * @TRACKER_SEGMENT_FORMAT_GIF: GIF file, segments are the extension
+ * and image descriptor blocks.
+ *
+ * Enumeration of the file formats #TrackerSegmentScanner can scan.
+ *
+ * Since: 1.2
+ */
+typedef enum {
+	TRACKER_SEGMENT_FORMAT_UNKNOWN,
+	TRACKER_SEGMENT_FORMAT_JPEG,
+	TRACKER_SEGMENT_FORMAT_GIF
+} TrackerSegmentFormat;
+
+/**
+ * TrackerSegment:
+ * @type: For JPEG, the marker code (e.g. 0xE1 for APP1). For GIF,
+ * the block introducer (%TRACKER_SEGMENT_GIF_EXTENSION or
+ * %TRACKER_SEGMENT_GIF_IMAGE).
+ * @data: The segment contents. For JPEG, these follow the length
+ * field. For GIF extensions, these start with the extension label,
+ * followed by the data sub-blocks without the block terminator. For
+ * GIF images, this is the image descriptor following the introducer.
+ * @length: The length of @data.
+ *
+ * A segment in the file, @data points into the mapped file and
+ * remains valid as long as the #TrackerSegmentScanner does.
+ *
+ * Since: 1.2
+ */
+typedef struct {
+	guint type;
+	const guchar *data;
+	gsize length;
+} TrackerSegment;
+
+typedef struct _TrackerSegmentScanner TrackerSegmentScanner;
+
+TrackerSegmentScanner * tracker_segment_scanner_new        (const gchar            *filename,
+                                                            GError                **error);
+void                    tracker_segment_scanner_free       (TrackerSegmentScanner  *scanner);
+
+TrackerSegmentFormat    tracker_segment_scanner_get_format (TrackerSegmentScanner  *scanner);
+gboolean                tracker_segment_scanner_next       (TrackerSegmentScanner  *scanner,
+                                                            TrackerSegment         *segment);
+
+gchar *                 tracker_segment_gif_get_data       (const TrackerSegment   *segment,
+                                                            gsize                  *length);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_EXTRACT_SEGMENT_SCANNER_H__ */
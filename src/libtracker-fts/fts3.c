@@ -466,6 +466,7 @@ static int fts3DisconnectMethod(sqlite3_vtab *pVtab){
   sqlite3_free(p->zWriteExprlist);
   sqlite3_free(p->zContentTbl);
   sqlite3_free(p->zLanguageid);
+  sqlite3_free(p->aCheckpoint);
 
   /* Invoke the tokenizer destructor to free the tokenizer. */
   p->pTokenizer->pModule->xDestroy(p->pTokenizer);
@@ -518,6 +519,7 @@ static int fts3DestroyMethod(sqlite3_vtab *pVtab){
   fts3DbExec(&rc, db, "DROP TABLE IF EXISTS %Q.'%q_segdir'", zDb, p->zName);
   fts3DbExec(&rc, db, "DROP TABLE IF EXISTS %Q.'%q_docsize'", zDb, p->zName);
   fts3DbExec(&rc, db, "DROP TABLE IF EXISTS %Q.'%q_stat'", zDb, p->zName);
+  fts3DbExec(&rc, db, "DROP TABLE IF EXISTS %Q.'%q_offsets'", zDb, p->zName);
 
   /* If everything has worked, invoke fts3DisconnectMethod() to free the
   ** memory associated with the Fts3Table structure and return SQLITE_OK.
@@ -590,6 +592,11 @@ void sqlite3Fts3CreateStatTable(int *pRc, Fts3Table *p){
 ** If the p->bHasDocsize boolean is true (indicating that this is an
 ** FTS4 table, not an FTS3 table) then also create the %_docsize and
 ** %_stat tables required by FTS4.
+**
+** If the checkpoint=N option was given, the %_offsets table is created
+** too. It stores the byte offset of every Nth token of each document,
+** so that snippets can be extracted without tokenizing the document
+** text that precedes them.
 */
 static int fts3CreateTables(Fts3Table *p){
   int rc = SQLITE_OK;             /* Return code */
@@ -642,6 +649,12 @@ static int fts3CreateTables(Fts3Table *p){
         p->zDb, p->zName
     );
   }
+  if( p->nCheckpoint ){
+    fts3DbExec(&rc, db, 
+        "CREATE TABLE %Q.'%q_offsets'(docid INTEGER PRIMARY KEY, offsets BLOB);",
+        p->zDb, p->zName
+    );
+  }
   assert( p->bHasStat==p->bFts4 );
   if( p->bHasStat ){
     sqlite3Fts3CreateStatTable(&rc, p);
@@ -1076,6 +1089,7 @@ static int fts3InitVtab(
   /* The results of parsing supported FTS4 key=value options: */
   int bNoDocsize = 0;             /* True to omit %_docsize table */
   int bDescIdx = 0;               /* True to store descending indexes */
+  int nCheckpoint = 0;            /* checkpoint=? parameter (or 0) */
   char *zPrefix = 0;              /* Prefix parameter value (or NULL) */
   char *zCompress = 0;            /* compress=? parameter (or NULL) */
   char *zUncompress = 0;          /* uncompress=? parameter (or NULL) */
@@ -1131,7 +1145,8 @@ static int fts3InitVtab(
         { "uncompress", 10 },     /* 3 -> UNCOMPRESS */
         { "order",       5 },     /* 4 -> ORDER */
         { "content",     7 },     /* 5 -> CONTENT */
-        { "languageid", 10 }      /* 6 -> LANGUAGEID */
+        { "languageid", 10 },     /* 6 -> LANGUAGEID */
+        { "checkpoint", 10 }      /* 7 -> CHECKPOINT */
       };
 
       int iOpt;
@@ -1192,11 +1207,19 @@ static int fts3InitVtab(
               break;
 
             case 6:              /* LANGUAGEID */
-              assert( iOpt==6 );
               sqlite3_free(zLanguageid);
               zLanguageid = zVal;
               zVal = 0;
               break;
+
+            case 7:              /* CHECKPOINT */
+              assert( iOpt==7 );
+              nCheckpoint = atoi(zVal);
+              if( nCheckpoint<1 ){
+                *pzErr = sqlite3_mprintf("invalid checkpoint interval: %s", zVal);
+                rc = SQLITE_ERROR;
+              }
+              break;
           }
         }
         sqlite3_free(zVal);
@@ -1287,6 +1310,7 @@ static int fts3InitVtab(
   p->bHasStat = isFts4;
   p->bFts4 = isFts4;
   p->bDescIdx = bDescIdx;
+  p->nCheckpoint = nCheckpoint;
   p->bAutoincrmerge = 0xff;   /* 0xff means setting unknown */
   p->zContentTbl = zContent;
   p->zLanguageid = zLanguageid;
@@ -3447,6 +3471,12 @@ static int fts3RenameMethod(
       p->zDb, p->zName, zName
     );
   }
+  if( p->nCheckpoint ){
+    fts3DbExec(&rc, db,
+      "ALTER TABLE %Q.'%q_offsets'  RENAME TO '%q_offsets';",
+      p->zDb, p->zName, zName
+    );
+  }
   fts3DbExec(&rc, db,
     "ALTER TABLE %Q.'%q_segments' RENAME TO '%q_segments';",
     p->zDb, p->zName, zName
@@ -203,7 +203,7 @@ struct Fts3Table {
   /* Precompiled statements used by the implementation. Each of these 
   ** statements is run and reset within a single virtual table API call. 
   */
-  sqlite3_stmt *aStmt[37];
+  sqlite3_stmt *aStmt[41];
 
   char *zReadExprlist;
   char *zWriteExprlist;
@@ -213,6 +213,10 @@ struct Fts3Table {
   u8 bHasStat;                    /* True if %_stat table exists */
   u8 bHasDocsize;                 /* True if %_docsize table exists */
   u8 bDescIdx;                    /* True if doclists are in reverse order */
+  int nCheckpoint;                /* Token interval of %_offsets entries or 0 */
+  char *aCheckpoint;              /* Pending %_offsets blob for iPrevDocid */
+  int nCheckpointData;            /* Bytes of valid data in aCheckpoint */
+  int nCheckpointAlloc;           /* Allocated size of aCheckpoint */
   u8 bIgnoreSavepoint;            /* True to ignore xSavepoint invocations */
   int nPgsz;                      /* Page size for host database */
   char *zSegmentsTbl;             /* Name of %_segments table */
@@ -426,6 +430,7 @@ int sqlite3Fts3ReadBlock(Fts3Table*, sqlite3_int64, char **, int*, int*);
 
 int sqlite3Fts3SelectDoctotal(Fts3Table *, sqlite3_stmt **);
 int sqlite3Fts3SelectDocsize(Fts3Table *, sqlite3_int64, sqlite3_stmt **);
+int sqlite3Fts3SelectOffsets(Fts3Table *, sqlite3_int64, sqlite3_stmt **);
 
 #ifndef SQLITE_DISABLE_FTS4_DEFERRED
 void sqlite3Fts3FreeDeferredTokens(Fts3Cursor *);
@@ -593,6 +593,86 @@ static int fts3SnippetShift(
   return SQLITE_OK;
 }
 
+/*
+** If the table has a %_offsets table, use it to find where tokenizing
+** column iCol of the current row may start and stop so that all tokens
+** from position iPos to iPos+2*nSnippet are seen. *piStartPos and
+** *piStartOff are set to the position and byte offset of the last
+** checkpoint at or before iPos, and *piEndOff to the byte offset of
+** the first checkpoint after the snippet, or nDoc if there is none.
+**
+** This keeps the cost of extracting a snippet proportional to the
+** snippet length, instead of to the offset of the snippet within
+** the document.
+*/
+static int fts3SnippetSeek(
+  Fts3Cursor *pCsr,               /* FTS3 Cursor */
+  int iCol,                       /* Column to seek in */
+  int iPos,                       /* First token of snippet */
+  int nSnippet,                   /* Number of tokens in snippet */
+  int nDoc,                       /* Size of column text in bytes */
+  int *piStartPos,                /* OUT: Position to start tokenizing at */
+  int *piStartOff,                /* OUT: Byte offset of *piStartPos */
+  int *piEndOff                   /* OUT: Byte offset to stop tokenizing at */
+){
+  Fts3Table *pTab = (Fts3Table *)pCsr->base.pVtab;
+  sqlite3_stmt *pStmt = 0;
+  const char *a;
+  const char *aEnd;
+  int rc;
+
+  *piStartPos = 0;
+  *piStartOff = 0;
+  *piEndOff = nDoc;
+
+  if( pTab->nCheckpoint==0 ) return SQLITE_OK;
+
+  rc = sqlite3Fts3SelectOffsets(pTab, pCsr->iPrevId, &pStmt);
+  if( rc!=SQLITE_OK || pStmt==0 ) return rc;
+
+  a = (const char *)sqlite3_column_blob(pStmt, 0);
+  aEnd = &a[sqlite3_column_bytes(pStmt, 0)];
+
+  while( a<aEnd ){
+    int iColumn = 0;
+    int nEntry = 0;
+    int iCurPos = 0;
+    int iCurOff = 0;
+    int i;
+
+    a += sqlite3Fts3GetVarint32(a, &iColumn);
+    if( a>=aEnd ) break;
+    a += sqlite3Fts3GetVarint32(a, &nEntry);
+
+    for(i=0; i<nEntry && a<aEnd; i++){
+      int iDelta = 0;
+      a += sqlite3Fts3GetVarint32(a, &iDelta);
+      iCurPos += iDelta;
+      if( a>=aEnd ) break;
+      a += sqlite3Fts3GetVarint32(a, &iDelta);
+      iCurOff += iDelta;
+
+      if( iColumn!=iCol ) continue;
+
+      /* Ignore offsets past the end of the text, the content
+      ** table may have changed since the row was indexed */
+      if( iCurOff>nDoc ) break;
+
+      if( iCurPos<=iPos ){
+        *piStartPos = iCurPos;
+        *piStartOff = iCurOff;
+      }else if( iCurPos>=iPos+2*nSnippet ){
+        *piEndOff = iCurOff;
+        break;
+      }
+    }
+
+    if( iColumn==iCol ) break;
+  }
+
+  return sqlite3_reset(pStmt);
+}
+
 /*
 ** Extract the snippet text for fragment pFragment from cursor pCsr and
 ** append it to string buffer pOut.
@@ -618,6 +698,9 @@ static int fts3SnippetText(
   int iPos = pFragment->iPos;     /* First token of snippet */
   u64 hlmask = pFragment->hlmask; /* Highlight-mask for snippet */
   int iCol = pFragment->iCol+1;   /* Query column to extract text from */
+  int iStartPos = 0;              /* Position of first token tokenized */
+  int iStartOff = 0;              /* Byte offset of first token tokenized */
+  int iEndOff = 0;                /* Byte offset to stop tokenizing at */
   sqlite3_tokenizer_module *pMod; /* Tokenizer module methods object */
   sqlite3_tokenizer_cursor *pC;   /* Tokenizer cursor open on zDoc/nDoc */
   
@@ -630,9 +713,18 @@ static int fts3SnippetText(
   }
   nDoc = sqlite3_column_bytes(pCsr->pStmt, iCol);
 
+  /* Skip the text before and after the snippet if possible */
+  rc = fts3SnippetSeek(pCsr, pFragment->iCol, iPos, nSnippet, nDoc,
+                       &iStartPos, &iStartOff, &iEndOff);
+  if( rc!=SQLITE_OK ){
+    return rc;
+  }
+  iEnd = iStartOff;
+
   /* Open a token cursor on the document. */
   pMod = (sqlite3_tokenizer_module *)pTab->pTokenizer->pModule;
-  rc = sqlite3Fts3OpenTokenizer(pTab->pTokenizer, pCsr->iLangid, zDoc,nDoc,&pC);
+  rc = sqlite3Fts3OpenTokenizer(pTab->pTokenizer, pCsr->iLangid,
+                                &zDoc[iStartOff], iEndOff-iStartOff, &pC);
   if( rc!=SQLITE_OK ){
     return rc;
   }
@@ -662,14 +754,17 @@ static int fts3SnippetText(
         ** of the column. Append any punctuation that occurred between the end
         ** of the previous token and the end of the document to the output. 
         ** Then break out of the loop. */
-        rc = fts3StringAppend(pOut, &zDoc[iEnd], -1);
+        rc = fts3StringAppend(pOut, &zDoc[iEnd], iEndOff-iEnd);
       }
       break;
     }
+    iBegin += iStartOff;
+    iFin += iStartOff;
+    iCurrent += iStartPos;
     if( iCurrent<iPos ){ continue; }
 
     if( !isShiftDone ){
-      int n = nDoc - iBegin;
+      int n = iEndOff - iBegin;
       rc = fts3SnippetShift(
           pTab, pCsr->iLangid, nSnippet, &zDoc[iBegin], n, &iPos, &hlmask
       );
@@ -268,6 +268,11 @@ struct SegmentNode {
 #define SQL_SELECT_INDEXES            35
 #define SQL_SELECT_MXLEVEL            36
 
+#define SQL_DELETE_ALL_OFFSETS        37
+#define SQL_DELETE_OFFSETS            38
+#define SQL_REPLACE_OFFSETS           39
+#define SQL_SELECT_OFFSETS            40
+
 /*
 ** This function is used to obtain an SQLite prepared statement handle
 ** for the statement identified by the second argument. If successful,
@@ -369,7 +374,12 @@ static int fts3SqlStmt(
 
 /* SQL_SELECT_MXLEVEL
 **   Return the largest relative level in the FTS index or indexes.  */
-/* 36 */  "SELECT max( level %% 1024 ) FROM %Q.'%q_segdir'"
+/* 36 */  "SELECT max( level %% 1024 ) FROM %Q.'%q_segdir'",
+
+/* 37 */  "DELETE FROM %Q.'%q_offsets'",
+/* 38 */  "DELETE FROM %Q.'%q_offsets' WHERE docid = ?",
+/* 39 */  "REPLACE INTO %Q.'%q_offsets' VALUES(?,?)",
+/* 40 */  "SELECT offsets FROM %Q.'%q_offsets' WHERE docid=?"
   };
   int rc = SQLITE_OK;
   sqlite3_stmt *pStmt;
@@ -462,6 +472,35 @@ int sqlite3Fts3SelectDocsize(
   return fts3SelectDocsize(pTab, iDocid, ppStmt);
 }
 
+/*
+** Obtain a statement handle positioned on the %_offsets row of document
+** iDocid. Documents with too few tokens for a checkpoint have no row, in
+** which case SQLITE_OK is returned and *ppStmt set to 0. The caller must
+** reset the returned statement.
+*/
+int sqlite3Fts3SelectOffsets(
+  Fts3Table *pTab,                /* Fts3 table handle */
+  sqlite3_int64 iDocid,           /* Docid to read offsets for */
+  sqlite3_stmt **ppStmt           /* OUT: Statement handle */
+){
+  sqlite3_stmt *pStmt = 0;
+  int rc;
+
+  assert( pTab->nCheckpoint>0 );
+  rc = fts3SqlStmt(pTab, SQL_SELECT_OFFSETS, &pStmt, 0);
+  if( rc==SQLITE_OK ){
+    sqlite3_bind_int64(pStmt, 1, iDocid);
+    if( sqlite3_step(pStmt)!=SQLITE_ROW
+     || sqlite3_column_type(pStmt, 0)!=SQLITE_BLOB
+    ){
+      rc = sqlite3_reset(pStmt);
+      pStmt = 0;
+    }
+  }
+  *ppStmt = pStmt;
+  return rc;
+}
+
 /*
 ** Similar to fts3SqlStmt(). Except, after binding the parameters in
 ** array apVal[] to the SQL statement identified by eStmt, the statement
@@ -764,11 +803,49 @@ static int fts3PendingTermsAddOne(
   return rc;
 }
 
+/*
+** Append the varints in aVal[0..nVal-1] to the pending %_offsets blob,
+** at byte offset iOff. Any data already at or after iOff is moved past
+** the appended varints.
+*/
+static int fts3CheckpointInsert(
+  Fts3Table *p,
+  int iOff,
+  sqlite3_int64 *aVal,
+  int nVal
+){
+  char aBuf[4*FTS3_VARINT_MAX];
+  int nBuf = 0;
+  int i;
+
+  assert( nVal<=4 );
+  for(i=0; i<nVal; i++){
+    nBuf += sqlite3Fts3PutVarint(&aBuf[nBuf], aVal[i]);
+  }
+  if( p->nCheckpointData+nBuf>p->nCheckpointAlloc ){
+    int nAlloc = (p->nCheckpointData+nBuf) * 2 + 64;
+    char *aNew = (char *)sqlite3_realloc(p->aCheckpoint, nAlloc);
+    if( !aNew ) return SQLITE_NOMEM;
+    p->aCheckpoint = aNew;
+    p->nCheckpointAlloc = nAlloc;
+  }
+  memmove(&p->aCheckpoint[iOff+nBuf], &p->aCheckpoint[iOff],
+          p->nCheckpointData-iOff);
+  memcpy(&p->aCheckpoint[iOff], aBuf, nBuf);
+  p->nCheckpointData += nBuf;
+  return SQLITE_OK;
+}
+
 /*
 ** Tokenize the nul-terminated string zText and add all tokens to the
 ** pending-terms hash-table. The docid used is that currently stored in
 ** p->iPrevDocid, and the column is specified by argument iCol.
 **
+** If the table has a %_offsets table, the position and byte offset of
+** the first token at or past every p->nCheckpoint positions is also
+** appended to the pending %_offsets blob, as a column number and count
+** followed by delta encoded (position, offset) pairs.
+**
 ** If successful, SQLITE_OK is returned. Otherwise, an SQLite error code.
 */
 static int fts3PendingTermsAdd(
@@ -783,6 +860,12 @@ static int fts3PendingTermsAdd(
   int iEnd = 0;
   int iPos = 0;
   int nWord = 0;
+  int bCheckpoint = (p->nCheckpoint>0 && iCol>=0);
+  int iCheckpointStart = p->nCheckpointData;
+  int nCheckpoint = 0;            /* Checkpoints recorded for this column */
+  int iNextCheckpoint = 0;        /* Position of the next checkpoint */
+  int iPrevPos = 0;               /* Position of the previous checkpoint */
+  int iPrevStart = 0;             /* Offset of the previous checkpoint */
 
   char const *zToken;
   int nToken = 0;
@@ -809,6 +892,7 @@ static int fts3PendingTermsAdd(
   }
 
   xNext = pModule->xNext;
+  iNextCheckpoint = p->nCheckpoint;
   while( SQLITE_OK==rc
       && SQLITE_OK==(rc = xNext(pCsr, &zToken, &nToken, &iStart, &iEnd, &iPos))
   ){
@@ -823,6 +907,18 @@ static int fts3PendingTermsAdd(
       break;
     }
 
+    if( bCheckpoint && iPos>=iNextCheckpoint && iStart>=iPrevStart ){
+      sqlite3_int64 aVal[2];
+      aVal[0] = iPos - iPrevPos;
+      aVal[1] = iStart - iPrevStart;
+      rc = fts3CheckpointInsert(p, p->nCheckpointData, aVal, 2);
+      if( rc!=SQLITE_OK ) break;
+      nCheckpoint++;
+      iPrevPos = iPos;
+      iPrevStart = iStart;
+      iNextCheckpoint = iPos + p->nCheckpoint;
+    }
+
     /* Add the term to the terms index */
     rc = fts3PendingTermsAddOne(
         p, iCol, iPos, &p->aIndex[0].hPending, zToken, nToken
@@ -841,6 +937,14 @@ static int fts3PendingTermsAdd(
 
   pModule->xClose(pCsr);
   *pnWord += nWord;
+
+  if( nCheckpoint>0 && (rc==SQLITE_OK || rc==SQLITE_DONE) ){
+    sqlite3_int64 aVal[2];
+    aVal[0] = iCol;
+    aVal[1] = nCheckpoint;
+    rc = fts3CheckpointInsert(p, iCheckpointStart, aVal, 2);
+  }
+
   return (rc==SQLITE_DONE ? SQLITE_OK : rc);
 }
 
@@ -906,6 +1010,7 @@ static int fts3InsertTerms(
   u32 *aSz
 ){
   int i;                          /* Iterator variable */
+  p->nCheckpointData = 0;
   for(i=2; i<p->nColumn+2; i++){
     const char *zText = (const char *)sqlite3_value_text(apVal[i]);
     int rc = fts3PendingTermsAdd(p, iLangid, zText, i-2, &aSz[i-2]);
@@ -1023,6 +1128,9 @@ static int fts3DeleteAll(Fts3Table *p, int bContent){
   if( p->bHasStat ){
     fts3SqlExec(&rc, p, SQL_DELETE_ALL_STAT, 0);
   }
+  if( p->nCheckpoint ){
+    fts3SqlExec(&rc, p, SQL_DELETE_ALL_OFFSETS, 0);
+  }
   return rc;
 }
 
@@ -3127,6 +3235,32 @@ static void fts3InsertDocsize(
   *pRC = sqlite3_reset(pStmt);
 }
 
+/*
+** Insert the %_offsets blob accumulated while tokenizing the document
+** with docid equal to p->iPrevDocid, if any checkpoint was recorded.
+*/
+static void fts3InsertOffsets(
+  int *pRC,                       /* Result code */
+  Fts3Table *p                    /* Table into which to insert */
+){
+  sqlite3_stmt *pStmt;     /* Statement used to insert the offsets */
+  int rc;                  /* Result code from subfunctions */
+
+  if( *pRC==SQLITE_OK && p->nCheckpointData>0 ){
+    rc = fts3SqlStmt(p, SQL_REPLACE_OFFSETS, &pStmt, 0);
+    if( rc==SQLITE_OK ){
+      sqlite3_bind_int64(pStmt, 1, p->iPrevDocid);
+      sqlite3_bind_blob(pStmt, 2, p->aCheckpoint, p->nCheckpointData,
+                        SQLITE_STATIC);
+      sqlite3_step(pStmt);
+      rc = sqlite3_reset(pStmt);
+      sqlite3_bind_null(pStmt, 2);
+    }
+    *pRC = rc;
+  }
+  p->nCheckpointData = 0;
+}
+
 /*
 ** Record 0 of the %_stat table contains a blob consisting of N varints,
 ** where N is the number of user defined columns in the fts3 table plus
@@ -3294,6 +3428,7 @@ static int fts3DoRebuild(Fts3Table *p){
       int iLangid = langidFromSelect(p, pStmt);
       rc = fts3PendingTermsDocid(p, iLangid, sqlite3_column_int64(pStmt, 0));
       memset(aSz, 0, sizeof(aSz[0]) * (p->nColumn+1));
+      p->nCheckpointData = 0;
       for(iCol=0; rc==SQLITE_OK && iCol<p->nColumn; iCol++){
         const char *z = (const char *) sqlite3_column_text(pStmt, iCol+1);
         rc = fts3PendingTermsAdd(p, iLangid, z, iCol, &aSz[iCol]);
@@ -3302,6 +3437,9 @@ static int fts3DoRebuild(Fts3Table *p){
       if( p->bHasDocsize ){
         fts3InsertDocsize(&rc, p, aSz);
       }
+      if( p->nCheckpoint ){
+        fts3InsertOffsets(&rc, p);
+      }
       if( rc!=SQLITE_OK ){
         sqlite3_finalize(pStmt);
         pStmt = 0;
@@ -5223,6 +5361,9 @@ static int fts3DeleteByRowid(
         if( p->bHasDocsize ){
           fts3SqlExec(&rc, p, SQL_DELETE_DOCSIZE, &pRowid);
         }
+        if( p->nCheckpoint ){
+          fts3SqlExec(&rc, p, SQL_DELETE_OFFSETS, &pRowid);
+        }
       }
     }
   }
@@ -5364,6 +5505,9 @@ int sqlite3Fts3UpdateMethod(
     if( p->bHasDocsize ){
       fts3InsertDocsize(&rc, p, aSzIns);
     }
+    if( p->nCheckpoint ){
+      fts3InsertOffsets(&rc, p);
+    }
     nChng++;
   }
 
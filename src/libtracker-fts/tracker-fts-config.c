@@ -39,6 +39,7 @@
 #define DEFAULT_IGNORE_STOP_WORDS    TRUE
 #define DEFAULT_ENABLE_STEMMER       FALSE  /* As per GB#526346, disabled */
 #define DEFAULT_ENABLE_UNACCENT      TRUE
+#define DEFAULT_PREFIX_INDEX         ""
 
 static void config_set_property         (GObject       *object,
                                          guint          param_id,
@@ -63,6 +64,7 @@ enum {
 
 	/* Performance */
 	PROP_MAX_WORDS_TO_INDEX,
+	PROP_PREFIX_INDEX,
 };
 
 static TrackerConfigMigrationEntry migration[] = {
@@ -133,6 +135,13 @@ tracker_fts_config_class_init (TrackerFTSConfigClass *klass)
 	                                                   G_MAXINT,
 	                                                   DEFAULT_MAX_WORDS_TO_INDEX,
 	                                                   G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_PREFIX_INDEX,
+	                                 g_param_spec_string ("prefix-index",
+	                                                      "Prefix index",
+	                                                      " Comma separated prefix lengths to keep an index for, e.g. \"2,3,4\" (default=\"\")",
+	                                                      DEFAULT_PREFIX_INDEX,
+	                                                      G_PARAM_READWRITE));
 
 }
 
@@ -173,6 +182,10 @@ config_set_property (GObject      *object,
 		tracker_fts_config_set_max_words_to_index (TRACKER_FTS_CONFIG (object),
 		                                           g_value_get_int (value));
 		break;
+	case PROP_PREFIX_INDEX:
+		tracker_fts_config_set_prefix_index (TRACKER_FTS_CONFIG (object),
+		                                     g_value_get_string (value));
+		break;
 
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
@@ -208,6 +221,9 @@ config_get_property (GObject    *object,
 	case PROP_MAX_WORDS_TO_INDEX:
 		g_value_set_int (value, tracker_fts_config_get_max_words_to_index (config));
 		break;
+	case PROP_PREFIX_INDEX:
+		g_value_take_string (value, tracker_fts_config_get_prefix_index (config));
+		break;
 
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
@@ -309,6 +325,14 @@ tracker_fts_config_get_max_words_to_index (TrackerFTSConfig *config)
 	return g_settings_get_int (G_SETTINGS (config), "max-words-to-index");
 }
 
+gchar *
+tracker_fts_config_get_prefix_index (TrackerFTSConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_FTS_CONFIG (config), g_strdup (DEFAULT_PREFIX_INDEX));
+
+	return g_settings_get_string (G_SETTINGS (config), "prefix-index");
+}
+
 void
 tracker_fts_config_set_max_word_length (TrackerFTSConfig *config,
                                         gint              value)
@@ -368,3 +392,13 @@ tracker_fts_config_set_max_words_to_index (TrackerFTSConfig *config,
         g_settings_set_int (G_SETTINGS (config), "max-words-to-index", value);
 	g_object_notify (G_OBJECT (config), "max-words-to-index");
 }
+
+void
+tracker_fts_config_set_prefix_index (TrackerFTSConfig *config,
+                                     const gchar      *value)
+{
+	g_return_if_fail (TRACKER_IS_FTS_CONFIG (config));
+
+        g_settings_set_string (G_SETTINGS (config), "prefix-index", value ? value : "");
+	g_object_notify (G_OBJECT (config), "prefix-index");
+}
@@ -54,6 +54,7 @@ gboolean          tracker_fts_config_get_enable_unaccent    (TrackerFTSConfig *c
 gboolean          tracker_fts_config_get_ignore_numbers     (TrackerFTSConfig *config);
 gboolean          tracker_fts_config_get_ignore_stop_words  (TrackerFTSConfig *config);
 gint              tracker_fts_config_get_max_words_to_index (TrackerFTSConfig *config);
+gchar *           tracker_fts_config_get_prefix_index       (TrackerFTSConfig *config);
 void              tracker_fts_config_set_enable_stemmer     (TrackerFTSConfig *config,
                                                              gboolean          value);
 void              tracker_fts_config_set_enable_unaccent    (TrackerFTSConfig *config,
@@ -66,6 +67,8 @@ void              tracker_fts_config_set_max_words_to_index (TrackerFTSConfig *c
                                                              gint              value);
 void              tracker_fts_config_set_max_word_length    (TrackerFTSConfig *config,
                                                              gint              value);
+void              tracker_fts_config_set_prefix_index       (TrackerFTSConfig *config,
+                                                             const gchar      *value);
 
 G_END_DECLS
 
@@ -20,7 +20,9 @@
  */
 
 #include "config.h"
+#include <string.h>
 #include <sqlite3.h>
+#include "tracker-fts-config.h"
 #include "tracker-fts-tokenizer.h"
 #include "tracker-fts.h"
 
@@ -28,6 +30,13 @@
 #  include "fts3.h"
 #endif
 
+/* Longest prefix we keep an index for, longer prefixes
+ * match few enough terms to do without one */
+#define MAX_PREFIX_LENGTH 16
+
+/* Token interval at which byte offsets are stored for snippets */
+#define SNIPPET_CHECKPOINT_INTERVAL 64
+
 static gchar **property_names;
 
 gboolean
@@ -239,6 +248,67 @@ tracker_fts_init_db (sqlite3 *db,
 	return TRUE;
 }
 
+/* Returns the configured prefix index lengths as expected by the
+ * FTS4 prefix= option, sorted and without duplicates, or NULL if
+ * no prefix index should be created.
+ */
+static gchar *
+fts_get_prefix_option (void)
+{
+	TrackerFTSConfig *config;
+	gboolean lengths[MAX_PREFIX_LENGTH + 1] = { FALSE };
+	gchar **values, *value;
+	GString *str;
+	gint i;
+
+	config = tracker_fts_config_new ();
+	value = tracker_fts_config_get_prefix_index (config);
+	g_object_unref (config);
+
+	values = g_strsplit (value, ",", -1);
+	g_free (value);
+
+	for (i = 0; values[i]; i++) {
+		gchar *end;
+		gint64 length;
+
+		g_strstrip (values[i]);
+
+		if (values[i][0] == '\0') {
+			continue;
+		}
+
+		length = g_ascii_strtoll (values[i], &end, 10);
+
+		if (*end != '\0' || length < 1 || length > MAX_PREFIX_LENGTH) {
+			g_warning ("Ignoring invalid FTS prefix index length '%s'",
+			           values[i]);
+			continue;
+		}
+
+		lengths[length] = TRUE;
+	}
+
+	g_strfreev (values);
+	str = NULL;
+
+	for (i = 1; i <= MAX_PREFIX_LENGTH; i++) {
+		if (!lengths[i]) {
+			continue;
+		}
+
+		if (!str) {
+			str = g_string_new (NULL);
+		} else {
+			g_string_append_c (str, ',');
+		}
+
+		g_string_append_printf (str, "%d", i);
+	}
+
+	return str ? g_string_free (str, FALSE) : NULL;
+}
+
 gboolean
 tracker_fts_create_table (sqlite3    *db,
                           gchar      *table_name,
@@ -247,7 +317,7 @@ tracker_fts_create_table (sqlite3    *db,
 {
 	GString *str, *from, *fts;
 	GHashTableIter iter;
-	gchar *index_table;
+	gchar *index_table, *prefix;
 	GList *columns;
 	gint rc;
 
@@ -297,6 +367,20 @@ tracker_fts_create_table (sqlite3    *db,
 		return FALSE;
 	}
 
+	prefix = fts_get_prefix_option ();
+
+	if (prefix) {
+		g_string_append_printf (fts, "prefix=\"%s\", ", prefix);
+		g_free (prefix);
+	}
+
+#ifndef HAVE_BUILTIN_FTS
+	/* Lets snippet() start tokenizing close to the match,
+	 * instead of at the start of the document */
+	g_string_append_printf (fts, "checkpoint=%d, ",
+	                        SNIPPET_CHECKPOINT_INTERVAL);
+#endif
+
 	g_string_append (fts, "tokenize=TrackerTokenizer)");
 	rc = sqlite3_exec(db, fts->str, NULL, 0, NULL);
 	g_string_free (fts, TRUE);
@@ -358,3 +442,261 @@ tracker_fts_alter_table (sqlite3    *db,
 
 	return TRUE;
 }
+
+/* Returns a copy of the CREATE VIRTUAL TABLE statement in sql with
+ * its prefix= option replaced by the given one, or removed if prefix
+ * is NULL.
+ */
+static gchar *
+fts_replace_prefix_option (const gchar *sql,
+                           const gchar *prefix)
+{
+	const gchar *option, *tokenize;
+	GString *str;
+
+	str = g_string_new (NULL);
+	option = strstr (sql, "prefix=\"");
+
+	if (option) {
+		const gchar *end;
+
+		end = strchr (option + strlen ("prefix=\""), '"');
+
+		if (!end) {
+			g_string_free (str, TRUE);
+			return NULL;
+		}
+
+		end++;
+
+		if (g_str_has_prefix (end, ", ")) {
+			end += 2;
+		}
+
+		g_string_append_len (str, sql, option - sql);
+		g_string_append (str, end);
+	} else {
+		g_string_append (str, sql);
+	}
+
+	tokenize = strstr (str->str, "tokenize=");
+
+	if (!tokenize) {
+		g_string_free (str, TRUE);
+		return NULL;
+	}
+
+	if (prefix) {
+		gchar *option_str;
+
+		option_str = g_strdup_printf ("prefix=\"%s\", ", prefix);
+		g_string_insert (str, tokenize - str->str, option_str);
+		g_free (option_str);
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+static gchar *
+fts_get_table_prefix (const gchar *sql)
+{
+	const gchar *option, *end;
+
+	option = strstr (sql, "prefix=\"");
+
+	if (!option) {
+		return NULL;
+	}
+
+	option += strlen ("prefix=\"");
+	end = strchr (option, '"');
+
+	if (!end || end == option) {
+		return NULL;
+	}
+
+	return g_strndup (option, end - option);
+}
+
+gboolean
+tracker_fts_update_prefix_index (sqlite3    *db,
+                                 gchar      *table_name,
+                                 gboolean   *rebuilt)
+{
+	sqlite3_stmt *stmt;
+	gchar *query, *sql, *current, *prefix;
+	int rc;
+
+	if (rebuilt) {
+		*rebuilt = FALSE;
+	}
+
+	rc = sqlite3_prepare_v2 (db,
+	                         "SELECT sql FROM sqlite_master "
+	                         "WHERE type='table' AND name=?",
+	                         -1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		return FALSE;
+	}
+
+	sqlite3_bind_text (stmt, 1, table_name, -1, SQLITE_STATIC);
+
+	if (sqlite3_step (stmt) != SQLITE_ROW) {
+		sqlite3_finalize (stmt);
+		return FALSE;
+	}
+
+	sql = g_strdup ((const gchar *) sqlite3_column_text (stmt, 0));
+	sqlite3_finalize (stmt);
+
+	current = fts_get_table_prefix (sql);
+	prefix = fts_get_prefix_option ();
+
+	if (g_strcmp0 (current, prefix) == 0) {
+		g_free (current);
+		g_free (prefix);
+		g_free (sql);
+		return TRUE;
+	}
+
+	query = fts_replace_prefix_option (sql, prefix);
+	g_free (sql);
+
+	if (!query) {
+		g_free (current);
+		g_free (prefix);
+		return FALSE;
+	}
+
+	g_message ("FTS prefix index changed from '%s' to '%s', rebuilding index",
+	           current ? current : "", prefix ? prefix : "");
+	g_free (current);
+	g_free (prefix);
+
+	/* The table only holds the index, the text is in fts_view,
+	 * so it can be recreated and rebuilt from there */
+	rc = sqlite3_exec (db, "SAVEPOINT fts_prefix", NULL, NULL, NULL);
+
+	if (rc == SQLITE_OK) {
+		gchar *drop;
+
+		drop = g_strdup_printf ("DROP TABLE %s", table_name);
+		rc = sqlite3_exec (db, drop, NULL, NULL, NULL);
+		g_free (drop);
+	}
+
+	if (rc == SQLITE_OK) {
+		rc = sqlite3_exec (db, query, NULL, NULL, NULL);
+	}
+
+	g_free (query);
+
+	if (rc == SQLITE_OK) {
+		gchar *rebuild;
+
+		rebuild = g_strdup_printf ("INSERT INTO %s(%s) VALUES('rebuild')",
+		                           table_name, table_name);
+		rc = sqlite3_exec (db, rebuild, NULL, NULL, NULL);
+		g_free (rebuild);
+	}
+
+	if (rc != SQLITE_OK) {
+		sqlite3_exec (db, "ROLLBACK TO fts_prefix", NULL, NULL, NULL);
+		sqlite3_exec (db, "RELEASE fts_prefix", NULL, NULL, NULL);
+		return FALSE;
+	}
+
+	rc = sqlite3_exec (db, "RELEASE fts_prefix", NULL, NULL, NULL);
+
+	if (rebuilt) {
+		*rebuilt = (rc == SQLITE_OK);
+	}
+
+	return (rc == SQLITE_OK);
+}
+
+gboolean
+tracker_fts_merge (sqlite3    *db,
+                   gchar      *table_name,
+                   gint        n_pages,
+                   gint        min_segments,
+                   gboolean   *finished)
+{
+	gchar *query;
+	gint changes;
+	int rc;
+
+	changes = sqlite3_total_changes (db);
+
+	/* Incremental merge, writes at most n_pages leaf pages merging
+	 * segments from levels with at least min_segments segments */
+	query = g_strdup_printf ("INSERT INTO %s(%s) VALUES('merge=%d,%d')",
+				 table_name, table_name,
+				 n_pages, min_segments);
+	rc = sqlite3_exec (db, query, NULL, NULL, NULL);
+	g_free (query);
+
+	if (finished) {
+		/* If less than 2 rows changed, there was nothing left
+		 * to merge, as documented for FTS4 */
+		*finished = (rc != SQLITE_OK ||
+		             sqlite3_total_changes (db) - changes < 2);
+	}
+
+	return (rc == SQLITE_OK);
+}
+
+gboolean
+tracker_fts_optimize (sqlite3    *db,
+                      gchar      *table_name)
+{
+	gchar *query;
+	int rc;
+
+	query = g_strdup_printf ("INSERT INTO %s(%s) VALUES('optimize')",
+				 table_name, table_name);
+	rc = sqlite3_exec (db, query, NULL, NULL, NULL);
+	g_free (query);
+
+	return (rc == SQLITE_OK);
+}
+
+gboolean
+tracker_fts_get_segment_count (sqlite3    *db,
+                               gchar      *table_name,
+                               gint       *n_segments,
+                               gint       *n_levels)
+{
+	sqlite3_stmt *stmt;
+	gchar *query;
+	int rc;
+
+	/* Levels are offset by 1024 for each prefix index, just
+	 * count the distinct levels of the main index */
+	query = g_strdup_printf ("SELECT COUNT(*), COUNT(DISTINCT level %% 1024) "
+				 "FROM %s_segdir",
+				 table_name);
+	rc = sqlite3_prepare_v2 (db, query, -1, &stmt, NULL);
+	g_free (query);
+
+	if (rc != SQLITE_OK) {
+		return FALSE;
+	}
+
+	rc = sqlite3_step (stmt);
+
+	if (rc == SQLITE_ROW) {
+		if (n_segments) {
+			*n_segments = sqlite3_column_int (stmt, 0);
+		}
+
+		if (n_levels) {
+			*n_levels = sqlite3_column_int (stmt, 1);
+		}
+	}
+
+	sqlite3_finalize (stmt);
+
+	return (rc == SQLITE_ROW);
+}
@@ -38,6 +38,20 @@ gboolean    tracker_fts_alter_table      (sqlite3    *db,
                                           gchar      *table_name,
                                           GHashTable *tables,
                                           GHashTable *grouped_columns);
+gboolean    tracker_fts_update_prefix_index (sqlite3    *db,
+                                             gchar      *table_name,
+                                             gboolean   *rebuilt);
+gboolean    tracker_fts_merge            (sqlite3    *db,
+                                          gchar      *table_name,
+                                          gint        n_pages,
+                                          gint        min_segments,
+                                          gboolean   *finished);
+gboolean    tracker_fts_optimize         (sqlite3    *db,
+                                          gchar      *table_name);
+gboolean    tracker_fts_get_segment_count (sqlite3    *db,
+                                           gchar      *table_name,
+                                           gint       *n_segments,
+                                           gint       *n_levels);
 
 
 G_END_DECLS
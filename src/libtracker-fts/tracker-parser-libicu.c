@@ -27,6 +27,7 @@
 #include <unicode/utypes.h>
 #include <unicode/ucnv.h>
 #include <unicode/ubrk.h>
+#include <unicode/uloc.h>
 #include <unicode/ustring.h>
 #include <unicode/uchar.h>
 #include <unicode/unorm.h>
@@ -44,6 +45,29 @@ typedef enum {
 /* Max possible length of a UChar encoded string (just a safety limit) */
 #define WORD_BUFFER_LENGTH 512
 
+/* Character classes used by the ASCII fast path. Word characters are
+ * those UAX#29 never breaks between (ALetter, Numeric, ExtendNumLet), the
+ * MID ones only join two letters/numbers at both sides (WB6/7, WB11/12).
+ * SLOW marks bytes that must go through libicu: anything non-ASCII, and
+ * the colon, whose MidLetter behavior depends on the ICU version and
+ * locale tailoring. */
+#define ASCII_LETTER     (1 << 0)
+#define ASCII_DIGIT      (1 << 1)
+#define ASCII_UNDERSCORE (1 << 2)
+#define ASCII_MIDNUMLET  (1 << 3)
+#define ASCII_MIDNUM     (1 << 4)
+#define ASCII_SPACE      (1 << 5)
+#define ASCII_SLOW       (1 << 6)
+
+#define ASCII_WORD       (ASCII_LETTER | ASCII_DIGIT | ASCII_UNDERSCORE)
+
+/* Environment variable to disable the ASCII fast path, mainly useful
+ * to compare against the libicu-only path in tests and benchmarks */
+#define DISABLE_ASCII_FAST_PATH_ENV "TRACKER_PARSER_DISABLE_ASCII_FAST_PATH"
+
+static guint8 ascii_class[256];
+static gchar  ascii_lower[256];
+
 struct TrackerParser {
 	const gchar           *txt;
 	gint                   txt_size;
@@ -62,12 +86,29 @@ struct TrackerParser {
 	gint                   word_length;
 	guint                  word_position;
 
-	/* Text as UChars */
+	/* The input text is processed in runs, each of them either
+	 * handled by the ASCII fast path or by libicu. Runs always
+	 * start after ASCII whitespace, which is a word break in
+	 * any case, so splitting doesn't change the output words. */
+	gboolean               enable_ascii_fast_path;
+	gboolean               locale_ascii_casing;
+	gsize                  run_start;
+	gsize                  run_end;
+	gboolean               run_is_ascii;
+
+	/* Cursor for ASCII runs, as index of the txt array of bytes */
+	gsize                  ascii_cursor;
+
+	/* Text of the current libicu run as UChars */
 	UChar                 *utxt;
 	gint                   utxt_size;
+	gsize                  utxt_allocated;
 	/* Original offset of each UChar in the input txt string */
 	gint32                *offsets;
 
+	/* UTF-8 converter, opened on the first libicu run */
+	UConverter            *converter;
+
 	/* The word-break iterator */
 	UBreakIterator        *bi;
 
@@ -75,6 +116,99 @@ struct TrackerParser {
 	gsize                  cursor;
 };
 
+static void
+ascii_tables_init (void)
+{
+	static gsize initialized = 0;
+
+	if (g_once_init_enter (&initialized)) {
+		guint c;
+
+		for (c = 0; c < 256; c++) {
+			ascii_lower[c] = (gchar) c;
+
+			if (c >= 0x80) {
+				ascii_class[c] = ASCII_SLOW;
+			} else if (g_ascii_isalpha (c)) {
+				ascii_class[c] = ASCII_LETTER;
+				ascii_lower[c] = g_ascii_tolower (c);
+			} else if (g_ascii_isdigit (c)) {
+				ascii_class[c] = ASCII_DIGIT;
+			} else if (g_ascii_isspace (c)) {
+				ascii_class[c] = ASCII_SPACE;
+			}
+		}
+
+		/* Note: the dot is also MidNumLet, but being a forced
+		 * wordbreak it never ends up inside a word */
+		ascii_class['_'] = ASCII_UNDERSCORE;
+		ascii_class['\''] = ASCII_MIDNUMLET;
+		ascii_class[','] = ASCII_MIDNUM;
+		ascii_class[';'] = ASCII_MIDNUM;
+		ascii_class[':'] = ASCII_SLOW;
+
+		g_once_init_leave (&initialized, 1);
+	}
+}
+
+/* Returns TRUE if libicu lowercases ASCII letters the same way the fast
+ * path does in the current locale. Turkic languages map 'I' to a dotless
+ * i, and Lithuanian keeps dots over lowercased i when accents follow, so
+ * these go through libicu for the results not to depend on the path. */
+static gboolean
+locale_has_ascii_casing (void)
+{
+	static const gchar *special_casing[] = { "tr", "az", "lt", NULL };
+	UErrorCode error = U_ZERO_ERROR;
+	gchar language[ULOC_LANG_CAPACITY];
+	gint i;
+
+	uloc_getLanguage (uloc_getDefault (), language, sizeof (language), &error);
+
+	if (U_FAILURE (error)) {
+		return FALSE;
+	}
+
+	for (i = 0; special_casing[i]; i++) {
+		if (strcmp (language, special_casing[i]) == 0) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* Returns TRUE if the whole text can go through the ASCII fast path.
+ * Checks 8 bytes at a time for bytes with the high bit set or colons. */
+static gboolean
+text_is_ascii (const gchar *txt,
+               gsize        txt_size)
+{
+	const guint64 high_bits = G_GUINT64_CONSTANT (0x8080808080808080);
+	const guint64 low_bits = G_GUINT64_CONSTANT (0x0101010101010101);
+	const guint64 colons = G_GUINT64_CONSTANT (0x3A3A3A3A3A3A3A3A);
+	gsize i = 0;
+
+	for (; i + sizeof (guint64) <= txt_size; i += sizeof (guint64)) {
+		guint64 v, x;
+
+		memcpy (&v, &txt[i], sizeof (guint64));
+		x = v ^ colons;
+
+		if ((v | ((x - low_bits) & ~x)) & high_bits) {
+			return FALSE;
+		}
+	}
+
+	for (; i < txt_size; i++) {
+		if (ascii_class[(guchar) txt[i]] & ASCII_SLOW) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
 
 static gboolean
 get_word_info (const UChar           *word,
@@ -253,6 +387,44 @@ convert_UChar_to_utf8 (const UChar *word,
 	return utf8_str;
 }
 
+/* Last steps of the word processing, common to the libicu and ASCII
+ * paths. Takes ownership of the given UTF-8 string. */
+static gchar *
+process_word_utf8 (TrackerParser *parser,
+                   gchar         *utf8_str,
+                   gsize          length,
+                   gboolean      *stop_word)
+{
+	/* Check if stop word */
+	if (parser->ignore_stop_words) {
+		*stop_word = tracker_language_is_stop_word (parser->language,
+		                                            utf8_str);
+	}
+
+	/* Stemming needed? */
+	if (utf8_str &&
+	    parser->enable_stemmer) {
+		gchar *stemmed;
+
+		/* Input for stemmer ALWAYS in UTF-8, as well as output */
+		stemmed = tracker_language_stem_word (parser->language,
+		                                      utf8_str,
+		                                      length);
+
+		/* Log after stemming */
+		tracker_parser_message_hex ("    After stemming",
+		                            stemmed, strlen (stemmed));
+
+		/* If stemmed wanted and succeeded, free previous and return it */
+		if (stemmed) {
+			g_free (utf8_str);
+			return stemmed;
+		}
+	}
+
+	return utf8_str;
+}
+
 static gchar *
 process_word_uchar (TrackerParser         *parser,
                     const UChar           *word,
@@ -355,34 +527,10 @@ process_word_uchar (TrackerParser         *parser,
 	                            utf8_str,
 	                            new_word_length);
 
-	/* Check if stop word */
-	if (parser->ignore_stop_words) {
-		*stop_word = tracker_language_is_stop_word (parser->language,
-		                                            utf8_str);
-	}
-
-	/* Stemming needed? */
-	if (utf8_str &&
-	    parser->enable_stemmer) {
-		gchar *stemmed;
-
-		/* Input for stemmer ALWAYS in UTF-8, as well as output */
-		stemmed = tracker_language_stem_word (parser->language,
-		                                      utf8_str,
-		                                      new_word_length);
-
-		/* Log after stemming */
-		tracker_parser_message_hex ("    After stemming",
-		                            stemmed, strlen (stemmed));
-
-		/* If stemmed wanted and succeeded, free previous and return it */
-		if (stemmed) {
-			g_free (utf8_str);
-			return stemmed;
-		}
-	}
-
-	return utf8_str;
+	return process_word_utf8 (parser,
+	                          utf8_str,
+	                          new_word_length,
+	                          stop_word);
 }
 
 static gboolean
@@ -427,21 +575,16 @@ parser_check_forced_wordbreaks (const UChar *buffer,
 }
 
 static gboolean
-parser_next (TrackerParser *parser,
-             gint          *byte_offset_start,
-             gint          *byte_offset_end,
-             gboolean      *stop_word)
+parser_next_icu (TrackerParser *parser,
+                 gint          *byte_offset_start,
+                 gint          *byte_offset_end,
+                 gboolean      *stop_word)
 {
 	gsize word_length_uchar = 0;
 	gsize word_length_utf8 = 0;
 	gchar *processed_word = NULL;
 	gsize current_word_offset_utf8;
 
-	*byte_offset_start = 0;
-	*byte_offset_end = 0;
-
-	g_return_val_if_fail (parser, FALSE);
-
 	/* Loop to look for next valid word */
 	while (!processed_word &&
 	       parser->cursor < parser->utxt_size) {
@@ -472,7 +615,7 @@ parser_next (TrackerParser *parser,
 		if (next_word_offset_uchar >= parser->utxt_size) {
 			/* Last word support... */
 			next_word_offset_uchar = parser->utxt_size;
-			next_word_offset_utf8 = parser->txt_size;
+			next_word_offset_utf8 = parser->run_end;
 		} else {
 			next_word_offset_utf8 = parser->offsets[next_word_offset_uchar];
 		}
@@ -562,6 +705,317 @@ parser_next (TrackerParser *parser,
 		return TRUE;
 	}
 
+	/* No more words in this run... */
+	return FALSE;
+}
+
+static gboolean
+parser_next_ascii (TrackerParser *parser,
+                   gint          *byte_offset_start,
+                   gint          *byte_offset_end,
+                   gboolean      *stop_word)
+{
+	const guchar *txt = (const guchar *) parser->txt;
+	gsize run_end = parser->run_end;
+	gsize i = parser->ascii_cursor;
+
+	while (i < run_end) {
+		gchar *processed_word;
+		gchar *word;
+		gsize word_start;
+		gsize word_length;
+		guint8 first_class;
+		gsize j;
+
+		/* Skip everything up to the next word start */
+		while (i < run_end && !(ascii_class[txt[i]] & ASCII_WORD)) {
+			i++;
+		}
+
+		if (i == run_end) {
+			break;
+		}
+
+		word_start = i;
+		first_class = ascii_class[txt[i]];
+
+		/* Find the word end, following the UAX#29 rules which
+		 * apply to ASCII input, so that words are the same ones
+		 * libicu would give */
+		for (i++; i < run_end; i++) {
+			guint8 cur = ascii_class[txt[i]];
+
+			if (cur & ASCII_WORD) {
+				continue;
+			}
+
+			/* A MID character followed by a letter/number only
+			 * joins if preceded by the same kind of character */
+			if ((cur & (ASCII_MIDNUMLET | ASCII_MIDNUM)) &&
+			    i + 1 < run_end) {
+				guint8 common = (ascii_class[txt[i - 1]] &
+				                 ascii_class[txt[i + 1]]);
+
+				if ((common & ASCII_DIGIT) ||
+				    ((common & ASCII_LETTER) && (cur & ASCII_MIDNUMLET))) {
+					i++;
+					continue;
+				}
+			}
+
+			break;
+		}
+
+		word_length = i - word_start;
+
+		/* Ignore the word if longer than the maximum allowed */
+		if (word_length >= parser->max_word_length) {
+			continue;
+		}
+
+		/* Ignore the word if not an allowed word start */
+		if ((first_class & ASCII_DIGIT) && parser->ignore_numbers) {
+			continue;
+		}
+
+		/* check if word is reserved */
+		if (parser->ignore_reserved_words &&
+		    tracker_parser_is_reserved_word_utf8 (&parser->txt[word_start],
+		                                          word_length)) {
+			continue;
+		}
+
+		/* Ignore words too long to lowercase, as the libicu path does */
+		if (word_length > WORD_BUFFER_LENGTH) {
+			continue;
+		}
+
+		/* Lowercase, ASCII is already valid UTF-8 */
+		word = g_malloc (word_length + 1);
+		for (j = 0; j < word_length; j++) {
+			word[j] = ascii_lower[txt[word_start + j]];
+		}
+		word[word_length] = '\0';
+
+		processed_word = process_word_utf8 (parser,
+		                                    word,
+		                                    word_length,
+		                                    stop_word);
+		if (!processed_word) {
+			continue;
+		}
+
+		*byte_offset_start = word_start;
+		*byte_offset_end = i;
+
+		parser->ascii_cursor = i;
+		parser->word_length = strlen (processed_word);
+		parser->word = processed_word;
+
+		return TRUE;
+	}
+
+	/* No more words in this run... */
+	parser->ascii_cursor = run_end;
+	return FALSE;
+}
+
+/* Finds the end of the run starting at the given offset. The text is
+ * split in chunks of non-whitespace followed by whitespace, and the run
+ * spans all consecutive chunks of the same kind (ASCII or not). */
+static gsize
+find_run_end (TrackerParser *parser,
+              gsize          start,
+              gboolean      *is_ascii)
+{
+	const guchar *txt = (const guchar *) parser->txt;
+	gsize txt_size = parser->txt_size;
+	gsize i = start;
+
+	*is_ascii = TRUE;
+
+	while (i < txt_size) {
+		gsize chunk_start = i;
+		guint8 chunk_class = 0;
+
+		while (i < txt_size && !(ascii_class[txt[i]] & ASCII_SPACE)) {
+			chunk_class |= ascii_class[txt[i]];
+			i++;
+		}
+
+		while (i < txt_size && (ascii_class[txt[i]] & ASCII_SPACE)) {
+			i++;
+		}
+
+		if (chunk_start == start) {
+			*is_ascii = !(chunk_class & ASCII_SLOW);
+		} else if (*is_ascii == !!(chunk_class & ASCII_SLOW)) {
+			return chunk_start;
+		}
+	}
+
+	return txt_size;
+}
+
+static void
+parser_setup_icu_run (TrackerParser *parser)
+{
+	UErrorCode error = U_ZERO_ERROR;
+	UChar *last_uchar;
+	const gchar *last_utf8;
+	gsize run_size;
+	gint i;
+
+	parser->utxt_size = 0;
+	parser->cursor = 0;
+
+	if (!parser->converter) {
+		/* Open converter UTF-8 to UChar */
+		parser->converter = ucnv_open ("UTF-8", &error);
+		if (!parser->converter) {
+			g_warning ("Cannot open UTF-8 converter: '%s'",
+			           U_FAILURE (error) ? u_errorName (error) : "none");
+			return;
+		}
+	} else {
+		ucnv_reset (parser->converter);
+	}
+
+	/* Allocate UChars and offsets buffers, UTF-16 never needs
+	 * more code units than UTF-8 bytes */
+	run_size = parser->run_end - parser->run_start;
+
+	if (parser->utxt_allocated < run_size + 1) {
+		g_free (parser->utxt);
+		g_free (parser->offsets);
+		parser->utxt_allocated = run_size + 1;
+		parser->utxt = g_malloc (parser->utxt_allocated * sizeof (UChar));
+		parser->offsets = g_malloc (parser->utxt_allocated * sizeof (gint32));
+	}
+
+	/* last_uchar and last_utf8 will be also an output parameter! */
+	last_uchar = parser->utxt;
+	last_utf8 = &parser->txt[parser->run_start];
+
+	/* Convert to UChars storing offsets */
+	ucnv_toUnicode (parser->converter,
+	                &last_uchar,
+	                &parser->utxt[run_size],
+	                &last_utf8,
+	                &parser->txt[parser->run_end],
+	                parser->offsets,
+	                FALSE,
+	                &error);
+
+	if (U_SUCCESS (error)) {
+		/* Proper UChar array size is now given by 'last_uchar' */
+		parser->utxt_size = last_uchar - parser->utxt;
+
+		/* Offsets are given relative to the run start */
+		for (i = 0; i < parser->utxt_size; i++) {
+			parser->offsets[i] += parser->run_start;
+		}
+
+		/* Open word-break iterator, or reuse the one we have */
+		if (!parser->bi) {
+			parser->bi = ubrk_open (UBRK_WORD,
+			                        setlocale (LC_CTYPE, NULL),
+			                        parser->utxt,
+			                        parser->utxt_size,
+			                        &error);
+		} else {
+			ubrk_setText (parser->bi,
+			              parser->utxt,
+			              parser->utxt_size,
+			              &error);
+		}
+
+		if (U_SUCCESS (error)) {
+			/* Find FIRST word in the UChar array */
+			parser->cursor = ubrk_first (parser->bi);
+		}
+	}
+
+	/* If any error happened, skip the run */
+	if (U_FAILURE (error)) {
+		g_warning ("Error initializing libicu support: '%s'",
+		           u_errorName (error));
+		parser->utxt_size = 0;
+		parser->cursor = 0;
+		if (parser->bi) {
+			ubrk_close (parser->bi);
+			parser->bi = NULL;
+		}
+	}
+}
+
+static void
+parser_setup_run (TrackerParser *parser,
+                  gsize          start)
+{
+	parser->run_start = start;
+
+	if (!parser->enable_ascii_fast_path ||
+	    !parser->locale_ascii_casing) {
+		/* Whole text goes through libicu */
+		parser->run_end = parser->txt_size;
+		parser->run_is_ascii = FALSE;
+	} else if (start == 0 &&
+	           text_is_ascii (parser->txt, parser->txt_size)) {
+		/* Most common case, plain ASCII all along */
+		parser->run_end = parser->txt_size;
+		parser->run_is_ascii = TRUE;
+	} else {
+		parser->run_end = find_run_end (parser,
+		                                start,
+		                                &parser->run_is_ascii);
+	}
+
+	if (parser->run_is_ascii) {
+		parser->ascii_cursor = start;
+	} else {
+		parser_setup_icu_run (parser);
+	}
+}
+
+static gboolean
+parser_next (TrackerParser *parser,
+             gint          *byte_offset_start,
+             gint          *byte_offset_end,
+             gboolean      *stop_word)
+{
+	*byte_offset_start = 0;
+	*byte_offset_end = 0;
+
+	g_return_val_if_fail (parser, FALSE);
+
+	while (TRUE) {
+		gboolean found;
+
+		if (parser->run_is_ascii) {
+			found = parser_next_ascii (parser,
+			                           byte_offset_start,
+			                           byte_offset_end,
+			                           stop_word);
+		} else {
+			found = parser_next_icu (parser,
+			                         byte_offset_start,
+			                         byte_offset_end,
+			                         stop_word);
+		}
+
+		if (found) {
+			return TRUE;
+		}
+
+		/* Run finished, go on with the next one if any */
+		if (parser->run_end >= parser->txt_size) {
+			break;
+		}
+
+		parser_setup_run (parser, parser->run_end);
+	}
+
 	/* No more words... */
 	return FALSE;
 }
@@ -573,10 +1027,14 @@ tracker_parser_new (TrackerLanguage *language)
 
 	g_return_val_if_fail (TRACKER_IS_LANGUAGE (language), NULL);
 
+	ascii_tables_init ();
+
 	parser = g_new0 (TrackerParser, 1);
 
 	parser->language = g_object_ref (language);
 
+	parser->enable_ascii_fast_path = (g_getenv (DISABLE_ASCII_FAST_PATH_ENV) == NULL);
+
 	return parser;
 }
 
@@ -593,6 +1051,10 @@ tracker_parser_free (TrackerParser *parser)
 		ubrk_close (parser->bi);
 	}
 
+	if (parser->converter) {
+		ucnv_close (parser->converter);
+	}
+
 	g_free (parser->utxt);
 	g_free (parser->offsets);
 
@@ -612,11 +1074,6 @@ tracker_parser_reset (TrackerParser *parser,
                       gboolean       ignore_reserved_words,
                       gboolean       ignore_numbers)
 {
-	UErrorCode error = U_ZERO_ERROR;
-	UConverter *converter;
-	UChar *last_uchar;
-	const gchar *last_utf8;
-
 	g_return_if_fail (parser != NULL);
 	g_return_if_fail (txt != NULL);
 
@@ -638,79 +1095,22 @@ tracker_parser_reset (TrackerParser *parser,
 	g_free (parser->word);
 	parser->word = NULL;
 
+	/* The locale may have changed since the last text, so the
+	 * iterator is only reused between runs of the same text */
 	if (parser->bi) {
 		ubrk_close (parser->bi);
 		parser->bi = NULL;
 	}
-	g_free (parser->utxt);
-	parser->utxt = NULL;
-	g_free (parser->offsets);
-	parser->offsets = NULL;
 
 	parser->word_position = 0;
 
+	parser->utxt_size = 0;
 	parser->cursor = 0;
 
-	/* Open converter UTF-8 to UChar */
-	converter = ucnv_open ("UTF-8", &error);
-	if (!converter) {
-		g_warning ("Cannot open UTF-8 converter: '%s'",
-		           U_FAILURE (error) ? u_errorName (error) : "none");
-		return;
-	}
-
-	/* Allocate UChars and offsets buffers */
-	parser->utxt_size = txt_size + 1;
-	parser->utxt = g_malloc (parser->utxt_size * sizeof (UChar));
-	parser->offsets = g_malloc (parser->utxt_size * sizeof (gint32));
+	/* Checked on every reset, for the same reason */
+	parser->locale_ascii_casing = locale_has_ascii_casing ();
 
-	/* last_uchar and last_utf8 will be also an output parameter! */
-	last_uchar = parser->utxt;
-	last_utf8 = parser->txt;
-
-	/* Convert to UChars storing offsets */
-	ucnv_toUnicode (converter,
-	                &last_uchar,
-	                &parser->utxt[txt_size],
-	                &last_utf8,
-	                &parser->txt[txt_size],
-	                parser->offsets,
-	                FALSE,
-	                &error);
-	if (U_SUCCESS (error)) {
-		/* Proper UChar array size is now given by 'last_uchar' */
-		parser->utxt_size = last_uchar - parser->utxt;
-
-		/* Open word-break iterator */
-		parser->bi = ubrk_open(UBRK_WORD,
-		                       setlocale (LC_CTYPE, NULL),
-		                       parser->utxt,
-		                       parser->utxt_size,
-		                       &error);
-		if (U_SUCCESS (error)) {
-			/* Find FIRST word in the UChar array */
-			parser->cursor = ubrk_first (parser->bi);
-		}
-	}
-
-	/* If any error happened, reset buffers */
-	if (U_FAILURE (error)) {
-		g_warning ("Error initializing libicu support: '%s'",
-		           u_errorName (error));
-		/* Reset buffers */
-		g_free (parser->utxt);
-		parser->utxt = NULL;
-		g_free (parser->offsets);
-		parser->offsets = NULL;
-		parser->utxt_size = 0;
-		if (parser->bi) {
-			ubrk_close (parser->bi);
-			parser->bi = NULL;
-		}
-	}
-
-	/* Close converter */
-	ucnv_close (converter);
+	parser_setup_run (parser, 0);
 }
 
 const gchar *
@@ -19,6 +19,13 @@
 
 #include "config.h"
 
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include "tracker-crawler.h"
 #include "tracker-utils.h"
 
@@ -36,9 +43,28 @@
  */
 #define FILES_GROUP_SIZE             100
 
+/* Local directories are listed on a pool of worker threads, directories
+ * are queued for listing as soon as they are added to the tree, so
+ * several of them are read concurrently while the main thread checks
+ * the contents of the current one. Directories right past the maximum
+ * depth are listed ahead too, as callers crawling one level at a time
+ * start these next. This is the maximum number of listings that are
+ * kept ahead of the crawl.
+ */
+#define MAX_LISTING_THREADS          8
+#define MAX_PREFETCHED_DIRECTORIES   256
+#define LISTING_BUFFER_SIZE          32768
+
 typedef struct DirectoryChildData DirectoryChildData;
 typedef struct DirectoryProcessingData DirectoryProcessingData;
 typedef struct DirectoryRootInfo DirectoryRootInfo;
+typedef struct DirectoryListing DirectoryListing;
+typedef struct DirectoryListingEntry DirectoryListingEntry;
+
+typedef enum {
+	LISTING_NEEDS_SIZE  = 1 << 0,
+	LISTING_NEEDS_MTIME = 1 << 1
+} ListingFlags;
 
 struct DirectoryChildData {
 	GFile          *child;
@@ -66,10 +92,57 @@ struct DirectoryRootInfo {
 	guint files_ignored;
 };
 
+/* Compact representation of a directory entry, names are
+ * stored contiguously in the listing's name chunk.
+ */
+struct DirectoryListingEntry {
+	guint32 name_offset;
+	guint32 file_type;
+	guint32 mtime_usec;
+	guint64 mtime;
+	guint64 size;
+};
+
+struct DirectoryListing {
+	TrackerCrawler *crawler;
+	gchar *path;
+	guint ref_count;
+	guint flags;
+
+	/* Filled in by the worker thread */
+	GArray *entries;
+	GString *names;
+	GError *error;
+	guint64 dir_mtime;
+	guint64 dir_ctime;
+	volatile gint cancelled;
+
+	/* Set before dispatching a prefetched listing again,
+	 * the worker thread reads it again if it changed.
+	 */
+	gboolean check_stale;
+
+	guint done : 1;
+	guint prefetched : 1;
+	guint lookahead : 1;
+};
+
 struct TrackerCrawlerPrivate {
 	/* Directories to crawl */
 	GQueue         *directories;
 
+	/* Directory listings */
+	GThreadPool    *listing_pool;
+	GHashTable     *listings;
+	GQueue         *prefetched_listings;
+	DirectoryListing *waiting_listing;
+	GMutex          ready_mutex;
+	GList          *ready_listings;
+	guint           ready_id;
+	guint           listing_flags;
+	gboolean        use_listings;
+	gboolean        listings_disabled;
+
 	GList          *cancellables;
 
 	/* Idle handler for processing found data */
@@ -117,8 +190,23 @@ static void     file_enumerate_next     (GFileEnumerator *enumerator,
 static void     file_enumerate_children  (TrackerCrawler          *crawler,
 					  DirectoryRootInfo       *info,
 					  DirectoryProcessingData *dir_data);
+static gboolean file_list_children       (TrackerCrawler          *crawler,
+					  DirectoryRootInfo       *info,
+					  DirectoryProcessingData *dir_data);
 
 static void     directory_root_info_free (DirectoryRootInfo *info);
+static void     directory_listing_unref  (DirectoryListing  *listing);
+static void     directory_listings_cancel (TrackerCrawler   *crawler);
+static void     directory_listings_drop_root (TrackerCrawler *crawler,
+                                              GFile          *root);
+static void     directory_listing_prefetch (TrackerCrawler  *crawler,
+                                            GFile           *file,
+                                            gboolean         lookahead);
+static gboolean directory_listing_consume (TrackerCrawler          *crawler,
+                                           DirectoryRootInfo       *info,
+                                           DirectoryProcessingData *dir_data,
+                                           DirectoryListing        *listing);
+static gboolean process_func_start       (TrackerCrawler    *crawler);
 
 
 static guint signals[LAST_SIGNAL] = { 0, };
@@ -210,6 +298,17 @@ tracker_crawler_init (TrackerCrawler *object)
 	priv = object->priv;
 
 	priv->directories = g_queue_new ();
+
+	priv->listings = g_hash_table_new_full (g_str_hash,
+	                                        g_str_equal,
+	                                        NULL,
+	                                        (GDestroyNotify) directory_listing_unref);
+	priv->prefetched_listings = g_queue_new ();
+	g_mutex_init (&priv->ready_mutex);
+
+	/* Allows comparing against the GIO based enumeration */
+	priv->listings_disabled = g_getenv ("TRACKER_CRAWLER_DISABLE_FAST_PATH") != NULL;
+	priv->use_listings = !priv->listings_disabled;
 }
 
 static void
@@ -227,6 +326,22 @@ crawler_finalize (GObject *object)
 		g_source_remove (priv->idle_id);
 	}
 
+	directory_listings_cancel (TRACKER_CRAWLER (object));
+
+	if (priv->listing_pool) {
+		/* Queued listings return right away once cancelled */
+		g_thread_pool_free (priv->listing_pool, FALSE, TRUE);
+	}
+
+	if (priv->ready_id) {
+		g_source_remove (priv->ready_id);
+	}
+
+	g_list_free_full (priv->ready_listings, (GDestroyNotify) directory_listing_unref);
+	g_hash_table_unref (priv->listings);
+	g_queue_free (priv->prefetched_listings);
+	g_mutex_clear (&priv->ready_mutex);
+
 	g_list_free (priv->cancellables);
 
 	g_queue_foreach (priv->directories, (GFunc) directory_root_info_free, NULL);
@@ -475,8 +590,7 @@ process_func (gpointer data)
 				/* Directory contents haven't been inspected yet,
 				 * stop this idle function while it's being iterated
 				 */
-				file_enumerate_children (crawler, info, dir_data);
-				stop_idle = TRUE;
+				stop_idle = !file_list_children (crawler, info, dir_data);
 			}
 		} else if (dir_data->was_inspected &&
 			   !dir_data->ignored_by_content &&
@@ -509,6 +623,14 @@ process_func (gpointer data)
 
 				child_dir_data = directory_processing_data_new (child_node);
 				g_queue_push_tail (info->directory_processing_queue, child_dir_data);
+
+				directory_listing_prefetch (crawler, child_data->child, FALSE);
+			} else if (priv->is_running &&
+			           child_node && child_data->is_dir) {
+				/* Past the maximum depth, these are most
+				 * likely crawled next, one level at a time.
+				 */
+				directory_listing_prefetch (crawler, child_data->child, TRUE);
 			}
 
 			directory_child_data_free (child_data);
@@ -530,6 +652,7 @@ process_func (gpointer data)
 			       info->files_ignored);
 
 		g_queue_pop_head (priv->directories);
+		directory_listings_drop_root (crawler, info->directory);
 		directory_root_info_free (info);
 	}
 
@@ -598,32 +721,42 @@ enumerator_data_new (TrackerCrawler          *crawler,
 }
 
 static void
-enumerator_data_process (EnumeratorData *ed)
+directory_processing_data_check_contents (TrackerCrawler          *crawler,
+                                          DirectoryProcessingData *dir_data)
 {
-	TrackerCrawler *crawler;
 	GSList *l;
 	GList *children = NULL;
-	gboolean use;
-
-	crawler = ed->crawler;
+	gboolean use = FALSE;
 
-	for (l = ed->dir_info->children; l; l = l->next) {
+	for (l = dir_data->children; l; l = l->next) {
 		DirectoryChildData *child_data;
 
 		child_data = l->data;
 		children = g_list_prepend (children, child_data->child);
 	}
 
-	g_signal_emit (crawler, signals[CHECK_DIRECTORY_CONTENTS], 0, ed->dir_info->node->data, children, &use);
+	g_signal_emit (crawler, signals[CHECK_DIRECTORY_CONTENTS], 0, dir_data->node->data, children, &use);
 	g_list_free (children);
 
+	/* Crawler may have been stopped while waiting for the 'use' value,
+	 * and the DirectoryProcessingData already disposed... */
+	if (!crawler->priv->is_running) {
+		return;
+	}
+
 	if (!use) {
-		ed->dir_info->ignored_by_content = TRUE;
+		dir_data->ignored_by_content = TRUE;
 		/* FIXME: Update stats */
 		return;
 	}
 }
 
+static void
+enumerator_data_process (EnumeratorData *ed)
+{
+	directory_processing_data_check_contents (ed->crawler, ed->dir_info);
+}
+
 static void
 enumerator_data_free (EnumeratorData *ed)
 {
@@ -828,6 +961,614 @@ file_enumerate_children (TrackerCrawler          *crawler,
 	g_free (attrs);
 }
 
+static DirectoryListing *
+directory_listing_new (TrackerCrawler *crawler,
+                       const gchar    *path,
+                       gboolean        prefetched)
+{
+	DirectoryListing *listing;
+
+	listing = g_slice_new0 (DirectoryListing);
+	listing->crawler = crawler;
+	listing->path = g_strdup (path);
+	listing->ref_count = 1;
+	listing->flags = crawler->priv->listing_flags;
+	listing->prefetched = prefetched;
+	listing->entries = g_array_new (FALSE, FALSE, sizeof (DirectoryListingEntry));
+	listing->names = g_string_new (NULL);
+
+	return listing;
+}
+
+static DirectoryListing *
+directory_listing_ref (DirectoryListing *listing)
+{
+	listing->ref_count++;
+	return listing;
+}
+
+static void
+directory_listing_unref (DirectoryListing *listing)
+{
+	if (--listing->ref_count > 0) {
+		return;
+	}
+
+	g_array_free (listing->entries, TRUE);
+	g_string_free (listing->names, TRUE);
+	g_clear_error (&listing->error);
+	g_free (listing->path);
+	g_slice_free (DirectoryListing, listing);
+}
+
+static GFileType
+file_type_from_mode (mode_t mode)
+{
+	if (S_ISREG (mode)) {
+		return G_FILE_TYPE_REGULAR;
+	} else if (S_ISDIR (mode)) {
+		return G_FILE_TYPE_DIRECTORY;
+	} else if (S_ISLNK (mode)) {
+		return G_FILE_TYPE_SYMBOLIC_LINK;
+	}
+
+	return G_FILE_TYPE_SPECIAL;
+}
+
+static GFileType
+file_type_from_dirent (guchar d_type)
+{
+	switch (d_type) {
+	case DT_REG:
+		return G_FILE_TYPE_REGULAR;
+	case DT_DIR:
+		return G_FILE_TYPE_DIRECTORY;
+	case DT_LNK:
+		return G_FILE_TYPE_SYMBOLIC_LINK;
+	case DT_UNKNOWN:
+		return G_FILE_TYPE_UNKNOWN;
+	default:
+		return G_FILE_TYPE_SPECIAL;
+	}
+}
+
+/* Runs in a worker thread */
+static void
+directory_listing_add_entry (DirectoryListing *listing,
+                             gint              dir_fd,
+                             const gchar      *name,
+                             GFileType         file_type)
+{
+	DirectoryListingEntry entry = { 0 };
+
+	if (name[0] == '.' &&
+	    (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+		return;
+	}
+
+	/* Only stat when the type is unknown or more is needed,
+	 * symlinks are not followed, as GIO does with
+	 * G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS.
+	 */
+	if (listing->flags != 0 || file_type == G_FILE_TYPE_UNKNOWN) {
+#ifdef HAVE_STATX
+		struct statx st;
+
+		if (statx (dir_fd, name,
+		           AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT,
+		           STATX_TYPE | STATX_MTIME | STATX_SIZE,
+		           &st) != 0) {
+			/* Most likely removed meanwhile */
+			return;
+		}
+
+		file_type = file_type_from_mode (st.stx_mode);
+		entry.size = st.stx_size;
+		entry.mtime = st.stx_mtime.tv_sec;
+		entry.mtime_usec = st.stx_mtime.tv_nsec / 1000;
+#else
+		struct stat st;
+
+		if (fstatat (dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+			/* Most likely removed meanwhile */
+			return;
+		}
+
+		file_type = file_type_from_mode (st.st_mode);
+		entry.size = st.st_size;
+		entry.mtime = st.st_mtim.tv_sec;
+		entry.mtime_usec = st.st_mtim.tv_nsec / 1000;
+#endif
+	}
+
+	entry.name_offset = listing->names->len;
+	entry.file_type = file_type;
+	g_string_append_len (listing->names, name, strlen (name) + 1);
+	g_array_append_val (listing->entries, entry);
+}
+
+/* Runs in a worker thread */
+static void
+directory_listing_read (DirectoryListing *listing)
+{
+	struct stat st;
+	gint fd, errsv = 0;
+
+	fd = open (listing->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (fd < 0) {
+		errsv = errno;
+		listing->error = g_error_new (G_IO_ERROR,
+		                              g_io_error_from_errno (errsv),
+		                              "%s", g_strerror (errsv));
+		return;
+	}
+
+	/* Used to tell whether a prefetched listing is still current */
+	if (fstat (fd, &st) == 0) {
+		listing->dir_mtime = (guint64) st.st_mtim.tv_sec * G_GUINT64_CONSTANT (1000000000) + st.st_mtim.tv_nsec;
+		listing->dir_ctime = (guint64) st.st_ctim.tv_sec * G_GUINT64_CONSTANT (1000000000) + st.st_ctim.tv_nsec;
+	}
+
+#ifdef HAVE_GETDENTS64
+	{
+		gchar *buffer;
+		gssize len;
+
+		buffer = g_malloc (LISTING_BUFFER_SIZE);
+
+		while ((len = getdents64 (fd, buffer, LISTING_BUFFER_SIZE)) > 0 &&
+		       !g_atomic_int_get (&listing->cancelled)) {
+			gssize pos = 0;
+
+			while (pos < len) {
+				struct dirent64 *dirent;
+
+				dirent = (struct dirent64 *) (buffer + pos);
+				directory_listing_add_entry (listing, fd,
+				                             dirent->d_name,
+				                             file_type_from_dirent (dirent->d_type));
+				pos += dirent->d_reclen;
+			}
+		}
+
+		if (len < 0) {
+			errsv = errno;
+		}
+
+		g_free (buffer);
+		close (fd);
+	}
+#else
+	{
+		struct dirent *dirent;
+		DIR *dir;
+
+		dir = fdopendir (fd);
+
+		if (!dir) {
+			errsv = errno;
+			close (fd);
+		} else {
+			errno = 0;
+
+			while ((dirent = readdir (dir)) != NULL &&
+			       !g_atomic_int_get (&listing->cancelled)) {
+#ifdef _DIRENT_HAVE_D_TYPE
+				directory_listing_add_entry (listing, fd,
+				                             dirent->d_name,
+				                             file_type_from_dirent (dirent->d_type));
+#else
+				directory_listing_add_entry (listing, fd,
+				                             dirent->d_name,
+				                             G_FILE_TYPE_UNKNOWN);
+#endif
+				errno = 0;
+			}
+
+			errsv = errno;
+			closedir (dir);
+		}
+	}
+#endif
+
+	if (errsv != 0) {
+		listing->error = g_error_new (G_IO_ERROR,
+		                              g_io_error_from_errno (errsv),
+		                              "%s", g_strerror (errsv));
+	}
+}
+
+/* Runs in a worker thread */
+static gboolean
+directory_listing_is_stale (DirectoryListing *listing)
+{
+	struct stat st;
+	guint64 mtime, ctime;
+
+	if (stat (listing->path, &st) != 0) {
+		return TRUE;
+	}
+
+	mtime = (guint64) st.st_mtim.tv_sec * G_GUINT64_CONSTANT (1000000000) + st.st_mtim.tv_nsec;
+	ctime = (guint64) st.st_ctim.tv_sec * G_GUINT64_CONSTANT (1000000000) + st.st_ctim.tv_nsec;
+
+	return mtime != listing->dir_mtime || ctime != listing->dir_ctime;
+}
+
+static gboolean
+directory_listings_ready_cb (gpointer user_data)
+{
+	TrackerCrawler *crawler;
+	TrackerCrawlerPrivate *priv;
+	DirectoryListing *listing;
+	GList *ready, *l;
+	gboolean resume = FALSE;
+
+	crawler = user_data;
+	priv = crawler->priv;
+
+	g_mutex_lock (&priv->ready_mutex);
+	ready = priv->ready_listings;
+	priv->ready_listings = NULL;
+	priv->ready_id = 0;
+	g_mutex_unlock (&priv->ready_mutex);
+
+	for (l = ready; l; l = l->next) {
+		listing = l->data;
+		listing->done = TRUE;
+
+		if (listing == priv->waiting_listing) {
+			resume = TRUE;
+		}
+
+		/* Drop the reference held by the worker thread */
+		directory_listing_unref (listing);
+	}
+
+	g_list_free (ready);
+
+	if (resume) {
+		DirectoryRootInfo *info;
+		DirectoryProcessingData *dir_data;
+
+		listing = priv->waiting_listing;
+		priv->waiting_listing = NULL;
+
+		info = g_queue_peek_head (priv->directories);
+		dir_data = g_queue_peek_head (info->directory_processing_queue);
+
+		if (directory_listing_consume (crawler, info, dir_data, listing)) {
+			/* Continue with queued files/directories */
+			process_func_start (crawler);
+		}
+	}
+
+	return FALSE;
+}
+
+static void
+directory_listing_thread_func (gpointer data,
+                               gpointer user_data)
+{
+	DirectoryListing *listing = data;
+	TrackerCrawlerPrivate *priv;
+
+	priv = listing->crawler->priv;
+
+	if (g_atomic_int_get (&listing->cancelled)) {
+		/* Nothing to do */
+	} else if (!listing->check_stale) {
+		directory_listing_read (listing);
+	} else if (directory_listing_is_stale (listing)) {
+		/* The directory changed since it was listed */
+		g_array_set_size (listing->entries, 0);
+		g_string_truncate (listing->names, 0);
+		g_clear_error (&listing->error);
+		directory_listing_read (listing);
+	}
+
+	g_mutex_lock (&priv->ready_mutex);
+	priv->ready_listings = g_list_prepend (priv->ready_listings, listing);
+
+	if (priv->ready_id == 0) {
+		priv->ready_id = g_idle_add (directory_listings_ready_cb,
+		                             listing->crawler);
+	}
+
+	g_mutex_unlock (&priv->ready_mutex);
+}
+
+static void
+directory_listing_dispatch (TrackerCrawler   *crawler,
+                            DirectoryListing *listing)
+{
+	TrackerCrawlerPrivate *priv;
+
+	priv = crawler->priv;
+
+	if (!priv->listing_pool) {
+		priv->listing_pool = g_thread_pool_new (directory_listing_thread_func,
+		                                        NULL,
+		                                        MAX_LISTING_THREADS,
+		                                        FALSE,
+		                                        NULL);
+	}
+
+	/* The worker thread holds a reference until
+	 * directory_listings_ready_cb() is called.
+	 */
+	g_thread_pool_push (priv->listing_pool,
+	                    directory_listing_ref (listing),
+	                    NULL);
+}
+
+static gchar *
+directory_listing_get_path (TrackerCrawler *crawler,
+                            GFile          *file)
+{
+	if (!crawler->priv->use_listings ||
+	    !g_file_is_native (file)) {
+		return NULL;
+	}
+
+	return g_file_get_path (file);
+}
+
+static void
+directory_listing_prefetch (TrackerCrawler *crawler,
+                            GFile          *file,
+                            gboolean        lookahead)
+{
+	TrackerCrawlerPrivate *priv;
+	DirectoryListing *listing;
+	gchar *path;
+
+	priv = crawler->priv;
+
+	if (g_hash_table_size (priv->listings) >= MAX_PREFETCHED_DIRECTORIES) {
+		listing = g_queue_peek_head (priv->prefetched_listings);
+
+		/* Listings past the maximum depth might never be
+		 * consumed, the oldest one makes room for new ones.
+		 */
+		if (!listing || !listing->lookahead) {
+			return;
+		}
+
+		g_atomic_int_set (&listing->cancelled, TRUE);
+		g_queue_pop_head (priv->prefetched_listings);
+		g_hash_table_remove (priv->listings, listing->path);
+	}
+
+	path = directory_listing_get_path (crawler, file);
+
+	if (!path) {
+		return;
+	}
+
+	if (!g_hash_table_contains (priv->listings, path)) {
+		listing = directory_listing_new (crawler, path, TRUE);
+		listing->lookahead = lookahead;
+		g_hash_table_insert (priv->listings, listing->path, listing);
+		g_queue_push_tail (priv->prefetched_listings, listing);
+		directory_listing_dispatch (crawler, listing);
+	}
+
+	g_free (path);
+}
+
+static void
+directory_listings_cancel (TrackerCrawler *crawler)
+{
+	TrackerCrawlerPrivate *priv;
+	GList *l;
+
+	priv = crawler->priv;
+
+	for (l = priv->prefetched_listings->head; l; l = l->next) {
+		DirectoryListing *listing = l->data;
+
+		g_atomic_int_set (&listing->cancelled, TRUE);
+	}
+
+	g_queue_clear (priv->prefetched_listings);
+	g_hash_table_remove_all (priv->listings);
+
+	if (priv->waiting_listing) {
+		g_atomic_int_set (&priv->waiting_listing->cancelled, TRUE);
+		directory_listing_unref (priv->waiting_listing);
+		priv->waiting_listing = NULL;
+	}
+}
+
+/* Drops the listings done ahead within a root that was just
+ * crawled, as nothing is going to consume these anymore. Those
+ * past the maximum depth are kept for the crawls that follow.
+ */
+static void
+directory_listings_drop_root (TrackerCrawler *crawler,
+                              GFile          *root)
+{
+	TrackerCrawlerPrivate *priv;
+	gchar *root_path;
+	GList *l, *next;
+	gsize len;
+
+	priv = crawler->priv;
+	root_path = directory_listing_get_path (crawler, root);
+
+	if (!root_path) {
+		return;
+	}
+
+	len = strlen (root_path);
+
+	for (l = priv->prefetched_listings->head; l; l = next) {
+		DirectoryListing *listing = l->data;
+
+		next = l->next;
+
+		if (listing->lookahead) {
+			continue;
+		}
+
+		if (strncmp (listing->path, root_path, len) != 0 ||
+		    (listing->path[len] != '\0' &&
+		     listing->path[len] != G_DIR_SEPARATOR &&
+		     root_path[len - 1] != G_DIR_SEPARATOR)) {
+			continue;
+		}
+
+		g_atomic_int_set (&listing->cancelled, TRUE);
+		g_queue_delete_link (priv->prefetched_listings, l);
+		g_hash_table_remove (priv->listings, listing->path);
+	}
+
+	g_free (root_path);
+}
+
+static GFileInfo *
+directory_listing_entry_create_file_info (DirectoryListing      *listing,
+                                          DirectoryListingEntry *entry)
+{
+	GFileInfo *info;
+
+	info = g_file_info_new ();
+	g_file_info_set_name (info, &listing->names->str[entry->name_offset]);
+	g_file_info_set_file_type (info, entry->file_type);
+
+	if (listing->flags & LISTING_NEEDS_SIZE) {
+		g_file_info_set_size (info, entry->size);
+	}
+
+	if (listing->flags & LISTING_NEEDS_MTIME) {
+		g_file_info_set_attribute_uint64 (info,
+		                                  G_FILE_ATTRIBUTE_TIME_MODIFIED,
+		                                  entry->mtime);
+		g_file_info_set_attribute_uint32 (info,
+		                                  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+		                                  entry->mtime_usec);
+	}
+
+	return info;
+}
+
+/* Returns %FALSE if the listing is still to be finished,
+ * directory_listings_ready_cb() will call this again.
+ */
+static gboolean
+directory_listing_consume (TrackerCrawler          *crawler,
+                           DirectoryRootInfo       *info,
+                           DirectoryProcessingData *dir_data,
+                           DirectoryListing        *listing)
+{
+	TrackerCrawlerPrivate *priv;
+	GFile *parent;
+	guint i;
+
+	priv = crawler->priv;
+
+	if (!listing->done) {
+		priv->waiting_listing = listing;
+		return FALSE;
+	}
+
+	if (listing->flags != priv->listing_flags) {
+		DirectoryListing *fresh;
+
+		/* The listing lacks some of the file attributes */
+		fresh = directory_listing_new (crawler, listing->path, FALSE);
+		directory_listing_unref (listing);
+		directory_listing_dispatch (crawler, fresh);
+		priv->waiting_listing = fresh;
+		return FALSE;
+	}
+
+	if (listing->prefetched) {
+		/* Have a worker thread check whether the directory
+		 * changed since it was listed, so the main thread
+		 * doesn't block on stat().
+		 */
+		listing->prefetched = FALSE;
+		listing->done = FALSE;
+		listing->check_stale = TRUE;
+		directory_listing_dispatch (crawler, listing);
+		priv->waiting_listing = listing;
+		return FALSE;
+	}
+
+	parent = dir_data->node->data;
+
+	if (listing->error) {
+		g_warning ("Could not open directory '%s': %s",
+		           listing->path, listing->error->message);
+		directory_listing_unref (listing);
+		return TRUE;
+	}
+
+	for (i = 0; i < listing->entries->len; i++) {
+		DirectoryListingEntry *entry;
+		GFile *child;
+
+		entry = &g_array_index (listing->entries, DirectoryListingEntry, i);
+		child = g_file_get_child (parent, &listing->names->str[entry->name_offset]);
+
+		if (priv->file_attributes) {
+			/* Store the file info for future retrieval */
+			g_object_set_qdata_full (G_OBJECT (child),
+			                         file_info_quark,
+			                         directory_listing_entry_create_file_info (listing, entry),
+			                         (GDestroyNotify) g_object_unref);
+		}
+
+		directory_processing_data_add_child (dir_data, child,
+		                                     entry->file_type == G_FILE_TYPE_DIRECTORY);
+		g_object_unref (child);
+	}
+
+	directory_listing_unref (listing);
+	directory_processing_data_check_contents (crawler, dir_data);
+
+	return TRUE;
+}
+
+/* Returns %FALSE if the directory contents are being enumerated
+ * asynchronously, process_func_start() is called when done.
+ */
+static gboolean
+file_list_children (TrackerCrawler          *crawler,
+                    DirectoryRootInfo       *info,
+                    DirectoryProcessingData *dir_data)
+{
+	TrackerCrawlerPrivate *priv;
+	DirectoryListing *listing;
+	gchar *path;
+
+	priv = crawler->priv;
+	path = directory_listing_get_path (crawler, dir_data->node->data);
+
+	if (!path) {
+		file_enumerate_children (crawler, info, dir_data);
+		return FALSE;
+	}
+
+	listing = g_hash_table_lookup (priv->listings, path);
+
+	if (listing) {
+		directory_listing_ref (listing);
+		g_queue_remove (priv->prefetched_listings, listing);
+		g_hash_table_remove (priv->listings, path);
+	} else {
+		listing = directory_listing_new (crawler, path, FALSE);
+		directory_listing_dispatch (crawler, listing);
+	}
+
+	g_free (path);
+
+	return directory_listing_consume (crawler, info, dir_data, listing);
+}
+
 gboolean
 tracker_crawler_start (TrackerCrawler *crawler,
                        GFile          *file,
@@ -879,6 +1620,13 @@ tracker_crawler_start (TrackerCrawler *crawler,
 		return FALSE;
 	}
 
+	if (max_depth != 0) {
+		/* Start listing right away, other roots
+		 * may be queued before this one.
+		 */
+		directory_listing_prefetch (crawler, file, FALSE);
+	}
+
 	g_queue_push_tail (priv->directories, info);
 	process_func_start (crawler);
 
@@ -902,6 +1650,11 @@ tracker_crawler_stop (TrackerCrawler *crawler)
 	priv->is_running = FALSE;
 	g_list_foreach (priv->cancellables, (GFunc) g_cancellable_cancel, NULL);
 
+	if (!priv->is_finished) {
+		/* Listings done ahead might not be wanted anymore */
+		directory_listings_cancel (crawler);
+	}
+
 	process_func_stop (crawler);
 
 	if (priv->timer) {
@@ -980,6 +1733,48 @@ tracker_crawler_set_throttle (TrackerCrawler *crawler,
 	}
 }
 
+/* Returns %FALSE if some of the attributes can't
+ * be filled in from the directory listings
+ */
+static gboolean
+parse_listing_flags (const gchar *file_attributes,
+                     guint       *flags)
+{
+	gchar **attrs;
+	gboolean supported = TRUE;
+	gint i;
+
+	*flags = 0;
+
+	if (!file_attributes) {
+		return TRUE;
+	}
+
+	attrs = g_strsplit (file_attributes, ",", -1);
+
+	for (i = 0; attrs[i]; i++) {
+		const gchar *attr = g_strstrip (attrs[i]);
+
+		if (*attr == '\0' ||
+		    strcmp (attr, G_FILE_ATTRIBUTE_STANDARD_NAME) == 0 ||
+		    strcmp (attr, G_FILE_ATTRIBUTE_STANDARD_TYPE) == 0) {
+			continue;
+		} else if (strcmp (attr, G_FILE_ATTRIBUTE_STANDARD_SIZE) == 0) {
+			*flags |= LISTING_NEEDS_SIZE;
+		} else if (strcmp (attr, G_FILE_ATTRIBUTE_TIME_MODIFIED) == 0 ||
+		           strcmp (attr, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC) == 0) {
+			*flags |= LISTING_NEEDS_MTIME;
+		} else {
+			supported = FALSE;
+			break;
+		}
+	}
+
+	g_strfreev (attrs);
+
+	return supported;
+}
+
 /**
  * tracker_crawler_set_file_attributes:
  * @crawler: a #TrackerCrawler
@@ -997,6 +1792,10 @@ tracker_crawler_set_file_attributes (TrackerCrawler *crawler,
 
 	g_free (crawler->priv->file_attributes);
 	crawler->priv->file_attributes = g_strdup (file_attributes);
+
+	crawler->priv->use_listings =
+		!crawler->priv->listings_disabled &&
+		parse_listing_flags (file_attributes, &crawler->priv->listing_flags);
 }
 
 /**
@@ -26,6 +26,12 @@
 #define QUERY_BATCH_SIZE 100
 #define DEFAULT_BATCH_SIZE 100
 
+/* Resources missing metadata are loaded in pages of this many rows,
+ * the next page is queried once the queue gets below half of it.
+ */
+#define BACKLOG_PAGE_SIZE 1000
+#define BACKLOG_LOW_WATERMARK (BACKLOG_PAGE_SIZE / 2)
+
 #define TRACKER_DECORATOR_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), TRACKER_TYPE_DECORATOR, TrackerDecoratorPrivate))
 
 /**
@@ -79,6 +85,16 @@ struct _TrackerDecoratorPrivate {
 	gint batch_size;
 
 	gint stats_n_elems;
+
+	/* Backlog is paged by resource ID, elements with greater IDs
+	 * than backlog_last_id are yet to be loaded.
+	 */
+	GCancellable *cancellable;
+	gint backlog_last_id;
+	gint n_backlog;
+	gboolean backlog_exhausted;
+	gboolean querying_backlog;
+	gboolean waiting_backlog;
 };
 
 enum {
@@ -155,10 +171,12 @@ decorator_update_state (TrackerDecorator *decorator,
 	guint length;
 
 	priv = decorator->priv;
-	length = tracker_priority_queue_get_length (priv->elem_queue);
+	length = tracker_priority_queue_get_length (priv->elem_queue) +
+		priv->n_backlog;
 
 	if (length > 0) {
-		progress = 1 - ((gdouble) length / priv->stats_n_elems);
+		progress = 1 - ((gdouble) length /
+		                (priv->stats_n_elems + priv->n_backlog));
 		remaining_time = 0;
 	}
 
@@ -169,7 +187,7 @@ decorator_update_state (TrackerDecorator *decorator,
 
 		/* FIXME: Quite naive calculation */
 		elapsed = g_timer_elapsed (priv->timer, NULL);
-		elems_done = priv->stats_n_elems - length;
+		elems_done = priv->stats_n_elems + priv->n_backlog - length;
 
 		if (elems_done > 0)
 			remaining_time = (length * elapsed) / elems_done;
@@ -254,8 +272,24 @@ element_add (TrackerDecorator *decorator,
 	}
 }
 
-
 static void decorator_commit_info (TrackerDecorator *decorator);
+static void decorator_query_backlog (TrackerDecorator *decorator);
+static void complete_tasks_or_query (TrackerDecorator *decorator);
+
+static void
+decorator_notify_finished (TrackerDecorator *decorator)
+{
+	TrackerDecoratorPrivate *priv;
+
+	priv = decorator->priv;
+
+	/* Flush any remaining Sparql updates */
+	decorator_commit_info (decorator);
+
+	g_signal_emit (decorator, signals[FINISHED], 0);
+	decorator_update_state (decorator, "Idle", FALSE);
+	priv->stats_n_elems = 0;
+}
 
 static void
 element_remove_link (TrackerDecorator *decorator,
@@ -279,13 +313,16 @@ element_remove_link (TrackerDecorator *decorator,
 	tracker_priority_queue_remove_node (priv->elem_queue, elem_link);
 	g_hash_table_remove (priv->elems, GINT_TO_POINTER (node->id));
 
-	if (emit && g_hash_table_size (priv->elems) == 0) {
-		/* Flush any remaining Sparql updates */
-		decorator_commit_info (decorator);
+	if (emit) {
+		if (g_hash_table_size (priv->elems) < BACKLOG_LOW_WATERMARK)
+			decorator_query_backlog (decorator);
 
-		g_signal_emit (decorator, signals[FINISHED], 0);
-		decorator_update_state (decorator, "Idle", FALSE);
-		priv->stats_n_elems = 0;
+		/* If the backlog is still being paged through, the
+		 * next page will make items available again.
+		 */
+		if (g_hash_table_size (priv->elems) == 0 &&
+		    priv->backlog_exhausted)
+			decorator_notify_finished (decorator);
 	}
 
 	if (node->info)
@@ -629,6 +666,25 @@ query_type_and_add_element (TrackerDecorator *decorator,
 	g_object_unref (cursor);
 }
 
+/* Whether a resource is left for a later backlog page to load, so
+ * it doesn't need to be held in memory until then.
+ */
+static gboolean
+element_is_in_backlog (TrackerDecorator *decorator,
+                       gint              id)
+{
+	TrackerDecoratorPrivate *priv;
+
+	priv = decorator->priv;
+
+	/* A page being queried might have missed it */
+	if (priv->backlog_exhausted || priv->querying_backlog)
+		return FALSE;
+
+	return (id > priv->backlog_last_id &&
+	        g_hash_table_size (priv->elems) >= BACKLOG_PAGE_SIZE);
+}
+
 static void
 handle_deletes (TrackerDecorator *decorator,
                 GVariantIter     *iter)
@@ -651,7 +707,8 @@ handle_deletes (TrackerDecorator *decorator,
 			 * it doesn't matter to accumulate them to query in
 			 * batches. */
 			if (!g_hash_table_contains (priv->elems,
-			                            GINT_TO_POINTER (subject))) {
+			                            GINT_TO_POINTER (subject)) &&
+			    !element_is_in_backlog (decorator, subject)) {
 				query_type_and_add_element (decorator, subject);
 			}
 		}
@@ -681,7 +738,8 @@ handle_updates (TrackerDecorator *decorator,
 	while (g_variant_iter_loop (iter, "(iiii)",
 	                            &graph, &subject, &predicate, &object)) {
 		if (predicate == priv->rdf_type_id &&
-		    class_name_id_handled (decorator, object))
+		    class_name_id_handled (decorator, object) &&
+		    !element_is_in_backlog (decorator, subject))
 			element_add (decorator, subject, object, FALSE);
 	}
 }
@@ -779,6 +837,9 @@ tracker_decorator_finalize (GObject *object)
 		                                      priv->graph_updated_signal_id);
 	}
 
+	g_cancellable_cancel (priv->cancellable);
+	g_object_unref (priv->cancellable);
+
 	while ((l = tracker_priority_queue_get_head (priv->elem_queue)))
 		element_remove_link (decorator, l, FALSE);
 
@@ -822,30 +883,153 @@ _tracker_decorator_query_append_rdf_type_filter (TrackerDecorator *decorator,
 }
 
 static void
-query_elements_cb (GObject      *object,
-                   GAsyncResult *result,
-                   gpointer      user_data)
+decorator_append_backlog_filter (TrackerDecorator *decorator,
+                                 GString          *query)
+{
+	g_string_append (query,
+	                 "  ?urn a rdfs:Resource ; "
+	                 "       a ?type. ");
+	g_string_append_printf (query,
+	                        "FILTER (! EXISTS { ?urn nie:dataSource <%s> } ",
+	                        tracker_decorator_get_data_source (decorator));
+
+	_tracker_decorator_query_append_rdf_type_filter (decorator, query);
+	g_string_append (query, "&& BOUND(tracker:available(?urn)) ");
+}
+
+static void
+query_backlog_cb (GObject      *object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
 {
+	TrackerDecorator *decorator = user_data;
+	TrackerDecoratorPrivate *priv;
 	TrackerSparqlConnection *conn;
 	TrackerSparqlCursor *cursor;
 	GError *error = NULL;
+	gint n_rows = 0;
 
 	conn = TRACKER_SPARQL_CONNECTION (object);
 	cursor = tracker_sparql_connection_query_finish (conn, result, &error);
 
-        if (error) {
-                g_critical ("Could not load files missing metadata: %s", error->message);
-                g_error_free (error);
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		/* The decorator is gone */
+		g_error_free (error);
 		return;
 	}
 
-	while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
-		gint id = tracker_sparql_cursor_get_integer (cursor, 0);
-		gint class_name_id = tracker_sparql_cursor_get_integer (cursor, 1);
-		element_add (user_data, id, class_name_id, TRUE);
+	priv = decorator->priv;
+	priv->querying_backlog = FALSE;
+
+	if (error) {
+		g_critical ("Could not load files missing metadata: %s", error->message);
+		g_error_free (error);
+		priv->backlog_exhausted = TRUE;
+		priv->n_backlog = 0;
+	} else {
+		while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+			gint id = tracker_sparql_cursor_get_integer (cursor, 0);
+			gint class_name_id = tracker_sparql_cursor_get_integer (cursor, 1);
+
+			/* Resources with several matching types
+			 * come in consecutive rows.
+			 */
+			if (id != priv->backlog_last_id && priv->n_backlog > 0)
+				priv->n_backlog--;
+
+			priv->backlog_last_id = id;
+			element_add (decorator, id, class_name_id, TRUE);
+			n_rows++;
+		}
+
+		g_object_unref (cursor);
+
+		if (n_rows < BACKLOG_PAGE_SIZE) {
+			priv->backlog_exhausted = TRUE;
+			priv->n_backlog = 0;
+		}
 	}
 
-	g_object_unref (cursor);
+	if (priv->waiting_backlog) {
+		priv->waiting_backlog = FALSE;
+		complete_tasks_or_query (decorator);
+	}
+
+	if (g_hash_table_size (priv->elems) > 0) {
+		decorator_update_state (decorator, NULL, TRUE);
+	} else if (!priv->backlog_exhausted) {
+		decorator_query_backlog (decorator);
+	} else if (priv->stats_n_elems > 0) {
+		/* The queue ran empty while waiting for this page */
+		decorator_notify_finished (decorator);
+	}
+}
+
+static void
+decorator_query_backlog (TrackerDecorator *decorator)
+{
+	TrackerSparqlConnection *sparql_conn;
+	TrackerDecoratorPrivate *priv;
+	GString *query;
+
+	priv = decorator->priv;
+
+	if (priv->backlog_exhausted || priv->querying_backlog)
+		return;
+
+	/* Keyset pagination, so each page is as cheap as the first */
+	query = g_string_new ("SELECT tracker:id(?urn) tracker:id(?type) { ");
+	decorator_append_backlog_filter (decorator, query);
+	g_string_append_printf (query,
+	                        "&& tracker:id(?urn) > %d)} "
+	                        "ORDER BY tracker:id(?urn) "
+	                        "LIMIT %d",
+	                        priv->backlog_last_id,
+	                        BACKLOG_PAGE_SIZE);
+
+	priv->querying_backlog = TRUE;
+	sparql_conn = tracker_miner_get_connection (TRACKER_MINER (decorator));
+	tracker_sparql_connection_query_async (sparql_conn, query->str,
+	                                       priv->cancellable,
+	                                       query_backlog_cb,
+	                                       decorator);
+	g_string_free (query, TRUE);
+}
+
+static void
+count_backlog_cb (GObject      *object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+	TrackerDecorator *decorator = user_data;
+	TrackerDecoratorPrivate *priv;
+	TrackerSparqlConnection *conn;
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+
+	conn = TRACKER_SPARQL_CONNECTION (object);
+	cursor = tracker_sparql_connection_query_finish (conn, result, &error);
+
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_error_free (error);
+		return;
+	}
+
+	priv = decorator->priv;
+	priv->querying_backlog = FALSE;
+
+	if (error) {
+		/* Only progress reports are affected */
+		g_warning ("Could not count files missing metadata: %s", error->message);
+		g_error_free (error);
+	} else {
+		if (tracker_sparql_cursor_next (cursor, NULL, NULL))
+			priv->n_backlog = tracker_sparql_cursor_get_integer (cursor, 0);
+
+		g_object_unref (cursor);
+	}
+
+	decorator_query_backlog (decorator);
 }
 
 static void
@@ -881,28 +1065,29 @@ tracker_decorator_started (TrackerMiner *miner)
 	TrackerSparqlConnection *sparql_conn;
 	TrackerDecoratorPrivate *priv;
 	TrackerDecorator *decorator;
-	const gchar *data_source;
 	GString *query;
 
 	decorator = TRACKER_DECORATOR (miner);
 	priv = decorator->priv;
 
 	g_timer_start (priv->timer);
-	data_source = tracker_decorator_get_data_source (decorator);
-	query = g_string_new ("SELECT tracker:id(?urn) tracker:id(?type) { "
-	                      "  ?urn a rdfs:Resource ; "
-	                      "       a ?type. ");
 
-	g_string_append_printf (query,
-	                        "FILTER (! EXISTS { ?urn nie:dataSource <%s> } ",
-	                        data_source);
+	/* Only a window of the resources missing metadata is
+	 * kept in memory, count them all for progress reports.
+	 */
+	priv->backlog_last_id = 0;
+	priv->n_backlog = 0;
+	priv->backlog_exhausted = FALSE;
+	priv->querying_backlog = TRUE;
 
-	_tracker_decorator_query_append_rdf_type_filter (decorator, query);
-	g_string_append (query, "&& BOUND(tracker:available(?urn)))}");
+	query = g_string_new ("SELECT COUNT(DISTINCT ?urn) { ");
+	decorator_append_backlog_filter (decorator, query);
+	g_string_append (query, ")}");
 
 	sparql_conn = tracker_miner_get_connection (miner);
 	tracker_sparql_connection_query_async (sparql_conn, query->str,
-	                                       NULL, query_elements_cb,
+	                                       priv->cancellable,
+	                                       count_backlog_cb,
 	                                       decorator);
 	g_string_free (query, TRUE);
 }
@@ -1004,6 +1189,8 @@ tracker_decorator_init (TrackerDecorator *decorator)
 	priv->batch_size = DEFAULT_BATCH_SIZE;
 	priv->sparql_buffer = g_ptr_array_new_with_free_func (g_free);
 	priv->timer = g_timer_new ();
+	priv->cancellable = g_cancellable_new ();
+	priv->backlog_exhausted = TRUE;
 }
 
 /**
@@ -1112,8 +1299,6 @@ tracker_decorator_delete_id (TrackerDecorator *decorator,
 	element_remove_by_id (decorator, id);
 }
 
-static void complete_tasks_or_query (TrackerDecorator *decorator);
-
 typedef struct {
 	TrackerDecorator *decorator;
 	GArray *ids;
@@ -1266,6 +1451,12 @@ complete_tasks_or_query (TrackerDecorator *decorator)
 		}
 	}
 
+	/* The next backlog page will bring more elements */
+	if (priv->querying_backlog) {
+		priv->waiting_backlog = TRUE;
+		return;
+	}
+
 	/* There is no element left, or they are all being processed already */
 	while ((task = g_queue_pop_head (&priv->next_elem_queue))) {
 		g_task_return_new_error (task,
@@ -19,6 +19,10 @@
  * Author: Carlos Garnacho  <carlos@lanedo.com>
  */
 
+#include <string.h>
+
+#include <glib/gstdio.h>
+
 #include <libtracker-common/tracker-log.h>
 #include <libtracker-common/tracker-date-time.h>
 #include <libtracker-sparql/tracker-sparql.h>
@@ -32,9 +36,12 @@
 static GQuark quark_property_iri = 0;
 static GQuark quark_property_store_mtime = 0;
 static GQuark quark_property_filesystem_mtime = 0;
+static GQuark quark_property_n_files = 0;
 
 #define MAX_DEPTH 1
 
+#define CRAWL_STATE_HEADER "tracker-crawl-state 1"
+
 enum {
 	PROP_0,
 	PROP_INDEXING_TREE
@@ -56,6 +63,7 @@ static guint signals[LAST_SIGNAL] = { 0 };
 typedef struct {
 	GFile *root;
 	GQueue *pending_dirs;
+	GHashTable *pending_links;
 	GPtrArray *query_files;
 	GPtrArray *updated_dirs;
 	guint flags;
@@ -63,8 +71,45 @@ typedef struct {
 	guint directories_ignored;
 	guint files_found;
 	guint files_ignored;
+
+	/* Store contents of the root, sorted by parent
+	 * directory, merged as directories get crawled.
+	 */
+	TrackerSparqlCursor *cursor;
+	GCancellable *cursor_cancellable;
+	GHashTable *skipped_groups;
+	GFile *group_dir;
+	guint stream_contents : 1;
+	guint cursor_ready : 1;
+	guint waiting_cursor : 1;
+
+	/* Directories queued from unchanged parents, whose
+	 * store information is yet unknown.
+	 */
+	GHashTable *unchecked_dirs;
+	GCancellable *stat_cancellable;
+	guint use_crawl_state : 1;
 } RootData;
 
+typedef struct {
+	guint64 mtime;
+	guint n_files;
+	GPtrArray *subdirs;
+	guint skippable : 1;
+} CrawlStateEntry;
+
+typedef struct {
+	GFile *directory;
+	guint n_files;
+	GPtrArray *subdirs;
+	GArray *mtimes;
+} SubdirsStatData;
+
+typedef struct {
+	TrackerFileNotifier *notifier;
+	GCancellable *cancellable;
+} RootQueryData;
+
 typedef struct {
 	TrackerIndexingTree *indexing_tree;
 	TrackerFileSystem *file_system;
@@ -83,6 +128,11 @@ typedef struct {
 	GList *pending_index_roots;
 	RootData *current_index_root;
 
+	/* Directory URI -> CrawlStateEntry, as
+	 * saved on the last clean shutdown.
+	 */
+	GHashTable *crawl_state;
+
 	guint stopped : 1;
 } TrackerFileNotifierPrivate;
 
@@ -95,6 +145,7 @@ typedef struct {
 } DirectoryCrawledData;
 
 static gboolean crawl_directories_start (TrackerFileNotifier *notifier);
+static gboolean crawl_directory_in_current_root (TrackerFileNotifier *notifier);
 
 G_DEFINE_TYPE (TrackerFileNotifier, tracker_file_notifier, G_TYPE_OBJECT)
 
@@ -140,6 +191,50 @@ tracker_file_notifier_get_property (GObject    *object,
 	}
 }
 
+/* Pending directories are kept in a queue, links are looked up
+ * by file so these can be moved to the head in constant time.
+ */
+static void
+root_data_push_pending (RootData *data,
+                        GFile    *file)
+{
+	if (g_hash_table_contains (data->pending_links, file)) {
+		return;
+	}
+
+	g_queue_push_tail (data->pending_dirs, g_object_ref (file));
+	g_hash_table_insert (data->pending_links, file,
+	                     data->pending_dirs->tail);
+}
+
+static GFile *
+root_data_pop_pending (RootData *data)
+{
+	GFile *file;
+
+	file = g_queue_pop_head (data->pending_dirs);
+
+	if (file) {
+		g_hash_table_remove (data->pending_links, file);
+	}
+
+	return file;
+}
+
+static void
+root_data_move_pending_to_head (RootData *data,
+                                GFile    *file)
+{
+	GList *link;
+
+	link = g_hash_table_lookup (data->pending_links, file);
+
+	if (link && link != data->pending_dirs->head) {
+		g_queue_unlink (data->pending_dirs, link);
+		g_queue_push_head_link (data->pending_dirs, link);
+	}
+}
+
 static RootData *
 root_data_new (TrackerFileNotifier *notifier,
                GFile               *file,
@@ -150,11 +245,15 @@ root_data_new (TrackerFileNotifier *notifier,
 	data = g_new0 (RootData, 1);
 	data->root = g_object_ref (file);
 	data->pending_dirs = g_queue_new ();
+	data->pending_links = g_hash_table_new (NULL, NULL);
 	data->query_files = g_ptr_array_new ();
 	data->updated_dirs = g_ptr_array_new ();
+	data->skipped_groups = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                              g_free, NULL);
+	data->unchecked_dirs = g_hash_table_new (NULL, NULL);
 	data->flags = flags;
 
-	g_queue_push_tail (data->pending_dirs, g_object_ref (file));
+	root_data_push_pending (data, file);
 
 	return data;
 }
@@ -162,6 +261,20 @@ root_data_new (TrackerFileNotifier *notifier,
 static void
 root_data_free (RootData *data)
 {
+	if (data->cursor_cancellable) {
+		g_cancellable_cancel (data->cursor_cancellable);
+		g_object_unref (data->cursor_cancellable);
+	}
+
+	if (data->stat_cancellable) {
+		g_cancellable_cancel (data->stat_cancellable);
+		g_object_unref (data->stat_cancellable);
+	}
+
+	g_clear_object (&data->cursor);
+	g_hash_table_unref (data->skipped_groups);
+	g_hash_table_unref (data->unchecked_dirs);
+	g_hash_table_unref (data->pending_links);
 	g_queue_free_full (data->pending_dirs, (GDestroyNotify) g_object_unref);
 	g_ptr_array_unref (data->query_files);
 	g_ptr_array_unref (data->updated_dirs);
@@ -169,6 +282,30 @@ root_data_free (RootData *data)
 	g_free (data);
 }
 
+static void
+root_data_cursor_next (RootData *data)
+{
+	if (!tracker_sparql_cursor_next (data->cursor, NULL, NULL)) {
+		/* All store contents were merged */
+		g_clear_object (&data->cursor);
+	}
+}
+
+/* Returns the URI of the directory the current row belongs to */
+static const gchar *
+root_data_cursor_get_group (RootData *data)
+{
+	const gchar *group;
+
+	if (!data->cursor) {
+		return NULL;
+	}
+
+	group = tracker_sparql_cursor_get_string (data->cursor, 0, NULL);
+
+	return group ? group : "";
+}
+
 /* Crawler signal handlers */
 static gboolean
 crawler_check_file_cb (TrackerCrawler *crawler,
@@ -264,10 +401,11 @@ file_notifier_traverse_tree_foreach (GFile    *file,
 
 	/* If we're crawling over a subdirectory of a root index, it's been
 	 * already notified in the crawling op that made it processed, so avoid
-	 * it here again.
+	 * it here again. Unless its parent was skipped as unchanged.
 	 */
 	if (current_root == file &&
-	    current_root != priv->current_index_root->root)
+	    current_root != priv->current_index_root->root &&
+	    !g_hash_table_contains (priv->current_index_root->unchecked_dirs, file))
 		return FALSE;
 
 	store_mtime = tracker_file_system_get_property (priv->file_system, file,
@@ -317,6 +455,20 @@ file_notifier_traverse_tree_foreach (GFile    *file,
 	return FALSE;
 }
 
+static void
+notifier_emit_finished (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+
+	/* The crawl state only applies to the first crawl */
+	if (priv->crawl_state) {
+		g_hash_table_unref (priv->crawl_state);
+		priv->crawl_state = NULL;
+	}
+
+	g_signal_emit (notifier, signals[FINISHED], 0);
+}
+
 static gboolean
 notifier_check_next_root (TrackerFileNotifier *notifier)
 {
@@ -328,7 +480,7 @@ notifier_check_next_root (TrackerFileNotifier *notifier)
 	if (priv->pending_index_roots) {
 		return crawl_directories_start (notifier);
 	} else {
-		g_signal_emit (notifier, signals[FINISHED], 0);
+		notifier_emit_finished (notifier);
 		return FALSE;
 	}
 }
@@ -410,8 +562,7 @@ file_notifier_add_node_foreach (GNode    *node,
 			 * queue dirs for later processing
 			 */
 			g_assert (node->children == NULL);
-			g_queue_push_tail (priv->current_index_root->pending_dirs,
-			                   g_object_ref (canonical));
+			root_data_push_pending (priv->current_index_root, canonical);
 		}
 
 		if (depth != 0 || file == priv->current_index_root->root)
@@ -435,6 +586,7 @@ crawler_directory_crawled_cb (TrackerCrawler *crawler,
 	TrackerFileNotifier *notifier;
 	TrackerFileNotifierPrivate *priv;
 	DirectoryCrawledData data = { 0 };
+	GFile *canonical;
 
 	notifier = data.notifier = user_data;
 	priv = notifier->priv;
@@ -446,6 +598,15 @@ crawler_directory_crawled_cb (TrackerCrawler *crawler,
 	                 file_notifier_add_node_foreach,
 	                 &data);
 
+	/* Kept for the crawl state, directories are crawled one level at a time */
+	canonical = tracker_file_system_peek_file (priv->file_system, directory);
+
+	if (canonical) {
+		tracker_file_system_set_property (priv->file_system, canonical,
+		                                  quark_property_n_files,
+		                                  g_memdup (&files_found, sizeof (guint)));
+	}
+
 	priv->current_index_root->directories_found += directories_found;
 	priv->current_index_root->directories_ignored += directories_ignored;
 	priv->current_index_root->files_found += files_found;
@@ -475,51 +636,59 @@ _insert_store_info (TrackerFileNotifier *notifier,
 	return canonical;
 }
 
+/* Inserts the url, iri and mtime found from @column on */
 static void
-sparql_files_query_populate (TrackerFileNotifier *notifier,
-			     TrackerSparqlCursor *cursor,
-			     gboolean             check_root)
+sparql_files_query_populate_row (TrackerFileNotifier *notifier,
+                                 TrackerSparqlCursor *cursor,
+                                 gint                 column,
+                                 gboolean             check_root)
 {
 	TrackerFileNotifierPrivate *priv;
+	GFile *file, *canonical, *root;
+	const gchar *time_str, *iri;
+	GError *error = NULL;
+	guint64 _time;
 
 	priv = notifier->priv;
+	file = g_file_new_for_uri (tracker_sparql_cursor_get_string (cursor, column, NULL));
 
-	while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
-		GFile *file, *canonical, *root;
-		const gchar *time_str, *iri;
-		GError *error = NULL;
-		guint64 _time;
+	if (check_root) {
+		/* If it's a config root itself, other than the one
+		 * currently processed, bypass it, it will be processed
+		 * when the time arrives.
+		 */
+		canonical = tracker_file_system_peek_file (priv->file_system, file);
+		root = tracker_indexing_tree_get_root (priv->indexing_tree, file, NULL);
 
-		file = g_file_new_for_uri (tracker_sparql_cursor_get_string (cursor, 0, NULL));
+		if (canonical && root == file && priv->current_index_root &&
+		    root != priv->current_index_root->root) {
+			g_object_unref (file);
+			return;
+		}
+	}
 
-		if (check_root) {
-			/* If it's a config root itself, other than the one
-			 * currently processed, bypass it, it will be processed
-			 * when the time arrives.
-			 */
-			canonical = tracker_file_system_peek_file (priv->file_system, file);
-			root = tracker_indexing_tree_get_root (priv->indexing_tree, file, NULL);
+	iri = tracker_sparql_cursor_get_string (cursor, column + 1, NULL);
+	time_str = tracker_sparql_cursor_get_string (cursor, column + 2, NULL);
+	_time = tracker_string_to_date (time_str, NULL, &error);
 
-			if (canonical && root == file && priv->current_index_root &&
-			    root != priv->current_index_root->root) {
-				g_object_unref (file);
-				continue;
-			}
-		}
+	if (error) {
+		/* This should never happen. Assume that file was modified. */
+		g_critical ("Getting store mtime: %s", error->message);
+		g_clear_error (&error);
+		_time = 0;
+	}
 
-		iri = tracker_sparql_cursor_get_string (cursor, 1, NULL);
-		time_str = tracker_sparql_cursor_get_string (cursor, 2, NULL);
-		_time = tracker_string_to_date (time_str, NULL, &error);
-
-		if (error) {
-			/* This should never happen. Assume that file was modified. */
-			g_critical ("Getting store mtime: %s", error->message);
-			g_clear_error (&error);
-			_time = 0;
-		}
+	_insert_store_info (notifier, file, iri, _time);
+	g_object_unref (file);
+}
 
-		_insert_store_info (notifier, file, iri, _time);
-		g_object_unref (file);
+static void
+sparql_files_query_populate (TrackerFileNotifier *notifier,
+			     TrackerSparqlCursor *cursor,
+			     gboolean             check_root)
+{
+	while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+		sparql_files_query_populate_row (notifier, cursor, 0, check_root);
 	}
 }
 
@@ -550,26 +719,392 @@ sparql_contents_check_deleted (TrackerFileNotifier *notifier,
 	}
 }
 
+/* Skips the rows belonging to the current directory group */
+static void
+notifier_stream_skip_group (TrackerFileNotifier *notifier)
+{
+	RootData *data = notifier->priv->current_index_root;
+	gchar *group, *root_uri;
+
+	group = g_strdup (root_data_cursor_get_group (data));
+	root_uri = g_file_get_uri (data->root);
+
+	do {
+		/* The root itself is listed in the group of its parent */
+		if (g_strcmp0 (tracker_sparql_cursor_get_string (data->cursor, 1, NULL),
+		               root_uri) == 0) {
+			sparql_files_query_populate_row (notifier, data->cursor, 1, FALSE);
+		}
+
+		root_data_cursor_next (data);
+	} while (data->cursor &&
+	         strcmp (root_data_cursor_get_group (data), group) == 0);
+
+	g_free (root_uri);
+	g_free (group);
+}
+
+/* Inserts the store information of the current directory group */
+static void
+notifier_stream_consume_group (TrackerFileNotifier *notifier)
+{
+	RootData *data = notifier->priv->current_index_root;
+	gchar *group;
+
+	group = g_strdup (root_data_cursor_get_group (data));
+
+	do {
+		sparql_files_query_populate_row (notifier, data->cursor, 1, TRUE);
+		root_data_cursor_next (data);
+	} while (data->cursor &&
+	         strcmp (root_data_cursor_get_group (data), group) == 0);
+
+	g_free (group);
+}
+
+/* Returns the pending directory that the next directory group in
+ * the store contents belongs to, groups of directories that won't
+ * be crawled are skipped.
+ */
+static GFile *
+notifier_stream_next_directory (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	RootData *data = priv->current_index_root;
+
+	while (data->cursor) {
+		const gchar *group;
+		GFile *file, *canonical;
+
+		group = root_data_cursor_get_group (data);
+
+		if (!*group) {
+			notifier_stream_skip_group (notifier);
+			continue;
+		}
+
+		file = g_file_new_for_uri (group);
+		canonical = tracker_file_system_peek_file (priv->file_system, file);
+
+		if (canonical &&
+		    g_hash_table_contains (data->pending_links, canonical)) {
+			g_object_unref (file);
+			return canonical;
+		}
+
+		if (tracker_indexing_tree_get_root (priv->indexing_tree,
+		                                    file, NULL) == data->root) {
+			/* The directory is gone or wasn't found yet, its
+			 * contents will be queried separately if it gets
+			 * crawled later on.
+			 */
+			g_hash_table_add (data->skipped_groups, g_strdup (group));
+		}
+
+		g_object_unref (file);
+		notifier_stream_skip_group (notifier);
+	}
+
+	return NULL;
+}
+
+/* Returns the saved crawl state of @directory if it didn't change
+ * since it was saved, so it doesn't need to be listed, nor its
+ * files checked against the store.
+ */
+static CrawlStateEntry *
+notifier_get_unchanged_entry (TrackerFileNotifier *notifier,
+                              GFile               *directory)
+{
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	RootData *data = priv->current_index_root;
+	CrawlStateEntry *entry;
+	guint64 *disk_mtime;
+	gchar *uri;
+
+	if (!data->use_crawl_state || directory == data->root)
+		return NULL;
+
+	uri = g_file_get_uri (directory);
+	entry = g_hash_table_lookup (priv->crawl_state, uri);
+	g_free (uri);
+
+	if (!entry || !entry->skippable)
+		return NULL;
+
+	disk_mtime = tracker_file_system_get_property (priv->file_system, directory,
+	                                               quark_property_filesystem_mtime);
+
+	if (!disk_mtime || *disk_mtime != entry->mtime)
+		return NULL;
+
+	return entry;
+}
+
+static SubdirsStatData *
+subdirs_stat_data_new (GFile           *directory,
+                       CrawlStateEntry *entry)
+{
+	SubdirsStatData *stat_data;
+	guint i;
+
+	stat_data = g_slice_new0 (SubdirsStatData);
+	stat_data->directory = g_object_ref (directory);
+	stat_data->n_files = entry->n_files;
+	stat_data->subdirs = g_ptr_array_new_with_free_func (g_object_unref);
+	stat_data->mtimes = g_array_sized_new (FALSE, FALSE, sizeof (guint64),
+	                                       entry->subdirs->len);
+
+	for (i = 0; i < entry->subdirs->len; i++) {
+		g_ptr_array_add (stat_data->subdirs,
+		                 g_file_new_for_uri (g_ptr_array_index (entry->subdirs, i)));
+	}
+
+	return stat_data;
+}
+
+static void
+subdirs_stat_data_free (SubdirsStatData *stat_data)
+{
+	g_object_unref (stat_data->directory);
+	g_ptr_array_unref (stat_data->subdirs);
+	g_array_unref (stat_data->mtimes);
+	g_slice_free (SubdirsStatData, stat_data);
+}
+
+/* Queues the subdirectories of the unchanged directory at the head
+ * of the pending queue in its place, without crawling it.
+ */
+static void
+notifier_skip_directory (TrackerFileNotifier *notifier,
+                         SubdirsStatData     *stat_data)
+{
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	RootData *data = priv->current_index_root;
+	GFile *directory;
+	guint i;
+
+	directory = root_data_pop_pending (data);
+	g_assert (directory == stat_data->directory);
+
+	for (i = 0; i < stat_data->subdirs->len; i++) {
+		GFile *file, *canonical;
+
+		file = g_ptr_array_index (stat_data->subdirs, i);
+
+		/* Same checks than the crawler does on subdirectories,
+		 * other roots are processed on their own.
+		 */
+		if (tracker_indexing_tree_file_is_root (priv->indexing_tree, file) ||
+		    !tracker_indexing_tree_file_is_indexable (priv->indexing_tree, file,
+		                                              G_FILE_TYPE_DIRECTORY)) {
+			continue;
+		}
+
+		canonical = tracker_file_system_get_file (priv->file_system, file,
+		                                          G_FILE_TYPE_DIRECTORY,
+		                                          directory);
+		tracker_file_system_set_property (priv->file_system, canonical,
+		                                  quark_property_filesystem_mtime,
+		                                  g_memdup (&g_array_index (stat_data->mtimes, guint64, i),
+		                                            sizeof (guint64)));
+
+		g_hash_table_add (data->unchecked_dirs, canonical);
+		root_data_push_pending (data, canonical);
+		data->directories_found++;
+	}
+
+	tracker_file_system_set_property (priv->file_system, directory,
+	                                  quark_property_n_files,
+	                                  g_memdup (&stat_data->n_files, sizeof (guint)));
+	data->files_found += stat_data->n_files;
+
+	/* Only directories in monitored roots are skipped */
+	tracker_monitor_add (priv->monitor, directory);
+
+	g_object_unref (directory);
+}
+
+/* Subdirectories of an unchanged directory are stat'ed in a thread,
+ * there may be many of these on a first crawl.
+ */
+static void
+notifier_stat_subdirs_thread (GTask        *task,
+                              gpointer      source_object,
+                              gpointer      task_data,
+                              GCancellable *cancellable)
+{
+	SubdirsStatData *stat_data = task_data;
+	guint i;
+
+	for (i = 0; i < stat_data->subdirs->len; i++) {
+		GFileInfo *info;
+		guint64 mtime;
+
+		info = g_file_query_info (g_ptr_array_index (stat_data->subdirs, i),
+		                          G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+		                          G_FILE_ATTRIBUTE_STANDARD_TYPE,
+		                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+		                          cancellable, NULL);
+
+		if (!info ||
+		    g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY) {
+			/* Directory contents changed regardless of
+			 * its mtime, crawl it after all.
+			 */
+			g_clear_object (&info);
+			g_task_return_boolean (task, FALSE);
+			return;
+		}
+
+		mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+		g_array_append_val (stat_data->mtimes, mtime);
+		g_object_unref (info);
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static gboolean
+notifier_crawl_directory (TrackerFileNotifier *notifier,
+                          GFile               *directory)
+{
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	gboolean recurse;
+
+	g_cancellable_reset (priv->cancellable);
+	recurse = (priv->current_index_root->flags & TRACKER_DIRECTORY_FLAG_RECURSE) != 0;
+
+	return tracker_crawler_start (priv->crawler, directory,
+	                              (recurse) ? MAX_DEPTH : 1);
+}
+
+static void
+notifier_finish_current_root (TrackerFileNotifier *notifier,
+                              GFile               *directory)
+{
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+
+	g_signal_emit (notifier, signals[DIRECTORY_FINISHED], 0,
+	               directory,
+	               priv->current_index_root->directories_found,
+	               priv->current_index_root->directories_ignored,
+	               priv->current_index_root->files_found,
+	               priv->current_index_root->files_ignored);
+
+	tracker_info ("  Notified files after %2.2f seconds",
+	              g_timer_elapsed (priv->timer, NULL));
+	tracker_info ("  Found %d directories, ignored %d directories",
+	              priv->current_index_root->directories_found,
+	              priv->current_index_root->directories_ignored);
+	tracker_info ("  Found %d files, ignored %d files",
+	              priv->current_index_root->files_found,
+	              priv->current_index_root->files_ignored);
+
+	root_data_free (priv->current_index_root);
+	priv->current_index_root = NULL;
+
+	notifier_check_next_root (notifier);
+}
+
+static void
+notifier_stat_subdirs_cb (GObject      *object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+	TrackerFileNotifier *notifier = TRACKER_FILE_NOTIFIER (object);
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	SubdirsStatData *stat_data;
+	gboolean unchanged, retval;
+
+	if (g_cancellable_is_cancelled (g_task_get_cancellable (G_TASK (result)))) {
+		/* The root was removed meanwhile */
+		return;
+	}
+
+	stat_data = g_task_get_task_data (G_TASK (result));
+	unchanged = g_task_propagate_boolean (G_TASK (result), NULL);
+	g_clear_object (&priv->current_index_root->stat_cancellable);
+
+	/* The directory may have been moved back by a boost */
+	root_data_move_pending_to_head (priv->current_index_root,
+	                                stat_data->directory);
+
+	if (unchanged) {
+		notifier_skip_directory (notifier, stat_data);
+		retval = crawl_directory_in_current_root (notifier);
+	} else {
+		retval = notifier_crawl_directory (notifier, stat_data->directory);
+	}
+
+	if (!retval) {
+		notifier_finish_current_root (notifier, stat_data->directory);
+	}
+}
+
 static gboolean
 crawl_directory_in_current_root (TrackerFileNotifier *notifier)
 {
 	TrackerFileNotifierPrivate *priv = notifier->priv;
-	gboolean recurse, retval = FALSE;
+	SubdirsStatData *stat_data;
+	CrawlStateEntry *entry;
 	GFile *directory;
+	GTask *task;
 
 	if (!priv->current_index_root)
 		return FALSE;
 
-	directory = g_queue_peek_head (priv->current_index_root->pending_dirs);
+	while (TRUE) {
+		if (priv->current_index_root->cursor) {
+			/* Crawl directories in the order their contents
+			 * are found in the store, so these can be merged
+			 * as the crawler advances.
+			 */
+			directory = notifier_stream_next_directory (notifier);
 
-	if (!directory)
-		return FALSE;
+			if (directory) {
+				root_data_move_pending_to_head (priv->current_index_root,
+				                                directory);
+			}
 
-	g_cancellable_reset (priv->cancellable);
-	recurse = (priv->current_index_root->flags & TRACKER_DIRECTORY_FLAG_RECURSE) != 0;
-	retval = tracker_crawler_start (priv->crawler, directory,
-	                                (recurse) ? MAX_DEPTH : 1);
-	return retval;
+			priv->current_index_root->group_dir = directory;
+		}
+
+		directory = g_queue_peek_head (priv->current_index_root->pending_dirs);
+
+		if (!directory)
+			return FALSE;
+
+		entry = notifier_get_unchanged_entry (notifier, directory);
+
+		if (!entry)
+			break;
+
+		stat_data = subdirs_stat_data_new (directory, entry);
+
+		if (stat_data->subdirs->len == 0) {
+			notifier_skip_directory (notifier, stat_data);
+			subdirs_stat_data_free (stat_data);
+			continue;
+		}
+
+		/* Subdirectories must still be there for the directory
+		 * to be skipped, this is continued when these are stat'ed.
+		 */
+		priv->current_index_root->stat_cancellable = g_cancellable_new ();
+
+		task = g_task_new (notifier,
+		                   priv->current_index_root->stat_cancellable,
+		                   notifier_stat_subdirs_cb, NULL);
+		g_task_set_task_data (task, stat_data,
+		                      (GDestroyNotify) subdirs_stat_data_free);
+		g_task_run_in_thread (task, notifier_stat_subdirs_thread);
+		g_object_unref (task);
+
+		return TRUE;
+	}
+
+	return notifier_crawl_directory (notifier, directory);
 }
 
 static void
@@ -579,7 +1114,7 @@ finish_current_directory (TrackerFileNotifier *notifier)
 	GFile *directory;
 
 	priv = notifier->priv;
-	directory = g_queue_pop_head (priv->current_index_root->pending_dirs);
+	directory = root_data_pop_pending (priv->current_index_root);
 
 	/* We dispose regular files here, only directories are cached once crawling
 	 * has completed.
@@ -592,26 +1127,7 @@ finish_current_directory (TrackerFileNotifier *notifier)
 		/* No more directories left to be crawled in the current
 		 * root, jump to the next one.
 		 */
-		g_signal_emit (notifier, signals[DIRECTORY_FINISHED], 0,
-		               directory,
-		               priv->current_index_root->directories_found,
-		               priv->current_index_root->directories_ignored,
-		               priv->current_index_root->files_found,
-		               priv->current_index_root->files_ignored);
-
-		tracker_info ("  Notified files after %2.2f seconds",
-		              g_timer_elapsed (priv->timer, NULL));
-		tracker_info ("  Found %d directories, ignored %d directories",
-		              priv->current_index_root->directories_found,
-		              priv->current_index_root->directories_ignored);
-		tracker_info ("  Found %d files, ignored %d files",
-		              priv->current_index_root->files_found,
-		              priv->current_index_root->files_ignored);
-
-		root_data_free (priv->current_index_root);
-		priv->current_index_root = NULL;
-
-		notifier_check_next_root (notifier);
+		notifier_finish_current_root (notifier, directory);
 	}
 
 	g_object_unref (directory);
@@ -765,6 +1281,159 @@ sparql_files_query_start (TrackerFileNotifier  *notifier,
 	g_free (sparql);
 }
 
+static void
+notifier_query_crawled_files (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	GFile *directory;
+
+	directory = g_queue_peek_head (priv->current_index_root->pending_dirs);
+
+	if (priv->current_index_root->query_files->len > 0 &&
+	    (directory == priv->current_index_root->root ||
+	     g_hash_table_contains (priv->current_index_root->unchecked_dirs, directory) ||
+	     tracker_file_system_get_property (priv->file_system,
+	                                       directory, quark_property_iri))) {
+		sparql_files_query_start (notifier,
+					  (GFile**) priv->current_index_root->query_files->pdata,
+		                          priv->current_index_root->query_files->len);
+		g_ptr_array_set_size (priv->current_index_root->query_files, 0);
+	} else {
+		file_notifier_traverse_tree (notifier);
+		finish_current_directory (notifier);
+	}
+}
+
+/* Merges the store contents of the crawled directory */
+static void
+notifier_stream_check_directory (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	RootData *data = priv->current_index_root;
+	GFile *directory;
+	gchar *uri;
+
+	directory = g_queue_peek_head (data->pending_dirs);
+	uri = g_file_get_uri (directory);
+
+	if (g_hash_table_contains (data->skipped_groups, uri)) {
+		/* Contents were passed over in the store results */
+		g_free (uri);
+		notifier_query_crawled_files (notifier);
+		return;
+	}
+
+	g_free (uri);
+
+	if (!data->group_dir && data->cursor) {
+		/* The root was crawled before the results arrived */
+		data->group_dir = notifier_stream_next_directory (notifier);
+	}
+
+	if (data->group_dir == directory) {
+		notifier_stream_consume_group (notifier);
+	}
+
+	data->group_dir = NULL;
+	g_ptr_array_set_size (data->query_files, 0);
+
+	file_notifier_traverse_tree (notifier);
+
+	/* Deleted contents were already found in the group */
+	g_ptr_array_set_size (data->updated_dirs, 0);
+
+	finish_current_directory (notifier);
+}
+
+/* Query for all files in a recursive root, sorted by directory */
+static void
+sparql_root_query_cb (GObject      *object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+	RootQueryData *query_data = user_data;
+	TrackerFileNotifier *notifier;
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+	RootData *data;
+
+	notifier = query_data->notifier;
+	cursor = tracker_sparql_connection_query_finish (TRACKER_SPARQL_CONNECTION (object),
+	                                                 result, &error);
+
+	if (g_cancellable_is_cancelled (query_data->cancellable)) {
+		/* The root is gone */
+		g_clear_object (&cursor);
+		g_clear_error (&error);
+		g_object_unref (query_data->cancellable);
+		g_free (query_data);
+		return;
+	}
+
+	g_object_unref (query_data->cancellable);
+	g_free (query_data);
+
+	data = notifier->priv->current_index_root;
+	data->cursor_ready = TRUE;
+
+	if (error) {
+		g_warning ("Could not query indexed files: %s\n", error->message);
+		g_error_free (error);
+		data->stream_contents = FALSE;
+	} else if (cursor) {
+		data->cursor = cursor;
+		root_data_cursor_next (data);
+	}
+
+	if (data->waiting_cursor) {
+		data->waiting_cursor = FALSE;
+
+		if (data->stream_contents) {
+			notifier_stream_check_directory (notifier);
+		} else {
+			notifier_query_crawled_files (notifier);
+		}
+	}
+}
+
+static void
+sparql_root_query_start (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv;
+	RootQueryData *query_data;
+	RootData *data;
+	gchar *sparql, *uri;
+
+	priv = notifier->priv;
+	data = priv->current_index_root;
+	uri = g_file_get_uri (data->root);
+
+	/* Directories are sorted after their parent, so these
+	 * can be crawled in the same order.
+	 */
+	sparql = g_strdup_printf ("SELECT ?purl ?url ?u nfo:fileLastModified(?u) {"
+	                          "  ?u a rdfs:Resource ; nie:url ?url . "
+	                          "  OPTIONAL { ?u nfo:belongsToContainer ?p . ?p nie:url ?purl } "
+	                          "FILTER (?url = \"%s\" || tracker:uri-is-descendant (\"%s\", ?url))"
+	                          "} ORDER BY ?purl",
+	                          uri, uri);
+
+	data->stream_contents = TRUE;
+	data->cursor_cancellable = g_cancellable_new ();
+
+	query_data = g_new0 (RootQueryData, 1);
+	query_data->notifier = notifier;
+	query_data->cancellable = g_object_ref (data->cursor_cancellable);
+
+	tracker_sparql_connection_query_async (priv->connection,
+	                                       sparql,
+	                                       data->cursor_cancellable,
+	                                       sparql_root_query_cb,
+	                                       query_data);
+	g_free (sparql);
+	g_free (uri);
+}
+
 static gboolean
 crawl_directories_start (TrackerFileNotifier *notifier)
 {
@@ -791,8 +1460,24 @@ crawl_directories_start (TrackerFileNotifier *notifier)
 		directory = priv->current_index_root->root;
 		flags = priv->current_index_root->flags;
 
+		/* Unchanged directories may be skipped if the root
+		 * was indexed and monitored since the last clean
+		 * shutdown, and mtimes are not being checked.
+		 */
+		priv->current_index_root->use_crawl_state =
+			(priv->crawl_state != NULL &&
+			 (flags & TRACKER_DIRECTORY_FLAG_RECURSE) != 0 &&
+			 (flags & TRACKER_DIRECTORY_FLAG_MONITOR) != 0 &&
+			 (flags & TRACKER_DIRECTORY_FLAG_CHECK_MTIME) == 0);
+
 		if ((flags & TRACKER_DIRECTORY_FLAG_IGNORE) == 0 &&
 		    crawl_directory_in_current_root (notifier)) {
+			if (flags & TRACKER_DIRECTORY_FLAG_RECURSE &&
+			    !priv->current_index_root->use_crawl_state) {
+				/* Query the whole root at once while crawling */
+				sparql_root_query_start (notifier);
+			}
+
 			g_timer_reset (priv->timer);
 			g_signal_emit (notifier, signals[DIRECTORY_STARTED], 0, directory);
 
@@ -813,7 +1498,7 @@ crawl_directories_start (TrackerFileNotifier *notifier)
 		priv->current_index_root = NULL;
 	}
 
-	g_signal_emit (notifier, signals[FINISHED], 0);
+	notifier_emit_finished (notifier);
 
 	return FALSE;
 }
@@ -825,7 +1510,6 @@ crawler_finished_cb (TrackerCrawler *crawler,
 {
 	TrackerFileNotifier *notifier = user_data;
 	TrackerFileNotifierPrivate *priv = notifier->priv;
-	GFile *directory;
 
 	g_assert (priv->current_index_root != NULL);
 
@@ -834,19 +1518,15 @@ crawler_finished_cb (TrackerCrawler *crawler,
 		return;
 	}
 
-	directory = g_queue_peek_head (priv->current_index_root->pending_dirs);
-
-	if (priv->current_index_root->query_files->len > 0 &&
-	    (directory == priv->current_index_root->root ||
-	     tracker_file_system_get_property (priv->file_system,
-	                                       directory, quark_property_iri))) {
-		sparql_files_query_start (notifier,
-					  (GFile**) priv->current_index_root->query_files->pdata,
-		                          priv->current_index_root->query_files->len);
-		g_ptr_array_set_size (priv->current_index_root->query_files, 0);
+	if (priv->current_index_root->stream_contents) {
+		if (!priv->current_index_root->cursor_ready) {
+			/* Continued when the store contents arrive */
+			priv->current_index_root->waiting_cursor = TRUE;
+		} else {
+			notifier_stream_check_directory (notifier);
+		}
 	} else {
-		file_notifier_traverse_tree (notifier);
-		finish_current_directory (notifier);
+		notifier_query_crawled_files (notifier);
 	}
 }
 
@@ -1326,6 +2006,10 @@ tracker_file_notifier_finalize (GObject *object)
 	g_list_free (priv->pending_index_roots);
 	g_timer_destroy (priv->timer);
 
+	if (priv->crawl_state) {
+		g_hash_table_unref (priv->crawl_state);
+	}
+
 	G_OBJECT_CLASS (tracker_file_notifier_parent_class)->finalize (object);
 }
 
@@ -1448,6 +2132,10 @@ tracker_file_notifier_class_init (TrackerFileNotifierClass *klass)
 	quark_property_filesystem_mtime = g_quark_from_static_string ("tracker-property-filesystem-mtime");
 	tracker_file_system_register_property (quark_property_filesystem_mtime,
 	                                       g_free);
+
+	quark_property_n_files = g_quark_from_static_string ("tracker-property-n-files");
+	tracker_file_system_register_property (quark_property_n_files,
+	                                       g_free);
 }
 
 static void
@@ -1545,7 +2233,7 @@ tracker_file_notifier_start (TrackerFileNotifier *notifier)
 		if (priv->pending_index_roots) {
 			crawl_directories_start (notifier);
 		} else {
-			g_signal_emit (notifier, signals[FINISHED], 0);
+			notifier_emit_finished (notifier);
 		}
 	}
 
@@ -1579,6 +2267,63 @@ tracker_file_notifier_is_active (TrackerFileNotifier *notifier)
 	return priv->pending_index_roots || priv->current_index_root;
 }
 
+/**
+ * tracker_file_notifier_boost_directory:
+ * @notifier: a #TrackerFileNotifier
+ * @directory: a #GFile
+ *
+ * Makes @directory be crawled next if it is pending to be crawled,
+ * either in the root being currently crawled, or as part of a root
+ * yet to be crawled, in which case that root is crawled next.
+ *
+ * Returns: %TRUE if @directory was pending to be crawled.
+ **/
+gboolean
+tracker_file_notifier_boost_directory (TrackerFileNotifier *notifier,
+                                       GFile               *directory)
+{
+	TrackerFileNotifierPrivate *priv;
+	GFile *canonical;
+	GList *l;
+
+	g_return_val_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier), FALSE);
+	g_return_val_if_fail (G_IS_FILE (directory), FALSE);
+
+	priv = notifier->priv;
+
+	if (priv->current_index_root) {
+		canonical = tracker_file_system_peek_file (priv->file_system,
+		                                           directory);
+
+		if (canonical &&
+		    g_hash_table_contains (priv->current_index_root->pending_links,
+		                           canonical)) {
+			/* If contents are being streamed from the store,
+			 * the directory is crawled after the current group.
+			 */
+			root_data_move_pending_to_head (priv->current_index_root,
+			                                canonical);
+			return TRUE;
+		}
+	}
+
+	for (l = priv->pending_index_roots; l; l = l->next) {
+		RootData *data = l->data;
+
+		if (g_file_equal (data->root, directory) ||
+		    g_file_has_prefix (directory, data->root)) {
+			/* Crawl this root next */
+			priv->pending_index_roots =
+				g_list_remove_link (priv->pending_index_roots, l);
+			priv->pending_index_roots =
+				g_list_concat (l, priv->pending_index_roots);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 const gchar *
 tracker_file_notifier_get_file_iri (TrackerFileNotifier *notifier,
                                     GFile               *file,
@@ -1626,3 +2371,265 @@ tracker_file_notifier_get_file_iri (TrackerFileNotifier *notifier,
 
 	return iri;
 }
+
+static void
+crawl_state_entry_free (CrawlStateEntry *entry)
+{
+	g_ptr_array_unref (entry->subdirs);
+	g_slice_free (CrawlStateEntry, entry);
+}
+
+static CrawlStateEntry *
+crawl_state_lookup_entry (GHashTable  *crawl_state,
+                          const gchar *uri)
+{
+	CrawlStateEntry *entry;
+
+	entry = g_hash_table_lookup (crawl_state, uri);
+
+	if (!entry) {
+		entry = g_slice_new0 (CrawlStateEntry);
+		entry->subdirs = g_ptr_array_new_with_free_func (g_free);
+		g_hash_table_insert (crawl_state, g_strdup (uri), entry);
+	}
+
+	return entry;
+}
+
+/**
+ * tracker_file_notifier_load_crawl_state:
+ * @notifier: a #TrackerFileNotifier
+ * @filename: file written by tracker_file_notifier_save_crawl_state()
+ * @checksum: string identifying the configuration the state applies to
+ * @error: return location for errors
+ *
+ * Loads the state of all monitored directories as it was when saved,
+ * so directories that did not change since can be skipped during the
+ * next crawl. The state is discarded after that first crawl finishes.
+ *
+ * Returns: %TRUE if the state was loaded, %FALSE if @error is set.
+ **/
+gboolean
+tracker_file_notifier_load_crawl_state (TrackerFileNotifier  *notifier,
+                                        const gchar          *filename,
+                                        const gchar          *checksum,
+                                        GError              **error)
+{
+	TrackerFileNotifierPrivate *priv;
+	GHashTable *crawl_state;
+	gchar *contents, *header, **lines;
+	guint i;
+
+	g_return_val_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (checksum != NULL, FALSE);
+
+	priv = notifier->priv;
+
+	if (!g_file_get_contents (filename, &contents, NULL, error)) {
+		return FALSE;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+	header = g_strdup_printf (CRAWL_STATE_HEADER " %s", checksum);
+	g_free (contents);
+
+	if (g_strcmp0 (lines[0], header) != 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		             "Crawl state '%s' has an unknown format or "
+		             "applies to a different configuration", filename);
+		g_strfreev (lines);
+		g_free (header);
+		return FALSE;
+	}
+
+	g_free (header);
+	crawl_state = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                     (GDestroyNotify) crawl_state_entry_free);
+
+	for (i = 1; lines[i]; i++) {
+		CrawlStateEntry *entry, *parent_entry;
+		GFile *file, *parent;
+		gchar *str, *end, *uri;
+		guint64 mtime, n_files, skippable;
+
+		/* "<mtime> <n_files> <skippable> <uri>" */
+		str = lines[i];
+		mtime = g_ascii_strtoull (str, &end, 10);
+		if (end == str || *end != ' ')
+			continue;
+
+		str = end + 1;
+		n_files = g_ascii_strtoull (str, &end, 10);
+		if (end == str || *end != ' ')
+			continue;
+
+		str = end + 1;
+		skippable = g_ascii_strtoull (str, &end, 10);
+		if (end == str || *end != ' ' || end[1] == '\0')
+			continue;
+
+		entry = crawl_state_lookup_entry (crawl_state, end + 1);
+		entry->mtime = mtime;
+		entry->n_files = (guint) n_files;
+		entry->skippable = (skippable != 0);
+
+		/* Directories are saved before their subdirectories,
+		 * so the parent entry exists already if it was saved.
+		 */
+		file = g_file_new_for_uri (end + 1);
+		parent = g_file_get_parent (file);
+
+		if (parent) {
+			uri = g_file_get_uri (parent);
+			parent_entry = g_hash_table_lookup (crawl_state, uri);
+
+			if (parent_entry) {
+				g_ptr_array_add (parent_entry->subdirs,
+				                 g_strdup (end + 1));
+			}
+
+			g_object_unref (parent);
+			g_free (uri);
+		}
+
+		g_object_unref (file);
+	}
+
+	g_strfreev (lines);
+
+	if (priv->crawl_state) {
+		g_hash_table_unref (priv->crawl_state);
+	}
+
+	priv->crawl_state = crawl_state;
+
+	return TRUE;
+}
+
+typedef struct {
+	TrackerFileNotifier *notifier;
+	GFile *directory;
+	gboolean complete;
+} CrawlStateCheckData;
+
+static gboolean
+crawl_state_check_children_foreach (GFile    *file,
+                                    gpointer  user_data)
+{
+	CrawlStateCheckData *data = user_data;
+	TrackerFileNotifierPrivate *priv = data->notifier->priv;
+
+	if (file == data->directory)
+		return FALSE;
+
+	/* A subdirectory the state would not list makes the
+	 * directory unsuitable for skipping on the next crawl.
+	 */
+	if (tracker_file_system_get_file_type (priv->file_system, file) == G_FILE_TYPE_DIRECTORY &&
+	    (!tracker_file_system_get_property (priv->file_system, file,
+	                                        quark_property_filesystem_mtime) ||
+	     !tracker_file_system_get_property (priv->file_system, file,
+	                                        quark_property_n_files))) {
+		data->complete = FALSE;
+	}
+
+	/* Only direct children are checked */
+	return TRUE;
+}
+
+typedef struct {
+	TrackerFileNotifier *notifier;
+	GString *str;
+} CrawlStateSaveData;
+
+static gboolean
+crawl_state_save_foreach (GFile    *file,
+                          gpointer  user_data)
+{
+	CrawlStateSaveData *data = user_data;
+	TrackerFileNotifierPrivate *priv = data->notifier->priv;
+	CrawlStateCheckData check_data;
+	gboolean skippable;
+	guint64 *mtime;
+	guint *n_files;
+	gchar *uri;
+
+	if (tracker_file_system_get_file_type (priv->file_system, file) != G_FILE_TYPE_DIRECTORY)
+		return FALSE;
+
+	mtime = tracker_file_system_get_property (priv->file_system, file,
+	                                          quark_property_filesystem_mtime);
+	n_files = tracker_file_system_get_property (priv->file_system, file,
+	                                            quark_property_n_files);
+
+	if (!mtime || !n_files)
+		return FALSE;
+
+	check_data.notifier = data->notifier;
+	check_data.directory = file;
+	check_data.complete = TRUE;
+	tracker_file_system_traverse (priv->file_system, file, G_PRE_ORDER,
+	                              crawl_state_check_children_foreach,
+	                              &check_data);
+
+	/* All crawled directories are listed, so their parents know
+	 * about them, but changes could only be tracked on monitored
+	 * directories whose subdirectories are all listed too.
+	 */
+	skippable = (check_data.complete &&
+	             tracker_monitor_is_watched (priv->monitor, file));
+
+	uri = g_file_get_uri (file);
+	g_string_append_printf (data->str, "%" G_GUINT64_FORMAT " %u %d %s\n",
+	                        *mtime, *n_files, skippable ? 1 : 0, uri);
+	g_free (uri);
+
+	return FALSE;
+}
+
+/**
+ * tracker_file_notifier_save_crawl_state:
+ * @notifier: a #TrackerFileNotifier
+ * @filename: file to write the state to
+ * @checksum: string identifying the current configuration
+ * @error: return location for errors
+ *
+ * Saves the state of all crawled and monitored directories, to be
+ * loaded through tracker_file_notifier_load_crawl_state(). This is
+ * only meaningful if all changes notified so far were processed.
+ *
+ * Returns: %TRUE on success, %FALSE if @error is set.
+ **/
+gboolean
+tracker_file_notifier_save_crawl_state (TrackerFileNotifier  *notifier,
+                                        const gchar          *filename,
+                                        const gchar          *checksum,
+                                        GError              **error)
+{
+	TrackerFileNotifierPrivate *priv;
+	CrawlStateSaveData data;
+	gchar *dirname;
+	gboolean retval;
+
+	g_return_val_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (checksum != NULL, FALSE);
+
+	priv = notifier->priv;
+	data.notifier = notifier;
+	data.str = g_string_new (NULL);
+	g_string_append_printf (data.str, CRAWL_STATE_HEADER " %s\n", checksum);
+
+	tracker_file_system_traverse (priv->file_system, NULL, G_PRE_ORDER,
+	                              crawl_state_save_foreach, &data);
+
+	dirname = g_path_get_dirname (filename);
+	g_mkdir_with_parents (dirname, 0700);
+	g_free (dirname);
+
+	retval = g_file_set_contents (filename, data.str->str, data.str->len, error);
+	g_string_free (data.str, TRUE);
+
+	return retval;
+}
@@ -80,11 +80,22 @@ TrackerFileNotifier* tracker_file_notifier_new  (TrackerIndexingTree *indexing_t
 gboolean      tracker_file_notifier_start (TrackerFileNotifier *notifier);
 void          tracker_file_notifier_stop  (TrackerFileNotifier *notifier);
 gboolean      tracker_file_notifier_is_active (TrackerFileNotifier *notifier);
+gboolean      tracker_file_notifier_boost_directory (TrackerFileNotifier *notifier,
+                                                     GFile               *directory);
 
 const gchar * tracker_file_notifier_get_file_iri (TrackerFileNotifier *notifier,
                                                   GFile               *file,
                                                   gboolean             force);
 
+gboolean      tracker_file_notifier_load_crawl_state (TrackerFileNotifier  *notifier,
+                                                      const gchar          *filename,
+                                                      const gchar          *checksum,
+                                                      GError              **error);
+gboolean      tracker_file_notifier_save_crawl_state (TrackerFileNotifier  *notifier,
+                                                      const gchar          *filename,
+                                                      const gchar          *checksum,
+                                                      GError              **error);
+
 G_END_DECLS
 
 #endif /* __TRACKER_FILE_SYSTEM_H__ */
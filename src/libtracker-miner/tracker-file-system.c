@@ -24,38 +24,73 @@
 
 #include "tracker-file-system.h"
 
+/* Nodes are allocated in chunks of this size */
+#define FILE_NODE_CHUNK_SIZE 512
+
+/* Properties registered first are stored in the node itself */
+#define N_INLINE_PROPERTIES 4
+
 typedef struct _TrackerFileSystemPrivate TrackerFileSystemPrivate;
-typedef struct _FileNodeProperty FileNodeProperty;
-typedef struct _FileNodeData FileNodeData;
-typedef struct _NodeLookupData NodeLookupData;
+typedef struct _FileNodePropertyInfo FileNodePropertyInfo;
+typedef struct _FileNodeName FileNodeName;
+typedef struct _FileNode FileNode;
 
+/* Registered properties, quark -> index + 1 */
 static GHashTable *properties = NULL;
+static GArray *property_infos = NULL;
 
 struct _TrackerFileSystemPrivate {
-	GNode *file_tree;
+	FileNode *root;
+
+	/* Canonical GFile -> FileNode */
+	GHashTable *file_nodes;
+
+	/* Set of nodes, looked up by parent and name */
+	GHashTable *children;
+
+	/* Interned name segments */
+	GHashTable *names;
+
+	GSList *node_chunks;
+	FileNode *free_nodes;
+
+	/* Nodes aren't freed while traversing, as traverse
+	 * functions may drop the last reference on files.
+	 */
+	guint n_traversals;
+	GPtrArray *deferred_prunes;
 };
 
-struct _FileNodeProperty {
+struct _FileNodePropertyInfo {
 	GQuark prop_quark;
-	gpointer value;
+	GDestroyNotify destroy_notify;
 };
 
-struct _FileNodeData {
+struct _FileNodeName {
+	guint ref_count;
+	gchar str[1];
+};
+
+struct _FileNode {
+	FileNode *parent;
+	FileNode *children;
+
+	/* The first child's prev pointer points to the last child */
+	FileNode *prev;
+	FileNode *next;
+
+	FileNodeName *name;
 	GFile *file;
-	gchar *uri_suffix;
-	GArray *properties;
+
+	gpointer properties[N_INLINE_PROPERTIES];
+	gpointer *extra_properties;
+
+	guint n_extra_properties : 16;
 	guint shallow   : 1;
 	guint unowned : 1;
 	guint file_type : 4;
 };
 
-struct _NodeLookupData {
-	TrackerFileSystem *file_system;
-	GNode *node;
-};
-
-static GQuark quark_file_node = 0;
-
 static void file_weak_ref_notify (gpointer  user_data,
                                   GObject  *prev_location);
 
@@ -75,267 +110,446 @@ G_DEFINE_TYPE (TrackerFileSystem, tracker_file_system, G_TYPE_OBJECT)
  * tracker_file_system_forget_files() is called to delete them if there are
  * references held on them elsewhere, and they will stay until all references
  * are dropped.
+ *
+ * Internally, files are kept in a trie with a node for each path
+ * component, names are shared between nodes with the same name.
+ * Nodes for parent directories that were never requested have no
+ * GFile, a GFile is only set on these when asked for the directory
+ * itself. Nodes are kept in chunks that are only released when the
+ * TrackerFileSystem is finalized.
  */
 
+static FileNodeName *
+file_node_name_ref (TrackerFileSystemPrivate *priv,
+                    const gchar              *str)
+{
+	FileNodeName *name;
+
+	name = g_hash_table_lookup (priv->names, str);
+
+	if (!name) {
+		gsize len;
+
+		len = strlen (str);
+		name = g_malloc (G_STRUCT_OFFSET (FileNodeName, str) + len + 1);
+		name->ref_count = 0;
+		memcpy (name->str, str, len + 1);
+
+		g_hash_table_insert (priv->names, name->str, name);
+	}
+
+	name->ref_count++;
+
+	return name;
+}
 
 static void
-file_node_data_free (FileNodeData *data,
-                     GNode        *node)
+file_node_name_unref (TrackerFileSystemPrivate *priv,
+                      FileNodeName             *name)
 {
-	guint i;
-
-	if (data->file) {
-		if (!data->shallow) {
-			g_object_weak_unref (G_OBJECT (data->file),
-			                     file_weak_ref_notify,
-			                     node);
-		}
+	name->ref_count--;
 
-		if (!data->unowned) {
-			g_object_unref (data->file);
-		}
+	if (name->ref_count == 0) {
+		/* Frees the name */
+		g_hash_table_remove (priv->names, name->str);
 	}
+}
+
+static guint
+file_node_hash (gconstpointer key)
+{
+	const FileNode *node = key;
+
+	return (GPOINTER_TO_UINT (node->parent) >> 3) * 31 +
+		(GPOINTER_TO_UINT (node->name) >> 3);
+}
+
+static gboolean
+file_node_equal (gconstpointer a,
+                 gconstpointer b)
+{
+	const FileNode *node_a = a, *node_b = b;
 
-	data->file = NULL;
-	g_free (data->uri_suffix);
+	/* Names are interned */
+	return (node_a->parent == node_b->parent &&
+	        node_a->name == node_b->name);
+}
 
-	for (i = 0; i < data->properties->len; i++) {
-		FileNodeProperty *property;
-		GDestroyNotify destroy_notify;
+static FileNode *
+file_node_alloc (TrackerFileSystemPrivate *priv)
+{
+	FileNode *node;
 
-		property = &g_array_index (data->properties,
-		                           FileNodeProperty, i);
+	if (!priv->free_nodes) {
+		FileNode *chunk;
+		gint i;
 
-		destroy_notify = g_hash_table_lookup (properties,
-		                                      GUINT_TO_POINTER (property->prop_quark));
+		chunk = g_new (FileNode, FILE_NODE_CHUNK_SIZE);
+		priv->node_chunks = g_slist_prepend (priv->node_chunks, chunk);
 
-		if (destroy_notify) {
-			(destroy_notify) (property->value);
+		for (i = 0; i < FILE_NODE_CHUNK_SIZE; i++) {
+			chunk[i].next = priv->free_nodes;
+			priv->free_nodes = &chunk[i];
 		}
 	}
 
-	g_array_free (data->properties, TRUE);
-	g_slice_free (FileNodeData, data);
+	node = priv->free_nodes;
+	priv->free_nodes = node->next;
+	memset (node, 0, sizeof (FileNode));
+
+	return node;
 }
 
-static FileNodeData *
-file_node_data_new (TrackerFileSystem *file_system,
-                    GFile             *file,
-                    GFileType          file_type,
-                    GNode             *node)
+static FileNode *
+file_node_lookup_child (TrackerFileSystemPrivate *priv,
+                        FileNode                 *parent,
+                        const gchar              *name)
 {
-	FileNodeData *data;
-	NodeLookupData lookup_data;
-	GArray *node_data;
+	FileNode key;
 
-	data = g_slice_new0 (FileNodeData);
-	data->file = g_object_ref (file);
-	data->file_type = file_type;
-	data->properties = g_array_new (FALSE, TRUE, sizeof (FileNodeProperty));
+	key.name = g_hash_table_lookup (priv->names, name);
 
-	/* We use weak refs to keep track of files */
-	g_object_weak_ref (G_OBJECT (data->file), file_weak_ref_notify, node);
+	if (!key.name) {
+		return NULL;
+	}
 
-	node_data = g_object_get_qdata (G_OBJECT (data->file),
-	                                quark_file_node);
+	key.parent = parent;
 
-	if (!node_data) {
-		node_data = g_array_new (FALSE, FALSE, sizeof (NodeLookupData));
-		g_object_set_qdata_full (G_OBJECT (data->file),
-		                         quark_file_node,
-		                         node_data,
-		                         (GDestroyNotify) g_array_unref);
-	}
+	return g_hash_table_lookup (priv->children, &key);
+}
 
-	lookup_data.file_system = file_system;
-	lookup_data.node = node;
-	g_array_append_val (node_data, lookup_data);
+static FileNode *
+file_node_new_child (TrackerFileSystemPrivate *priv,
+                     FileNode                 *parent,
+                     const gchar              *name)
+{
+	FileNode *node, *first;
+
+	node = file_node_alloc (priv);
+	node->parent = parent;
+	node->name = file_node_name_ref (priv, name);
+	node->file_type = G_FILE_TYPE_UNKNOWN;
+
+	/* Append to the children list */
+	first = parent->children;
+
+	if (first) {
+		node->prev = first->prev;
+		first->prev->next = node;
+		first->prev = node;
+	} else {
+		node->prev = node;
+		parent->children = node;
+	}
 
-	g_assert (node->data == NULL);
-	node->data = data;
+	g_hash_table_add (priv->children, node);
 
-	return data;
+	return node;
 }
 
-static FileNodeData *
-file_node_data_root_new (void)
+static void
+file_node_clear_properties (FileNode *node)
 {
-	FileNodeData *data;
+	FileNodePropertyInfo *info;
+	gpointer value;
+	guint i;
 
-	data = g_slice_new0 (FileNodeData);
-	data->uri_suffix = g_strdup ("file:///");
-	data->file = g_file_new_for_uri (data->uri_suffix);
-	data->properties = g_array_new (FALSE, TRUE, sizeof (FileNodeProperty));
-	data->file_type = G_FILE_TYPE_DIRECTORY;
-	data->shallow = TRUE;
+	for (i = 0; property_infos && i < property_infos->len; i++) {
+		if (i < N_INLINE_PROPERTIES) {
+			value = node->properties[i];
+			node->properties[i] = NULL;
+		} else if (i - N_INLINE_PROPERTIES < node->n_extra_properties) {
+			value = node->extra_properties[i - N_INLINE_PROPERTIES];
+		} else {
+			break;
+		}
+
+		info = &g_array_index (property_infos, FileNodePropertyInfo, i);
+
+		if (value && info->destroy_notify) {
+			(info->destroy_notify) (value);
+		}
+	}
 
-	return data;
+	g_free (node->extra_properties);
+	node->extra_properties = NULL;
+	node->n_extra_properties = 0;
 }
 
-static gboolean
-file_node_data_equal_or_child (GNode  *node,
-                               gchar  *uri_suffix,
-                               gchar **uri_remainder)
-{
-	FileNodeData *data;
-	gsize len;
-
-	data = node->data;
-	len = strlen (data->uri_suffix);
-
-	if (strncmp (uri_suffix, data->uri_suffix, len) == 0) {
-		uri_suffix += len;
-
-		if (uri_suffix[0] == '/') {
-			uri_suffix++;
-		} else if (uri_suffix[0] != '\0' &&
-		           (len < 4 ||
-		            strcmp (data->uri_suffix + len - 4, ":///") != 0)) {
-			/* If the first char isn't an uri separator
-			 * nor \0, node represents a similarly named
-			 * file, but not a parent after all.
-			 */
-			return FALSE;
+static void
+file_node_free (TrackerFileSystemPrivate *priv,
+                FileNode                 *node)
+{
+	FileNode *parent, *first;
+
+	g_assert (node->children == NULL);
+	g_assert (node->file == NULL);
+
+	/* Unlink from the children list */
+	parent = node->parent;
+	first = parent->children;
+
+	if (node == first) {
+		parent->children = node->next;
+
+		if (node->next) {
+			node->next->prev = node->prev;
 		}
+	} else {
+		node->prev->next = node->next;
 
-		if (uri_remainder) {
-			*uri_remainder = uri_suffix;
+		if (node->next) {
+			node->next->prev = node->prev;
+		} else {
+			first->prev = node->prev;
 		}
+	}
 
-		return TRUE;
-	} else {
-		return FALSE;
+	g_hash_table_remove (priv->children, node);
+	file_node_name_unref (priv, node->name);
+	file_node_clear_properties (node);
+
+	node->parent = NULL;
+	node->next = priv->free_nodes;
+	priv->free_nodes = node;
+}
+
+/* Frees the node and its parents, as long as these have
+ * no file nor children left.
+ */
+static void
+file_node_prune (TrackerFileSystemPrivate *priv,
+                 FileNode                 *node)
+{
+	while (node != priv->root &&
+	       !node->file && !node->children) {
+		FileNode *parent;
+
+		parent = node->parent;
+		file_node_free (priv, node);
+		node = parent;
 	}
 }
 
-static GNode *
-file_tree_lookup (GNode     *tree,
-                  GFile     *file,
-                  GNode    **parent_node,
-                  gchar    **uri_remainder)
+static void
+file_system_traverse_begin (TrackerFileSystemPrivate *priv)
 {
-	GNode *parent, *node_found, *parent_found;
-	FileNodeData *data;
-	gchar *uri, *ptr;
+	priv->n_traversals++;
+}
 
-	uri = ptr = g_file_get_uri (file);
-	node_found = parent_found = NULL;
+static void
+file_system_traverse_end (TrackerFileSystemPrivate *priv)
+{
+	FileNode *node;
+	guint i;
 
-	/* Run through the filesystem tree, comparing chunks of
-	 * uri with the uri suffix in the file nodes, this would
-	 * get us to the closest registered parent, or the file
-	 * itself.
-	 */
+	g_assert (priv->n_traversals > 0);
 
-	if (parent_node) {
-		*parent_node = NULL;
+	if (--priv->n_traversals > 0) {
+		return;
 	}
 
-	if (uri_remainder) {
-		*uri_remainder = NULL;
-	}
+	for (i = 0; i < priv->deferred_prunes->len; i++) {
+		node = g_ptr_array_index (priv->deferred_prunes, i);
 
-	if (!tree) {
-		return NULL;
+		/* Skip nodes already freed along with a child */
+		if (node->parent) {
+			file_node_prune (priv, node);
+		}
 	}
 
-	if (!G_NODE_IS_ROOT (tree)) {
-		FileNodeData *parent_data;
-		gchar *parent_uri;
+	g_ptr_array_set_size (priv->deferred_prunes, 0);
+}
 
-		parent_data = tree->data;
-		parent_uri = g_file_get_uri (parent_data->file);
+static void
+file_node_set_file (TrackerFileSystem *file_system,
+                    FileNode          *node,
+                    GFile             *file,
+                    GFileType          file_type)
+{
+	TrackerFileSystemPrivate *priv;
 
-		/* Sanity check */
-		if (!g_str_has_prefix (uri, parent_uri)) {
-			g_free (parent_uri);
-			return NULL;
-		}
+	priv = file_system->priv;
 
-		ptr += strlen (parent_uri);
+	g_assert (node->file == NULL);
 
-		g_assert (ptr[0] == '/');
-		ptr++;
+	node->file = g_object_ref (file);
+	node->file_type = file_type;
+	node->unowned = FALSE;
 
-		g_free (parent_uri);
-	} else {
-		/* First check the root node */
-		if (!file_node_data_equal_or_child (tree, uri, &ptr)) {
-			g_free (uri);
-			return NULL;
+	/* We use weak refs to keep track of files */
+	g_object_weak_ref (G_OBJECT (file), file_weak_ref_notify, file_system);
+	g_hash_table_insert (priv->file_nodes, file, node);
+}
+
+static FileNode *
+file_system_lookup_node (TrackerFileSystem *file_system,
+                         GFile             *file,
+                         gboolean           create)
+{
+	TrackerFileSystemPrivate *priv;
+	FileNode *node;
+	gchar *uri, *ptr;
+
+	priv = file_system->priv;
+	uri = g_file_get_uri (file);
+
+	if (!g_str_has_prefix (uri, "file:///")) {
+		if (create) {
+			g_warning ("Could not find parent node for URI:'%s'", uri);
+			g_warning ("NOTE: URI themes other than 'file://' are not supported currently.");
 		}
 
-		/* Second check there is no basename and if there isn't,
-		 * then this node MUST be the closest registered node
-		 * we can use for the uri. The difference here is that
-		 * we return tree not NULL.
-		 */
-		else if (ptr[0] == '\0') {
-			g_free (uri);
-			return tree;
-                }
+		g_free (uri);
+		return NULL;
 	}
 
-	parent = tree;
+	/* Walk the trie, one path component at a time */
+	node = priv->root;
+	ptr = uri + strlen ("file:///");
+
+	while (node && *ptr) {
+		FileNode *child;
+		gchar *end;
 
-	while (parent) {
-		GNode *child, *next = NULL;
-		gchar *ret_ptr;
+		end = strchr (ptr, '/');
 
-		for (child = g_node_first_child (parent);
-		     child != NULL;
-		     child = g_node_next_sibling (child)) {
-			data = child->data;
+		if (end) {
+			*end = '\0';
+		}
 
-			if (data->uri_suffix[0] != ptr[0])
-				continue;
+		if (*ptr) {
+			child = file_node_lookup_child (priv, node, ptr);
 
-			if (file_node_data_equal_or_child (child, ptr, &ret_ptr)) {
-				ptr = ret_ptr;
-				next = child;
-				break;
+			if (!child && create) {
+				child = file_node_new_child (priv, node, ptr);
 			}
+
+			node = child;
 		}
 
-		if (next) {
-			if (ptr[0] == '\0') {
-				/* Exact match */
-				node_found = next;
-				parent_found = parent;
-				break;
-			} else {
-				/* Descent down the child */
-				parent = next;
-			}
-		} else {
-			parent_found = parent;
+		if (!end) {
 			break;
 		}
-	}
-
-	if (parent_node) {
-		*parent_node = parent_found;
-	}
 
-	if (ptr && *ptr && uri_remainder) {
-		*uri_remainder = g_strdup (ptr);
+		ptr = end + 1;
 	}
 
 	g_free (uri);
 
-	return node_found;
+	return node;
+}
+
+/* Returns the node for a file in the filesystem */
+static FileNode *
+file_system_get_node (TrackerFileSystem *file_system,
+                      GFile             *file)
+{
+	TrackerFileSystemPrivate *priv;
+	FileNode *node;
+
+	priv = file_system->priv;
+	node = g_hash_table_lookup (priv->file_nodes, file);
+
+	if (!node) {
+		node = file_system_lookup_node (file_system, file, FALSE);
+
+		if (node && !node->file) {
+			node = NULL;
+		}
+	}
+
+	return node;
 }
 
 static gboolean
-file_tree_free_node_foreach (GNode    *node,
-                             gpointer  user_data)
+file_node_traverse_pre_order (FileNode                      *node,
+                              TrackerFileSystemTraverseFunc  func,
+                              gpointer                       user_data)
 {
-	file_node_data_free (node->data, node);
+	FileNode *child;
+
+	if (node->file && func (node->file, user_data)) {
+		/* Avoid recursing within the children of this node */
+		return FALSE;
+	}
+
+	for (child = node->children; child; child = child->next) {
+		file_node_traverse_pre_order (child, func, user_data);
+	}
+
 	return FALSE;
 }
 
+static void
+file_node_traverse_post_order (FileNode                      *node,
+                               TrackerFileSystemTraverseFunc  func,
+                               gpointer                       user_data)
+{
+	FileNode *child;
+
+	for (child = node->children; child; child = child->next) {
+		file_node_traverse_post_order (child, func, user_data);
+	}
+
+	if (node->file) {
+		func (node->file, user_data);
+	}
+}
+
+static void
+file_node_traverse_level_order (FileNode                      *node,
+                                TrackerFileSystemTraverseFunc  func,
+                                gpointer                       user_data)
+{
+	GQueue queue = G_QUEUE_INIT;
+
+	g_queue_push_tail (&queue, node);
+
+	while ((node = g_queue_pop_head (&queue)) != NULL) {
+		FileNode *child;
+
+		if (node->file && func (node->file, user_data)) {
+			/* Avoid recursing within the children of this node */
+			continue;
+		}
+
+		for (child = node->children; child; child = child->next) {
+			g_queue_push_tail (&queue, child);
+		}
+	}
+}
+
 /* TrackerFileSystem implementation */
 
+static void
+file_node_finalize (FileNode *node,
+                    gpointer  user_data)
+{
+	TrackerFileSystem *file_system = user_data;
+	FileNode *child;
+
+	for (child = node->children; child; child = child->next) {
+		file_node_finalize (child, file_system);
+	}
+
+	file_node_clear_properties (node);
+
+	if (node->file) {
+		if (!node->shallow) {
+			g_object_weak_unref (G_OBJECT (node->file),
+			                     file_weak_ref_notify,
+			                     file_system);
+		}
+
+		if (!node->unowned) {
+			g_object_unref (node->file);
+		}
+
+		node->file = NULL;
+	}
+}
+
 static void
 tracker_file_system_finalize (GObject *object)
 {
@@ -343,12 +557,17 @@ tracker_file_system_finalize (GObject *object)
 
 	priv = TRACKER_FILE_SYSTEM (object)->priv;
 
-	g_node_traverse (priv->file_tree,
-	                 G_POST_ORDER,
-	                 G_TRAVERSE_ALL, -1,
-	                 file_tree_free_node_foreach,
-	                 NULL);
-	g_node_destroy (priv->file_tree);
+	/* Property destroy notifies might drop files elsewhere
+	 * in the tree, nodes are all released below anyway.
+	 */
+	priv->n_traversals++;
+	file_node_finalize (priv->root, object);
+
+	g_ptr_array_unref (priv->deferred_prunes);
+	g_slist_free_full (priv->node_chunks, g_free);
+	g_hash_table_unref (priv->file_nodes);
+	g_hash_table_unref (priv->children);
+	g_hash_table_unref (priv->names);
 
 	G_OBJECT_CLASS (tracker_file_system_parent_class)->finalize (object);
 }
@@ -362,23 +581,29 @@ tracker_file_system_class_init (TrackerFileSystemClass *klass)
 
 	g_type_class_add_private (object_class,
 	                          sizeof (TrackerFileSystemPrivate));
-
-	quark_file_node =
-		g_quark_from_static_string ("tracker-quark-file-node");
 }
+
 static void
 tracker_file_system_init (TrackerFileSystem *file_system)
 {
 	TrackerFileSystemPrivate *priv;
-	FileNodeData *root_data;
 
 	file_system->priv = priv =
 		G_TYPE_INSTANCE_GET_PRIVATE (file_system,
 		                             TRACKER_TYPE_FILE_SYSTEM,
 		                             TrackerFileSystemPrivate);
 
-	root_data = file_node_data_root_new ();
-	priv->file_tree = g_node_new (root_data);
+	priv->file_nodes = g_hash_table_new (NULL, NULL);
+	priv->children = g_hash_table_new (file_node_hash, file_node_equal);
+	priv->names = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                     NULL, g_free);
+	priv->deferred_prunes = g_ptr_array_new ();
+
+	priv->root = file_node_alloc (priv);
+	priv->root->file = g_file_new_for_uri ("file:///");
+	priv->root->file_type = G_FILE_TYPE_DIRECTORY;
+	priv->root->shallow = TRUE;
+	g_hash_table_insert (priv->file_nodes, priv->root->file, priv->root);
 }
 
 TrackerFileSystem *
@@ -387,91 +612,32 @@ tracker_file_system_new (void)
 	return g_object_new (TRACKER_TYPE_FILE_SYSTEM, NULL);
 }
 
-static void
-reparent_child_nodes_to_parent (GNode *node)
-{
-	FileNodeData *node_data;
-	GNode *child, *parent;
-
-	if (!node->parent) {
-		return;
-	}
-
-	parent = node->parent;
-	node_data = node->data;
-	child = g_node_first_child (node);
-
-	while (child) {
-		FileNodeData *data;
-		gchar *uri_suffix;
-		GNode *cur;
-
-		cur = child;
-		data = cur->data;
-		child = g_node_next_sibling (child);
-
-		uri_suffix = g_strdup_printf ("%s/%s",
-					      node_data->uri_suffix,
-					      data->uri_suffix);
-
-		g_free (data->uri_suffix);
-		data->uri_suffix = uri_suffix;
-
-		g_node_unlink (cur);
-		g_node_prepend (parent, cur);
-	}
-}
-
 static void
 file_weak_ref_notify (gpointer  user_data,
                       GObject  *prev_location)
-{
-	FileNodeData *data;
-	GNode *node;
-
-	node = user_data;
-	data = node->data;
-
-	g_assert (data->file == (GFile *) prev_location);
-
-	data->file = NULL;
-	reparent_child_nodes_to_parent (node);
-
-	/* Delete node tree here */
-	file_node_data_free (data, NULL);
-	g_node_destroy (node);
-}
-
-static GNode *
-file_system_get_node (TrackerFileSystem *file_system,
-                      GFile             *file)
 {
 	TrackerFileSystemPrivate *priv;
-	GArray *node_data;
-	GNode *node = NULL;
-
-	node_data = g_object_get_qdata (G_OBJECT (file), quark_file_node);
+	FileNode *node;
 
-	if (node_data) {
-		NodeLookupData *cur;
-		guint i;
+	priv = TRACKER_FILE_SYSTEM (user_data)->priv;
+	node = g_hash_table_lookup (priv->file_nodes, prev_location);
 
-		for (i = 0; i < node_data->len; i++) {
-			cur = &g_array_index (node_data, NodeLookupData, i);
+	g_assert (node != NULL);
+	g_assert (node->file == (GFile *) prev_location);
 
-			if (cur->file_system == file_system) {
-				node = cur->node;
-			}
-		}
-	}
+	g_hash_table_remove (priv->file_nodes, prev_location);
+	node->file = NULL;
+	node->file_type = G_FILE_TYPE_UNKNOWN;
+	node->unowned = FALSE;
+	file_node_clear_properties (node);
 
-	if (!node) {
-		priv = file_system->priv;
-		node = file_tree_lookup (priv->file_tree, file,
-		                         NULL, NULL);
+	if (priv->n_traversals > 0) {
+		g_ptr_array_add (priv->deferred_prunes, node);
+		return;
 	}
 
-	return node;
+	/* Children, if any, keep the node in the tree */
+	file_node_prune (priv, node);
 }
 
 GFile *
@@ -481,64 +647,41 @@ tracker_file_system_get_file (TrackerFileSystem *file_system,
                               GFile             *parent)
 {
 	TrackerFileSystemPrivate *priv;
-	FileNodeData *data;
-	GNode *node, *parent_node;
-	gchar *uri_suffix = NULL;
+	FileNode *node;
 
 	g_return_val_if_fail (G_IS_FILE (file), NULL);
 	g_return_val_if_fail (TRACKER_IS_FILE_SYSTEM (file_system), NULL);
 
 	priv = file_system->priv;
-	node = NULL;
-	parent_node = NULL;
 
-	if (parent) {
-		parent_node = file_system_get_node (file_system, parent);
-		node = file_tree_lookup (parent_node, file,
-		                         NULL, &uri_suffix);
-	} else {
-		node = file_tree_lookup (priv->file_tree, file,
-		                         &parent_node, &uri_suffix);
-	}
+	/* Lookups are done per path component, so @parent
+	 * isn't needed to find the insertion point.
+	 */
+	node = g_hash_table_lookup (priv->file_nodes, file);
 
 	if (!node) {
-		if (!parent_node) {
-			gchar *uri;
-
-			uri = g_file_get_uri (file);
-			g_warning ("Could not find parent node for URI:'%s'", uri);
-			g_warning ("NOTE: URI themes other than 'file://' are not supported currently.");
-			g_free (uri);
+		node = file_system_lookup_node (file_system, file, TRUE);
 
+		if (!node) {
 			return NULL;
 		}
+	}
 
-		node = g_node_new (NULL);
-
-		/* Parent was found, add file as child */
-		data = file_node_data_new (file_system, file,
-		                           file_type, node);
-		data->uri_suffix = uri_suffix;
-
-		g_node_append (parent_node, node);
-	} else {
-		data = node->data;
-		g_free (uri_suffix);
-
+	if (!node->file) {
+		file_node_set_file (file_system, node, file, file_type);
+	} else if (node->file_type == G_FILE_TYPE_UNKNOWN) {
 		/* Update file type if it was unknown */
-		if (data->file_type == G_FILE_TYPE_UNKNOWN) {
-			data->file_type = file_type;
-		}
+		node->file_type = file_type;
 	}
 
-	return data->file;
+	return node->file;
 }
 
 GFile *
 tracker_file_system_peek_file (TrackerFileSystem *file_system,
                                GFile             *file)
 {
-	GNode *node;
+	FileNode *node;
 
 	g_return_val_if_fail (G_IS_FILE (file), NULL);
 	g_return_val_if_fail (TRACKER_IS_FILE_SYSTEM (file_system), NULL);
@@ -546,10 +689,7 @@ tracker_file_system_peek_file (TrackerFileSystem *file_system,
 	node = file_system_get_node (file_system, file);
 
 	if (node) {
-		FileNodeData *data;
-
-		data = node->data;
-		return data->file;
+		return node->file;
 	}
 
 	return NULL;
@@ -559,7 +699,7 @@ GFile *
 tracker_file_system_peek_parent (TrackerFileSystem *file_system,
                                  GFile             *file)
 {
-	GNode *node;
+	FileNode *node;
 
 	g_return_val_if_fail (file != NULL, NULL);
 	g_return_val_if_fail (TRACKER_IS_FILE_SYSTEM (file_system), NULL);
@@ -567,62 +707,17 @@ tracker_file_system_peek_parent (TrackerFileSystem *file_system,
 	node = file_system_get_node (file_system, file);
 
 	if (node) {
-		FileNodeData *parent_data;
-		GNode *parent;
-
-		parent = node->parent;
-		parent_data = parent->data;
-
-		return parent_data->file;
+		/* Closest parent in the filesystem */
+		for (node = node->parent; node; node = node->parent) {
+			if (node->file) {
+				return node->file;
+			}
+		}
 	}
 
 	return NULL;
 }
 
-typedef struct {
-	TrackerFileSystemTraverseFunc func;
-	gpointer user_data;
-	GSList *ignore_children;
-} TraverseData;
-
-static gint
-node_is_child_of_ignored (gconstpointer a,
-                          gconstpointer b)
-{
-	if (g_node_is_ancestor ((GNode *) a, (GNode *) b))
-		return 0;
-
-	return 1;
-}
-
-static gboolean
-traverse_filesystem_func (GNode    *node,
-                          gpointer  user_data)
-{
-	TraverseData *data = user_data;
-	FileNodeData *node_data;
-	gboolean retval = FALSE;
-
-	node_data = node->data;
-
-	if (!data->ignore_children ||
-	    !g_slist_find_custom (data->ignore_children,
-	                          node, node_is_child_of_ignored)) {
-		/* This node isn't a child of an
-		 * ignored one, execute callback
-		 */
-		retval = data->func (node_data->file, data->user_data);
-	}
-
-	/* Avoid recursing within the children of this node */
-	if (retval) {
-		data->ignore_children = g_slist_prepend (data->ignore_children,
-		                                         node);
-	}
-
-	return FALSE;
-}
-
 void
 tracker_file_system_traverse (TrackerFileSystem             *file_system,
                               GFile                         *root,
@@ -631,8 +726,7 @@ tracker_file_system_traverse (TrackerFileSystem             *file_system,
                               gpointer                       user_data)
 {
 	TrackerFileSystemPrivate *priv;
-	TraverseData data;
-	GNode *node;
+	FileNode *node;
 
 	g_return_if_fail (TRACKER_IS_FILE_SYSTEM (file_system));
 	g_return_if_fail (func != NULL);
@@ -642,31 +736,42 @@ tracker_file_system_traverse (TrackerFileSystem             *file_system,
 	if (root) {
 		node = file_system_get_node (file_system, root);
 	} else {
-		node = priv->file_tree;
+		node = priv->root;
 	}
 
-	data.func = func;
-	data.user_data = user_data;
-	data.ignore_children = NULL;
+	if (!node) {
+		return;
+	}
 
-	g_node_traverse (node,
-	                 order,
-	                 G_TRAVERSE_ALL,
-	                 -1,
-	                 traverse_filesystem_func,
-	                 &data);
+	file_system_traverse_begin (priv);
+
+	switch (order) {
+	case G_POST_ORDER:
+		file_node_traverse_post_order (node, func, user_data);
+		break;
+	case G_LEVEL_ORDER:
+		file_node_traverse_level_order (node, func, user_data);
+		break;
+	default:
+		file_node_traverse_pre_order (node, func, user_data);
+		break;
+	}
 
-	g_slist_free (data.ignore_children);
+	file_system_traverse_end (priv);
 }
 
 void
 tracker_file_system_register_property (GQuark             prop,
                                        GDestroyNotify     destroy_notify)
 {
+	FileNodePropertyInfo info;
+
 	g_return_if_fail (prop != 0);
 
 	if (!properties) {
 		properties = g_hash_table_new (NULL, NULL);
+		property_infos = g_array_new (FALSE, FALSE,
+		                              sizeof (FileNodePropertyInfo));
 	}
 
 	if (g_hash_table_contains (properties, GUINT_TO_POINTER (prop))) {
@@ -675,26 +780,61 @@ tracker_file_system_register_property (GQuark             prop,
 		return;
 	}
 
+	info.prop_quark = prop;
+	info.destroy_notify = destroy_notify;
+	g_array_append_val (property_infos, info);
+
 	g_hash_table_insert (properties,
 	                     GUINT_TO_POINTER (prop),
-	                     destroy_notify);
+	                     GUINT_TO_POINTER (property_infos->len));
 }
 
-static int
-search_property_node (gconstpointer key,
-                      gconstpointer item)
+/* Returns the index of a registered property, or -1 */
+static gint
+property_get_index (GQuark prop)
 {
-	const FileNodeProperty *key_prop, *prop;
+	gpointer index = NULL;
 
-	key_prop = key;
-	prop = item;
+	if (properties) {
+		index = g_hash_table_lookup (properties, GUINT_TO_POINTER (prop));
+	}
+
+	return GPOINTER_TO_INT (index) - 1;
+}
+
+/* Returns the slot for a property, if @create is FALSE and
+ * the property was never set on the node, NULL is returned.
+ */
+static gpointer *
+file_node_get_property_slot (FileNode *node,
+                             gint      index,
+                             gboolean  create)
+{
+	guint extra_index;
+
+	if (index < N_INLINE_PROPERTIES) {
+		return &node->properties[index];
+	}
+
+	extra_index = index - N_INLINE_PROPERTIES;
+
+	if (extra_index >= node->n_extra_properties) {
+		guint n_extra;
 
-	if (key_prop->prop_quark < prop->prop_quark)
-		return -1;
-	else if (key_prop->prop_quark > prop->prop_quark)
-		return 1;
+		if (!create) {
+			return NULL;
+		}
 
-	return 0;
+		n_extra = property_infos->len - N_INLINE_PROPERTIES;
+		node->extra_properties = g_renew (gpointer,
+		                                  node->extra_properties,
+		                                  n_extra);
+		memset (&node->extra_properties[node->n_extra_properties], 0,
+		        (n_extra - node->n_extra_properties) * sizeof (gpointer));
+		node->n_extra_properties = n_extra;
+	}
+
+	return &node->extra_properties[extra_index];
 }
 
 void
@@ -703,19 +843,18 @@ tracker_file_system_set_property (TrackerFileSystem *file_system,
                                   GQuark             prop,
                                   gpointer           prop_data)
 {
-	FileNodeProperty property, *match;
-	GDestroyNotify destroy_notify;
-	FileNodeData *data;
-	GNode *node;
+	FileNodePropertyInfo *info;
+	gpointer *slot;
+	FileNode *node;
+	gint index;
 
 	g_return_if_fail (TRACKER_IS_FILE_SYSTEM (file_system));
 	g_return_if_fail (file != NULL);
 	g_return_if_fail (prop != 0);
 
-	if (!properties ||
-	    !g_hash_table_lookup_extended (properties,
-	                                   GUINT_TO_POINTER (prop),
-	                                   NULL, (gpointer *) &destroy_notify)) {
+	index = property_get_index (prop);
+
+	if (index < 0) {
 		g_warning ("FileSystem: property '%s' is not registered",
 		           g_quark_to_string (prop));
 		return;
@@ -724,41 +863,14 @@ tracker_file_system_set_property (TrackerFileSystem *file_system,
 	node = file_system_get_node (file_system, file);
 	g_return_if_fail (node != NULL);
 
-	data = node->data;
-
-	property.prop_quark = prop;
-	match = bsearch (&property, data->properties->data,
-	                 data->properties->len, sizeof (FileNodeProperty),
-	                 search_property_node);
-
-	if (match) {
-		if (destroy_notify) {
-			(destroy_notify) (match->value);
-		}
-
-		match->value = prop_data;
-	} else {
-		FileNodeProperty *item;
-		guint i;
-
-		/* No match, insert new element */
-		for (i = 0; i < data->properties->len; i++) {
-			item = &g_array_index (data->properties,
-			                       FileNodeProperty, i);
-
-			if (item->prop_quark > prop) {
-				break;
-			}
-		}
-
-		property.value = prop_data;
+	info = &g_array_index (property_infos, FileNodePropertyInfo, index);
+	slot = file_node_get_property_slot (node, index, TRUE);
 
-		if (i >= data->properties->len) {
-			g_array_append_val (data->properties, property);
-		} else {
-			g_array_insert_val (data->properties, i, property);
-		}
+	if (*slot && info->destroy_notify) {
+		(info->destroy_notify) (*slot);
 	}
+
+	*slot = prop_data;
 }
 
 gpointer
@@ -766,9 +878,9 @@ tracker_file_system_get_property (TrackerFileSystem *file_system,
                                   GFile             *file,
                                   GQuark             prop)
 {
-	FileNodeData *data;
-	FileNodeProperty property, *match;
-	GNode *node;
+	gpointer *slot;
+	FileNode *node;
+	gint index;
 
 	g_return_val_if_fail (TRACKER_IS_FILE_SYSTEM (file_system), NULL);
 	g_return_val_if_fail (file != NULL, NULL);
@@ -777,14 +889,15 @@ tracker_file_system_get_property (TrackerFileSystem *file_system,
 	node = file_system_get_node (file_system, file);
 	g_return_val_if_fail (node != NULL, NULL);
 
-	data = node->data;
-	property.prop_quark = prop;
+	index = property_get_index (prop);
 
-	match = bsearch (&property, data->properties->data,
-	                 data->properties->len, sizeof (FileNodeProperty),
-	                 search_property_node);
+	if (index < 0) {
+		return NULL;
+	}
 
-	return (match) ? match->value : NULL;
+	slot = file_node_get_property_slot (node, index, FALSE);
+
+	return (slot) ? *slot : NULL;
 }
 
 void
@@ -792,85 +905,60 @@ tracker_file_system_unset_property (TrackerFileSystem *file_system,
                                     GFile             *file,
                                     GQuark             prop)
 {
-	FileNodeData *data;
-	FileNodeProperty property, *match;
-	GDestroyNotify destroy_notify = NULL;
-	GNode *node;
-	guint index;
+	FileNodePropertyInfo *info;
+	gpointer *slot;
+	FileNode *node;
+	gint index;
 
 	g_return_if_fail (TRACKER_IS_FILE_SYSTEM (file_system));
 	g_return_if_fail (file != NULL);
 	g_return_if_fail (prop > 0);
 
-	if (!properties ||
-	    !g_hash_table_lookup_extended (properties,
-	                                   GUINT_TO_POINTER (prop),
-	                                   NULL,
-	                                   (gpointer *) &destroy_notify)) {
+	index = property_get_index (prop);
+
+	if (index < 0) {
 		g_warning ("FileSystem: property '%s' is not registered",
 		           g_quark_to_string (prop));
+		return;
 	}
 
 	node = file_system_get_node (file_system, file);
 	g_return_if_fail (node != NULL);
 
-	data = node->data;
-	property.prop_quark = prop;
+	info = &g_array_index (property_infos, FileNodePropertyInfo, index);
+	slot = file_node_get_property_slot (node, index, FALSE);
 
-	match = bsearch (&property, data->properties->data,
-	                 data->properties->len, sizeof (FileNodeProperty),
-	                 search_property_node);
-
-	if (!match) {
+	if (!slot || !*slot) {
 		return;
 	}
 
-	if (destroy_notify) {
-		(destroy_notify) (match->value);
+	if (info->destroy_notify) {
+		(info->destroy_notify) (*slot);
 	}
 
-	/* Find out the index from memory positions */
-	index = (guint) ((FileNodeProperty *) match -
-	                 (FileNodeProperty *) data->properties->data);
-	g_assert (index < data->properties->len);
-
-	g_array_remove_index (data->properties, index);
+	*slot = NULL;
 }
 
-typedef struct {
-	TrackerFileSystem *file_system;
-	GList *list;
-	GFileType file_type;
-} ForgetFilesData;
-
-static gboolean
-append_deleted_files (GNode    *node,
-		      gpointer  user_data)
+static void
+append_deleted_files (FileNode   *node,
+                      GFileType   file_type,
+                      GPtrArray  *files)
 {
-	ForgetFilesData *data;
-	FileNodeData *node_data;
+	FileNode *child;
 
-	data = user_data;
-	node_data = node->data;
-
-	if (data->file_type == G_FILE_TYPE_UNKNOWN ||
-	    node_data->file_type == data->file_type) {
-		data->list = g_list_prepend (data->list, node_data);
+	for (child = node->children; child; child = child->next) {
+		append_deleted_files (child, file_type, files);
 	}
 
-	return FALSE;
-}
-
-static void
-forget_file (FileNodeData *node_data)
-{
-	if (!node_data->unowned) {
-		node_data->unowned = TRUE;
+	/* Regular files are only looked up on leaves */
+	if (file_type == G_FILE_TYPE_REGULAR && node->children) {
+		return;
+	}
 
-		/* Weak reference handler will remove the file from the tree and
-		 * clean up node_data if this is the final reference.
-		 */
-		g_object_unref (node_data->file);
+	if (node->file && !node->unowned &&
+	    (file_type == G_FILE_TYPE_UNKNOWN ||
+	     node->file_type == file_type)) {
+		g_ptr_array_add (files, node->file);
 	}
 }
 
@@ -879,27 +967,42 @@ tracker_file_system_forget_files (TrackerFileSystem *file_system,
 				  GFile             *root,
 				  GFileType          file_type)
 {
-	ForgetFilesData data = { file_system, NULL, file_type };
-	GNode *node;
+	TrackerFileSystemPrivate *priv;
+	GPtrArray *files;
+	FileNode *node;
+	guint i;
 
 	g_return_if_fail (TRACKER_IS_FILE_SYSTEM (file_system));
 	g_return_if_fail (G_IS_FILE (root));
 
+	priv = file_system->priv;
 	node = file_system_get_node (file_system, root);
 	g_return_if_fail (node != NULL);
 
-	/* We need to get the files to delete into a list, so
-	 * the node tree isn't modified during traversal.
+	/* We need to get the files to delete into an array, so
+	 * the node tree isn't modified during traversal. Files
+	 * are added children first.
 	 */
-	g_node_traverse (node,
-	                 G_PRE_ORDER,
-	                 (file_type == G_FILE_TYPE_REGULAR) ?
-	                   G_TRAVERSE_LEAVES : G_TRAVERSE_ALL,
-	                 -1, append_deleted_files,
-	                 &data);
+	files = g_ptr_array_new ();
+	append_deleted_files (node, file_type, files);
+
+	for (i = 0; i < files->len; i++) {
+		node = g_hash_table_lookup (priv->file_nodes,
+		                            g_ptr_array_index (files, i));
+
+		if (node->shallow) {
+			continue;
+		}
+
+		node->unowned = TRUE;
 
-	g_list_foreach (data.list, (GFunc) forget_file, NULL);
-	g_list_free (data.list);
+		/* Weak reference handler will remove the file from the tree and
+		 * clean up the node if this is the final reference.
+		 */
+		g_object_unref (node->file);
+	}
+
+	g_ptr_array_unref (files);
 }
 
 GFileType
@@ -907,7 +1010,7 @@ tracker_file_system_get_file_type (TrackerFileSystem *file_system,
                                    GFile             *file)
 {
 	GFileType file_type = G_FILE_TYPE_UNKNOWN;
-	GNode *node;
+	FileNode *node;
 
 	g_return_val_if_fail (TRACKER_IS_FILE_SYSTEM (file_system), file_type);
 	g_return_val_if_fail (G_IS_FILE (file), file_type);
@@ -915,10 +1018,7 @@ tracker_file_system_get_file_type (TrackerFileSystem *file_system,
 	node = file_system_get_node (file_system, file);
 
 	if (node) {
-		FileNodeData *node_data;
-
-		node_data = node->data;
-		file_type = node_data->file_type;
+		file_type = node->file_type;
 	}
 
 	return file_type;
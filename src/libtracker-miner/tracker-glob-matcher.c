@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "tracker-glob-matcher.h"
+
+/* Matches strings against a set of globs with the same semantics than
+ * GPatternSpec, without testing each glob in turn. The most common
+ * forms are looked up in hash tables: literals ("lost+found"), prefixes
+ * ("tmp*") and suffixes ("*.o"), these take a few lookups regardless of
+ * the number of globs. Every other glob is compiled into a single
+ * regular expression alternation, which is matched as an automaton
+ * running all alternatives at once (see g_regex_match_all()), instead
+ * of backtracking through each.
+ */
+
+/* Prefixes up to this length are looked up without allocating */
+#define PREFIX_BUFFER_SIZE 256
+
+struct _TrackerGlobMatcher {
+	GHashTable *literals;
+	GHashTable *prefixes;
+	GHashTable *suffixes;
+
+	/* Distinct lengths of prefixes and suffixes */
+	GArray *prefix_lengths;
+	GArray *suffix_lengths;
+
+	/* Globs that didn't fit any of the above */
+	GPtrArray *globs;
+	GPtrArray *specs;
+	GRegex *regex;
+
+	guint match_all : 1;
+	guint regex_valid : 1;
+};
+
+TrackerGlobMatcher *
+tracker_glob_matcher_new (void)
+{
+	TrackerGlobMatcher *matcher;
+
+	matcher = g_slice_new0 (TrackerGlobMatcher);
+	matcher->literals = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	matcher->prefixes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	matcher->suffixes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	matcher->prefix_lengths = g_array_new (FALSE, FALSE, sizeof (gsize));
+	matcher->suffix_lengths = g_array_new (FALSE, FALSE, sizeof (gsize));
+	matcher->globs = g_ptr_array_new_with_free_func (g_free);
+	matcher->specs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_pattern_spec_free);
+
+	return matcher;
+}
+
+void
+tracker_glob_matcher_free (TrackerGlobMatcher *matcher)
+{
+	g_return_if_fail (matcher != NULL);
+
+	g_hash_table_unref (matcher->literals);
+	g_hash_table_unref (matcher->prefixes);
+	g_hash_table_unref (matcher->suffixes);
+	g_array_unref (matcher->prefix_lengths);
+	g_array_unref (matcher->suffix_lengths);
+	g_ptr_array_unref (matcher->globs);
+	g_ptr_array_unref (matcher->specs);
+
+	if (matcher->regex) {
+		g_regex_unref (matcher->regex);
+	}
+
+	g_slice_free (TrackerGlobMatcher, matcher);
+}
+
+static void
+lengths_add (GArray *lengths,
+             gsize   length)
+{
+	guint i;
+
+	for (i = 0; i < lengths->len; i++) {
+		if (g_array_index (lengths, gsize, i) == length) {
+			return;
+		}
+	}
+
+	g_array_append_val (lengths, length);
+}
+
+static gchar *
+glob_to_regex (const gchar *glob_string)
+{
+	const gchar *p, *literal;
+	GString *str;
+	gchar *escaped;
+
+	str = g_string_new (NULL);
+	literal = glob_string;
+
+	for (p = glob_string; ; p++) {
+		if (*p != '*' && *p != '?' && *p != '\0') {
+			continue;
+		}
+
+		if (p > literal) {
+			escaped = g_regex_escape_string (literal, p - literal);
+			g_string_append (str, escaped);
+			g_free (escaped);
+		}
+
+		if (*p == '\0') {
+			break;
+		} else if (*p == '*') {
+			g_string_append (str, ".*");
+		} else {
+			g_string_append_c (str, '.');
+		}
+
+		literal = p + 1;
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+static void
+glob_matcher_compile_regex (TrackerGlobMatcher *matcher)
+{
+	GError *error = NULL;
+	GString *str;
+	gchar *regex;
+	guint i;
+
+	if (matcher->regex) {
+		g_regex_unref (matcher->regex);
+		matcher->regex = NULL;
+	}
+
+	str = g_string_new ("^(?:");
+
+	for (i = 0; i < matcher->globs->len; i++) {
+		const gchar *glob_string = g_ptr_array_index (matcher->globs, i);
+
+		if (!g_utf8_validate (glob_string, -1, NULL)) {
+			/* Leave matching to GPatternSpec */
+			g_string_free (str, TRUE);
+			return;
+		}
+
+		regex = glob_to_regex (glob_string);
+
+		if (i > 0) {
+			g_string_append_c (str, '|');
+		}
+
+		g_string_append (str, regex);
+		g_free (regex);
+	}
+
+	g_string_append (str, ")\\z");
+
+	matcher->regex = g_regex_new (str->str,
+	                              G_REGEX_DOTALL | G_REGEX_OPTIMIZE,
+	                              0, &error);
+	if (!matcher->regex) {
+		g_warning ("Could not compile glob filters: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_string_free (str, TRUE);
+}
+
+/**
+ * tracker_glob_matcher_add:
+ * @matcher: a #TrackerGlobMatcher
+ * @glob_string: a glob, as accepted by g_pattern_spec_new()
+ *
+ * Adds @glob_string to the globs matched by @matcher.
+ **/
+void
+tracker_glob_matcher_add (TrackerGlobMatcher *matcher,
+                          const gchar        *glob_string)
+{
+	const gchar *first_wildcard, *last_wildcard;
+	gsize len;
+
+	g_return_if_fail (matcher != NULL);
+	g_return_if_fail (glob_string != NULL);
+
+	len = strlen (glob_string);
+	first_wildcard = strpbrk (glob_string, "*?");
+
+	if (!first_wildcard) {
+		g_hash_table_add (matcher->literals, g_strdup (glob_string));
+		return;
+	}
+
+	if (strspn (glob_string, "*") == len) {
+		matcher->match_all = TRUE;
+		return;
+	}
+
+	last_wildcard = first_wildcard;
+
+	while (strpbrk (last_wildcard + 1, "*?")) {
+		last_wildcard = strpbrk (last_wildcard + 1, "*?");
+	}
+
+	if (first_wildcard == last_wildcard && *first_wildcard == '*') {
+		if (first_wildcard == &glob_string[len - 1]) {
+			/* "prefix*" */
+			g_hash_table_add (matcher->prefixes,
+			                  g_strndup (glob_string, len - 1));
+			lengths_add (matcher->prefix_lengths, len - 1);
+			return;
+		} else if (first_wildcard == glob_string) {
+			/* "*suffix" */
+			g_hash_table_add (matcher->suffixes,
+			                  g_strdup (&glob_string[1]));
+			lengths_add (matcher->suffix_lengths, len - 1);
+			return;
+		}
+	}
+
+	g_ptr_array_add (matcher->globs, g_strdup (glob_string));
+	g_ptr_array_add (matcher->specs, g_pattern_spec_new (glob_string));
+	matcher->regex_valid = FALSE;
+}
+
+static gboolean
+glob_matcher_match_prefix (TrackerGlobMatcher *matcher,
+                           const gchar        *string,
+                           gsize               len)
+{
+	gchar buffer[PREFIX_BUFFER_SIZE];
+	gboolean found;
+	gchar *prefix;
+	gsize length;
+	guint i;
+
+	for (i = 0; i < matcher->prefix_lengths->len; i++) {
+		length = g_array_index (matcher->prefix_lengths, gsize, i);
+
+		if (length > len) {
+			continue;
+		}
+
+		if (length < PREFIX_BUFFER_SIZE) {
+			memcpy (buffer, string, length);
+			buffer[length] = '\0';
+			found = g_hash_table_contains (matcher->prefixes, buffer);
+		} else {
+			prefix = g_strndup (string, length);
+			found = g_hash_table_contains (matcher->prefixes, prefix);
+			g_free (prefix);
+		}
+
+		if (found) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static gboolean
+glob_matcher_match_suffix (TrackerGlobMatcher *matcher,
+                           const gchar        *string,
+                           gsize               len)
+{
+	gsize length;
+	guint i;
+
+	for (i = 0; i < matcher->suffix_lengths->len; i++) {
+		length = g_array_index (matcher->suffix_lengths, gsize, i);
+
+		if (length <= len &&
+		    g_hash_table_contains (matcher->suffixes, &string[len - length])) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * tracker_glob_matcher_match:
+ * @matcher: a #TrackerGlobMatcher
+ * @string: a UTF-8 string
+ *
+ * Returns whether @string matches any of the globs in @matcher, as
+ * g_pattern_match_string() would.
+ *
+ * Returns: %TRUE if @string matches.
+ **/
+gboolean
+tracker_glob_matcher_match (TrackerGlobMatcher *matcher,
+                            const gchar        *string)
+{
+	gsize len;
+	guint i;
+
+	g_return_val_if_fail (matcher != NULL, FALSE);
+	g_return_val_if_fail (string != NULL, FALSE);
+
+	if (matcher->match_all) {
+		return TRUE;
+	}
+
+	if (g_hash_table_contains (matcher->literals, string)) {
+		return TRUE;
+	}
+
+	len = strlen (string);
+
+	if (glob_matcher_match_suffix (matcher, string, len) ||
+	    glob_matcher_match_prefix (matcher, string, len)) {
+		return TRUE;
+	}
+
+	if (matcher->globs->len == 0) {
+		return FALSE;
+	}
+
+	if (!matcher->regex_valid) {
+		glob_matcher_compile_regex (matcher);
+		matcher->regex_valid = TRUE;
+	}
+
+	if (matcher->regex && g_utf8_validate (string, len, NULL)) {
+		return g_regex_match_all (matcher->regex, string, 0, NULL);
+	}
+
+	for (i = 0; i < matcher->specs->len; i++) {
+		if (g_pattern_match (g_ptr_array_index (matcher->specs, i),
+		                     len, string, NULL)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_MINER_GLOB_MATCHER_H__
+#define __LIBTRACKER_MINER_GLOB_MATCHER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TrackerGlobMatcher TrackerGlobMatcher;
+
+TrackerGlobMatcher * tracker_glob_matcher_new   (void);
+void                 tracker_glob_matcher_free  (TrackerGlobMatcher *matcher);
+
+void                 tracker_glob_matcher_add   (TrackerGlobMatcher *matcher,
+                                                 const gchar        *glob_string);
+gboolean             tracker_glob_matcher_match (TrackerGlobMatcher *matcher,
+                                                 const gchar        *string);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_MINER_GLOB_MATCHER_H__ */
@@ -21,6 +21,7 @@
 
 #include <libtracker-common/tracker-file-utils.h>
 #include "tracker-indexing-tree.h"
+#include "tracker-glob-matcher.h"
 
 /**
  * SECTION:tracker-indexing-tree
@@ -46,7 +47,7 @@ struct _NodeData
 
 struct _PatternData
 {
-	GPatternSpec *pattern;
+	gchar *glob_string;
 	TrackerFilterType type;
 	GFile *file; /* Only filled in in absolute paths */
 };
@@ -64,6 +65,12 @@ struct _TrackerIndexingTreePrivate
 	GList *filter_patterns;
 	TrackerFilterPolicy policies[TRACKER_FILTER_PARENT_DIRECTORY + 1];
 
+	/* Filters of each type compiled into a single matcher, and those
+	 * given as absolute paths, built on demand from filter_patterns.
+	 */
+	TrackerGlobMatcher *matchers[TRACKER_FILTER_PARENT_DIRECTORY + 1];
+	GList *path_filters[TRACKER_FILTER_PARENT_DIRECTORY + 1];
+
 	guint filter_hidden : 1;
 };
 
@@ -117,7 +124,7 @@ pattern_data_new (const gchar *glob_string,
 	PatternData *data;
 
 	data = g_slice_new0 (PatternData);
-	data->pattern = g_pattern_spec_new (glob_string);
+	data->glob_string = g_strdup (glob_string);
 	data->type = type;
 
 	if (g_path_is_absolute (glob_string)) {
@@ -134,7 +141,7 @@ pattern_data_free (PatternData *data)
 		g_object_unref (data->file);
 	}
 
-	g_pattern_spec_free (data->pattern);
+	g_free (data->glob_string);
 	g_slice_free (PatternData, data);
 }
 
@@ -179,15 +186,67 @@ tracker_indexing_tree_set_property (GObject      *object,
 	}
 }
 
+static void
+indexing_tree_invalidate_filters (TrackerIndexingTree *tree,
+                                  TrackerFilterType    type)
+{
+	TrackerIndexingTreePrivate *priv = tree->priv;
+
+	if (priv->matchers[type]) {
+		tracker_glob_matcher_free (priv->matchers[type]);
+		priv->matchers[type] = NULL;
+	}
+
+	g_list_free (priv->path_filters[type]);
+	priv->path_filters[type] = NULL;
+}
+
+static TrackerGlobMatcher *
+indexing_tree_get_matcher (TrackerIndexingTree *tree,
+                           TrackerFilterType    type)
+{
+	TrackerIndexingTreePrivate *priv = tree->priv;
+	GList *l;
+
+	if (priv->matchers[type]) {
+		return priv->matchers[type];
+	}
+
+	priv->matchers[type] = tracker_glob_matcher_new ();
+
+	for (l = priv->filter_patterns; l; l = l->next) {
+		PatternData *data = l->data;
+
+		if (data->type != type)
+			continue;
+
+		if (data->file) {
+			/* Absolute paths never match a basename */
+			priv->path_filters[type] = g_list_prepend (priv->path_filters[type],
+			                                           data->file);
+		} else {
+			tracker_glob_matcher_add (priv->matchers[type],
+			                          data->glob_string);
+		}
+	}
+
+	return priv->matchers[type];
+}
+
 static void
 tracker_indexing_tree_finalize (GObject *object)
 {
 	TrackerIndexingTreePrivate *priv;
 	TrackerIndexingTree *tree;
+	gint i;
 
 	tree = TRACKER_INDEXING_TREE (object);
 	priv = tree->priv;
 
+	for (i = TRACKER_FILTER_FILE; i <= TRACKER_FILTER_PARENT_DIRECTORY; i++) {
+		indexing_tree_invalidate_filters (tree, i);
+	}
+
 	g_list_foreach (priv->filter_patterns, (GFunc) pattern_data_free, NULL);
 	g_list_free (priv->filter_patterns);
 
@@ -511,6 +570,7 @@ tracker_indexing_tree_add_filter (TrackerIndexingTree *tree,
 
 	data = pattern_data_new (glob_string, filter);
 	priv->filter_patterns = g_list_prepend (priv->filter_patterns, data);
+	indexing_tree_invalidate_filters (tree, filter);
 }
 
 /**
@@ -543,6 +603,8 @@ tracker_indexing_tree_clear_filters (TrackerIndexingTree *tree,
 			pattern_data_free (data);
 		}
 	}
+
+	indexing_tree_invalidate_filters (tree, type);
 }
 
 /**
@@ -561,39 +623,29 @@ tracker_indexing_tree_file_matches_filter (TrackerIndexingTree *tree,
                                            GFile               *file)
 {
 	TrackerIndexingTreePrivate *priv;
-	GList *filters;
+	TrackerGlobMatcher *matcher;
+	gboolean matches;
 	gchar *basename;
+	GList *l;
 
 	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), FALSE);
 	g_return_val_if_fail (G_IS_FILE (file), FALSE);
 
 	priv = tree->priv;
-	filters = priv->filter_patterns;
-	basename = g_file_get_basename (file);
+	matcher = indexing_tree_get_matcher (tree, type);
 
-	while (filters) {
-		PatternData *data = filters->data;
-
-		filters = filters->next;
-
-		if (data->type != type)
-			continue;
-
-		if (data->file &&
-		    (g_file_equal (file, data->file) ||
-		     g_file_has_prefix (file, data->file))) {
-			g_free (basename);
-			return TRUE;
-		}
-
-		if (g_pattern_match_string (data->pattern, basename)) {
-			g_free (basename);
+	for (l = priv->path_filters[type]; l; l = l->next) {
+		if (g_file_equal (file, l->data) ||
+		    g_file_has_prefix (file, l->data)) {
 			return TRUE;
 		}
 	}
 
+	basename = g_file_get_basename (file);
+	matches = tracker_glob_matcher_match (matcher, basename);
 	g_free (basename);
-	return FALSE;
+
+	return matches;
 }
 
 static gboolean
@@ -97,12 +97,36 @@ static gboolean miner_fs_queues_status_trace_timeout_cb (gpointer data);
 #define DEFAULT_WAIT_POOL_LIMIT 1
 #define DEFAULT_READY_POOL_LIMIT 1
 
+/* Maximum number of queued items handled on each dispatch of the
+ * queue handlers, files are handed over to ::process_files in
+ * batches of up to this size, further bound by the processing pool
+ * limit.
+ */
+#define ITEM_QUEUE_BATCH_SIZE 32
+
 /* Put tasks processing at a lower priority so other events
  * (timeouts, monitor events, etc...) are guaranteed to be
  * dispatched promptly.
  */
 #define TRACKER_TASK_PRIORITY G_PRIORITY_DEFAULT_IDLE + 10
 
+/* Queue priority for files within directories given to
+ * tracker_miner_fs_boost_directory(), ahead of any other.
+ */
+#define BOOSTED_PRIORITY (G_PRIORITY_HIGH - 100)
+
+/* Maximum number of boosted directories kept at a time */
+#define MAX_BOOSTED_DIRECTORIES 8
+
+/* Files from each indexing root are queued in rounds of this size,
+ * each at a lower priority than the previous one, up to a maximum
+ * number of rounds. This way files from roots added later are
+ * interleaved with the ones from roots already queued, instead of
+ * waiting for all of these to be processed.
+ */
+#define ROOT_ROUND_SIZE 100
+#define ROOT_ROUND_MAX 50
+
 /**
  * SECTION:tracker-miner-fs
  * @short_description: Abstract base class for filesystem miners
@@ -162,6 +186,12 @@ struct _TrackerMinerFSPrivate {
 
 	GHashTable     *items_ignore_next_update;
 
+	/* Boosted directories, most recent first */
+	GList          *boosted_directories;
+
+	/* Indexing root -> number of files queued since the queues were empty */
+	GHashTable     *roots_queued;
+
 	GQuark          quark_ignore_file;
 	GQuark          quark_attribute_updated;
 	GQuark          quark_directory_found_crawling;
@@ -178,6 +208,9 @@ struct _TrackerMinerFSPrivate {
 	/* Extraction tasks */
 	TrackerTaskPool *task_pool;
 
+	/* Extraction tasks waiting to be handed to ::process_files */
+	GPtrArray      *process_batch;
+
 	/* Writeback tasks */
 	TrackerTaskPool *writeback_pool;
 
@@ -573,11 +606,18 @@ tracker_miner_fs_init (TrackerMinerFS *object)
 	                                                        (GDestroyNotify) g_free,
 	                                                        (GDestroyNotify) NULL);
 
+	priv->roots_queued = g_hash_table_new_full (g_file_hash,
+	                                            (GEqualFunc) g_file_equal,
+	                                            (GDestroyNotify) g_object_unref,
+	                                            NULL);
+
 	/* Create processing pools */
 	priv->task_pool = tracker_task_pool_new (DEFAULT_WAIT_POOL_LIMIT);
 	g_signal_connect (priv->task_pool, "notify::limit-reached",
 	                  G_CALLBACK (task_pool_limit_reached_notify_cb), object);
 
+	priv->process_batch = g_ptr_array_new_with_free_func ((GDestroyNotify) tracker_task_unref);
+
 	priv->writeback_pool = tracker_task_pool_new (DEFAULT_WAIT_POOL_LIMIT);
 	g_signal_connect (priv->writeback_pool, "notify::limit-reached",
 	                  G_CALLBACK (task_pool_limit_reached_notify_cb), object);
@@ -681,6 +721,7 @@ fs_finalize (GObject *object)
 	                           task_pool_cancel_foreach,
 	                           NULL);
 	g_object_unref (priv->task_pool);
+	g_ptr_array_unref (priv->process_batch);
 
 	g_object_unref (priv->writeback_pool);
 
@@ -715,6 +756,9 @@ fs_finalize (GObject *object)
 
 	g_hash_table_unref (priv->items_ignore_next_update);
 
+	g_list_free_full (priv->boosted_directories, g_object_unref);
+	g_hash_table_unref (priv->roots_queued);
+
 	g_object_unref (priv->indexing_tree);
 	g_object_unref (priv->file_notifier);
 
@@ -1109,6 +1153,116 @@ update_processing_task_context_free (UpdateProcessingTaskContext *ctxt)
 	g_slice_free (UpdateProcessingTaskContext, ctxt);
 }
 
+static void
+process_file_refused (TrackerMinerFS *fs,
+                      GFile          *task_file,
+                      const gchar    *uri)
+{
+	TrackerTask *task;
+
+	/* Re-fetch data, since it might have been
+	 * removed in broken implementations
+	 */
+	task = tracker_task_pool_find (fs->priv->task_pool, task_file);
+
+	g_message ("%s refused to process '%s'", G_OBJECT_TYPE_NAME (fs), uri);
+
+	if (!task) {
+		g_critical ("%s has returned FALSE in ::process-file for '%s', "
+		            "but it seems that this file has been processed through "
+		            "tracker_miner_fs_file_notify(), this is an "
+		            "implementation error", G_OBJECT_TYPE_NAME (fs), uri);
+	} else {
+		tracker_task_pool_remove (fs->priv->task_pool, task);
+		tracker_task_unref (task);
+	}
+}
+
+static gboolean
+process_files_batched (TrackerMinerFS *fs)
+{
+	/* Handlers connected to ::process-file take precedence, so
+	 * batches are only used if the class implementation would
+	 * otherwise be the only one called.
+	 */
+	return (TRACKER_MINER_FS_GET_CLASS (fs)->process_files != NULL &&
+	        !g_signal_has_handler_pending (fs, signals[PROCESS_FILE], 0, FALSE));
+}
+
+/* Hands the tasks queued in the current batch to ::process_files,
+ * returns the number of files that were refused.
+ */
+static guint
+process_batch_flush (TrackerMinerFS *fs)
+{
+	TrackerMinerFSPrivate *priv;
+	TrackerSparqlBuilder **builders;
+	GCancellable **cancellables;
+	gboolean *accepted;
+	GPtrArray *batch;
+	GFile **files;
+	guint i, n_files, n_refused = 0;
+
+	priv = fs->priv;
+
+	if (priv->process_batch->len == 0) {
+		return 0;
+	}
+
+	batch = priv->process_batch;
+	priv->process_batch = g_ptr_array_new_with_free_func ((GDestroyNotify) tracker_task_unref);
+
+	n_files = batch->len;
+	files = g_new (GFile *, n_files);
+	builders = g_new (TrackerSparqlBuilder *, n_files);
+	cancellables = g_new (GCancellable *, n_files);
+	accepted = g_new0 (gboolean, n_files);
+
+	for (i = 0; i < n_files; i++) {
+		UpdateProcessingTaskContext *ctxt;
+		TrackerTask *task;
+
+		task = g_ptr_array_index (batch, i);
+		ctxt = tracker_task_get_data (task);
+		files[i] = tracker_task_get_file (task);
+		builders[i] = ctxt->builder;
+		cancellables[i] = ctxt->cancellable;
+	}
+
+	g_debug ("Processing batch of %u files...", n_files);
+	TRACKER_MINER_FS_GET_CLASS (fs)->process_files (fs, files, builders,
+	                                                cancellables, accepted,
+	                                                n_files);
+
+	for (i = 0; i < n_files; i++) {
+		gchar *uri;
+
+		if (accepted[i]) {
+			continue;
+		}
+
+		uri = g_file_get_uri (files[i]);
+		process_file_refused (fs, files[i], uri);
+		g_free (uri);
+
+		/* It was accounted as processed when queued */
+		priv->total_files_processed--;
+		n_refused++;
+	}
+
+	g_free (files);
+	g_free (builders);
+	g_free (cancellables);
+	g_free (accepted);
+
+	/* Tasks are kept alive until here, even if notified
+	 * synchronously from ::process_files.
+	 */
+	g_ptr_array_unref (batch);
+
+	return n_refused;
+}
+
 static gboolean
 do_process_file (TrackerMinerFS *fs,
                  TrackerTask    *task)
@@ -1128,7 +1282,16 @@ do_process_file (TrackerMinerFS *fs,
 	attribute_update_only = GPOINTER_TO_INT (g_object_get_qdata (G_OBJECT (task_file),
 	                                                             priv->quark_attribute_updated));
 
-	if (!attribute_update_only) {
+	if (!attribute_update_only && process_files_batched (fs)) {
+		/* Handed over to ::process_files by the queue handlers
+		 * once they're done with this dispatch.
+		 */
+		g_debug ("Queueing file '%s' for processing...", uri);
+		g_ptr_array_add (priv->process_batch, tracker_task_ref (task));
+		g_free (uri);
+
+		return TRUE;
+	} else if (!attribute_update_only) {
 		g_debug ("Processing file '%s'...", uri);
 		g_signal_emit (fs, signals[PROCESS_FILE], 0,
 		               task_file,
@@ -1145,22 +1308,7 @@ do_process_file (TrackerMinerFS *fs,
 	}
 
 	if (!processing) {
-		/* Re-fetch data, since it might have been
-		 * removed in broken implementations
-		 */
-		task = tracker_task_pool_find (priv->task_pool, task_file);
-
-		g_message ("%s refused to process '%s'", G_OBJECT_TYPE_NAME (fs), uri);
-
-		if (!task) {
-			g_critical ("%s has returned FALSE in ::process-file for '%s', "
-			            "but it seems that this file has been processed through "
-			            "tracker_miner_fs_file_notify(), this is an "
-			            "implementation error", G_OBJECT_TYPE_NAME (fs), uri);
-		} else {
-			tracker_task_pool_remove (priv->task_pool, task);
-			tracker_task_unref (task);
-		}
+		process_file_refused (fs, task_file, uri);
 	}
 
 	g_free (uri);
@@ -1875,83 +2023,29 @@ item_reenqueue (TrackerMinerFS       *fs,
 	return item_reenqueue_full (fs, item_queue, queue_file, queue_file, priority);
 }
 
-static QueueState
-item_queue_get_next_file (TrackerMinerFS  *fs,
-                          GFile          **file,
-                          GFile          **source_file,
-                          gint            *priority_out)
+static gint
+item_queue_get_priority (TrackerPriorityQueue *queue)
 {
-	ItemMovedData *data;
-	ItemWritebackData *wdata;
-	GFile *queue_file;
 	gint priority;
 
-	/* Writeback items first */
-	wdata = tracker_priority_queue_pop (fs->priv->items_writeback,
-	                                    &priority);
-	if (wdata) {
-		gboolean processing;
-
-		*file = g_object_ref (wdata->file);
-		*source_file = NULL;
-		*priority_out = priority;
-
-		trace_eq_pop_head ("WRITEBACK", wdata->file);
-
-		g_signal_emit (fs, signals[WRITEBACK_FILE], 0,
-		               wdata->file,
-		               wdata->rdf_types,
-		               wdata->results,
-		               wdata->cancellable,
-		               &processing);
-
-		if (processing) {
-			TrackerTask *task;
-
-			task = tracker_task_new (wdata->file, wdata,
-			                         (GDestroyNotify) item_writeback_data_free);
-			tracker_task_pool_add (fs->priv->writeback_pool, task);
-
-			return QUEUE_WRITEBACK;
-		} else {
-			item_writeback_data_free (wdata);
-		}
+	if (!tracker_priority_queue_peek (queue, &priority)) {
+		return G_MAXINT;
 	}
 
-	/* Deleted items second */
-	queue_file = tracker_priority_queue_pop (fs->priv->items_deleted,
-	                                         &priority);
-	if (queue_file) {
-		*source_file = NULL;
-
-		trace_eq_pop_head ("DELETED", queue_file);
-
-		/* Do not ignore DELETED event even if file is marked as
-		   IgnoreNextUpdate. We should never see DELETED on update
-		   (atomic rename or in-place update) but we may see DELETED
-		   due to actual file deletion right after update. */
-
-		/* If the same item OR its first parent is currently being processed,
-		 * we need to wait for this event */
-		if (should_wait (fs, queue_file)) {
-			*file = NULL;
-
-			trace_eq_push_head ("DELETED", queue_file, "Should wait");
-
-			/* Need to postpone event... */
-			if (item_reenqueue (fs, fs->priv->items_deleted, queue_file, priority - 1)) {
-				return QUEUE_WAIT;
-			} else {
-				return QUEUE_NONE;
-			}
-		}
+	return priority;
+}
 
-		*file = queue_file;
-		*priority_out = priority;
-		return QUEUE_DELETED;
-	}
+/* Pops the next created item, returns FALSE if there is none */
+static gboolean
+item_queue_get_next_created (TrackerMinerFS  *fs,
+                             GFile          **file,
+                             GFile          **source_file,
+                             gint            *priority_out,
+                             QueueState      *state)
+{
+	GFile *queue_file;
+	gint priority;
 
-	/* Created items next */
 	queue_file = tracker_priority_queue_pop (fs->priv->items_created,
 	                                         &priority);
 	if (queue_file) {
@@ -1975,7 +2069,8 @@ item_queue_get_next_file (TrackerMinerFS  *fs,
 				         uri);
 				g_free (uri);
 
-				return QUEUE_IGNORE_NEXT_UPDATE;
+				*state = QUEUE_IGNORE_NEXT_UPDATE;
+				return TRUE;
 			} else {
 				/* Just remove the IgnoreNextUpdate request */
 				g_debug ("Skipping the IgnoreNextUpdate request on CREATED event for '%s', file is actually new",
@@ -1994,18 +2089,34 @@ item_queue_get_next_file (TrackerMinerFS  *fs,
 
 			/* Need to postpone event... */
 			if (item_reenqueue (fs, fs->priv->items_created, queue_file, priority - 1)) {
-				return QUEUE_WAIT;
+				*state = QUEUE_WAIT;
 			} else {
-				return QUEUE_NONE;
+				*state = QUEUE_NONE;
 			}
+
+			return TRUE;
 		}
 
 		*file = queue_file;
 		*priority_out = priority;
-		return QUEUE_CREATED;
+		*state = QUEUE_CREATED;
+		return TRUE;
 	}
 
-	/* Updated items next */
+	return FALSE;
+}
+
+/* Pops the next updated item, returns FALSE if there is none */
+static gboolean
+item_queue_get_next_updated (TrackerMinerFS  *fs,
+                             GFile          **file,
+                             GFile          **source_file,
+                             gint            *priority_out,
+                             QueueState      *state)
+{
+	GFile *queue_file;
+	gint priority;
+
 	queue_file = tracker_priority_queue_pop (fs->priv->items_updated,
 	                                         &priority);
 	if (queue_file) {
@@ -2023,7 +2134,8 @@ item_queue_get_next_file (TrackerMinerFS  *fs,
 			         uri);
 			g_free (uri);
 
-			return QUEUE_IGNORE_NEXT_UPDATE;
+			*state = QUEUE_IGNORE_NEXT_UPDATE;
+			return TRUE;
 		}
 
 		/* If the same item OR its first parent is currently being processed,
@@ -2035,15 +2147,111 @@ item_queue_get_next_file (TrackerMinerFS  *fs,
 
 			/* Need to postpone event... */
 			if (item_reenqueue (fs, fs->priv->items_updated, queue_file, priority - 1)) {
+				*state = QUEUE_WAIT;
+			} else {
+				*state = QUEUE_NONE;
+			}
+
+			return TRUE;
+		}
+
+		*priority_out = priority;
+		*state = QUEUE_UPDATED;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static QueueState
+item_queue_get_next_file (TrackerMinerFS  *fs,
+                          GFile          **file,
+                          GFile          **source_file,
+                          gint            *priority_out)
+{
+	ItemMovedData *data;
+	ItemWritebackData *wdata;
+	GFile *queue_file;
+	QueueState state;
+	gint priority;
+
+	/* Writeback items first */
+	wdata = tracker_priority_queue_pop (fs->priv->items_writeback,
+	                                    &priority);
+	if (wdata) {
+		gboolean processing;
+
+		*file = g_object_ref (wdata->file);
+		*source_file = NULL;
+		*priority_out = priority;
+
+		trace_eq_pop_head ("WRITEBACK", wdata->file);
+
+		g_signal_emit (fs, signals[WRITEBACK_FILE], 0,
+		               wdata->file,
+		               wdata->rdf_types,
+		               wdata->results,
+		               wdata->cancellable,
+		               &processing);
+
+		if (processing) {
+			TrackerTask *task;
+
+			task = tracker_task_new (wdata->file, wdata,
+			                         (GDestroyNotify) item_writeback_data_free);
+			tracker_task_pool_add (fs->priv->writeback_pool, task);
+
+			return QUEUE_WRITEBACK;
+		} else {
+			item_writeback_data_free (wdata);
+		}
+	}
+
+	/* Deleted items second */
+	queue_file = tracker_priority_queue_pop (fs->priv->items_deleted,
+	                                         &priority);
+	if (queue_file) {
+		*source_file = NULL;
+
+		trace_eq_pop_head ("DELETED", queue_file);
+
+		/* Do not ignore DELETED event even if file is marked as
+		   IgnoreNextUpdate. We should never see DELETED on update
+		   (atomic rename or in-place update) but we may see DELETED
+		   due to actual file deletion right after update. */
+
+		/* If the same item OR its first parent is currently being processed,
+		 * we need to wait for this event */
+		if (should_wait (fs, queue_file)) {
+			*file = NULL;
+
+			trace_eq_push_head ("DELETED", queue_file, "Should wait");
+
+			/* Need to postpone event... */
+			if (item_reenqueue (fs, fs->priv->items_deleted, queue_file, priority - 1)) {
 				return QUEUE_WAIT;
 			} else {
 				return QUEUE_NONE;
 			}
 		}
 
+		*file = queue_file;
 		*priority_out = priority;
+		return QUEUE_DELETED;
+	}
+
+	/* Created and updated items next, whichever has the highest
+	 * priority, created items go first on equal priorities.
+	 */
+	if (item_queue_get_priority (fs->priv->items_updated) <
+	    item_queue_get_priority (fs->priv->items_created) &&
+	    item_queue_get_next_updated (fs, file, source_file, priority_out, &state)) {
+		return state;
+	}
 
-		return QUEUE_UPDATED;
+	if (item_queue_get_next_created (fs, file, source_file, priority_out, &state) ||
+	    item_queue_get_next_updated (fs, file, source_file, priority_out, &state)) {
+		return state;
 	}
 
 	/* Moved items next */
@@ -2097,6 +2305,9 @@ item_queue_get_next_file (TrackerMinerFS  *fs,
 	*file = NULL;
 	*source_file = NULL;
 
+	/* Queues are empty, start over the rounds of every root */
+	g_hash_table_remove_all (fs->priv->roots_queued);
+
 	if (tracker_file_notifier_is_active (fs->priv->file_notifier) ||
 	    tracker_task_pool_limit_reached (fs->priv->task_pool) ||
 	    tracker_task_pool_limit_reached (TRACKER_TASK_POOL (fs->priv->sparql_buffer))) {
@@ -2149,10 +2360,12 @@ item_queue_get_progress (TrackerMinerFS *fs,
 	return (gdouble) (items_total - items_to_process) / items_total;
 }
 
+/* Handles the next queued item, returns FALSE if
+ * the queue handlers should stop after it.
+ */
 static gboolean
-item_queue_handlers_cb (gpointer user_data)
+item_queue_handle_next (TrackerMinerFS *fs)
 {
-	TrackerMinerFS *fs = user_data;
 	GFile *file = NULL;
 	GFile *source_file = NULL;
 	GFile *parent;
@@ -2162,14 +2375,8 @@ item_queue_handlers_cb (gpointer user_data)
 	gboolean keep_processing = TRUE;
 	gint priority = 0;
 
-	if (fs->priv->timer_stopped) {
-		g_timer_start (fs->priv->timer);
-		fs->priv->timer_stopped = FALSE;
-	}
-
 	if (tracker_task_pool_limit_reached (TRACKER_TASK_POOL (fs->priv->sparql_buffer))) {
 		/* Task pool is full, give it a break */
-		fs->priv->item_queues_handler_id = 0;
 		return FALSE;
 	}
 
@@ -2180,8 +2387,6 @@ item_queue_handlers_cb (gpointer user_data)
 		 * the processing pool is cleared before starting with
 		 * the next directories batch.
 		 */
-		fs->priv->item_queues_handler_id = 0;
-
 		/* We should flush the processing pool buffer here, because
 		 * if there was a previous task on the same file we want to
 		 * process now, we want it to get finished before we can go
@@ -2301,6 +2506,9 @@ item_queue_handlers_cb (gpointer user_data)
 	case QUEUE_NONE:
 		if (!tracker_file_notifier_is_active (fs->priv->file_notifier) &&
 		    tracker_task_pool_get_size (fs->priv->task_pool) == 0) {
+			g_list_free_full (fs->priv->boosted_directories, g_object_unref);
+			fs->priv->boosted_directories = NULL;
+
 			if (tracker_task_pool_get_size (TRACKER_TASK_POOL (fs->priv->sparql_buffer)) == 0) {
 				/* Print stats and signal finished */
 				process_stop (fs);
@@ -2384,12 +2592,47 @@ item_queue_handlers_cb (gpointer user_data)
 		g_object_unref (source_file);
 	}
 
+	return keep_processing;
+}
+
+static gboolean
+item_queue_handlers_cb (gpointer user_data)
+{
+	TrackerMinerFS *fs = user_data;
+	gboolean keep_processing = TRUE;
+	guint i, n_items, n_refused;
+
+	if (fs->priv->timer_stopped) {
+		g_timer_start (fs->priv->timer);
+		fs->priv->timer_stopped = FALSE;
+	}
+
+	/* Handle several items per dispatch, unless throttled, in
+	 * which case the dispatch interval sets the processing pace.
+	 */
+	n_items = (fs->priv->throttle > 0) ? 1 : ITEM_QUEUE_BATCH_SIZE;
+
+	for (i = 0; i < n_items && keep_processing; i++) {
+		keep_processing = item_queue_handle_next (fs);
+	}
+
+	n_refused = process_batch_flush (fs);
+
 	if (!keep_processing) {
 		fs->priv->item_queues_handler_id = 0;
+
+		if (n_refused > 0) {
+			/* Refused files leave room in the processing pool,
+			 * or might have left it empty, so the queue handlers
+			 * must run again to either go on or finish.
+			 */
+			item_queue_handlers_set_up (fs);
+		}
+
 		return FALSE;
-	} else {
-		return TRUE;
 	}
+
+	return TRUE;
 }
 
 static guint
@@ -2546,17 +2789,51 @@ cancel_writeback_task (TrackerMinerFS *fs,
 	}
 }
 
+static gboolean
+miner_fs_file_is_boosted (TrackerMinerFS *fs,
+                          GFile          *file)
+{
+	GList *l;
+
+	for (l = fs->priv->boosted_directories; l; l = l->next) {
+		if (g_file_equal (file, l->data) ||
+		    g_file_has_prefix (file, l->data)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 static gint
 miner_fs_get_queue_priority (TrackerMinerFS *fs,
                              GFile          *file)
 {
 	TrackerDirectoryFlags flags;
+	GFile *root;
+	guint n_queued;
+	gint priority;
 
-	tracker_indexing_tree_get_root (fs->priv->indexing_tree,
-	                                file, &flags);
+	if (miner_fs_file_is_boosted (fs, file)) {
+		return BOOSTED_PRIORITY;
+	}
+
+	root = tracker_indexing_tree_get_root (fs->priv->indexing_tree,
+	                                       file, &flags);
 
-	return (flags & TRACKER_DIRECTORY_FLAG_PRIORITY) ?
+	priority = (flags & TRACKER_DIRECTORY_FLAG_PRIORITY) ?
 	        G_PRIORITY_HIGH : G_PRIORITY_DEFAULT;
+
+	if (root) {
+		n_queued = GPOINTER_TO_UINT (g_hash_table_lookup (fs->priv->roots_queued, root));
+		g_hash_table_replace (fs->priv->roots_queued,
+		                      g_object_ref (root),
+		                      GUINT_TO_POINTER (n_queued + 1));
+
+		priority += MIN (n_queued / ROOT_ROUND_SIZE, ROOT_ROUND_MAX);
+	}
+
+	return priority;
 }
 
 static void
@@ -3426,6 +3703,64 @@ tracker_miner_fs_check_directory (TrackerMinerFS *fs,
 	                                                check_parents);
 }
 
+/**
+ * tracker_miner_fs_boost_directory:
+ * @fs: a #TrackerMinerFS
+ * @directory: #GFile for the directory to boost
+ *
+ * Tells the filesystem miner to process the contents of @directory
+ * before anything else, e.g. because the user is browsing it. Files
+ * already queued within @directory are moved ahead, and so are the
+ * ones found later on, if @directory is still pending to be crawled
+ * it will be crawled next. The boost lasts until all queued files
+ * are processed, only the most recently boosted directories are kept.
+ *
+ * @directory must be part of the usual crawling directories of
+ * #TrackerMinerFS, see tracker_miner_fs_directory_add().
+ *
+ * Since: 1.2
+ **/
+void
+tracker_miner_fs_boost_directory (TrackerMinerFS *fs,
+                                  GFile          *directory)
+{
+	TrackerMinerFSPrivate *priv;
+	GList *last;
+	guint n_boosted;
+	gchar *uri;
+
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
+	g_return_if_fail (G_IS_FILE (directory));
+
+	priv = fs->priv;
+
+	if (!miner_fs_file_is_boosted (fs, directory)) {
+		priv->boosted_directories = g_list_prepend (priv->boosted_directories,
+		                                            g_object_ref (directory));
+
+		if (g_list_length (priv->boosted_directories) > MAX_BOOSTED_DIRECTORIES) {
+			last = g_list_last (priv->boosted_directories);
+			g_object_unref (last->data);
+			priv->boosted_directories = g_list_delete_link (priv->boosted_directories,
+			                                                last);
+		}
+	}
+
+	n_boosted = tracker_priority_queue_boost (priv->items_created,
+	                                          (GEqualFunc) file_equal_or_descendant,
+	                                          directory, BOOSTED_PRIORITY);
+	n_boosted += tracker_priority_queue_boost (priv->items_updated,
+	                                           (GEqualFunc) file_equal_or_descendant,
+	                                           directory, BOOSTED_PRIORITY);
+
+	tracker_file_notifier_boost_directory (priv->file_notifier, directory);
+
+	uri = g_file_get_uri (directory);
+	g_debug ("Boosted directory '%s', %u queued files moved ahead",
+	         uri, n_boosted);
+	g_free (uri);
+}
+
 /**
  * tracker_miner_fs_file_notify:
  * @fs: a #TrackerMinerFS
@@ -3791,6 +4126,62 @@ tracker_miner_fs_get_initial_crawling (TrackerMinerFS *fs)
 	return fs->priv->initial_crawling;
 }
 
+/**
+ * tracker_miner_fs_load_crawl_state:
+ * @fs: a #TrackerMinerFS
+ * @filename: file written by tracker_miner_fs_save_crawl_state()
+ * @checksum: string identifying the configuration the state applies to
+ * @error: return location for errors
+ *
+ * Loads the directory state saved on a previous run, so the initial
+ * crawl can skip monitored directories that did not change since, as
+ * long as mtime checking is disabled for these. It must be called
+ * before the miner is started, and fails if @checksum doesn't match
+ * the one given when saving.
+ *
+ * Returns: %TRUE if the state was loaded, %FALSE if @error is set.
+ *
+ * Since: 1.2
+ **/
+gboolean
+tracker_miner_fs_load_crawl_state (TrackerMinerFS  *fs,
+                                   const gchar     *filename,
+                                   const gchar     *checksum,
+                                   GError         **error)
+{
+	g_return_val_if_fail (TRACKER_IS_MINER_FS (fs), FALSE);
+
+	return tracker_file_notifier_load_crawl_state (fs->priv->file_notifier,
+	                                               filename, checksum, error);
+}
+
+/**
+ * tracker_miner_fs_save_crawl_state:
+ * @fs: a #TrackerMinerFS
+ * @filename: file to write the state to
+ * @checksum: string identifying the current configuration
+ * @error: return location for errors
+ *
+ * Saves the state of crawled directories, to be loaded on the next
+ * run through tracker_miner_fs_load_crawl_state(). It should only be
+ * called on shutdown, once all pending items were processed.
+ *
+ * Returns: %TRUE on success, %FALSE if @error is set.
+ *
+ * Since: 1.2
+ **/
+gboolean
+tracker_miner_fs_save_crawl_state (TrackerMinerFS  *fs,
+                                   const gchar     *filename,
+                                   const gchar     *checksum,
+                                   GError         **error)
+{
+	g_return_val_if_fail (TRACKER_IS_MINER_FS (fs), FALSE);
+
+	return tracker_file_notifier_save_crawl_state (fs->priv->file_notifier,
+	                                               filename, checksum, error);
+}
+
 /**
  * tracker_miner_fs_has_items_to_process:
  * @fs: a #TrackerMinerFS
@@ -67,6 +67,11 @@ struct _TrackerMinerFS {
  * @process_file_attributes: Called when the metadata associated with
  * a file's attributes changes, for example, the mtime.
  * @writeback_file: Called when a file must be written back
+ * @process_files: Called with a batch of files whose metadata is
+ * requested, instead of emitting ::process-file on each of them when
+ * no handlers are connected to it. Implementations set @accepted for
+ * every file, and call tracker_miner_fs_file_notify() on each accepted
+ * file once processed (since 1.2).
  * @padding: Reserved for future API improvements.
 
  *
@@ -93,8 +98,14 @@ typedef struct {
 	                                       GFile                *file,
 	                                       GStrv                 rdf_types,
 	                                       GPtrArray            *results);
+	void     (* process_files)            (TrackerMinerFS        *fs,
+	                                       GFile                **files,
+	                                       TrackerSparqlBuilder **builders,
+	                                       GCancellable         **cancellables,
+	                                       gboolean              *accepted,
+	                                       guint                  n_files);
 	/* <Private> */
-	gpointer padding[10];
+	gpointer padding[9];
 } TrackerMinerFSClass;
 
 GType                 tracker_miner_fs_get_type             (void) G_GNUC_CONST;
@@ -139,6 +150,8 @@ const gchar          *tracker_miner_fs_get_parent_urn       (TrackerMinerFS *fs,
 gchar                *tracker_miner_fs_query_urn            (TrackerMinerFS *fs,
                                                              GFile          *file);
 void                  tracker_miner_fs_force_recheck        (TrackerMinerFS *fs);
+void                  tracker_miner_fs_boost_directory      (TrackerMinerFS *fs,
+                                                             GFile          *directory);
 
 void                  tracker_miner_fs_set_mtime_checking   (TrackerMinerFS *fs,
                                                              gboolean        mtime_checking);
@@ -147,6 +160,15 @@ void                  tracker_miner_fs_set_initial_crawling (TrackerMinerFS *fs,
 gboolean              tracker_miner_fs_get_mtime_checking   (TrackerMinerFS *fs);
 gboolean              tracker_miner_fs_get_initial_crawling (TrackerMinerFS *fs);
 
+gboolean              tracker_miner_fs_load_crawl_state     (TrackerMinerFS  *fs,
+                                                             const gchar     *filename,
+                                                             const gchar     *checksum,
+                                                             GError         **error);
+gboolean              tracker_miner_fs_save_crawl_state     (TrackerMinerFS  *fs,
+                                                             const gchar     *filename,
+                                                             const gchar     *checksum,
+                                                             GError         **error);
+
 gboolean              tracker_miner_fs_has_items_to_process (TrackerMinerFS *fs);
 
 void                  tracker_miner_fs_add_directory_without_parent (TrackerMinerFS *fs,
@@ -30,6 +30,18 @@
 #define TRACKER_MONITOR_KQUEUE
 #endif
 
+#if defined (HAVE_SYS_FANOTIFY_H)
+#include <sys/fanotify.h>
+#ifdef FAN_REPORT_DFID_NAME
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/statfs.h>
+#include <glib-unix.h>
+#define TRACKER_MONITOR_FANOTIFY
+#endif /* FAN_REPORT_DFID_NAME */
+#endif /* HAVE_SYS_FANOTIFY_H */
+
 #include "tracker-monitor.h"
 
 #define TRACKER_MONITOR_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TRACKER_TYPE_MONITOR, TrackerMonitorPrivate))
@@ -49,8 +61,13 @@
 #warning Assuming GLib/GIO always sends CHANGES_DONE_HINT after CREATED...
 #endif /* GIO_ALWAYS_SENDS_CHANGES_DONE_HINT_AFTER_CREATED */
 
-/* The life time of an item in the cache */
-#define CACHE_LIFETIME_SECONDS 1
+/* Events on the same file arriving within this window are merged
+ * together, every new event on the file starts the window again.
+ */
+#define EVENT_COALESCE_WINDOW_MSEC 2000
+
+/* How often the cache is checked for expired events */
+#define EVENT_COALESCE_CHECK_MSEC  (EVENT_COALESCE_WINDOW_MSEC / 4)
 
 /* When we receive IO monitor events, we pause sending information to
  * the indexer for a few seconds before continuing. We have to receive
@@ -63,6 +80,21 @@
  */
 #undef  PAUSE_ON_IO
 
+#ifdef TRACKER_MONITOR_FANOTIFY
+/* Events requested on fanotify filesystem marks, with FAN_RENAME
+ * (Linux >= 5.17) both ends of a move are reported in one event.
+ */
+#ifdef FAN_RENAME
+#define FANOTIFY_EVENT_MASK (FAN_CREATE | FAN_DELETE | FAN_RENAME | \
+                             FAN_MODIFY | FAN_CLOSE_WRITE | FAN_ATTRIB | FAN_ONDIR)
+#else
+#define FANOTIFY_EVENT_MASK (FAN_CREATE | FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO | \
+                             FAN_MODIFY | FAN_CLOSE_WRITE | FAN_ATTRIB | FAN_ONDIR)
+#endif
+
+#define FANOTIFY_BUFFER_SIZE 65536
+#endif /* TRACKER_MONITOR_FANOTIFY */
+
 struct TrackerMonitorPrivate {
 	GHashTable    *monitors;
 
@@ -88,7 +120,28 @@ struct TrackerMonitorPrivate {
 	GHashTable    *pre_delete;
 	guint          event_pairs_timeout_id;
 
+	/* Sources of the MOVED events waiting in pre_update,
+	 * pointing to the destination file the event is keyed by.
+	 */
+	GHashTable    *pre_move_sources;
+
+	guint          events_received;
+	guint          items_emitted;
+
 	TrackerIndexingTree *tree;
+
+#ifdef TRACKER_MONITOR_FANOTIFY
+	/* A single fanotify descriptor marks whole filesystems,
+	 * events are mapped back to monitored directories through
+	 * their file handles.
+	 */
+	gint           fanotify_fd;
+	guint          fanotify_source_id;
+	GHashTable    *fanotify_watches;
+	GHashTable    *fanotify_filesystems;
+	guint          n_fanotify_watches;
+	guint64       *fanotify_buffer;
+#endif /* TRACKER_MONITOR_FANOTIFY */
 };
 
 typedef struct {
@@ -97,9 +150,13 @@ typedef struct {
 	GFile    *other_file;
 	gchar    *other_file_uri;
 	gboolean  is_directory;
-	GTimeVal  start_time;
+	gint64    start_time;
 	guint32   event_type;
 	gboolean  expirable;
+	/* For file MOVED events, whether the
+	 * destination also needs updating.
+	 */
+	gboolean  updated;
 } EventData;
 
 enum {
@@ -137,6 +194,10 @@ static void           emit_signal_for_event        (TrackerMonitor *monitor,
                                                     EventData      *event_data);
 static gboolean       monitor_cancel_recursively   (TrackerMonitor *monitor,
                                                     GFile          *file);
+#ifdef TRACKER_MONITOR_FANOTIFY
+static void           fanotify_init_backend        (TrackerMonitor *monitor);
+static void           fanotify_shutdown            (TrackerMonitor *monitor);
+#endif /* TRACKER_MONITOR_FANOTIFY */
 
 static guint signals[LAST_SIGNAL] = { 0, };
 
@@ -255,6 +316,11 @@ tracker_monitor_init (TrackerMonitor *object)
 		                       (GEqualFunc) g_file_equal,
 		                       (GDestroyNotify) g_object_unref,
 		                       event_data_free);
+	priv->pre_move_sources =
+		g_hash_table_new_full (g_file_hash,
+		                       (GEqualFunc) g_file_equal,
+		                       (GDestroyNotify) g_object_unref,
+		                       (GDestroyNotify) g_object_unref);
 
 	/* For the first monitor we get the type and find out if we
 	 * are using inotify, FAM, polling, etc.
@@ -349,6 +415,10 @@ tracker_monitor_init (TrackerMonitor *object)
 
 	g_object_unref (file);
 	g_message ("Monitor limit is %d", priv->monitor_limit);
+
+#ifdef TRACKER_MONITOR_FANOTIFY
+	fanotify_init_backend (object);
+#endif /* TRACKER_MONITOR_FANOTIFY */
 }
 
 static void
@@ -370,8 +440,16 @@ tracker_monitor_finalize (GObject *object)
 
 	g_hash_table_unref (priv->pre_update);
 	g_hash_table_unref (priv->pre_delete);
+	g_hash_table_unref (priv->pre_move_sources);
 	g_hash_table_unref (priv->monitors);
 
+#ifdef TRACKER_MONITOR_FANOTIFY
+	fanotify_shutdown (TRACKER_MONITOR (object));
+	g_hash_table_unref (priv->fanotify_watches);
+	g_hash_table_unref (priv->fanotify_filesystems);
+	g_free (priv->fanotify_buffer);
+#endif /* TRACKER_MONITOR_FANOTIFY */
+
 	G_OBJECT_CLASS (tracker_monitor_parent_class)->finalize (object);
 }
 
@@ -512,10 +590,8 @@ event_data_new (GFile    *file,
                 guint32   event_type)
 {
 	EventData *event;
-	GTimeVal now;
 
 	event = g_slice_new0 (EventData);
-	g_get_current_time (&now);
 
 	event->file = g_object_ref (file);
 	event->file_uri = g_file_get_uri (file);
@@ -527,7 +603,7 @@ event_data_new (GFile    *file,
 		event->other_file_uri = NULL;
 	}
 	event->is_directory = is_directory;
-	event->start_time = now;
+	event->start_time = g_get_monotonic_time ();
 	event->event_type = event_type;
 	/* Always expirable when created */
 	event->expirable = TRUE;
@@ -535,6 +611,13 @@ event_data_new (GFile    *file,
 	return event;
 }
 
+/* Starts the coalescing window again */
+static void
+event_data_touch (EventData *event)
+{
+	event->start_time = g_get_monotonic_time ();
+}
+
 static void
 event_data_free (gpointer data)
 {
@@ -673,6 +756,11 @@ static void
 emit_signal_for_event (TrackerMonitor *monitor,
                        EventData      *event_data)
 {
+	if (event_data->event_type != G_FILE_MONITOR_EVENT_PRE_UNMOUNT &&
+	    event_data->event_type != G_FILE_MONITOR_EVENT_UNMOUNTED) {
+		monitor->priv->items_emitted++;
+	}
+
 	switch (event_data->event_type) {
 	case G_FILE_MONITOR_EVENT_CREATED:
 		g_debug ("Emitting ITEM_CREATED for (%s) '%s'",
@@ -772,6 +860,16 @@ emit_signal_for_event (TrackerMonitor *monitor,
 			               event_data->other_file,
 			               event_data->is_directory,
 			               TRUE);
+
+			if (event_data->updated) {
+				g_debug ("Emitting ITEM_UPDATED for (FILE) '%s' after move",
+				         event_data->other_file_uri);
+				monitor->priv->items_emitted++;
+				g_signal_emit (monitor,
+				               signals[ITEM_UPDATED], 0,
+				               event_data->other_file,
+				               event_data->is_directory);
+			}
 		}
 
 		break;
@@ -786,7 +884,8 @@ emit_signal_for_event (TrackerMonitor *monitor,
 static void
 event_pairs_process_in_ht (TrackerMonitor *monitor,
                            GHashTable     *ht,
-                           GTimeVal       *now)
+                           gint64          now,
+                           GFile          *flush_dir)
 {
 	GHashTableIter iter;
 	gpointer key, value;
@@ -802,30 +901,48 @@ event_pairs_process_in_ht (TrackerMonitor *monitor,
 	g_hash_table_iter_init (&iter, ht);
 	while (g_hash_table_iter_next (&iter, &key, &value)) {
 		EventData *event_data = value;
-		glong seconds;
+		gint64 msecs;
 
-		/* If event is not yet expirable, keep it */
-		if (!event_data->expirable)
-			continue;
+		msecs = (now - event_data->start_time) / 1000;
 
-		/* If event is expirable, but didn't expire yet, keep it */
-		seconds = now->tv_sec - event_data->start_time.tv_sec;
-		if (seconds < 2)
-			continue;
+		if (flush_dir) {
+			/* Only events within the directory are flushed */
+			if (!g_file_has_prefix (event_data->file, flush_dir) &&
+			    (!event_data->other_file ||
+			     !g_file_has_prefix (event_data->other_file, flush_dir)))
+				continue;
+		} else {
+			/* If event is not yet expirable, keep it */
+			if (!event_data->expirable)
+				continue;
+
+			/* If event is expirable, but didn't expire yet, keep it */
+			if (msecs < EVENT_COALESCE_WINDOW_MSEC)
+				continue;
+		}
 
-		g_debug ("Event '%s' for URI '%s' has timed out (%ld seconds have elapsed)",
+		g_debug ("Event '%s' for URI '%s' has timed out (%" G_GINT64_FORMAT " ms have elapsed)",
 		         monitor_event_to_string (event_data->event_type),
 		         event_data->file_uri,
-		         seconds);
+		         msecs);
+
+		if (event_data->event_type == G_FILE_MONITOR_EVENT_MOVED &&
+		    !event_data->is_directory) {
+			g_hash_table_remove (monitor->priv->pre_move_sources,
+			                     event_data->file);
+		}
+
 		/* STEAL the item from the HT, so that disposal methods
 		 * for key and value are not called. */
 		g_hash_table_iter_steal (&iter);
 		/* Unref the key, as no longer needed */
 		g_object_unref (key);
 		/* Add the expired event to our temp list */
-		expired_events = g_list_append (expired_events, event_data);
+		expired_events = g_list_prepend (expired_events, event_data);
 	}
 
+	expired_events = g_list_reverse (expired_events);
+
 	for (l = expired_events; l; l = g_list_next (l)) {
 		/* Emit signal for the expired event */
 		emit_signal_for_event (monitor, l->data);
@@ -839,36 +956,124 @@ static gboolean
 event_pairs_timeout_cb (gpointer user_data)
 {
 	TrackerMonitor *monitor;
-	GTimeVal now;
+	gint64 now;
 
 	monitor = user_data;
-	g_get_current_time (&now);
+	now = g_get_monotonic_time ();
 
 	/* Process PRE-UPDATE hash table */
-	event_pairs_process_in_ht (monitor, monitor->priv->pre_update, &now);
+	event_pairs_process_in_ht (monitor, monitor->priv->pre_update, now, NULL);
 
 	/* Process PRE-DELETE hash table */
-	event_pairs_process_in_ht (monitor, monitor->priv->pre_delete, &now);
+	event_pairs_process_in_ht (monitor, monitor->priv->pre_delete, now, NULL);
 
 	if (g_hash_table_size (monitor->priv->pre_update) > 0 ||
 	    g_hash_table_size (monitor->priv->pre_delete) > 0) {
 		return TRUE;
 	}
 
-	g_debug ("No more events to pair");
+	g_debug ("No more events to pair, %u events received, %u items notified so far",
+	         monitor->priv->events_received,
+	         monitor->priv->items_emitted);
+
+	g_hash_table_remove_all (monitor->priv->pre_move_sources);
 	monitor->priv->event_pairs_timeout_id = 0;
 	return FALSE;
 }
 
+/* Notifies the updates waiting in the cache for files within dir,
+ * so these happen before the event being processed, e.g. before the
+ * directory goes away. Moves are flushed if either end is within it.
+ */
+static void
+event_pairs_flush_updates (TrackerMonitor *monitor,
+                           GFile          *dir)
+{
+	event_pairs_process_in_ht (monitor, monitor->priv->pre_update,
+	                           g_get_monotonic_time (), dir);
+}
+
+static void
+pending_move_insert (TrackerMonitor *monitor,
+                     EventData      *event)
+{
+	g_hash_table_replace (monitor->priv->pre_update,
+	                      g_object_ref (event->other_file),
+	                      event);
+	g_hash_table_replace (monitor->priv->pre_move_sources,
+	                      g_object_ref (event->file),
+	                      g_object_ref (event->other_file));
+}
+
+/* If a MOVED event from this file is waiting in the cache, notify it
+ * now, anything new happening on the file must come after it. Moves
+ * back to except_dest are left for monitor_event_file_moved() to merge.
+ */
+static void
+pending_move_flush (TrackerMonitor *monitor,
+                    GFile          *source,
+                    GFile          *except_dest)
+{
+	EventData *event;
+	GFile *dest;
+
+	dest = g_hash_table_lookup (monitor->priv->pre_move_sources, source);
+
+	if (!dest ||
+	    (except_dest && g_file_equal (dest, except_dest))) {
+		return;
+	}
+
+	dest = g_object_ref (dest);
+	g_hash_table_remove (monitor->priv->pre_move_sources, source);
+
+	event = g_hash_table_lookup (monitor->priv->pre_update, dest);
+
+	/* The index may be stale, the event could have been merged */
+	if (event &&
+	    event->event_type == G_FILE_MONITOR_EVENT_MOVED &&
+	    g_file_equal (event->file, source)) {
+		g_debug ("Notifying MOVED(A->B) before new events on '%s'",
+		         event->file_uri);
+		emit_signal_for_event (monitor, event);
+		g_hash_table_remove (monitor->priv->pre_update, dest);
+	}
+
+	g_object_unref (dest);
+}
+
 static void
 monitor_event_file_created (TrackerMonitor *monitor,
                             GFile          *file)
 {
 	EventData *new_event;
+	EventData *previous_update_event_data;
+
+	/* Get previous event data, if any */
+	previous_update_event_data = g_hash_table_lookup (monitor->priv->pre_update, file);
+
+	if (previous_update_event_data) {
+		if (previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_DELETED) {
+			/* DELETED(A) + CREATED(A) = UPDATED(A)
+			 *
+			 * The file was replaced, as rsync or editors
+			 * saving a file do.
+			 */
+			g_hash_table_replace (monitor->priv->pre_update,
+			                      g_object_ref (file),
+			                      event_data_new (file,
+			                                      NULL,
+			                                      FALSE,
+			                                      G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT));
+		} else {
+			event_data_touch (previous_update_event_data);
+		}
+
+		return;
+	}
 
 	/*  - When a G_FILE_MONITOR_EVENT_CREATED(A) is received,
-	 *    -- Add it to the cache, replacing any previous element
-	 *       (shouldn't be any)
+	 *    -- Add it to the cache
 	 */
 	new_event = event_data_new (file,
 	                            NULL,
@@ -907,13 +1112,18 @@ monitor_event_file_changed (TrackerMonitor *monitor,
 				 * remove it, as we know there will be a CHANGES_DONE_HINT afterwards
 				 */
 				g_hash_table_remove (monitor->priv->pre_update, file);
-			} else if (previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_CREATED) {
+			} else {
 #ifdef GIO_ALWAYS_SENDS_CHANGES_DONE_HINT_AFTER_CREATED
 				/* If we got a CHANGED event before the CREATED was expired,
 				 * set the CREATED as not expirable, as we expect a CHANGES_DONE_HINT
 				 * afterwards. */
-				previous_update_event_data->expirable = FALSE;
+				if (previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_CREATED) {
+					previous_update_event_data->expirable = FALSE;
+				}
 #endif /* GIO_ALWAYS_SENDS_CHANGES_DONE_HINT_AFTER_CREATED */
+
+				/* The file is still being written */
+				event_data_touch (previous_update_event_data);
 			}
 		}
 		return;
@@ -933,7 +1143,8 @@ monitor_event_file_changed (TrackerMonitor *monitor,
 		return;
 	}
 
-	if (previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED) {
+	if (previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED ||
+	    previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_DELETED) {
 		/* Replace the previous ATTRIBUTE_CHANGED event with a CHANGED one. */
 		g_hash_table_replace (monitor->priv->pre_update,
 		                      g_object_ref (file),
@@ -942,8 +1153,12 @@ monitor_event_file_changed (TrackerMonitor *monitor,
 		                                      FALSE,
 		                                      G_FILE_MONITOR_EVENT_CHANGED));
 	} else {
+		if (previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_MOVED) {
+			previous_update_event_data->updated = TRUE;
+		}
+
 		/* Update the start_time of the previous one */
-		g_get_current_time (&(previous_update_event_data->start_time));
+		event_data_touch (previous_update_event_data);
 	}
 }
 
@@ -966,14 +1181,29 @@ monitor_event_file_attribute_changed (TrackerMonitor *monitor,
 		return;
 	}
 
-	if (previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED) {
-		/* Update the start_time of the previous one, if it is an ATTRIBUTE_CHANGED
-		 * event. */
-		g_get_current_time (&(previous_update_event_data->start_time));
-
-		/* No need to update event time in CREATED, as these events
-		 * only expire when there is a CHANGES_DONE_HINT.
+	switch (previous_update_event_data->event_type) {
+	case G_FILE_MONITOR_EVENT_DELETED:
+		/* Recreated without a CREATED event, check it fully */
+		g_hash_table_replace (monitor->priv->pre_update,
+		                      g_object_ref (file),
+		                      event_data_new (file,
+		                                      NULL,
+		                                      FALSE,
+		                                      G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT));
+		break;
+	case G_FILE_MONITOR_EVENT_MOVED:
+		/* ATTR_UPDATED is turned into UPDATED after moves,
+		 * as in monitor_event_file_moved().
+		 */
+		previous_update_event_data->updated = TRUE;
+		event_data_touch (previous_update_event_data);
+		break;
+	default:
+		/* Any other pending event already covers attributes,
+		 * just start the window again.
 		 */
+		event_data_touch (previous_update_event_data);
+		break;
 	}
 }
 
@@ -985,19 +1215,27 @@ monitor_event_file_changes_done (TrackerMonitor *monitor,
 
 	/* Get previous event data, if any */
 	previous_update_event_data = g_hash_table_lookup (monitor->priv->pre_update, file);
-	if (!previous_update_event_data) {
-		/* Insert new update item in cache */
-		g_hash_table_insert (monitor->priv->pre_update,
-		                     g_object_ref (file),
-		                     event_data_new (file,
-		                                     NULL,
-		                                     FALSE,
-		                                     G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT));
+	if (!previous_update_event_data ||
+	    previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_DELETED ||
+	    previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED) {
+		/* Insert new update item in cache, an attributes
+		 * only update is superseded by this one.
+		 */
+		g_hash_table_replace (monitor->priv->pre_update,
+		                      g_object_ref (file),
+		                      event_data_new (file,
+		                                      NULL,
+		                                      FALSE,
+		                                      G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT));
 		return;
 	}
 
+	if (previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_MOVED) {
+		previous_update_event_data->updated = TRUE;
+	}
+
 	/* Refresh event timer, and make sure the event is now set as expirable */
-	g_get_current_time (&(previous_update_event_data->start_time));
+	event_data_touch (previous_update_event_data);
 	previous_update_event_data->expirable = TRUE;
 }
 
@@ -1005,33 +1243,51 @@ static void
 monitor_event_file_deleted (TrackerMonitor *monitor,
                             GFile          *file)
 {
-	EventData *new_event;
 	EventData *previous_update_event_data;
+	GFile *source;
 
 	/* Get previous event data, if any */
 	previous_update_event_data = g_hash_table_lookup (monitor->priv->pre_update, file);
 
-	/* Remove any previous pending event (if blacklisting enabled, there may be some) */
 	if (previous_update_event_data) {
-		GFileMonitorEvent previous_update_event_type;
-
-		previous_update_event_type = previous_update_event_data->event_type;
-		g_hash_table_remove (monitor->priv->pre_update, file);
-
-		if (previous_update_event_type == G_FILE_MONITOR_EVENT_CREATED) {
+		switch (previous_update_event_data->event_type) {
+		case G_FILE_MONITOR_EVENT_CREATED:
 			/* Oh, oh, oh, we got a previous CREATED event waiting in the event
 			 * cache... so we cancel it with the DELETED and don't notify anything */
+			g_hash_table_remove (monitor->priv->pre_update, file);
+			return;
+		case G_FILE_MONITOR_EVENT_MOVED:
+			/* MOVED(A->B) + DELETED(B) = DELETED(A) */
+			source = g_object_ref (previous_update_event_data->file);
+			g_hash_table_remove (monitor->priv->pre_move_sources, source);
+			g_hash_table_remove (monitor->priv->pre_update, file);
+
+			g_hash_table_replace (monitor->priv->pre_update,
+			                      g_object_ref (source),
+			                      event_data_new (source,
+			                                      NULL,
+			                                      FALSE,
+			                                      G_FILE_MONITOR_EVENT_DELETED));
+			g_object_unref (source);
 			return;
+		case G_FILE_MONITOR_EVENT_DELETED:
+			event_data_touch (previous_update_event_data);
+			return;
+		default:
+			/* Updates are superseded by the deletion */
+			break;
 		}
-		/* else, keep on notifying the event */
 	}
 
-	new_event = event_data_new (file,
-	                            NULL,
-	                            FALSE,
-	                            G_FILE_MONITOR_EVENT_DELETED);
-	emit_signal_for_event (monitor, new_event);
-	event_data_free (new_event);
+	/* The DELETED event waits in the cache too, in case
+	 * the file is created again right after.
+	 */
+	g_hash_table_replace (monitor->priv->pre_update,
+	                      g_object_ref (file),
+	                      event_data_new (file,
+	                                      NULL,
+	                                      FALSE,
+	                                      G_FILE_MONITOR_EVENT_DELETED));
 }
 
 static void
@@ -1041,6 +1297,42 @@ monitor_event_file_moved (TrackerMonitor *monitor,
 {
 	EventData *new_event;
 	EventData *previous_update_event_data;
+	EventData *previous_dest_event_data;
+	gboolean updated = FALSE;
+
+	/* Whatever was waiting for the destination file, it
+	 * is overwritten now.
+	 */
+	previous_dest_event_data = g_hash_table_lookup (monitor->priv->pre_update, dst_file);
+
+	if (previous_dest_event_data &&
+	    !g_file_equal (src_file, dst_file)) {
+		if (previous_dest_event_data->event_type == G_FILE_MONITOR_EVENT_MOVED &&
+		    !g_file_equal (previous_dest_event_data->file, src_file)) {
+			GFile *overwritten;
+
+			/* MOVED(X->B) + MOVED(A->B) = DELETED(X) + MOVED(A->B) */
+			overwritten = g_object_ref (previous_dest_event_data->file);
+			g_hash_table_remove (monitor->priv->pre_move_sources, overwritten);
+			g_hash_table_remove (monitor->priv->pre_update, dst_file);
+
+			g_hash_table_replace (monitor->priv->pre_update,
+			                      g_object_ref (overwritten),
+			                      event_data_new (overwritten,
+			                                      NULL,
+			                                      FALSE,
+			                                      G_FILE_MONITOR_EVENT_DELETED));
+			g_object_unref (overwritten);
+		} else if (previous_dest_event_data->event_type == G_FILE_MONITOR_EVENT_DELETED) {
+			/* Let the deletion through before something
+			 * else takes that place.
+			 */
+			emit_signal_for_event (monitor, previous_dest_event_data);
+			g_hash_table_remove (monitor->priv->pre_update, dst_file);
+		} else if (previous_dest_event_data->event_type != G_FILE_MONITOR_EVENT_MOVED) {
+			g_hash_table_remove (monitor->priv->pre_update, dst_file);
+		}
+	}
 
 	/* Get previous event data, if any */
 	previous_update_event_data = g_hash_table_lookup (monitor->priv->pre_update, src_file);
@@ -1050,19 +1342,24 @@ monitor_event_file_moved (TrackerMonitor *monitor,
 	 *   (a) CREATED(A)      + MOVED(A->B)  = CREATED (B)
 	 *   (b) UPDATED(A)      + MOVED(A->B)  = MOVED(A->B) + UPDATED(B)
 	 *   (c) ATTR_UPDATED(A) + MOVED(A->B)  = MOVED(A->B) + UPDATED(B)
+	 *   (d) MOVED(A->B)     + MOVED(B->C)  = MOVED(A->C)
 	 * Notes:
 	 *  - In case (a), the CREATED event is queued in the cache.
 	 *  - In case (a), note that B may already exist before, so instead of a CREATED
 	 *    we should be issuing an UPDATED instead... we don't do it as at the end we
 	 *    don't really mind, and we save a call to g_file_query_exists().
-	 *  - In case (b), the MOVED event is emitted right away, while the UPDATED
-	 *    one is queued in the cache.
+	 *  - In cases (b) and (c), the MOVED event is queued in the cache, and
+	 *    the UPDATED one is notified right after it.
 	 *  - In case (c), we issue an UPDATED instead of ATTR_UPDATED, because there may
 	 *    already be another UPDATED or CREATED event for B, so we make sure in this
 	 *    way that not only attributes get checked at the end.
+	 *  - In case (d), if C is A, only the UPDATED event is left if any.
 	 * */
 	if (previous_update_event_data) {
-		if (previous_update_event_data->event_type == G_FILE_MONITOR_EVENT_CREATED) {
+		GFile *source;
+
+		switch (previous_update_event_data->event_type) {
+		case G_FILE_MONITOR_EVENT_CREATED:
 			/* (a) CREATED(A) + MOVED(A->B)  = UPDATED (B)
 			 *
 			 * Oh, oh, oh, we got a previous created event
@@ -1090,30 +1387,57 @@ monitor_event_file_moved (TrackerMonitor *monitor,
 
 			/* Do not notify the moved event now */
 			return;
-		}
 
-		/*   (b) UPDATED(A)      + MOVED(A->B)  = MOVED(A->B) + UPDATED(B)
-		 *   (c) ATTR_UPDATED(A) + MOVED(A->B)  = MOVED(A->B) + UPDATED(B)
-		 *
-		 * We setup here the UPDATED(B) event, added to the cache */
-		g_hash_table_replace (monitor->priv->pre_update,
-		                      g_object_ref (dst_file),
-		                      event_data_new (dst_file,
-		                                      NULL,
-		                                      FALSE,
-		                                      G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT));
-		/* Remove previous event */
-		g_hash_table_remove (monitor->priv->pre_update, src_file);
+		case G_FILE_MONITOR_EVENT_MOVED:
+			/* (d) MOVED(A->B) + MOVED(B->C) = MOVED(A->C) */
+			source = g_object_ref (previous_update_event_data->file);
+			updated = previous_update_event_data->updated;
+			g_hash_table_remove (monitor->priv->pre_move_sources, source);
+			g_hash_table_remove (monitor->priv->pre_update, src_file);
+
+			if (g_file_equal (source, dst_file)) {
+				if (updated) {
+					g_hash_table_replace (monitor->priv->pre_update,
+					                      g_object_ref (dst_file),
+					                      event_data_new (dst_file,
+					                                      NULL,
+					                                      FALSE,
+					                                      G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT));
+				}
+			} else {
+				new_event = event_data_new (source,
+				                            dst_file,
+				                            FALSE,
+				                            G_FILE_MONITOR_EVENT_MOVED);
+				new_event->updated = updated;
+				pending_move_insert (monitor, new_event);
+			}
 
-		/* And keep on notifying the MOVED event */
+			g_object_unref (source);
+			return;
+
+		case G_FILE_MONITOR_EVENT_DELETED:
+			/* Can't be moved if deleted, let it through */
+			emit_signal_for_event (monitor, previous_update_event_data);
+			g_hash_table_remove (monitor->priv->pre_update, src_file);
+			break;
+
+		default:
+			/*   (b) UPDATED(A)      + MOVED(A->B)  = MOVED(A->B) + UPDATED(B)
+			 *   (c) ATTR_UPDATED(A) + MOVED(A->B)  = MOVED(A->B) + UPDATED(B)
+			 */
+			g_hash_table_remove (monitor->priv->pre_update, src_file);
+			updated = TRUE;
+			break;
+		}
 	}
 
 	new_event = event_data_new (src_file,
 	                            dst_file,
 	                            FALSE,
 	                            G_FILE_MONITOR_EVENT_MOVED);
-	emit_signal_for_event (monitor, new_event);
-	event_data_free (new_event);
+	new_event->updated = updated;
+	pending_move_insert (monitor, new_event);
 }
 
 static void
@@ -1148,6 +1472,9 @@ monitor_event_directory_deleted (TrackerMonitor *monitor,
 	EventData *previous_update_event_data;
 	EventData *previous_delete_event_data;
 
+	/* Pending file events may be inside the directory */
+	event_pairs_flush_updates (monitor, dir);
+
 	/* If any previous update event on this item, notify it */
 	previous_update_event_data = g_hash_table_lookup (monitor->priv->pre_update, dir);
 	if (previous_update_event_data) {
@@ -1185,6 +1512,10 @@ monitor_event_directory_moved (TrackerMonitor *monitor,
 	EventData *previous_update_event_data;
 	EventData *previous_delete_event_data;
 
+	/* Pending file events may be inside either directory */
+	event_pairs_flush_updates (monitor, src_dir);
+	event_pairs_flush_updates (monitor, dst_dir);
+
 	/* If any previous update event on this item, notify it */
 	previous_update_event_data = g_hash_table_lookup (monitor->priv->pre_update, src_dir);
 	if (previous_update_event_data) {
@@ -1224,30 +1555,21 @@ monitor_event_directory_moved (TrackerMonitor *monitor,
 }
 
 static void
-monitor_event_cb (GFileMonitor      *file_monitor,
-                  GFile             *file,
-                  GFile             *other_file,
-                  GFileMonitorEvent  event_type,
-                  gpointer           user_data)
+monitor_event_process (TrackerMonitor    *monitor,
+                       GFile             *file,
+                       GFile             *other_file,
+                       gboolean           is_directory,
+                       GFileMonitorEvent  event_type)
 {
-	TrackerMonitor *monitor;
 	gchar *file_uri;
 	gchar *other_file_uri;
-	gboolean is_directory;
 
-	monitor = user_data;
-
-	if (G_UNLIKELY (!monitor->priv->enabled)) {
-		g_debug ("Silently dropping monitor event, monitor disabled for now");
-		return;
-	}
+	monitor->priv->events_received++;
 
 	/* Get URIs as paths may not be in UTF-8 */
 	file_uri = g_file_get_uri (file);
 
 	if (!other_file) {
-		is_directory = check_is_directory (monitor, file);
-
 		/* Avoid non-indexable-files */
 		if (monitor->priv->tree &&
 		    !tracker_indexing_tree_file_is_indexable (monitor->priv->tree,
@@ -1266,11 +1588,6 @@ monitor_event_cb (GFileMonitor      *file_monitor,
 		         is_directory ? "directory" : "file",
 		         file_uri);
 	} else {
-		/* If we have other_file, it means an item was moved from file to other_file;
-		 * so, it makes sense to check if the other_file is directory instead of
-		 * the origin file, as this one will not exist any more */
-		is_directory = check_is_directory (monitor, other_file);
-
 		/* Avoid doing anything of both
 		 * file/other_file are non-indexable
 		 */
@@ -1314,7 +1631,15 @@ monitor_event_cb (GFileMonitor      *file_monitor,
 #endif /* PAUSE_ON_IO */
 
 	if (!is_directory) {
-		/* FILE Events */
+		/* FILE Events, a move waiting in the cache from either
+		 * location goes first, unless this moves the file back.
+		 */
+		pending_move_flush (monitor, file, NULL);
+
+		if (other_file) {
+			pending_move_flush (monitor, other_file, file);
+		}
+
 		switch (event_type) {
 		case G_FILE_MONITOR_EVENT_CREATED:
 			monitor_event_file_created (monitor, file);
@@ -1367,9 +1692,9 @@ monitor_event_cb (GFileMonitor      *file_monitor,
 		if (monitor->priv->event_pairs_timeout_id == 0) {
 			g_debug ("Waiting for event pairs");
 			monitor->priv->event_pairs_timeout_id =
-				g_timeout_add_seconds (CACHE_LIFETIME_SECONDS,
-				                       event_pairs_timeout_cb,
-				                       monitor);
+				g_timeout_add (EVENT_COALESCE_CHECK_MSEC,
+				               event_pairs_timeout_cb,
+				               monitor);
 		}
 	} else {
 		if (monitor->priv->event_pairs_timeout_id != 0) {
@@ -1383,6 +1708,497 @@ monitor_event_cb (GFileMonitor      *file_monitor,
 	g_free (other_file_uri);
 }
 
+static void
+monitor_event_cb (GFileMonitor      *file_monitor,
+                  GFile             *file,
+                  GFile             *other_file,
+                  GFileMonitorEvent  event_type,
+                  gpointer           user_data)
+{
+	TrackerMonitor *monitor;
+	gboolean is_directory;
+
+	monitor = user_data;
+
+	if (G_UNLIKELY (!monitor->priv->enabled)) {
+		g_debug ("Silently dropping monitor event, monitor disabled for now");
+		return;
+	}
+
+	if (!other_file) {
+		is_directory = check_is_directory (monitor, file);
+	} else {
+		/* If we have other_file, it means an item was moved from file to other_file;
+		 * so, it makes sense to check if the other_file is directory instead of
+		 * the origin file, as this one will not exist any more */
+		is_directory = check_is_directory (monitor, other_file);
+	}
+
+	monitor_event_process (monitor, file, other_file,
+	                       is_directory, event_type);
+}
+
+#ifdef TRACKER_MONITOR_FANOTIFY
+
+/* Stands for a monitored directory in the monitors table when the
+ * fanotify backend is used, so it can be cancelled and destroyed as
+ * any other GFileMonitor.
+ */
+typedef struct {
+	GFileMonitor parent_instance;
+	TrackerMonitor *monitor;
+	GFile *directory;
+	GBytes *handle;
+} TrackerFanotifyWatch;
+
+typedef struct {
+	GFileMonitorClass parent_class;
+} TrackerFanotifyWatchClass;
+
+static GType tracker_fanotify_watch_get_type (void);
+
+G_DEFINE_TYPE (TrackerFanotifyWatch, tracker_fanotify_watch, G_TYPE_FILE_MONITOR)
+
+static gboolean
+tracker_fanotify_watch_cancel (GFileMonitor *file_monitor)
+{
+	TrackerFanotifyWatch *watch = (TrackerFanotifyWatch *) file_monitor;
+	TrackerMonitorPrivate *priv;
+
+	if (!watch->monitor) {
+		return TRUE;
+	}
+
+	priv = watch->monitor->priv;
+
+	/* The handle may have been taken over by a newer watch on
+	 * the same directory, e.g. on tracker_monitor_move().
+	 */
+	if (g_hash_table_lookup (priv->fanotify_watches, watch->handle) == watch) {
+		g_hash_table_remove (priv->fanotify_watches, watch->handle);
+	}
+
+	priv->n_fanotify_watches--;
+	watch->monitor = NULL;
+
+	return TRUE;
+}
+
+static void
+tracker_fanotify_watch_finalize (GObject *object)
+{
+	TrackerFanotifyWatch *watch = (TrackerFanotifyWatch *) object;
+
+	g_object_unref (watch->directory);
+	g_bytes_unref (watch->handle);
+
+	G_OBJECT_CLASS (tracker_fanotify_watch_parent_class)->finalize (object);
+}
+
+static void
+tracker_fanotify_watch_class_init (TrackerFanotifyWatchClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	GFileMonitorClass *file_monitor_class = G_FILE_MONITOR_CLASS (klass);
+
+	object_class->finalize = tracker_fanotify_watch_finalize;
+	file_monitor_class->cancel = tracker_fanotify_watch_cancel;
+}
+
+static void
+tracker_fanotify_watch_init (TrackerFanotifyWatch *watch)
+{
+}
+
+G_STATIC_ASSERT (sizeof (fsid_t) == sizeof (__kernel_fsid_t));
+
+static GBytes *
+fanotify_handle_key_new (gconstpointer              fsid,
+                         const struct file_handle *handle)
+{
+	gsize len;
+	guchar *data;
+
+	len = sizeof (fsid_t) + sizeof (gint) + handle->handle_bytes;
+	data = g_malloc (len);
+
+	memcpy (data, fsid, sizeof (fsid_t));
+	memcpy (data + sizeof (fsid_t), &handle->handle_type, sizeof (gint));
+	memcpy (data + sizeof (fsid_t) + sizeof (gint),
+	        handle->f_handle, handle->handle_bytes);
+
+	return g_bytes_new_take (data, len);
+}
+
+static void
+fanotify_shutdown (TrackerMonitor *monitor)
+{
+	TrackerMonitorPrivate *priv = monitor->priv;
+
+	if (priv->fanotify_source_id) {
+		g_source_remove (priv->fanotify_source_id);
+		priv->fanotify_source_id = 0;
+	}
+
+	if (priv->fanotify_fd != -1) {
+		close (priv->fanotify_fd);
+		priv->fanotify_fd = -1;
+	}
+}
+
+/* Replaces the watches added so far with per-directory
+ * monitors, once fanotify can't be used anymore.
+ */
+static void
+fanotify_fall_back (TrackerMonitor *monitor)
+{
+	TrackerMonitorPrivate *priv = monitor->priv;
+	GList *watches, *l;
+
+	fanotify_shutdown (monitor);
+	watches = g_hash_table_get_values (priv->fanotify_watches);
+
+	for (l = watches; l; l = l->next) {
+		TrackerFanotifyWatch *watch = l->data;
+		GFile *directory;
+
+		if (g_hash_table_lookup (priv->monitors, watch->directory) != watch) {
+			continue;
+		}
+
+		/* Cancels and frees the watch */
+		directory = g_object_ref (watch->directory);
+		g_hash_table_replace (priv->monitors, directory,
+		                      directory_monitor_new (monitor, directory));
+	}
+
+	g_list_free (watches);
+}
+
+/* Marks the filesystem containing path, once per filesystem */
+static gboolean
+fanotify_mark_filesystem (TrackerMonitor *monitor,
+                          const gchar    *path,
+                          const fsid_t   *fsid)
+{
+	TrackerMonitorPrivate *priv = monitor->priv;
+	GBytes *key;
+	gpointer value;
+	gboolean marked;
+
+	key = g_bytes_new (fsid, sizeof (fsid_t));
+
+	if (g_hash_table_lookup_extended (priv->fanotify_filesystems,
+	                                  key, NULL, &value)) {
+		g_bytes_unref (key);
+		return GPOINTER_TO_INT (value);
+	}
+
+	marked = fanotify_mark (priv->fanotify_fd,
+	                        FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+	                        FANOTIFY_EVENT_MASK,
+	                        AT_FDCWD, path) == 0;
+
+	if (!marked) {
+		if (errno == EPERM) {
+			/* Filesystem marks need CAP_SYS_ADMIN, nothing
+			 * else will be marked either.
+			 */
+			g_message ("Not permitted to watch filesystems with fanotify, "
+			           "falling back to per-directory monitors");
+			fanotify_fall_back (monitor);
+			g_bytes_unref (key);
+			return FALSE;
+		}
+
+		g_debug ("Could not watch filesystem of path:'%s' with fanotify, %s, "
+		         "using per-directory monitors there",
+		         path, g_strerror (errno));
+	}
+
+	g_hash_table_insert (priv->fanotify_filesystems, key,
+	                     GINT_TO_POINTER (marked));
+
+	return marked;
+}
+
+static GFileMonitor *
+fanotify_watch_new (TrackerMonitor *monitor,
+                    GFile          *file)
+{
+	TrackerMonitorPrivate *priv = monitor->priv;
+	TrackerFanotifyWatch *watch;
+	guint64 handle_buf[(sizeof (struct file_handle) + MAX_HANDLE_SZ) / sizeof (guint64) + 1];
+	struct file_handle *handle;
+	struct statfs st;
+	gint mount_id;
+	gchar *path;
+	GBytes *key;
+
+	path = g_file_get_path (file);
+
+	if (!path) {
+		return NULL;
+	}
+
+	handle = (struct file_handle *) handle_buf;
+	handle->handle_bytes = MAX_HANDLE_SZ;
+
+	if (statfs (path, &st) != 0 ||
+	    name_to_handle_at (AT_FDCWD, path, handle, &mount_id, 0) != 0 ||
+	    !fanotify_mark_filesystem (monitor, path, &st.f_fsid)) {
+		g_free (path);
+		return NULL;
+	}
+
+	g_free (path);
+
+	key = fanotify_handle_key_new (&st.f_fsid, handle);
+
+	watch = g_object_new (tracker_fanotify_watch_get_type (), NULL);
+	watch->monitor = monitor;
+	watch->directory = g_object_ref (file);
+	watch->handle = key;
+
+	g_hash_table_replace (priv->fanotify_watches,
+	                      g_bytes_ref (key), watch);
+	priv->n_fanotify_watches++;
+
+	return G_FILE_MONITOR (watch);
+}
+
+static GFile *
+fanotify_resolve_file (TrackerMonitor                     *monitor,
+                       const struct fanotify_event_info_fid *fid)
+{
+	const struct file_handle *handle;
+	TrackerFanotifyWatch *watch;
+	const gchar *name;
+	GBytes *key;
+
+	handle = (const struct file_handle *) fid->handle;
+	name = (const gchar *) handle->f_handle + handle->handle_bytes;
+
+	key = fanotify_handle_key_new (&fid->fsid, handle);
+	watch = g_hash_table_lookup (monitor->priv->fanotify_watches, key);
+	g_bytes_unref (key);
+
+	/* Not in a monitored directory */
+	if (!watch) {
+		return NULL;
+	}
+
+	if (name[0] == '\0' || strcmp (name, ".") == 0) {
+		return g_object_ref (watch->directory);
+	}
+
+	return g_file_get_child (watch->directory, name);
+}
+
+static void
+fanotify_handle_event (TrackerMonitor                       *monitor,
+                       const struct fanotify_event_metadata *metadata)
+{
+	const gchar *ptr, *end;
+	GFile *file = NULL, *other_file = NULL;
+	gboolean is_directory;
+	guint64 mask;
+
+	ptr = (const gchar *) metadata + metadata->metadata_len;
+	end = (const gchar *) metadata + metadata->event_len;
+
+	while (ptr + sizeof (struct fanotify_event_info_header) <= end) {
+		const struct fanotify_event_info_header *header;
+
+		header = (const struct fanotify_event_info_header *) ptr;
+
+		if (header->len == 0 || ptr + header->len > end) {
+			break;
+		}
+
+		switch (header->info_type) {
+		case FAN_EVENT_INFO_TYPE_DFID_NAME:
+#ifdef FAN_RENAME
+		case FAN_EVENT_INFO_TYPE_OLD_DFID_NAME:
+#endif
+			if (!file) {
+				file = fanotify_resolve_file (monitor, (gconstpointer) ptr);
+			}
+			break;
+#ifdef FAN_RENAME
+		case FAN_EVENT_INFO_TYPE_NEW_DFID_NAME:
+			if (!other_file) {
+				other_file = fanotify_resolve_file (monitor, (gconstpointer) ptr);
+			}
+			break;
+#endif
+		default:
+			break;
+		}
+
+		ptr += header->len;
+	}
+
+	mask = metadata->mask;
+	is_directory = (mask & FAN_ONDIR) != 0;
+
+#ifdef FAN_RENAME
+	if (mask & FAN_RENAME) {
+		if (file && other_file) {
+			monitor_event_process (monitor, file, other_file, is_directory,
+			                       G_FILE_MONITOR_EVENT_MOVED);
+		} else if (file) {
+			/* Moved out of the monitored directories */
+			monitor_event_process (monitor, file, NULL, is_directory,
+			                       G_FILE_MONITOR_EVENT_DELETED);
+		} else if (other_file) {
+			monitor_event_process (monitor, other_file, NULL, is_directory,
+			                       G_FILE_MONITOR_EVENT_CREATED);
+		}
+	}
+#endif
+
+	if (!file) {
+		g_clear_object (&other_file);
+		return;
+	}
+
+	/* Events on the same file may be merged by the kernel, these
+	 * are replayed in the order they most likely happened. If the
+	 * file was both created and deleted, whether it exists tells
+	 * which one came last.
+	 */
+	if ((mask & FAN_CREATE) && (mask & FAN_DELETE) &&
+	    g_file_query_exists (file, NULL)) {
+		monitor_event_process (monitor, file, NULL, is_directory,
+		                       G_FILE_MONITOR_EVENT_DELETED);
+		mask &= ~FAN_DELETE;
+	}
+
+	if (mask & (FAN_CREATE | FAN_MOVED_TO)) {
+		monitor_event_process (monitor, file, NULL, is_directory,
+		                       G_FILE_MONITOR_EVENT_CREATED);
+	}
+
+	if (mask & FAN_MODIFY) {
+		monitor_event_process (monitor, file, NULL, is_directory,
+		                       G_FILE_MONITOR_EVENT_CHANGED);
+	}
+
+	if (mask & FAN_ATTRIB) {
+		monitor_event_process (monitor, file, NULL, is_directory,
+		                       G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED);
+	}
+
+	if (mask & FAN_CLOSE_WRITE) {
+		monitor_event_process (monitor, file, NULL, is_directory,
+		                       G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT);
+	}
+
+	if (mask & (FAN_DELETE | FAN_MOVED_FROM)) {
+		monitor_event_process (monitor, file, NULL, is_directory,
+		                       G_FILE_MONITOR_EVENT_DELETED);
+	}
+
+	g_object_unref (file);
+	g_clear_object (&other_file);
+}
+
+static gboolean
+fanotify_read_cb (gint         fd,
+                  GIOCondition condition,
+                  gpointer     user_data)
+{
+	TrackerMonitor *monitor = user_data;
+	guint64 *buf = monitor->priv->fanotify_buffer;
+	const struct fanotify_event_metadata *metadata;
+	gssize len;
+
+	while ((len = read (fd, buf, FANOTIFY_BUFFER_SIZE)) > 0) {
+		metadata = (const struct fanotify_event_metadata *) buf;
+
+		while (FAN_EVENT_OK (metadata, len)) {
+			if (metadata->vers != FANOTIFY_METADATA_VERSION) {
+				g_critical ("Unexpected fanotify metadata version %d",
+				            metadata->vers);
+				break;
+			}
+
+			if (metadata->mask & FAN_Q_OVERFLOW) {
+				g_warning ("fanotify event queue overflowed, "
+				           "some changes were not noticed");
+			} else {
+				fanotify_handle_event (monitor, metadata);
+			}
+
+			/* Events with FID reporting carry no file descriptor */
+			if (metadata->fd >= 0) {
+				close (metadata->fd);
+			}
+
+			metadata = FAN_EVENT_NEXT (metadata, len);
+		}
+
+		/* The source may have gone if handling events
+		 * disabled the monitor.
+		 */
+		if (monitor->priv->fanotify_fd != fd) {
+			return FALSE;
+		}
+	}
+
+	if (len < 0 && errno != EAGAIN && errno != EINTR) {
+		g_critical ("Could not read fanotify events: %s",
+		            g_strerror (errno));
+	}
+
+	return TRUE;
+}
+
+static void
+fanotify_init_backend (TrackerMonitor *monitor)
+{
+	TrackerMonitorPrivate *priv = monitor->priv;
+
+	priv->fanotify_fd = -1;
+	priv->fanotify_watches =
+		g_hash_table_new_full (g_bytes_hash,
+		                       g_bytes_equal,
+		                       (GDestroyNotify) g_bytes_unref,
+		                       NULL);
+	priv->fanotify_filesystems =
+		g_hash_table_new_full (g_bytes_hash,
+		                       g_bytes_equal,
+		                       (GDestroyNotify) g_bytes_unref,
+		                       NULL);
+
+	if (g_getenv ("TRACKER_MONITOR_DISABLE_FANOTIFY")) {
+		return;
+	}
+
+	priv->fanotify_fd = fanotify_init (FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME |
+	                                   FAN_CLOEXEC | FAN_NONBLOCK,
+	                                   O_RDONLY | O_LARGEFILE);
+
+	if (priv->fanotify_fd == -1) {
+		g_debug ("fanotify is not available: %s", g_strerror (errno));
+		return;
+	}
+
+	/* Kept until finalization, as the backend may be shut
+	 * down while events read into it are being handled.
+	 */
+	priv->fanotify_buffer = g_malloc (FANOTIFY_BUFFER_SIZE);
+
+	priv->fanotify_source_id =
+		g_unix_fd_add (priv->fanotify_fd, G_IO_IN,
+		               fanotify_read_cb, monitor);
+
+	g_message ("Monitor backend is fanotify, for filesystems that can be marked");
+}
+
+#endif /* TRACKER_MONITOR_FANOTIFY */
+
 static GFileMonitor *
 directory_monitor_new (TrackerMonitor *monitor,
                        GFile          *file)
@@ -1390,6 +2206,16 @@ directory_monitor_new (TrackerMonitor *monitor,
 	GFileMonitor *file_monitor;
 	GError *error = NULL;
 
+#ifdef TRACKER_MONITOR_FANOTIFY
+	if (monitor->priv->fanotify_fd != -1) {
+		file_monitor = fanotify_watch_new (monitor, file);
+
+		if (file_monitor) {
+			return file_monitor;
+		}
+	}
+#endif /* TRACKER_MONITOR_FANOTIFY */
+
 	file_monitor = g_file_monitor_directory (file,
 	                                         G_FILE_MONITOR_SEND_MOVED | G_FILE_MONITOR_WATCH_MOUNTS,
 	                                         NULL,
@@ -1505,6 +2331,32 @@ tracker_monitor_set_enabled (TrackerMonitor *monitor,
 	g_list_free (keys);
 }
 
+/* Number of monitors counting against monitor_limit, fanotify
+ * watches don't use any per-directory kernel resource.
+ */
+static guint
+monitor_get_limited_count (TrackerMonitor *monitor)
+{
+	guint count;
+
+	count = g_hash_table_size (monitor->priv->monitors);
+
+#ifdef TRACKER_MONITOR_FANOTIFY
+	if (monitor->priv->fanotify_fd != -1) {
+		if (!monitor->priv->enabled) {
+			/* No watches exist while disabled, most will
+			 * be fanotify ones once enabled.
+			 */
+			return 0;
+		}
+
+		count -= monitor->priv->n_fanotify_watches;
+	}
+#endif /* TRACKER_MONITOR_FANOTIFY */
+
+	return count;
+}
+
 gboolean
 tracker_monitor_add (TrackerMonitor *monitor,
                      GFile          *file)
@@ -1520,7 +2372,7 @@ tracker_monitor_add (TrackerMonitor *monitor,
 	}
 
 	/* Cap the number of monitors */
-	if (g_hash_table_size (monitor->priv->monitors) >= monitor->priv->monitor_limit) {
+	if (monitor_get_limited_count (monitor) >= monitor->priv->monitor_limit) {
 		monitor->priv->monitors_ignored++;
 
 		if (!monitor->priv->monitor_limit_warned) {
@@ -1700,3 +2552,19 @@ tracker_monitor_get_ignored (TrackerMonitor *monitor)
 
 	return monitor->priv->monitors_ignored;
 }
+
+guint
+tracker_monitor_get_events_received (TrackerMonitor *monitor)
+{
+	g_return_val_if_fail (TRACKER_IS_MONITOR (monitor), 0);
+
+	return monitor->priv->events_received;
+}
+
+guint
+tracker_monitor_get_items_emitted (TrackerMonitor *monitor)
+{
+	g_return_val_if_fail (TRACKER_IS_MONITOR (monitor), 0);
+
+	return monitor->priv->items_emitted;
+}
@@ -75,6 +75,8 @@ gboolean        tracker_monitor_is_watched_by_string (TrackerMonitor *monitor,
                                                       const gchar    *path);
 guint           tracker_monitor_get_count            (TrackerMonitor *monitor);
 guint           tracker_monitor_get_ignored          (TrackerMonitor *monitor);
+guint           tracker_monitor_get_events_received  (TrackerMonitor *monitor);
+guint           tracker_monitor_get_items_emitted    (TrackerMonitor *monitor);
 
 G_END_DECLS
 
@@ -234,6 +234,16 @@ tracker_priority_queue_foreach_remove (TrackerPriorityQueue *queue,
 				segment->first_elem = elem->next;
 			} else if (elem == segment->last_elem) {
 				segment->last_elem = elem->prev;
+
+				/* Move on to the next segment */
+				if (list) {
+					n_segment++;
+					g_assert (n_segment < queue->segments->len);
+
+					segment = &g_array_index (queue->segments,
+					                          PrioritySegment,
+					                          n_segment);
+				}
 			}
 
 			if (destroy_notify) {
@@ -259,6 +269,86 @@ tracker_priority_queue_foreach_remove (TrackerPriorityQueue *queue,
 	return updated;
 }
 
+guint
+tracker_priority_queue_boost (TrackerPriorityQueue *queue,
+                              GEqualFunc            compare_func,
+                              gpointer              compare_user_data,
+                              gint                  priority)
+{
+	PrioritySegment *segment;
+	gint n_segment = 0;
+	GQueue boosted = G_QUEUE_INIT;
+	GList *list, *elem;
+	guint n_boosted;
+
+	g_return_val_if_fail (queue != NULL, 0);
+	g_return_val_if_fail (compare_func != NULL, 0);
+
+	list = queue->queue.head;
+
+	if (!list) {
+		return 0;
+	}
+
+	segment = &g_array_index (queue->segments, PrioritySegment, n_segment);
+
+	while (list) {
+		elem = list;
+		list = list->next;
+
+		if (segment->priority > priority &&
+		    (compare_func) (elem->data, compare_user_data)) {
+			/* Update segment limits */
+			if (elem == segment->first_elem &&
+			    elem == segment->last_elem) {
+				g_array_remove_index (queue->segments,
+				                      n_segment);
+
+				if (list) {
+					segment = &g_array_index (queue->segments,
+					                          PrioritySegment,
+					                          n_segment);
+				}
+			} else if (elem == segment->first_elem) {
+				segment->first_elem = elem->next;
+			} else if (elem == segment->last_elem) {
+				segment->last_elem = elem->prev;
+
+				/* Move on to the next segment */
+				if (list) {
+					n_segment++;
+					g_assert (n_segment < queue->segments->len);
+
+					segment = &g_array_index (queue->segments,
+					                          PrioritySegment,
+					                          n_segment);
+				}
+			}
+
+			g_queue_unlink (&queue->queue, elem);
+			g_queue_push_tail_link (&boosted, elem);
+		} else if (list != NULL &&
+		           elem == segment->last_elem) {
+			/* Move on to the next segment */
+			n_segment++;
+			g_assert (n_segment < queue->segments->len);
+
+			segment = &g_array_index (queue->segments,
+			                          PrioritySegment,
+			                          n_segment);
+		}
+	}
+
+	n_boosted = boosted.length;
+
+	/* Reinsert in the same relative order */
+	while ((elem = g_queue_pop_head_link (&boosted)) != NULL) {
+		insert_node (queue, priority, elem);
+	}
+
+	return n_boosted;
+}
+
 gboolean
 tracker_priority_queue_is_empty (TrackerPriorityQueue *queue)
 {
@@ -49,6 +49,11 @@ gboolean tracker_priority_queue_foreach_remove (TrackerPriorityQueue *queue,
                                                 gpointer              compare_user_data,
                                                 GDestroyNotify        destroy_notify);
 
+guint    tracker_priority_queue_boost          (TrackerPriorityQueue *queue,
+                                                GEqualFunc            compare_func,
+                                                gpointer              compare_user_data,
+                                                gint                  priority);
+
 gpointer tracker_priority_queue_find           (TrackerPriorityQueue *queue,
                                                 gint                 *priority_out,
                                                 GEqualFunc            compare_func,
@@ -30,6 +30,7 @@
 #include <glib.h>
 #include <glib-object.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 #include <libtracker-common/tracker-dbus.h>
 #include <libtracker-common/tracker-ioprio.h>
@@ -680,6 +681,104 @@ miner_needs_check (TrackerMiner *miner,
 	}
 }
 
+static gchar *
+crawl_state_get_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+	                         "tracker",
+	                         "crawl-state",
+	                         NULL);
+}
+
+static void
+checksum_update_list (GChecksum *checksum,
+                      GSList    *list)
+{
+	GSList *l;
+
+	for (l = list; l; l = l->next) {
+		g_checksum_update (checksum, l->data, -1);
+		g_checksum_update (checksum, (const guchar *) "\n", 1);
+	}
+
+	g_checksum_update (checksum, (const guchar *) "\n", 1);
+}
+
+static gchar *
+crawl_state_get_checksum (TrackerConfig *config)
+{
+	GChecksum *checksum;
+	gchar *str;
+
+	/* The crawl state is only valid for the same set
+	 * of indexed directories and filters.
+	 */
+	checksum = g_checksum_new (G_CHECKSUM_MD5);
+	checksum_update_list (checksum, tracker_config_get_index_recursive_directories (config));
+	checksum_update_list (checksum, tracker_config_get_index_single_directories (config));
+	checksum_update_list (checksum, tracker_config_get_ignored_directories (config));
+	checksum_update_list (checksum, tracker_config_get_ignored_directories_with_content (config));
+	checksum_update_list (checksum, tracker_config_get_ignored_files (config));
+
+	str = g_strdup_printf ("%d%d",
+	                       tracker_config_get_index_removable_devices (config),
+	                       tracker_config_get_index_optical_discs (config));
+	g_checksum_update (checksum, (const guchar *) str, -1);
+	g_free (str);
+
+	str = g_strdup (g_checksum_get_string (checksum));
+	g_checksum_free (checksum);
+
+	return str;
+}
+
+static void
+crawl_state_load (TrackerConfig *config,
+                  TrackerMiner  *miner)
+{
+	gchar *filename, *checksum;
+	GError *error = NULL;
+
+	filename = crawl_state_get_filename ();
+	checksum = crawl_state_get_checksum (config);
+
+	if (!tracker_miner_fs_load_crawl_state (TRACKER_MINER_FS (miner),
+	                                        filename, checksum, &error)) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+			g_message ("Could not load crawl state, crawling all directories: %s",
+			           error->message);
+		}
+
+		g_error_free (error);
+	}
+
+	/* It would be stale if we crash */
+	g_unlink (filename);
+
+	g_free (checksum);
+	g_free (filename);
+}
+
+static void
+crawl_state_save (TrackerConfig *config,
+                  TrackerMiner  *miner)
+{
+	gchar *filename, *checksum;
+	GError *error = NULL;
+
+	filename = crawl_state_get_filename ();
+	checksum = crawl_state_get_checksum (config);
+
+	if (!tracker_miner_fs_save_crawl_state (TRACKER_MINER_FS (miner),
+	                                        filename, checksum, &error)) {
+		g_message ("Could not save crawl state: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_free (checksum);
+	g_free (filename);
+}
+
 int
 main (gint argc, gchar *argv[])
 {
@@ -829,6 +928,14 @@ main (gint argc, gchar *argv[])
 	/* Configure files miner */
 	tracker_miner_fs_set_initial_crawling (TRACKER_MINER_FS (miner_files), do_crawling);
 	tracker_miner_fs_set_mtime_checking (TRACKER_MINER_FS (miner_files), do_mtime_checking);
+
+	/* Directories unchanged since the last clean shutdown
+	 * may be skipped, as long as these are monitored.
+	 */
+	if (!do_mtime_checking && tracker_config_get_enable_monitors (config)) {
+		crawl_state_load (config, miner_files);
+	}
+
 	g_signal_connect (miner_files, "finished",
 			  G_CALLBACK (miner_finished_cb),
 			  NULL);
@@ -847,6 +954,10 @@ main (gint argc, gchar *argv[])
 	if (miners_timeout_id == 0 &&
 	    !miner_needs_check (miner_files, store_available)) {
 		tracker_db_manager_set_need_mtime_check (FALSE);
+
+		if (tracker_config_get_enable_monitors (config)) {
+			crawl_state_save (config, miner_files);
+		}
 	}
 
 	g_main_loop_unref (main_loop);
@@ -35,6 +35,9 @@ static const gchar introspection_xml[] =
   "    <method name='IndexFile'>"
   "      <arg type='s' name='file_uri' direction='in' />"
   "    </method>"
+  "    <method name='BoostDirectory'>"
+  "      <arg type='s' name='directory_uri' direction='in' />"
+  "    </method>"
   "  </interface>"
   "</node>";
 
@@ -376,6 +379,53 @@ handle_method_call_index_file (TrackerMinerFilesIndex *miner,
 	g_object_unref (file);
 }
 
+static void
+handle_method_call_boost_directory (TrackerMinerFilesIndex *miner,
+                                    GDBusMethodInvocation  *invocation,
+                                    GVariant               *parameters)
+{
+	TrackerMinerFilesIndexPrivate *priv;
+	TrackerDBusRequest *request;
+	TrackerIndexingTree *indexing_tree;
+	GError *internal_error;
+	const gchar *directory_uri;
+	GFile *directory;
+
+	priv = TRACKER_MINER_FILES_INDEX_GET_PRIVATE (miner);
+
+	g_variant_get (parameters, "(&s)", &directory_uri);
+
+	tracker_gdbus_async_return_if_fail (directory_uri != NULL, invocation);
+
+	request = tracker_g_dbus_request_begin (invocation, "%s(uri:'%s')", __FUNCTION__, directory_uri);
+
+	directory = g_file_new_for_uri (directory_uri);
+	indexing_tree = tracker_miner_fs_get_indexing_tree (TRACKER_MINER_FS (priv->files_miner));
+
+	/* Only directories indexed already can be boosted,
+	 * IndexFile() can be used for others.
+	 */
+	if (!tracker_indexing_tree_file_is_indexable (indexing_tree, directory,
+	                                              G_FILE_TYPE_DIRECTORY)) {
+		internal_error = g_error_new_literal (1, 0, "Directory is not eligible to be indexed");
+		tracker_dbus_request_end (request, internal_error);
+		g_dbus_method_invocation_return_gerror (invocation, internal_error);
+
+		g_error_free (internal_error);
+
+		g_object_unref (directory);
+
+		return;
+	}
+
+	tracker_miner_fs_boost_directory (TRACKER_MINER_FS (priv->files_miner), directory);
+
+	tracker_dbus_request_end (request, NULL);
+	g_dbus_method_invocation_return_value (invocation, NULL);
+
+	g_object_unref (directory);
+}
+
 static void
 handle_method_call (GDBusConnection       *connection,
                     const gchar           *sender,
@@ -395,6 +445,8 @@ handle_method_call (GDBusConnection       *connection,
 		tracker_miner_files_index_reindex_mime_types (miner, invocation, parameters);
 	} else if (g_strcmp0 (method_name, "IndexFile") == 0) {
 		handle_method_call_index_file (miner, invocation, parameters);
+	} else if (g_strcmp0 (method_name, "BoostDirectory") == 0) {
+		handle_method_call_boost_directory (miner, invocation, parameters);
 	} else {
 		g_assert_not_reached ();
 	}
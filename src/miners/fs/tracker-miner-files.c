@@ -40,6 +40,7 @@
 #include <libtracker-common/tracker-type-utils.h>
 #include <libtracker-common/tracker-utils.h>
 #include <libtracker-common/tracker-file-utils.h>
+#include <libtracker-common/tracker-mime-cache.h>
 #include <libtracker-common/tracker-storage.h>
 
 #include <libtracker-data/tracker-db-manager.h>
@@ -56,6 +57,15 @@
 
 #define TRACKER_MINER_FILES_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), TRACKER_TYPE_MINER_FILES, TrackerMinerFilesPrivate))
 
+/* Attributes queried to build the basic file metadata, the
+ * content type is resolved separately through the MIME cache.
+ */
+#define PROCESS_FILE_ATTRIBUTES \
+	TRACKER_MIME_CACHE_FILE_ATTRIBUTES "," \
+	G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+	G_FILE_ATTRIBUTE_TIME_ACCESS
+
 static GQuark miner_files_error_quark = 0;
 
 typedef struct ProcessFileData ProcessFileData;
@@ -68,6 +78,13 @@ struct ProcessFileData {
 	gchar *mime_type;
 };
 
+typedef struct {
+	ProcessFileData **data;
+	GFileInfo **infos;
+	GError **errors;
+	guint n_files;
+} ProcessFilesBatch;
+
 struct TrackerMinerFilesPrivate {
 	TrackerConfig *config;
 	TrackerStorage *storage;
@@ -102,6 +119,8 @@ struct TrackerMinerFilesPrivate {
 	guint stale_volumes_check_id;
 
 	GList *extraction_queue;
+
+	TrackerMimeCache *mime_cache;
 };
 
 enum {
@@ -175,6 +194,12 @@ static gboolean    miner_files_process_file             (TrackerMinerFS       *f
                                                          GFile                *file,
                                                          TrackerSparqlBuilder *sparql,
                                                          GCancellable         *cancellable);
+static void        miner_files_process_files            (TrackerMinerFS        *fs,
+                                                         GFile                **files,
+                                                         TrackerSparqlBuilder **builders,
+                                                         GCancellable         **cancellables,
+                                                         gboolean              *accepted,
+                                                         guint                  n_files);
 static gboolean    miner_files_process_file_attributes  (TrackerMinerFS       *fs,
                                                          GFile                *file,
                                                          TrackerSparqlBuilder *sparql,
@@ -223,6 +248,7 @@ tracker_miner_files_class_init (TrackerMinerFilesClass *klass)
 
 	miner_fs_class->process_file = miner_files_process_file;
 	miner_fs_class->process_file_attributes = miner_files_process_file_attributes;
+	miner_fs_class->process_files = miner_files_process_files;
 	miner_fs_class->ignore_next_update_file = miner_files_ignore_next_update_file;
 	miner_fs_class->finished = miner_files_finished;
 
@@ -243,11 +269,16 @@ static void
 tracker_miner_files_init (TrackerMinerFiles *mf)
 {
 	TrackerMinerFilesPrivate *priv;
+	gchar *cache_file;
 
 	priv = mf->private = TRACKER_MINER_FILES_GET_PRIVATE (mf);
 
 	priv->storage = tracker_storage_new ();
 
+	cache_file = g_build_filename (g_get_user_cache_dir (), "tracker", "mime-cache", NULL);
+	priv->mime_cache = tracker_mime_cache_new (cache_file);
+	g_free (cache_file);
+
 	g_signal_connect (priv->storage, "mount-point-added",
 	                  G_CALLBACK (mount_point_added_cb),
 	                  mf);
@@ -594,6 +625,17 @@ miner_files_get_property (GObject    *object,
 	}
 }
 
+static void
+miner_files_save_mime_cache (TrackerMinerFiles *mf)
+{
+	GError *error = NULL;
+
+	if (!tracker_mime_cache_save (mf->private->mime_cache, &error)) {
+		g_message ("Could not save MIME cache: %s", error->message);
+		g_error_free (error);
+	}
+}
+
 static void
 miner_files_finalize (GObject *object)
 {
@@ -651,6 +693,9 @@ miner_files_finalize (GObject *object)
 
 	g_list_free (priv->extraction_queue);
 
+	miner_files_save_mime_cache (mf);
+	tracker_mime_cache_free (priv->mime_cache);
+
 	G_OBJECT_CLASS (tracker_miner_files_parent_class)->finalize (object);
 }
 
@@ -2096,27 +2141,25 @@ sparql_builder_finish (ProcessFileData *data,
 	}
 }
 
+/* Builds the SPARQL for a file out of its queried info, notifies
+ * the miner and frees @data.
+ */
 static void
-process_file_cb (GObject      *object,
-                 GAsyncResult *result,
-                 gpointer      user_data)
+process_file_info (ProcessFileData *data,
+                   GFileInfo       *file_info,
+                   const GError    *error)
 {
 	TrackerMinerFilesPrivate *priv;
 	TrackerSparqlBuilder *sparql;
-	ProcessFileData *data;
 	const gchar *mime_type, *urn, *parent_urn;
-	GFileInfo *file_info;
 	guint64 time_;
 	GFile *file;
 	gchar *uri;
-	GError *error = NULL;
 	gboolean is_iri;
 	gboolean is_directory;
 
-	data = user_data;
-	file = G_FILE (object);
+	file = data->file;
 	sparql = data->sparql;
-	file_info = g_file_query_info_finish (file, result, &error);
 	priv = TRACKER_MINER_FILES (data->miner)->private;
 
 	if (error) {
@@ -2124,7 +2167,6 @@ process_file_cb (GObject      *object,
 		tracker_miner_fs_file_notify (TRACKER_MINER_FS (data->miner), file, error);
 		priv->extraction_queue = g_list_remove (priv->extraction_queue, data);
 		process_file_data_free (data);
-		g_error_free (error);
 
 		return;
 	}
@@ -2200,19 +2242,17 @@ process_file_cb (GObject      *object,
 	priv->extraction_queue = g_list_remove (priv->extraction_queue, data);
 	process_file_data_free (data);
 
-	g_object_unref (file_info);
 	g_free (uri);
 }
 
-static gboolean
-miner_files_process_file (TrackerMinerFS       *fs,
-                          GFile                *file,
-                          TrackerSparqlBuilder *sparql,
-                          GCancellable         *cancellable)
+static ProcessFileData *
+process_file_data_new (TrackerMinerFS       *fs,
+                       GFile                *file,
+                       TrackerSparqlBuilder *sparql,
+                       GCancellable         *cancellable)
 {
 	TrackerMinerFilesPrivate *priv;
 	ProcessFileData *data;
-	const gchar *attrs;
 
 	data = g_slice_new0 (ProcessFileData);
 	data->miner = g_object_ref (fs);
@@ -2223,22 +2263,133 @@ miner_files_process_file (TrackerMinerFS       *fs,
 	priv = TRACKER_MINER_FILES (fs)->private;
 	priv->extraction_queue = g_list_prepend (priv->extraction_queue, data);
 
-	attrs = G_FILE_ATTRIBUTE_STANDARD_TYPE ","
-		G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
-		G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME ","
-		G_FILE_ATTRIBUTE_STANDARD_SIZE ","
-		G_FILE_ATTRIBUTE_TIME_MODIFIED ","
-		G_FILE_ATTRIBUTE_TIME_ACCESS;
+	return data;
+}
 
-	g_file_query_info_async (file,
-	                         attrs,
-	                         G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-	                         G_PRIORITY_DEFAULT,
-	                         cancellable,
-	                         process_file_cb,
-	                         data);
+static void
+process_files_batch_free (ProcessFilesBatch *batch)
+{
+	guint i;
 
-	return TRUE;
+	for (i = 0; i < batch->n_files; i++) {
+		if (batch->infos[i]) {
+			g_object_unref (batch->infos[i]);
+		}
+
+		g_clear_error (&batch->errors[i]);
+	}
+
+	/* ProcessFileData is freed as each file is notified */
+	g_free (batch->data);
+	g_free (batch->infos);
+	g_free (batch->errors);
+	g_slice_free (ProcessFilesBatch, batch);
+}
+
+static void
+process_files_thread (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+	ProcessFilesBatch *batch = task_data;
+	guint i;
+
+	/* One sweep over the whole batch, instead of an
+	 * asynchronous query (and thread dispatch) per file.
+	 */
+	for (i = 0; i < batch->n_files; i++) {
+		ProcessFileData *data = batch->data[i];
+		const gchar *content_type;
+
+		batch->infos[i] = g_file_query_info (data->file,
+		                                     PROCESS_FILE_ATTRIBUTES,
+		                                     G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+		                                     data->cancellable,
+		                                     &batch->errors[i]);
+		if (!batch->infos[i]) {
+			continue;
+		}
+
+		content_type = tracker_mime_cache_get_content_type (data->miner->private->mime_cache,
+		                                                    data->file,
+		                                                    batch->infos[i],
+		                                                    data->cancellable,
+		                                                    &batch->errors[i]);
+		if (content_type) {
+			g_file_info_set_content_type (batch->infos[i], content_type);
+		} else {
+			g_clear_object (&batch->infos[i]);
+		}
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+process_files_cb (GObject      *object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+	ProcessFilesBatch *batch;
+	guint i;
+
+	batch = g_task_get_task_data (G_TASK (result));
+
+	for (i = 0; i < batch->n_files; i++) {
+		process_file_info (batch->data[i],
+		                   batch->infos[i],
+		                   batch->errors[i]);
+	}
+}
+
+static void
+miner_files_process_files (TrackerMinerFS        *fs,
+                           GFile                **files,
+                           TrackerSparqlBuilder **builders,
+                           GCancellable         **cancellables,
+                           gboolean              *accepted,
+                           guint                  n_files)
+{
+	ProcessFilesBatch *batch;
+	GTask *task;
+	guint i;
+
+	batch = g_slice_new0 (ProcessFilesBatch);
+	batch->n_files = n_files;
+	batch->data = g_new0 (ProcessFileData *, n_files);
+	batch->infos = g_new0 (GFileInfo *, n_files);
+	batch->errors = g_new0 (GError *, n_files);
+
+	for (i = 0; i < n_files; i++) {
+		batch->data[i] = process_file_data_new (fs, files[i],
+		                                        builders[i],
+		                                        cancellables[i]);
+		accepted[i] = TRUE;
+	}
+
+	task = g_task_new (fs, NULL, process_files_cb, NULL);
+	g_task_set_task_data (task, batch,
+	                      (GDestroyNotify) process_files_batch_free);
+	g_task_run_in_thread (task, process_files_thread);
+	g_object_unref (task);
+}
+
+static gboolean
+miner_files_process_file (TrackerMinerFS       *fs,
+                          GFile                *file,
+                          TrackerSparqlBuilder *sparql,
+                          GCancellable         *cancellable)
+{
+	gboolean accepted;
+
+	/* Content types may need reading the file, so
+	 * this is also done in a thread, as a batch of one.
+	 */
+	miner_files_process_files (fs, &file, &sparql, &cancellable,
+	                           &accepted, 1);
+
+	return accepted;
 }
 
 static void
@@ -2439,7 +2590,18 @@ miner_files_ignore_next_update_file (TrackerMinerFS       *fs,
 static void
 miner_files_finished (TrackerMinerFS *fs)
 {
+	TrackerMinerFiles *mf = TRACKER_MINER_FILES (fs);
+	guint n_guessed, n_cached, n_sniffed;
+
 	tracker_db_manager_set_last_crawl_done (TRUE);
+
+	tracker_mime_cache_get_stats (mf->private->mime_cache,
+	                              &n_guessed, &n_cached, &n_sniffed);
+	g_message ("Content types: %u resolved by file name, %u cached, "
+	           "%u sniffed (%u sniffs avoided)",
+	           n_guessed, n_cached, n_sniffed, n_cached);
+
+	miner_files_save_mime_cache (mf);
 }
 
 TrackerMiner *
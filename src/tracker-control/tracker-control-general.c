@@ -61,6 +61,7 @@ static gboolean get_log_verbosity;
 static gboolean start;
 static gchar *backup;
 static gchar *restore;
+static gboolean optimize_fts;
 static gboolean collect_debug_info;
 
 #define GENERAL_OPTIONS_ENABLED() \
@@ -75,6 +76,7 @@ static gboolean collect_debug_info;
 	 start || \
 	 backup || \
 	 restore || \
+	 optimize_fts || \
 	 collect_debug_info)
 
 static gboolean term_option_arg_func (const gchar  *option_value,
@@ -109,6 +111,9 @@ static GOptionEntry entries[] = {
 	{ "restore", 'o', 0, G_OPTION_ARG_FILENAME, &restore,
 	  N_("Restore databases from the file provided"),
 	  N_("FILE") },
+	{ "optimize-fts", 0, 0, G_OPTION_ARG_NONE, &optimize_fts,
+	  N_("Merge the full-text search index, this makes searches faster but may take some time"),
+	  NULL },
 	{ "set-log-verbosity", 0, 0, G_OPTION_ARG_STRING, &set_log_verbosity,
 	  N_("Sets the logging verbosity to LEVEL ('debug', 'detailed', 'minimal', 'errors') for all processes"),
 	  N_("LEVEL") },
@@ -1363,6 +1368,52 @@ tracker_control_general_run (void)
 		g_free (uri);
 	}
 
+	if (optimize_fts) {
+		GDBusConnection *connection;
+		GDBusProxy *proxy;
+		GError *error = NULL;
+		GVariant *v;
+
+		if (!tracker_control_dbus_get_connection ("org.freedesktop.Tracker1",
+		                                          "/org/freedesktop/Tracker1/Resources",
+		                                          "org.freedesktop.Tracker1.Resources",
+		                                          G_DBUS_PROXY_FLAGS_NONE,
+		                                          &connection,
+		                                          &proxy)) {
+			return EXIT_FAILURE;
+		}
+
+		g_print ("%s\n", _("Optimizing full-text search index"));
+
+		/* Merging all segments can take some time */
+		g_dbus_proxy_set_default_timeout (proxy, G_MAXINT);
+
+		v = g_dbus_proxy_call_sync (proxy,
+		                            "OptimizeFts",
+		                            NULL,
+		                            G_DBUS_CALL_FLAGS_NONE,
+		                            -1,
+		                            NULL,
+		                            &error);
+
+		if (proxy) {
+			g_object_unref (proxy);
+		}
+
+		if (error) {
+			g_critical ("%s, %s",
+			            _("Could not optimize full-text search index"),
+			            error ? error->message : _("No error given"));
+			g_clear_error (&error);
+
+			return EXIT_FAILURE;
+		}
+
+		if (v) {
+			g_variant_unref (v);
+		}
+	}
+
 	return EXIT_SUCCESS;
 }
 
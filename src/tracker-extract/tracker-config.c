@@ -43,6 +43,9 @@ enum {
 	PROP_MAX_BYTES,
 	PROP_MAX_MEDIA_ART_WIDTH,
 	PROP_WAIT_FOR_MINER_FS,
+	PROP_MAX_EXTRACTING_FILES,
+	PROP_USE_WORKER_PROCESSES,
+	PROP_EXTRACT_CACHE_SIZE,
 };
 
 static TrackerConfigMigrationEntry migration[] = {
@@ -109,6 +112,34 @@ tracker_config_class_init (TrackerConfigClass *klass)
 	                                                       "%TRUE to wait for tracker-miner-fs is done before extracting. %FAlSE otherwise",
 	                                                       FALSE,
 	                                                       G_PARAM_READWRITE));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_MAX_EXTRACTING_FILES,
+	                                 g_param_spec_int ("max-extracting-files",
+	                                                   "Max extracting files",
+	                                                   "Maximum number of files extracted concurrently (0=number of processors, 1->64=max files)",
+	                                                   0,
+	                                                   64,
+	                                                   0,
+	                                                   G_PARAM_READWRITE));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_USE_WORKER_PROCESSES,
+	                                 g_param_spec_boolean ("use-worker-processes",
+	                                                       "Use worker processes",
+	                                                       "%TRUE to extract metadata in worker processes. %FALSE otherwise",
+	                                                       FALSE,
+	                                                       G_PARAM_READWRITE));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_EXTRACT_CACHE_SIZE,
+	                                 g_param_spec_int ("extract-cache-size",
+	                                                   "Extraction cache size",
+	                                                   "Size in megabytes of the cache of extraction results (0=disabled, 1->65536=max megabytes)",
+	                                                   0,
+	                                                   65536,
+	                                                   0,
+	                                                   G_PARAM_READWRITE));
 }
 
 static void
@@ -138,6 +169,9 @@ config_set_property (GObject      *object,
 	case PROP_MAX_BYTES:
 	case PROP_MAX_MEDIA_ART_WIDTH:
 	case PROP_WAIT_FOR_MINER_FS:
+	case PROP_MAX_EXTRACTING_FILES:
+	case PROP_USE_WORKER_PROCESSES:
+	case PROP_EXTRACT_CACHE_SIZE:
 		break;
 
 	default:
@@ -180,6 +214,21 @@ config_get_property (GObject    *object,
 		                     tracker_config_get_wait_for_miner_fs (config));
 		break;
 
+	case PROP_MAX_EXTRACTING_FILES:
+		g_value_set_int (value,
+		                 tracker_config_get_max_extracting_files (config));
+		break;
+
+	case PROP_USE_WORKER_PROCESSES:
+		g_value_set_boolean (value,
+		                     tracker_config_get_use_worker_processes (config));
+		break;
+
+	case PROP_EXTRACT_CACHE_SIZE:
+		g_value_set_int (value,
+		                 tracker_config_get_extract_cache_size (config));
+		break;
+
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 		break;
@@ -214,6 +263,9 @@ config_constructed (GObject *object)
 	g_settings_bind (settings, "max-bytes", object, "max-bytes", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "max-media-art-width", object, "max-media-art-width", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "wait-for-miner-fs", object, "wait-for-miner-fs", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "max-extracting-files", object, "max-extracting-files", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "use-worker-processes", object, "use-worker-processes", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "extract-cache-size", object, "extract-cache-size", G_SETTINGS_BIND_GET);
 
 	/* Migrate keyfile-based configuration */
 	config_file = tracker_config_file_new ();
@@ -281,3 +333,27 @@ tracker_config_get_wait_for_miner_fs (TrackerConfig *config)
 
 	return g_settings_get_boolean (G_SETTINGS (config), "wait-for-miner-fs");
 }
+
+gint
+tracker_config_get_max_extracting_files (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), 0);
+
+	return g_settings_get_int (G_SETTINGS (config), "max-extracting-files");
+}
+
+gboolean
+tracker_config_get_use_worker_processes (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), FALSE);
+
+	return g_settings_get_boolean (G_SETTINGS (config), "use-worker-processes");
+}
+
+gint
+tracker_config_get_extract_cache_size (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), 0);
+
+	return g_settings_get_int (G_SETTINGS (config), "extract-cache-size");
+}
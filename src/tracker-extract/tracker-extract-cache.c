@@ -0,0 +1,520 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+
+#include <libtracker-common/tracker-file-utils.h>
+
+#include "tracker-extract-cache.h"
+
+/* Extraction results are cached on disk, one file per result, named
+ * after a hash of the file size and its first and last blocks. The
+ * mimetype, graph, file name and tracker version are hashed too, as
+ * these decide which modules run and what they generate, and some
+ * modules fall back to the file name for the title. The directory is
+ * not, so copies in other directories share results. Results referring
+ * to local files are not cached, as these may point to the file itself
+ * or to its siblings.
+ *
+ * Files are written atomically, so several worker processes may
+ * share the cache. Each process keeps an estimate of its size on
+ * disk, and evicts the least recently used results when it gets
+ * too big, hits update the modification time for that purpose.
+ */
+
+/* Bytes hashed at each end of files */
+#define BLOCK_SIZE (64 * 1024)
+
+/* Results stored between rescans, as other processes store too */
+#define SCAN_INTERVAL 256
+
+#define ENTRY_TYPE G_VARIANT_TYPE ("(ssss)")
+
+struct _TrackerExtractCache {
+	gchar *path;
+	guint64 max_size;
+
+	/* Protects the fields below, results
+	 * are stored from several threads.
+	 */
+	GMutex mutex;
+	guint64 size;
+	guint n_stores;
+	gboolean scanned;
+};
+
+typedef struct {
+	gchar *path;
+	guint64 size;
+	time_t mtime;
+} CacheEntry;
+
+/**
+ * tracker_extract_cache_new:
+ * @path: directory holding the cached results
+ * @max_size: size in bytes the cache is kept under
+ *
+ * Creates a cache of extraction results in @path, the directory
+ * is created when the first result is stored.
+ *
+ * Returns: a new #TrackerExtractCache.
+ **/
+TrackerExtractCache *
+tracker_extract_cache_new (const gchar *path,
+                           guint64      max_size)
+{
+	TrackerExtractCache *cache;
+
+	g_return_val_if_fail (path != NULL, NULL);
+	g_return_val_if_fail (max_size > 0, NULL);
+
+	cache = g_slice_new0 (TrackerExtractCache);
+	cache->path = g_strdup (path);
+	cache->max_size = max_size;
+	g_mutex_init (&cache->mutex);
+
+	return cache;
+}
+
+void
+tracker_extract_cache_free (TrackerExtractCache *cache)
+{
+	g_return_if_fail (cache != NULL);
+
+	g_mutex_clear (&cache->mutex);
+	g_free (cache->path);
+	g_slice_free (TrackerExtractCache, cache);
+}
+
+static void
+checksum_update_string (GChecksum   *checksum,
+                        const gchar *str)
+{
+	/* Including the nul byte, so strings can't run into each other */
+	g_checksum_update (checksum, (const guchar *) (str ? str : ""),
+	                   str ? strlen (str) + 1 : 1);
+}
+
+static gboolean
+checksum_update_block (GChecksum *checksum,
+                       gint       fd,
+                       guchar    *buffer,
+                       goffset    offset,
+                       gsize      len)
+{
+	gsize done = 0;
+
+	while (done < len) {
+		gssize n_read;
+
+		n_read = pread (fd, &buffer[done], len - done, offset + done);
+
+		if (n_read == -1 && errno == EINTR) {
+			continue;
+		} else if (n_read <= 0) {
+			return FALSE;
+		}
+
+		done += n_read;
+	}
+
+	g_checksum_update (checksum, buffer, len);
+
+	return TRUE;
+}
+
+/**
+ * tracker_extract_cache_get_key:
+ * @cache: a #TrackerExtractCache
+ * @uri: URI of the file being extracted
+ * @mimetype: mimetype of the file
+ * @graph: graph the metadata goes to, or %NULL
+ *
+ * Computes the key results for @uri are cached under. Only the
+ * first and last blocks of the file are read.
+ *
+ * Returns: the key, or %NULL if the file can't be cached.
+ **/
+gchar *
+tracker_extract_cache_get_key (TrackerExtractCache *cache,
+                               const gchar         *uri,
+                               const gchar         *mimetype,
+                               const gchar         *graph)
+{
+	gchar *filename, *basename, *key = NULL;
+	GChecksum *checksum;
+	struct stat st;
+	guint64 size;
+	guchar *buffer;
+	gboolean read_ok;
+	gint fd;
+
+	g_return_val_if_fail (cache != NULL, NULL);
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	filename = g_filename_from_uri (uri, NULL, NULL);
+
+	if (!filename) {
+		return NULL;
+	}
+
+	fd = tracker_file_open_fd (filename);
+	basename = g_path_get_basename (filename);
+	g_free (filename);
+
+	if (fd == -1) {
+		g_free (basename);
+		return NULL;
+	}
+
+	if (fstat (fd, &st) == -1 || !S_ISREG (st.st_mode)) {
+		g_free (basename);
+		close (fd);
+		return NULL;
+	}
+
+	size = GUINT64_TO_LE ((guint64) st.st_size);
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA1);
+	checksum_update_string (checksum, PACKAGE_VERSION);
+	checksum_update_string (checksum, mimetype);
+	checksum_update_string (checksum, graph);
+	checksum_update_string (checksum, basename);
+	g_checksum_update (checksum, (const guchar *) &size, sizeof (size));
+	g_free (basename);
+
+	buffer = g_malloc (BLOCK_SIZE);
+
+	if (st.st_size <= 2 * BLOCK_SIZE) {
+		read_ok = checksum_update_block (checksum, fd, buffer, 0, st.st_size);
+	} else {
+		read_ok = (checksum_update_block (checksum, fd, buffer, 0, BLOCK_SIZE) &&
+		           checksum_update_block (checksum, fd, buffer,
+		                                  st.st_size - BLOCK_SIZE, BLOCK_SIZE));
+	}
+
+	if (read_ok) {
+		key = g_strdup (g_checksum_get_string (checksum));
+	}
+
+	g_checksum_free (checksum);
+	g_free (buffer);
+	close (fd);
+
+	return key;
+}
+
+static gchar *
+cache_get_entry_path (TrackerExtractCache *cache,
+                      const gchar         *key)
+{
+	gchar dirname[3] = { key[0], key[1], '\0' };
+
+	return g_build_filename (cache->path, dirname, key, NULL);
+}
+
+/**
+ * tracker_extract_cache_lookup:
+ * @cache: a #TrackerExtractCache
+ * @key: key returned by tracker_extract_cache_get_key()
+ * @uri: URI of the file being extracted
+ * @mimetype: mimetype of the file
+ * @graph: graph the metadata goes to, or %NULL
+ *
+ * Looks up the result of a previous extraction of the same content.
+ *
+ * Returns: (transfer full): a #TrackerExtractInfo for @uri holding
+ * the cached result, or %NULL if there is none.
+ **/
+TrackerExtractInfo *
+tracker_extract_cache_lookup (TrackerExtractCache *cache,
+                              const gchar         *key,
+                              const gchar         *uri,
+                              const gchar         *mimetype,
+                              const gchar         *graph)
+{
+	const gchar *preupdate, *metadata, *postupdate, *where;
+	TrackerExtractInfo *info;
+	GVariant *entry;
+	gchar *path, *contents;
+	gsize len;
+	GFile *file;
+
+	g_return_val_if_fail (cache != NULL, NULL);
+	g_return_val_if_fail (key != NULL, NULL);
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	path = cache_get_entry_path (cache, key);
+
+	if (!g_file_get_contents (path, &contents, &len, NULL)) {
+		g_free (path);
+		return NULL;
+	}
+
+	/* Used recently, last to be evicted */
+	g_utime (path, NULL);
+	g_free (path);
+
+	/* Anything could have been written there, this gets validated */
+	entry = g_variant_new_from_data (ENTRY_TYPE, contents, len,
+	                                 FALSE, g_free, contents);
+	g_variant_ref_sink (entry);
+	g_variant_get (entry, "(&s&s&s&s)",
+	               &preupdate, &metadata, &postupdate, &where);
+
+	if (!*metadata) {
+		g_variant_unref (entry);
+		return NULL;
+	}
+
+	file = g_file_new_for_uri (uri);
+	info = tracker_extract_info_new (file, mimetype, graph);
+	g_object_unref (file);
+
+	/* Empty chunks are left out, so builder lengths stay the same */
+	if (*preupdate) {
+		tracker_sparql_builder_append (tracker_extract_info_get_preupdate_builder (info),
+		                               preupdate);
+	}
+
+	tracker_sparql_builder_append (tracker_extract_info_get_metadata_builder (info),
+	                               metadata);
+
+	if (*postupdate) {
+		tracker_sparql_builder_append (tracker_extract_info_get_postupdate_builder (info),
+		                               postupdate);
+	}
+
+	if (*where) {
+		tracker_extract_info_set_where_clause (info, where);
+	}
+
+	g_variant_unref (entry);
+
+	return info;
+}
+
+static gint
+cache_entry_compare (gconstpointer a,
+                     gconstpointer b)
+{
+	const CacheEntry *entry_a = a, *entry_b = b;
+
+	if (entry_a->mtime == entry_b->mtime) {
+		return 0;
+	}
+
+	return (entry_a->mtime < entry_b->mtime) ? -1 : 1;
+}
+
+static void
+cache_entry_clear (CacheEntry *entry)
+{
+	g_free (entry->path);
+}
+
+/* Must be called with the mutex held */
+static GArray *
+cache_scan (TrackerExtractCache *cache)
+{
+	const gchar *dirname, *name;
+	GArray *entries;
+	GDir *dir, *subdir;
+
+	entries = g_array_new (FALSE, FALSE, sizeof (CacheEntry));
+	g_array_set_clear_func (entries, (GDestroyNotify) cache_entry_clear);
+	cache->size = 0;
+	cache->scanned = TRUE;
+
+	dir = g_dir_open (cache->path, 0, NULL);
+
+	if (!dir) {
+		return entries;
+	}
+
+	while ((dirname = g_dir_read_name (dir)) != NULL) {
+		gchar *subdir_path;
+
+		subdir_path = g_build_filename (cache->path, dirname, NULL);
+		subdir = g_dir_open (subdir_path, 0, NULL);
+
+		while (subdir && (name = g_dir_read_name (subdir)) != NULL) {
+			CacheEntry entry;
+			GStatBuf st;
+
+			entry.path = g_build_filename (subdir_path, name, NULL);
+
+			if (g_stat (entry.path, &st) == -1 || !S_ISREG (st.st_mode)) {
+				g_free (entry.path);
+				continue;
+			}
+
+			entry.size = st.st_size;
+			entry.mtime = st.st_mtime;
+			cache->size += entry.size;
+			g_array_append_val (entries, entry);
+		}
+
+		if (subdir) {
+			g_dir_close (subdir);
+		}
+
+		g_free (subdir_path);
+	}
+
+	g_dir_close (dir);
+
+	return entries;
+}
+
+/* Must be called with the mutex held */
+static void
+cache_evict (TrackerExtractCache *cache)
+{
+	guint64 target;
+	GArray *entries;
+	guint i;
+
+	entries = cache_scan (cache);
+
+	/* Leave some room, so this doesn't happen on every store */
+	target = cache->max_size / 10 * 9;
+
+	if (cache->size > cache->max_size) {
+		g_array_sort (entries, cache_entry_compare);
+
+		for (i = 0; i < entries->len && cache->size > target; i++) {
+			CacheEntry *entry;
+
+			entry = &g_array_index (entries, CacheEntry, i);
+
+			/* It might be gone already */
+			g_unlink (entry->path);
+			cache->size -= entry->size;
+		}
+
+		g_debug ("Evicted %u results from the extraction cache", i);
+	}
+
+	g_array_unref (entries);
+}
+
+static gboolean
+info_refers_to_files (TrackerExtractInfo *info)
+{
+	const gchar *chunks[4];
+	guint i;
+
+	chunks[0] = tracker_sparql_builder_get_result (tracker_extract_info_get_preupdate_builder (info));
+	chunks[1] = tracker_sparql_builder_get_result (tracker_extract_info_get_metadata_builder (info));
+	chunks[2] = tracker_sparql_builder_get_result (tracker_extract_info_get_postupdate_builder (info));
+	chunks[3] = tracker_extract_info_get_where_clause (info);
+
+	for (i = 0; i < G_N_ELEMENTS (chunks); i++) {
+		if (chunks[i] && strstr (chunks[i], "file://")) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * tracker_extract_cache_store:
+ * @cache: a #TrackerExtractCache
+ * @key: key returned by tracker_extract_cache_get_key()
+ * @info: the extraction result
+ *
+ * Stores the extraction result in @info for files with the same
+ * content to find, evicting older results if the cache gets too big.
+ * Results referring to local files are not stored.
+ **/
+void
+tracker_extract_cache_store (TrackerExtractCache *cache,
+                             const gchar         *key,
+                             TrackerExtractInfo  *info)
+{
+	GError *error = NULL;
+	gchar *path, *dirname;
+	GVariant *entry;
+	gsize len;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (key != NULL);
+	g_return_if_fail (info != NULL);
+
+	if (info_refers_to_files (info)) {
+		return;
+	}
+
+	entry = g_variant_new ("(ssss)",
+	                       tracker_sparql_builder_get_result (tracker_extract_info_get_preupdate_builder (info)),
+	                       tracker_sparql_builder_get_result (tracker_extract_info_get_metadata_builder (info)),
+	                       tracker_sparql_builder_get_result (tracker_extract_info_get_postupdate_builder (info)),
+	                       tracker_extract_info_get_where_clause (info) ?
+	                       tracker_extract_info_get_where_clause (info) : "");
+	g_variant_ref_sink (entry);
+	len = g_variant_get_size (entry);
+
+	if (len > cache->max_size / 100) {
+		/* Not worth a big share of the cache */
+		g_variant_unref (entry);
+		return;
+	}
+
+	path = cache_get_entry_path (cache, key);
+	dirname = g_path_get_dirname (path);
+	g_mkdir_with_parents (dirname, 0700);
+	g_free (dirname);
+
+	/* Written to a temporary file and renamed, so readers
+	 * never see partial results.
+	 */
+	if (!g_file_set_contents (path, g_variant_get_data (entry), len, &error)) {
+		g_debug ("Could not store extraction result in '%s': %s",
+		         path, error->message);
+		g_error_free (error);
+		g_variant_unref (entry);
+		g_free (path);
+		return;
+	}
+
+	g_variant_unref (entry);
+	g_free (path);
+
+	g_mutex_lock (&cache->mutex);
+
+	cache->size += len;
+	cache->n_stores++;
+
+	if (!cache->scanned ||
+	    cache->size > cache->max_size ||
+	    cache->n_stores % SCAN_INTERVAL == 0) {
+		cache_evict (cache);
+	}
+
+	g_mutex_unlock (&cache->mutex);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_EXTRACT_CACHE_H__
+#define __TRACKER_EXTRACT_CACHE_H__
+
+#include <gio/gio.h>
+#include <libtracker-extract/tracker-extract.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TrackerExtractCache TrackerExtractCache;
+
+TrackerExtractCache * tracker_extract_cache_new     (const gchar         *path,
+                                                     guint64              max_size);
+void                  tracker_extract_cache_free    (TrackerExtractCache *cache);
+
+gchar *               tracker_extract_cache_get_key (TrackerExtractCache *cache,
+                                                     const gchar         *uri,
+                                                     const gchar         *mimetype,
+                                                     const gchar         *graph);
+
+TrackerExtractInfo *  tracker_extract_cache_lookup  (TrackerExtractCache *cache,
+                                                     const gchar         *key,
+                                                     const gchar         *uri,
+                                                     const gchar         *mimetype,
+                                                     const gchar         *graph);
+void                  tracker_extract_cache_store   (TrackerExtractCache *cache,
+                                                     const gchar         *key,
+                                                     TrackerExtractInfo  *info);
+
+G_END_DECLS
+
+#endif /* __TRACKER_EXTRACT_CACHE_H__ */
@@ -0,0 +1,973 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "tracker-extract-channel.h"
+
+/* Messages between the extractor and its worker processes go through
+ * a pair of single producer/single consumer ring buffers living in
+ * shared memory, one for each direction. The socket does not carry
+ * any data, a byte is written to it every time the peer needs to look
+ * at the rings, either because there's something to read, or because
+ * some space was freed while it was waiting to write. This lets both
+ * ends wait on a file descriptor from their main loop.
+ *
+ * Messages are serialized GVariants, preceded by their size as a
+ * 64 bit integer, which keeps the message data aligned once copied.
+ *
+ * Big messages, typically extraction results for text documents,
+ * are not copied through the rings. These are serialized straight
+ * into a memory file, handed over the socket, and mapped by the
+ * receiver, only the size goes through the ring, flagged as such.
+ * File descriptors and flagged sizes are sent in the same order.
+ * Memory files not sealed against writes and shrinking are copied
+ * by the receiver instead, as the peer could change them under it.
+ */
+
+/* Must be a power of 2 */
+#define RING_SIZE (1 << 20)
+
+/* Anything bigger comes from a confused peer */
+#define MAX_MESSAGE_SIZE (256 * 1024 * 1024)
+
+/* Messages bigger than this go through a memory file by default */
+#define OUT_OF_LINE_SIZE (64 * 1024)
+#define OUT_OF_LINE_FLAG (G_GUINT64_CONSTANT (1) << 63)
+
+/* File descriptors received at once */
+#define MAX_FDS 4
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#ifndef MSG_CMSG_CLOEXEC
+#define MSG_CMSG_CLOEXEC 0
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+typedef struct {
+	/* Positions are never wrapped, only the offsets
+	 * into the data, so these overflow together.
+	 */
+	volatile gint head; /* Written by the producer */
+	volatile gint tail; /* Written by the consumer */
+} RingHeader;
+
+typedef struct {
+	RingHeader *header;
+	guchar *data;
+} Ring;
+
+#define RING_MEMORY_SIZE (sizeof (RingHeader) + RING_SIZE)
+#define MEMORY_SIZE (2 * RING_MEMORY_SIZE)
+
+struct _TrackerExtractChannel {
+	gpointer memory;
+	gint socket_fd;
+
+	Ring in;
+	Ring out;
+
+	/* Message being received, with its size */
+	GByteArray *incoming;
+	gboolean closed;
+
+	/* Memory files received, for out of line messages */
+	GQueue fds;
+	gsize out_of_line_size;
+};
+
+static void
+ring_init (Ring     *ring,
+           gpointer  memory)
+{
+	ring->header = memory;
+	ring->data = (guchar *) memory + sizeof (RingHeader);
+}
+
+/* Positions are written by the peer, these can't be trusted */
+static gboolean
+ring_get_positions (Ring     *ring,
+                    guint    *head,
+                    guint    *tail,
+                    GError  **error)
+{
+	*head = (guint) g_atomic_int_get (&ring->header->head);
+	*tail = (guint) g_atomic_int_get (&ring->header->tail);
+
+	if (*head - *tail > RING_SIZE) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		             "Invalid ring positions (head %u, tail %u)",
+		             *head, *tail);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gssize
+ring_write (Ring         *ring,
+            const guchar *data,
+            gsize         len,
+            GError      **error)
+{
+	guint head, tail, offset, chunk;
+
+	if (!ring_get_positions (ring, &head, &tail, error)) {
+		return -1;
+	}
+
+	len = MIN (len, RING_SIZE - (head - tail));
+	offset = head & (RING_SIZE - 1);
+	chunk = MIN (len, RING_SIZE - offset);
+
+	memcpy (&ring->data[offset], data, chunk);
+	memcpy (ring->data, &data[chunk], len - chunk);
+
+	/* Publishes the data to the consumer */
+	g_atomic_int_set (&ring->header->head, (gint) (head + len));
+
+	return len;
+}
+
+static gssize
+ring_read (Ring    *ring,
+           guchar  *data,
+           gsize    len,
+           GError **error)
+{
+	guint head, tail, offset, chunk;
+
+	if (!ring_get_positions (ring, &head, &tail, error)) {
+		return -1;
+	}
+
+	len = MIN (len, head - tail);
+	offset = tail & (RING_SIZE - 1);
+	chunk = MIN (len, RING_SIZE - offset);
+
+	memcpy (data, &ring->data[offset], chunk);
+	memcpy (&data[chunk], ring->data, len - chunk);
+
+	/* Hands the space back to the producer */
+	g_atomic_int_set (&ring->header->tail, (gint) (tail + len));
+
+	return len;
+}
+
+static gssize
+ring_get_free_space (Ring    *ring,
+                     GError **error)
+{
+	guint head, tail;
+
+	if (!ring_get_positions (ring, &head, &tail, error)) {
+		return -1;
+	}
+
+	return RING_SIZE - (head - tail);
+}
+
+static TrackerExtractChannel *
+channel_new (gpointer  memory,
+             gint      socket_fd,
+             gboolean  is_worker)
+{
+	TrackerExtractChannel *channel;
+	gpointer first, second;
+
+	first = memory;
+	second = (guchar *) memory + RING_MEMORY_SIZE;
+
+	channel = g_slice_new0 (TrackerExtractChannel);
+	channel->memory = memory;
+	channel->socket_fd = socket_fd;
+	channel->incoming = g_byte_array_new ();
+	channel->out_of_line_size = OUT_OF_LINE_SIZE;
+
+	/* The first ring goes from the extractor to the worker */
+	ring_init (&channel->out, is_worker ? second : first);
+	ring_init (&channel->in, is_worker ? first : second);
+
+	return channel;
+}
+
+/* Returns an unlinked file of @size bytes, preferably backed by
+ * memory only, so it can't outlive its users.
+ */
+static gint
+create_memory_fd (gsize    size,
+                  GError **error)
+{
+	gint fd = -1;
+
+#ifdef __NR_memfd_create
+	fd = syscall (__NR_memfd_create, "tracker-extract",
+	              MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#endif
+
+	if (fd == -1) {
+		gchar *path;
+
+		fd = g_file_open_tmp ("tracker-extract-XXXXXX", &path, error);
+
+		if (fd == -1) {
+			return -1;
+		}
+
+		/* Only the processes the descriptor is handed to see it */
+		g_unlink (path);
+		g_free (path);
+
+		fcntl (fd, F_SETFD, FD_CLOEXEC);
+	}
+
+	if (ftruncate (fd, size) == -1) {
+		g_set_error (error, G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not allocate shared memory: %s",
+		             g_strerror (errno));
+		close (fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static gpointer
+map_memory (gint     fd,
+            GError **error)
+{
+	gpointer memory;
+
+	memory = mmap (NULL, MEMORY_SIZE, PROT_READ | PROT_WRITE,
+	               MAP_SHARED, fd, 0);
+
+	if (memory == MAP_FAILED) {
+		g_set_error (error, G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not map shared memory: %s",
+		             g_strerror (errno));
+		return NULL;
+	}
+
+	return memory;
+}
+
+/**
+ * tracker_extract_channel_new:
+ * @peer_memory_fd: (out): return location for the shared memory
+ * file descriptor to hand to the worker
+ * @peer_socket_fd: (out): return location for the worker end of
+ * the socket
+ * @error: return location for a #GError
+ *
+ * Creates the extractor end of a channel to a worker process. The
+ * returned file descriptors are meant to be passed to the worker,
+ * and must be closed by the caller afterwards.
+ *
+ * Returns: a new #TrackerExtractChannel, or %NULL on error.
+ **/
+TrackerExtractChannel *
+tracker_extract_channel_new (gint    *peer_memory_fd,
+                             gint    *peer_socket_fd,
+                             GError **error)
+{
+	gpointer memory;
+	gint memory_fd;
+	gint fds[2];
+
+	g_return_val_if_fail (peer_memory_fd != NULL, NULL);
+	g_return_val_if_fail (peer_socket_fd != NULL, NULL);
+
+	memory_fd = create_memory_fd (MEMORY_SIZE, error);
+
+	if (memory_fd == -1) {
+		return NULL;
+	}
+
+	/* The file is sparse and zero filled, so both
+	 * rings are initially empty.
+	 */
+	memory = map_memory (memory_fd, error);
+
+	if (!memory) {
+		close (memory_fd);
+		return NULL;
+	}
+
+	if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+		g_set_error (error, G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not create socket pair: %s",
+		             g_strerror (errno));
+		munmap (memory, MEMORY_SIZE);
+		close (memory_fd);
+		return NULL;
+	}
+
+	fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl (fds[0], F_SETFL, O_NONBLOCK);
+	fcntl (fds[1], F_SETFD, FD_CLOEXEC);
+
+	*peer_memory_fd = memory_fd;
+	*peer_socket_fd = fds[1];
+
+	return channel_new (memory, fds[0], FALSE);
+}
+
+/**
+ * tracker_extract_channel_new_for_fds:
+ * @memory_fd: the shared memory file descriptor
+ * @socket_fd: the worker end of the socket
+ * @error: return location for a #GError
+ *
+ * Creates the worker end of a channel from the file descriptors
+ * handed by the extractor. @socket_fd is owned by the channel.
+ *
+ * Returns: a new #TrackerExtractChannel, or %NULL on error.
+ **/
+TrackerExtractChannel *
+tracker_extract_channel_new_for_fds (gint     memory_fd,
+                                     gint     socket_fd,
+                                     GError **error)
+{
+	gpointer memory;
+
+	memory = map_memory (memory_fd, error);
+
+	if (!memory) {
+		return NULL;
+	}
+
+	fcntl (socket_fd, F_SETFD, FD_CLOEXEC);
+	fcntl (socket_fd, F_SETFL, O_NONBLOCK);
+
+	return channel_new (memory, socket_fd, TRUE);
+}
+
+void
+tracker_extract_channel_free (TrackerExtractChannel *channel)
+{
+	g_return_if_fail (channel != NULL);
+
+	munmap (channel->memory, MEMORY_SIZE);
+	close (channel->socket_fd);
+	g_byte_array_unref (channel->incoming);
+
+	while (!g_queue_is_empty (&channel->fds)) {
+		close (GPOINTER_TO_INT (g_queue_pop_head (&channel->fds)));
+	}
+
+	g_slice_free (TrackerExtractChannel, channel);
+}
+
+/**
+ * tracker_extract_channel_get_fd:
+ * @channel: a #TrackerExtractChannel
+ *
+ * Returns the file descriptor that becomes readable whenever
+ * tracker_extract_channel_receive() should be called.
+ *
+ * Returns: a file descriptor owned by @channel.
+ **/
+gint
+tracker_extract_channel_get_fd (TrackerExtractChannel *channel)
+{
+	g_return_val_if_fail (channel != NULL, -1);
+
+	return channel->socket_fd;
+}
+
+/**
+ * tracker_extract_channel_set_out_of_line_size:
+ * @channel: a #TrackerExtractChannel
+ * @size: size in bytes
+ *
+ * Sets the size above which messages sent through @channel are
+ * handed in a memory file of their own instead of being copied
+ * through the ring, %G_MAXSIZE disables this.
+ **/
+void
+tracker_extract_channel_set_out_of_line_size (TrackerExtractChannel *channel,
+                                              gsize                  size)
+{
+	g_return_if_fail (channel != NULL);
+
+	channel->out_of_line_size = size;
+}
+
+static void
+channel_notify (TrackerExtractChannel *channel)
+{
+	/* If the socket buffer is full, the peer has
+	 * plenty of wakeups pending already.
+	 */
+	if (send (channel->socket_fd, "", 1, MSG_NOSIGNAL) == -1 &&
+	    errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+		channel->closed = TRUE;
+	}
+}
+
+/* Consumes pending notifications, must be done before
+ * looking at the rings so none is lost.
+ */
+static void
+channel_drain (TrackerExtractChannel *channel)
+{
+	union {
+		struct cmsghdr header;
+		gchar buffer[CMSG_SPACE (MAX_FDS * sizeof (gint))];
+	} control;
+	gchar buffer[64];
+	struct msghdr msg;
+	struct iovec iov;
+	gssize len;
+
+	do {
+		struct cmsghdr *cmsg;
+
+		memset (&msg, 0, sizeof (msg));
+		iov.iov_base = buffer;
+		iov.iov_len = sizeof (buffer);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = sizeof (control.buffer);
+
+		len = recvmsg (channel->socket_fd, &msg, MSG_CMSG_CLOEXEC);
+
+		if (len <= 0) {
+			continue;
+		}
+
+		for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+			gint *fds, i, n_fds;
+
+			if (cmsg->cmsg_level != SOL_SOCKET ||
+			    cmsg->cmsg_type != SCM_RIGHTS) {
+				continue;
+			}
+
+			fds = (gint *) CMSG_DATA (cmsg);
+			n_fds = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (gint);
+
+			for (i = 0; i < n_fds; i++) {
+				g_queue_push_tail (&channel->fds, GINT_TO_POINTER (fds[i]));
+			}
+		}
+
+		if (msg.msg_flags & MSG_CTRUNC) {
+			/* Messages won't match their descriptors anymore */
+			channel->closed = TRUE;
+		}
+	} while (len > 0 || (len == -1 && errno == EINTR));
+
+	if (len == 0 ||
+	    (len == -1 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+		channel->closed = TRUE;
+	}
+}
+
+static gboolean
+channel_wait (TrackerExtractChannel  *channel,
+              GError                **error)
+{
+	struct pollfd fd = { 0 };
+
+	fd.fd = channel->socket_fd;
+	fd.events = POLLIN;
+
+	while (poll (&fd, 1, -1) == -1) {
+		if (errno != EINTR) {
+			g_set_error (error, G_IO_ERROR,
+			             g_io_error_from_errno (errno),
+			             "Could not wait on channel: %s",
+			             g_strerror (errno));
+			return FALSE;
+		}
+	}
+
+	channel_drain (channel);
+
+	return TRUE;
+}
+
+static gboolean
+channel_send_fd (TrackerExtractChannel  *channel,
+                 gint                    fd,
+                 GError                **error)
+{
+	union {
+		struct cmsghdr header;
+		gchar buffer[CMSG_SPACE (sizeof (gint))];
+	} control;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	gchar byte = 0;
+
+	memset (&msg, 0, sizeof (msg));
+	memset (&control, 0, sizeof (control));
+	iov.iov_base = &byte;
+	iov.iov_len = 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof (control.buffer);
+
+	cmsg = CMSG_FIRSTHDR (&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN (sizeof (gint));
+	memcpy (CMSG_DATA (cmsg), &fd, sizeof (gint));
+
+	while (sendmsg (channel->socket_fd, &msg, MSG_NOSIGNAL) == -1) {
+		/* Unlike notifications, this one can't be dropped */
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			struct pollfd pfd = { 0 };
+
+			pfd.fd = channel->socket_fd;
+			pfd.events = POLLOUT;
+			poll (&pfd, 1, -1);
+		} else if (errno != EINTR) {
+			g_set_error (error, G_IO_ERROR,
+			             g_io_error_from_errno (errno),
+			             "Could not send message: %s",
+			             g_strerror (errno));
+			channel->closed = TRUE;
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+channel_send_out_of_line (TrackerExtractChannel  *channel,
+                          GVariant               *message,
+                          gsize                   size,
+                          GError                **error)
+{
+	gpointer memory;
+	gboolean retval;
+	gint fd;
+
+	fd = create_memory_fd (size, error);
+
+	if (fd == -1) {
+		return FALSE;
+	}
+
+	memory = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+	if (memory == MAP_FAILED) {
+		g_set_error (error, G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not map message memory: %s",
+		             g_strerror (errno));
+		close (fd);
+		return FALSE;
+	}
+
+	/* The only copy of the message data */
+	g_variant_store (message, memory);
+	munmap (memory, size);
+
+#ifdef F_ADD_SEALS
+	/* Not changing under the receiver's feet */
+	fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+
+	retval = channel_send_fd (channel, fd, error);
+	close (fd);
+
+	return retval;
+}
+
+/* Whether the peer can't change the memory file contents anymore */
+static gboolean
+memory_fd_is_sealed (gint fd)
+{
+#ifdef F_GET_SEALS
+	gint seals;
+
+	seals = fcntl (fd, F_GET_SEALS);
+
+	return (seals != -1 &&
+	        (seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) == (F_SEAL_SHRINK | F_SEAL_WRITE));
+#else
+	return FALSE;
+#endif
+}
+
+/* Reads the message into memory of our own, unlike accessing a
+ * mapping, reading fails gracefully if the peer truncates the file.
+ */
+static GBytes *
+read_memory_fd (gint     fd,
+                gsize    size,
+                GError **error)
+{
+	guchar *data;
+	gsize len = 0;
+
+	data = g_malloc (size);
+
+	while (len < size) {
+		gssize retval;
+
+		retval = pread (fd, &data[len], size - len, len);
+
+		if (retval == -1 && errno == EINTR) {
+			continue;
+		} else if (retval == -1) {
+			g_set_error (error, G_IO_ERROR,
+			             g_io_error_from_errno (errno),
+			             "Could not read message memory: %s",
+			             g_strerror (errno));
+			g_free (data);
+			return NULL;
+		} else if (retval == 0) {
+			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			                     "Message memory is too small");
+			g_free (data);
+			return NULL;
+		}
+
+		len += retval;
+	}
+
+	return g_bytes_new_take (data, size);
+}
+
+static GVariant *
+channel_receive_out_of_line (TrackerExtractChannel  *channel,
+                             const GVariantType     *type,
+                             gsize                   size,
+                             GError                **error)
+{
+	GMappedFile *mapped_file;
+	GBytes *bytes, *data;
+	GVariant *message;
+	gint fd;
+
+	/* The descriptor was sent before the size was written */
+	if (g_queue_is_empty (&channel->fds)) {
+		channel_drain (channel);
+	}
+
+	if (g_queue_is_empty (&channel->fds)) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		                     "Message arrived without its memory");
+		return NULL;
+	}
+
+	fd = GPOINTER_TO_INT (g_queue_pop_head (&channel->fds));
+
+	if (!memory_fd_is_sealed (fd)) {
+		/* The peer could still change or truncate the memory
+		 * while the message is being used, so it's copied.
+		 */
+		data = read_memory_fd (fd, size, error);
+		close (fd);
+
+		if (!data) {
+			return NULL;
+		}
+
+		message = g_variant_new_from_bytes (type, data, FALSE);
+		g_variant_ref_sink (message);
+		g_bytes_unref (data);
+
+		return message;
+	}
+
+	mapped_file = g_mapped_file_new_from_fd (fd, FALSE, error);
+	close (fd);
+
+	if (!mapped_file) {
+		return NULL;
+	}
+
+	if (g_mapped_file_get_length (mapped_file) < size) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		                     "Message memory is too small");
+		g_mapped_file_unref (mapped_file);
+		return NULL;
+	}
+
+	bytes = g_mapped_file_get_bytes (mapped_file);
+	data = g_bytes_new_from_bytes (bytes, 0, size);
+	g_mapped_file_unref (mapped_file);
+
+	/* Messages are untrusted, these get validated */
+	message = g_variant_new_from_bytes (type, data, FALSE);
+	g_variant_ref_sink (message);
+
+	g_bytes_unref (data);
+	g_bytes_unref (bytes);
+
+	return message;
+}
+
+/**
+ * tracker_extract_channel_send:
+ * @channel: a #TrackerExtractChannel
+ * @message: a #GVariant
+ * @blocking: whether to wait for the peer to make room
+ * @error: return location for a #GError
+ *
+ * Sends @message to the other end of @channel. If @blocking is
+ * %FALSE, the message is only sent if it fits at once, otherwise
+ * this waits for the peer to read as much as needed.
+ *
+ * Returns: %TRUE if @message was sent.
+ **/
+gboolean
+tracker_extract_channel_send (TrackerExtractChannel  *channel,
+                              GVariant               *message,
+                              gboolean                blocking,
+                              GError                **error)
+{
+	gboolean out_of_line;
+	guchar *data;
+	guint64 size, header;
+	gsize len, written = 0;
+	gssize free_space, ret;
+
+	g_return_val_if_fail (channel != NULL, FALSE);
+	g_return_val_if_fail (message != NULL, FALSE);
+
+	g_variant_ref_sink (message);
+
+	size = g_variant_get_size (message);
+	out_of_line = (size > channel->out_of_line_size);
+
+	if (out_of_line) {
+		header = size | OUT_OF_LINE_FLAG;
+		len = sizeof (header);
+	} else {
+		header = size;
+		len = sizeof (header) + size;
+	}
+
+	if (!blocking) {
+		free_space = ring_get_free_space (&channel->out, error);
+
+		if (free_space < 0) {
+			channel->closed = TRUE;
+			g_variant_unref (message);
+			return FALSE;
+		}
+
+		if ((gsize) free_space < len) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK,
+			             "No room for a %" G_GUINT64_FORMAT " bytes message",
+			             size);
+			g_variant_unref (message);
+			return FALSE;
+		}
+	}
+
+	if (out_of_line &&
+	    !channel_send_out_of_line (channel, message, size, error)) {
+		g_variant_unref (message);
+		return FALSE;
+	}
+
+	data = g_malloc (len);
+	memcpy (data, &header, sizeof (header));
+
+	if (!out_of_line) {
+		g_variant_store (message, &data[sizeof (header)]);
+	}
+
+	g_variant_unref (message);
+
+	while (TRUE) {
+		ret = ring_write (&channel->out, &data[written], len - written, error);
+
+		if (ret < 0) {
+			channel->closed = TRUE;
+			break;
+		}
+
+		written += ret;
+		channel_notify (channel);
+
+		if (written == len) {
+			break;
+		}
+
+		if (channel->closed) {
+			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_CLOSED,
+			                     "Channel was closed");
+			break;
+		}
+
+		if (!channel_wait (channel, error)) {
+			break;
+		}
+	}
+
+	g_free (data);
+
+	return written == len;
+}
+
+/**
+ * tracker_extract_channel_receive:
+ * @channel: a #TrackerExtractChannel
+ * @type: the type of the messages expected
+ * @error: return location for a #GError
+ *
+ * Reads what is available from @channel, this never blocks.
+ * Messages may arrive in several pieces, in which case this
+ * returns %NULL with no error until the message is complete.
+ *
+ * Returns: (transfer full): the message received, or %NULL.
+ **/
+GVariant *
+tracker_extract_channel_receive (TrackerExtractChannel  *channel,
+                                 const GVariantType     *type,
+                                 GError                **error)
+{
+	GByteArray *incoming;
+	GVariant *message = NULL;
+	gsize len, needed, total = 0;
+	gssize ret;
+	guint64 size;
+
+	g_return_val_if_fail (channel != NULL, NULL);
+	g_return_val_if_fail (type != NULL, NULL);
+
+	incoming = channel->incoming;
+	channel_drain (channel);
+
+	while (!message) {
+		if (incoming->len < sizeof (size)) {
+			needed = sizeof (size) - incoming->len;
+		} else {
+			memcpy (&size, incoming->data, sizeof (size));
+
+			if ((size & ~OUT_OF_LINE_FLAG) > MAX_MESSAGE_SIZE) {
+				g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				             "Message too big (%" G_GUINT64_FORMAT " bytes)",
+				             size & ~OUT_OF_LINE_FLAG);
+				channel->closed = TRUE;
+				return NULL;
+			}
+
+			if (size & OUT_OF_LINE_FLAG) {
+				needed = 0;
+			} else {
+				needed = sizeof (size) + size - incoming->len;
+			}
+		}
+
+		if (needed > 0) {
+			g_byte_array_set_size (incoming, incoming->len + needed);
+			ret = ring_read (&channel->in,
+			                 &incoming->data[incoming->len - needed],
+			                 needed, error);
+
+			if (ret < 0) {
+				g_byte_array_set_size (incoming, incoming->len - needed);
+				channel->closed = TRUE;
+				return NULL;
+			}
+
+			len = ret;
+			g_byte_array_set_size (incoming, incoming->len - needed + len);
+			total += len;
+
+			if (len < needed) {
+				break;
+			}
+
+			if (incoming->len == sizeof (size)) {
+				/* Read the rest of the message */
+				continue;
+			}
+		}
+
+		if (incoming->len >= sizeof (size)) {
+			GBytes *bytes, *data;
+
+			memcpy (&size, incoming->data, sizeof (size));
+
+			if (size & OUT_OF_LINE_FLAG) {
+				g_byte_array_set_size (incoming, 0);
+				message = channel_receive_out_of_line (channel, type,
+				                                       size & ~OUT_OF_LINE_FLAG,
+				                                       error);
+
+				if (!message) {
+					channel->closed = TRUE;
+					return NULL;
+				}
+
+				continue;
+			}
+
+			bytes = g_byte_array_free_to_bytes (incoming);
+			data = g_bytes_new_from_bytes (bytes, sizeof (size), size);
+
+			/* Messages are untrusted, these get validated */
+			message = g_variant_new_from_bytes (type, data, FALSE);
+			g_variant_ref_sink (message);
+
+			g_bytes_unref (data);
+			g_bytes_unref (bytes);
+
+			incoming = channel->incoming = g_byte_array_new ();
+		}
+	}
+
+	if (total > 0) {
+		/* Let the peer know there is room again */
+		channel_notify (channel);
+	}
+
+	if (!message && channel->closed) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_CLOSED,
+		                     "Channel was closed");
+	}
+
+	return message;
+}
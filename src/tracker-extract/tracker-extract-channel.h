@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_EXTRACT_CHANNEL_H__
+#define __TRACKER_EXTRACT_CHANNEL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TrackerExtractChannel TrackerExtractChannel;
+
+TrackerExtractChannel * tracker_extract_channel_new                  (gint                   *peer_memory_fd,
+                                                                      gint                   *peer_socket_fd,
+                                                                      GError                **error);
+TrackerExtractChannel * tracker_extract_channel_new_for_fds          (gint                    memory_fd,
+                                                                      gint                    socket_fd,
+                                                                      GError                **error);
+void                    tracker_extract_channel_free                 (TrackerExtractChannel  *channel);
+
+gint                    tracker_extract_channel_get_fd               (TrackerExtractChannel  *channel);
+
+void                    tracker_extract_channel_set_out_of_line_size (TrackerExtractChannel  *channel,
+                                                                      gsize                   size);
+
+gboolean                tracker_extract_channel_send                 (TrackerExtractChannel  *channel,
+                                                                      GVariant               *message,
+                                                                      gboolean                blocking,
+                                                                      GError                **error);
+GVariant *              tracker_extract_channel_receive              (TrackerExtractChannel  *channel,
+                                                                      const GVariantType     *type,
+                                                                      GError                **error);
+
+G_END_DECLS
+
+#endif /* __TRACKER_EXTRACT_CHANNEL_H__ */
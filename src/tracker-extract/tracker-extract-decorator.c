@@ -23,28 +23,65 @@
 #include <libtracker-common/tracker-ontologies.h>
 #include "tracker-extract-decorator.h"
 #include "tracker-extract-priority-dbus.h"
+#include "tracker-main.h"
 
 enum {
 	PROP_EXTRACTOR = 1
 };
 
 #define TRACKER_EXTRACT_DATA_SOURCE TRACKER_TRACKER_PREFIX "extractor-data-source"
-#define MAX_EXTRACTING_FILES 1
+
+/* Memory left available for each file being extracted, no more files
+ * are extracted concurrently if there is not enough for another one.
+ */
+#define EXTRACT_MEMORY_RESERVE (64 * 1024 * 1024)
+
+/* Extracted files waiting for the ones before them to be done, as a
+ * multiple of the number of files extracted concurrently.
+ */
+#define MAX_PENDING_RESULTS_FACTOR 4
 
 #define TRACKER_EXTRACT_DECORATOR_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), TRACKER_TYPE_EXTRACT_DECORATOR, TrackerExtractDecoratorPrivate))
 
 typedef struct _TrackerExtractDecoratorPrivate TrackerExtractDecoratorPrivate;
 typedef struct _ExtractData ExtractData;
+typedef struct _ModuleData ModuleData;
 
 struct _ExtractData {
 	TrackerDecorator *decorator;
 	TrackerDecoratorInfo *decorator_info;
+	ModuleData *module_data;
+
+	/* Set once extraction is done */
+	TrackerExtractInfo *info;
+	GError *error;
+	guint done : 1;
+};
+
+struct _ModuleData {
+	guint n_extracting_files;
+	guint max_extracting_files;
+
+	/* ExtractData waiting for the module to be available */
+	GQueue waiting;
 };
 
 struct _TrackerExtractDecoratorPrivate {
 	TrackerExtract *extractor;
 	GTimer *timer;
+
+	/* Files requested to the decorator or being extracted */
 	guint n_extracting_files;
+	guint max_extracting_files;
+
+	/* Files waiting for a module to be available */
+	guint n_waiting_files;
+
+	/* ExtractData, in the order items were handed by the decorator */
+	GQueue results;
+
+	/* GModule -> ModuleData */
+	GHashTable *modules;
 
 	/* DBus name -> AppData */
 	GHashTable *apps;
@@ -72,6 +109,10 @@ static const gchar *supported_classes[] = {
 static GInitableIface *parent_initable_iface;
 
 static void decorator_get_next_file (TrackerDecorator *decorator);
+static void extract_data_free (ExtractData *data);
+static void get_metadata_cb (TrackerExtract *extract,
+                             GAsyncResult   *result,
+                             ExtractData    *data);
 static void tracker_extract_decorator_initable_iface_init (GInitableIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (TrackerExtractDecorator, tracker_extract_decorator,
@@ -112,6 +153,53 @@ tracker_extract_decorator_set_property (GObject      *object,
 	}
 }
 
+static void
+extract_data_cancel (ExtractData *data)
+{
+	GTask *task;
+
+	task = tracker_decorator_info_get_task (data->decorator_info);
+	g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+	                         "Extractor is shutting down");
+	extract_data_free (data);
+}
+
+static void
+tracker_extract_decorator_dispose (GObject *object)
+{
+	TrackerExtractDecoratorPrivate *priv;
+	ModuleData *module_data;
+	GHashTableIter iter;
+	ExtractData *data;
+
+	priv = TRACKER_EXTRACT_DECORATOR (object)->priv;
+
+	/* Files waiting for a module were not started, these are
+	 * also in priv->results, so just flag them as done.
+	 */
+	if (priv->modules) {
+		g_hash_table_iter_init (&iter, priv->modules);
+
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &module_data)) {
+			while ((data = g_queue_pop_head (&module_data->waiting)) != NULL)
+				data->done = TRUE;
+		}
+	}
+
+	priv->n_waiting_files = 0;
+
+	while ((data = g_queue_pop_head (&priv->results)) != NULL) {
+		if (data->done) {
+			extract_data_cancel (data);
+		} else {
+			/* Still being extracted, freed on get_metadata_cb() */
+			data->decorator = NULL;
+		}
+	}
+
+	G_OBJECT_CLASS (tracker_extract_decorator_parent_class)->dispose (object);
+}
+
 static void
 tracker_extract_decorator_finalize (GObject *object)
 {
@@ -128,6 +216,9 @@ tracker_extract_decorator_finalize (GObject *object)
 	g_object_unref (priv->iface);
 	g_hash_table_unref (priv->apps);
 
+	if (priv->modules)
+		g_hash_table_unref (priv->modules);
+
 	G_OBJECT_CLASS (tracker_extract_decorator_parent_class)->finalize (object);
 }
 
@@ -187,36 +278,172 @@ decorator_save_info (TrackerSparqlBuilder    *sparql,
 		tracker_sparql_builder_append (sparql, result);
 }
 
+static void
+extract_data_free (ExtractData *data)
+{
+	if (data->info)
+		tracker_extract_info_unref (data->info);
+
+	g_clear_error (&data->error);
+	tracker_decorator_info_unref (data->decorator_info);
+	g_slice_free (ExtractData, data);
+}
+
+static void
+module_data_free (ModuleData *module_data)
+{
+	g_slice_free (ModuleData, module_data);
+}
+
+static ModuleData *
+decorator_get_module_data (TrackerExtractDecorator *decorator,
+                           const gchar             *mimetype)
+{
+	TrackerModuleThreadAwareness thread_awareness = TRACKER_MODULE_NONE;
+	TrackerExtractDecoratorPrivate *priv;
+	ModuleData *module_data;
+	gpointer module;
+
+	priv = decorator->priv;
+
+	if (tracker_extract_get_n_workers (priv->extractor) > 0) {
+		/* Modules are only loaded by the worker processes,
+		 * files are grouped by the module in their rule.
+		 */
+		module = mimetype ?
+			(gpointer) tracker_extract_module_manager_get_module_path (mimetype) :
+			NULL;
+		thread_awareness = TRACKER_MODULE_MULTI_THREAD;
+	} else {
+		module = tracker_extract_get_module (priv->extractor, mimetype,
+		                                     &thread_awareness);
+	}
+
+	/* Files without modules fail right away */
+	if (!module || thread_awareness == TRACKER_MODULE_NONE)
+		return NULL;
+
+	module_data = g_hash_table_lookup (priv->modules, module);
+
+	if (!module_data) {
+		module_data = g_slice_new0 (ModuleData);
+		g_queue_init (&module_data->waiting);
+
+		/* Only modules able to run in the thread pool may
+		 * extract several files at once, others either run
+		 * in the main thread or in a dedicated one. Worker
+		 * processes run a single file each, so any module
+		 * may run in all of them.
+		 */
+		if (thread_awareness == TRACKER_MODULE_MULTI_THREAD ||
+		    tracker_extract_get_n_workers (priv->extractor) > 0)
+			module_data->max_extracting_files = priv->max_extracting_files;
+		else
+			module_data->max_extracting_files = 1;
+
+		g_hash_table_insert (priv->modules, module, module_data);
+	}
+
+	return module_data;
+}
+
+/* Hands the results back to the decorator in the order the items
+ * were handed to us, so these are committed in the same order in
+ * the SPARQL batches regardless of which extraction finishes first.
+ */
+static void
+decorator_flush_results (TrackerExtractDecorator *decorator)
+{
+	TrackerExtractDecoratorPrivate *priv;
+	ExtractData *data;
+	GTask *task;
+
+	priv = decorator->priv;
+
+	while ((data = g_queue_peek_head (&priv->results)) != NULL &&
+	       data->done) {
+		g_queue_pop_head (&priv->results);
+		task = tracker_decorator_info_get_task (data->decorator_info);
+
+		if (data->error) {
+			g_task_return_error (task, data->error);
+			data->error = NULL;
+		} else {
+			decorator_save_info (g_task_get_task_data (task),
+			                     decorator, data->decorator_info,
+			                     data->info);
+			g_task_return_boolean (task, TRUE);
+		}
+
+		extract_data_free (data);
+	}
+}
+
+static void
+decorator_extract_file (TrackerDecorator *decorator,
+                        ExtractData      *data)
+{
+	TrackerExtractDecoratorPrivate *priv;
+	GTask *task;
+
+	priv = TRACKER_EXTRACT_DECORATOR (decorator)->priv;
+	task = tracker_decorator_info_get_task (data->decorator_info);
+
+	g_message ("Extracting metadata for '%s'",
+	           tracker_decorator_info_get_url (data->decorator_info));
+
+	tracker_extract_file (priv->extractor,
+	                      tracker_decorator_info_get_url (data->decorator_info),
+	                      tracker_decorator_info_get_mimetype (data->decorator_info),
+	                      TRACKER_MINER_FS_GRAPH_URN,
+	                      g_task_get_cancellable (task),
+	                      (GAsyncReadyCallback) get_metadata_cb, data);
+}
+
 static void
 get_metadata_cb (TrackerExtract *extract,
                  GAsyncResult   *result,
                  ExtractData    *data)
 {
 	TrackerExtractDecoratorPrivate *priv;
+	ModuleData *module_data;
 	TrackerExtractInfo *info;
-	GTask *task;
+	ExtractData *next;
+
+	if (!data->decorator) {
+		/* The decorator was disposed meanwhile */
+		extract_data_cancel (data);
+		return;
+	}
 
 	priv = TRACKER_EXTRACT_DECORATOR (data->decorator)->priv;
-	task = tracker_decorator_info_get_task (data->decorator_info);
 	info = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (result));
 
 	if (!info) {
-		GError *error = NULL;
-
-		g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result), &error);
-		g_task_return_error (task, error);
+		g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result),
+		                                       &data->error);
 	} else {
-		decorator_save_info (g_task_get_task_data (task),
-		                     TRACKER_EXTRACT_DECORATOR (data->decorator),
-		                     data->decorator_info, info);
-		g_task_return_boolean (task, TRUE);
+		data->info = tracker_extract_info_ref (info);
 	}
 
+	data->done = TRUE;
 	priv->n_extracting_files--;
-	decorator_get_next_file (data->decorator);
+	module_data = data->module_data;
 
-	tracker_decorator_info_unref (data->decorator_info);
-	g_free (data);
+	if (module_data) {
+		module_data->n_extracting_files--;
+		next = g_queue_pop_head (&module_data->waiting);
+
+		if (next) {
+			module_data->n_extracting_files++;
+			priv->n_waiting_files--;
+			priv->n_extracting_files++;
+			decorator_extract_file (next->decorator, next);
+		}
+	}
+
+	decorator_flush_results (TRACKER_EXTRACT_DECORATOR (data->decorator));
+	decorator_get_next_file (data->decorator);
 }
 
 static void
@@ -226,9 +453,9 @@ decorator_next_item_cb (TrackerDecorator *decorator,
 {
 	TrackerExtractDecoratorPrivate *priv;
 	TrackerDecoratorInfo *info;
+	ModuleData *module_data;
 	GError *error = NULL;
 	ExtractData *data;
-	GTask *task;
 
 	priv = TRACKER_EXTRACT_DECORATOR (decorator)->priv;
 	info = tracker_decorator_next_finish (decorator, result, &error);
@@ -253,19 +480,47 @@ decorator_next_item_cb (TrackerDecorator *decorator,
 		return;
 	}
 
-	data = g_new0 (ExtractData, 1);
+	data = g_slice_new0 (ExtractData);
 	data->decorator = decorator;
 	data->decorator_info = info;
-	task = tracker_decorator_info_get_task (info);
+	g_queue_push_tail (&priv->results, data);
 
-	g_message ("Extracting metadata for '%s'", tracker_decorator_info_get_url (info));
+	module_data = decorator_get_module_data (TRACKER_EXTRACT_DECORATOR (decorator),
+	                                         tracker_decorator_info_get_mimetype (info));
+	data->module_data = module_data;
 
-	tracker_extract_file (priv->extractor,
-	                      tracker_decorator_info_get_url (info),
-	                      tracker_decorator_info_get_mimetype (info),
-	                      TRACKER_MINER_FS_GRAPH_URN,
-	                      g_task_get_cancellable (task),
-	                      (GAsyncReadyCallback) get_metadata_cb, data);
+	if (module_data &&
+	    module_data->n_extracting_files >= module_data->max_extracting_files) {
+		/* Leave the slot to files handled by other modules */
+		g_queue_push_tail (&module_data->waiting, data);
+		priv->n_extracting_files--;
+		priv->n_waiting_files++;
+		decorator_get_next_file (decorator);
+		return;
+	}
+
+	if (module_data)
+		module_data->n_extracting_files++;
+
+	decorator_extract_file (decorator, data);
+}
+
+static gboolean
+decorator_check_memory (TrackerExtractDecorator *decorator)
+{
+	TrackerExtractDecoratorPrivate *priv;
+	guint64 available;
+
+	priv = decorator->priv;
+
+	/* Always allow one file, so extraction makes progress */
+	if (priv->n_extracting_files == 0)
+		return TRUE;
+
+	if (!tracker_memory_get_available (&available))
+		return TRUE;
+
+	return available >= (priv->n_extracting_files + 1) * (guint64) EXTRACT_MEMORY_RESERVE;
 }
 
 static void
@@ -281,8 +536,11 @@ decorator_get_next_file (TrackerDecorator *decorator)
 		return;
 
 	available_items = tracker_decorator_get_n_items (decorator);
-	while (priv->n_extracting_files < MAX_EXTRACTING_FILES &&
-	       available_items > 0) {
+	while (priv->n_extracting_files < priv->max_extracting_files &&
+	       priv->n_waiting_files < priv->max_extracting_files &&
+	       priv->results.length < priv->max_extracting_files * MAX_PENDING_RESULTS_FACTOR &&
+	       available_items > 0 &&
+	       decorator_check_memory (TRACKER_EXTRACT_DECORATOR (decorator))) {
 		priv->n_extracting_files++;
 		available_items--;
 		tracker_decorator_next (decorator, NULL,
@@ -324,12 +582,17 @@ tracker_extract_decorator_items_available (TrackerDecorator *decorator)
 	TrackerExtractDecoratorPrivate *priv;
 
 	priv = TRACKER_EXTRACT_DECORATOR (decorator)->priv;
-	g_message ("Starting to process %d items",
-	           tracker_decorator_get_n_items (decorator));
-
-	priv->timer = g_timer_new ();
-	if (tracker_miner_is_paused (TRACKER_MINER (decorator)))
-		g_timer_stop (priv->timer);
+	/* Items may become available again while the backlog is
+	 * loaded in pages, keep timing since the first ones.
+	 */
+	if (!priv->timer) {
+		g_message ("Starting to process %d items",
+		           tracker_decorator_get_n_items (decorator));
+
+		priv->timer = g_timer_new ();
+		if (tracker_miner_is_paused (TRACKER_MINER (decorator)))
+			g_timer_stop (priv->timer);
+	}
 
 	decorator_get_next_file (decorator);
 }
@@ -511,6 +774,7 @@ tracker_extract_decorator_class_init (TrackerExtractDecoratorClass *klass)
 	TrackerMinerClass *miner_class = TRACKER_MINER_CLASS (klass);
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+	object_class->dispose = tracker_extract_decorator_dispose;
 	object_class->finalize = tracker_extract_decorator_finalize;
 	object_class->get_property = tracker_extract_decorator_get_property;
 	object_class->set_property = tracker_extract_decorator_set_property;
@@ -548,11 +812,26 @@ tracker_extract_decorator_initable_init (GInitable     *initable,
 	TrackerExtractDecorator        *decorator;
 	TrackerExtractDecoratorPrivate *priv;
 	GDBusConnection                *conn;
+	TrackerConfig                  *config;
 	gboolean                        ret = TRUE;
 
 	decorator = TRACKER_EXTRACT_DECORATOR (initable);
 	priv = decorator->priv;
 
+	config = tracker_main_get_config ();
+	priv->max_extracting_files = config ? tracker_config_get_max_extracting_files (config) : 0;
+
+	if (priv->max_extracting_files == 0)
+		priv->max_extracting_files = g_get_num_processors ();
+
+	g_message ("Extracting up to %u files concurrently",
+	           priv->max_extracting_files);
+	tracker_extract_set_max_threads (priv->extractor,
+	                                 priv->max_extracting_files);
+
+	priv->modules = g_hash_table_new_full (NULL, NULL, NULL,
+	                                       (GDestroyNotify) module_data_free);
+
 	priv->apps = g_hash_table_new_full (g_str_hash,
 	                                    g_str_equal,
 	                                    g_free,
@@ -20,21 +20,17 @@
 
 #include "config.h"
 
-#include <errno.h>
-#include <fcntl.h>
 #include <string.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <unistd.h>
-
-#include <gif_lib.h>
 
 #include <libtracker-common/tracker-common.h>
 
 #include <libtracker-extract/tracker-extract.h>
 
 #define XMP_MAGIC_TRAILER_LENGTH 256
+#define XMP_APPLICATION_ID "XMP DataXMP"
+#define XMP_APPLICATION_ID_LENGTH 11
 #define EXTENSION_RECORD_COMMENT_BLOCK_CODE 0xFE
+#define EXTENSION_RECORD_APPLICATION_BLOCK_CODE 0xFF
 
 typedef struct {
 	const gchar *title;
@@ -48,189 +44,62 @@ typedef struct {
 	gchar *comment;
 } GifData;
 
-typedef struct {
-	unsigned int   byteCount;
-	char          *bytes;
-} ExtBlock;
-
-static int
-ext_block_append(ExtBlock *extBlock,
-		 unsigned int len,
-		 unsigned char extData[])
-{
-	extBlock->bytes = realloc(extBlock->bytes,extBlock->byteCount+len);
-	if (extBlock->bytes == NULL) {
-		return (GIF_ERROR);
-	}
-
-	memcpy(&(extBlock->bytes[extBlock->byteCount]), &extData[0], len);
-	extBlock->byteCount += len;
-
-	return (GIF_OK);
-}
-
-#if GIFLIB_MAJOR >= 5
-static inline void
-gif_error (const gchar *action, int err)
-{
-	const char *str = GifErrorString (err);
-	if (str != NULL) {
-		g_message ("%s, error: '%s'", action, str);
-	} else {
-		g_message ("%s, undefined error %d", action, err);
-	}
-}
-#else /* GIFLIB_MAJOR >= 5 */
-static inline void print_gif_error()
-{
-#if defined(GIFLIB_MAJOR) && defined(GIFLIB_MINOR) && ((GIFLIB_MAJOR == 4 && GIFLIB_MINOR >= 2) || GIFLIB_MAJOR > 4)
-	const char *str = GifErrorString ();
-	if (str != NULL) {
-		g_message ("GIF, error: '%s'", str);
-	} else {
-		g_message ("GIF, undefined error");
-	}
-#else
-	PrintGifError();
-#endif
-}
-#endif /* GIFLIB_MAJOR >= 5 */
-
 static void
-read_metadata (TrackerSparqlBuilder *preupdate,
-               TrackerSparqlBuilder *metadata,
-               GString              *where,
-               GifFileType          *gifFile,
-               const gchar          *uri,
-               const gchar          *graph)
+read_metadata (TrackerSparqlBuilder  *preupdate,
+               TrackerSparqlBuilder  *metadata,
+               GString               *where,
+               TrackerSegmentScanner *scanner,
+               const gchar           *uri,
+               const gchar           *graph)
 {
-	GifRecordType RecordType;
-	int frameheight;
-	int framewidth;
-	unsigned char *framedata = NULL;
+	TrackerSegment segment;
 	GPtrArray *keywords;
 	guint i;
-	int status;
 	MergeData md = { 0 };
 	GifData   gd = { 0 };
 	TrackerXmpData *xd = NULL;
 
-	do {
-		GifByteType *ExtData;
-		int ExtCode;
-		ExtBlock extBlock;
-
-		if (DGifGetRecordType(gifFile, &RecordType) == GIF_ERROR) {
-#if GIFLIB_MAJOR < 5
-			print_gif_error ();
-#else  /* GIFLIB_MAJOR < 5 */
-			gif_error ("Could not read next GIF record type", gifFile->Error);
-#endif /* GIFLIB_MAJOR < 5 */
-			return;
-		}
-
-		switch (RecordType) {
-			case IMAGE_DESC_RECORD_TYPE:
-			if (DGifGetImageDesc(gifFile) == GIF_ERROR) {
-#if GIFLIB_MAJOR < 5
-				print_gif_error();
-#else  /* GIFLIB_MAJOR < 5 */
-				gif_error ("Could not get GIF record information", gifFile->Error);
-#endif /* GIFLIB_MAJOR < 5 */
-				return;
-			}
-
-			framewidth  = gifFile->Image.Width;
-			frameheight = gifFile->Image.Height;
-
-			framedata = g_malloc (framewidth*frameheight);
-
-			if (DGifGetLine(gifFile, framedata, framewidth*frameheight)==GIF_ERROR) {
-#if GIFLIB_MAJOR < 5
-				print_gif_error();
-#else  /* GIFLIB_MAJOR < 5 */
-				gif_error ("Could not load a block of GIF pixes", gifFile->Error);
-#endif /* GIFLIB_MAJOR < 5 */
-				return;
-			}
-
-			gd.width  = g_strdup_printf ("%d", framewidth);
-			gd.height = g_strdup_printf ("%d", frameheight);
-
-
-			g_free (framedata);
-
-		break;
-		case EXTENSION_RECORD_TYPE:
-			extBlock.bytes = NULL;
-			extBlock.byteCount = 0;
-
-			if ((status = DGifGetExtension (gifFile, &ExtCode, &ExtData)) != GIF_OK) {
-				g_warning ("Problem getting the extension");
-				return;
-			}
+	/* Image data is skipped by following the sub-block lengths,
+	 * it is never decoded.
+	 */
+	while (tracker_segment_scanner_next (scanner, &segment)) {
+		switch (segment.type) {
+		case TRACKER_SEGMENT_GIF_IMAGE:
+			/* Left and top positions, then width and height,
+			 * the last frame wins.
+			 */
+			g_free (gd.width);
+			g_free (gd.height);
+			gd.width = g_strdup_printf ("%d", segment.data[4] | segment.data[5] << 8);
+			gd.height = g_strdup_printf ("%d", segment.data[6] | segment.data[7] << 8);
+			break;
+		case TRACKER_SEGMENT_GIF_EXTENSION:
 #if defined(HAVE_EXEMPI)
-			if (ExtData && *ExtData &&
-			    strncmp (&ExtData[1],"XMP Data",8) == 0) {
-				while (ExtData != NULL && status == GIF_OK ) {
-					if ((status = DGifGetExtensionNext (gifFile, &ExtData)) == GIF_OK) {
-						if (ExtData != NULL) {
-							if (ext_block_append (&extBlock, ExtData[0]+1, (char *) &(ExtData[0])) != GIF_OK) {
-								g_warning ("Problem with extension data");
-								return;
-							}
-						}
-					}
-				}
-
-				xd = tracker_xmp_new (extBlock.bytes,
-				                      extBlock.byteCount-XMP_MAGIC_TRAILER_LENGTH,
+			/* XMP is stored raw, the sub-block lengths are part
+			 * of the packet, followed by a "magic trailer" that
+			 * makes them valid.
+			 */
+			if (!xd &&
+			    segment.data[0] == EXTENSION_RECORD_APPLICATION_BLOCK_CODE &&
+			    segment.length > 2 + XMP_APPLICATION_ID_LENGTH + XMP_MAGIC_TRAILER_LENGTH &&
+			    segment.data[1] == XMP_APPLICATION_ID_LENGTH &&
+			    memcmp (&segment.data[2], XMP_APPLICATION_ID, XMP_APPLICATION_ID_LENGTH) == 0) {
+				xd = tracker_xmp_new ((const gchar *) &segment.data[2 + XMP_APPLICATION_ID_LENGTH],
+				                      segment.length - 2 - XMP_APPLICATION_ID_LENGTH - XMP_MAGIC_TRAILER_LENGTH,
 				                      uri);
-
-				g_free (extBlock.bytes);
 			} else
 #endif
 			/* See Section 24. Comment Extension. in the GIF format definition */
-			if (ExtCode == EXTENSION_RECORD_COMMENT_BLOCK_CODE &&
-			    ExtData && *ExtData) {
-				guint block_count = 0;
-
-				/* Merge all blocks */
-				do {
-					block_count++;
-
-					g_debug ("Comment Extension block found (#%u, %u bytes)",
-					         block_count,
-					         ExtData[0]);
-					if (ext_block_append (&extBlock, ExtData[0], (char *) &(ExtData[1])) != GIF_OK) {
-						g_warning ("Problem with Comment extension data");
-						return;
-					}
-				} while (((status = DGifGetExtensionNext(gifFile, &ExtData)) == GIF_OK) &&
-				         ExtData != NULL);
-
-				/* Add last NUL byte */
-				g_debug ("Comment Extension blocks found (%u) with %u bytes",
-				         block_count,
-				         extBlock.byteCount);
-				extBlock.bytes = g_realloc (extBlock.bytes, extBlock.byteCount + 1);
-				extBlock.bytes[extBlock.byteCount] = '\0';
-
-				/* Set commentt */
-				gd.comment = extBlock.bytes;
-			} else {
-				do {
-					status = DGifGetExtensionNext(gifFile, &ExtData);
-				} while ( status == GIF_OK && ExtData != NULL);
+			if (segment.data[0] == EXTENSION_RECORD_COMMENT_BLOCK_CODE &&
+			    segment.length > 1) {
+				g_free (gd.comment);
+				gd.comment = tracker_segment_gif_get_data (&segment, NULL);
 			}
-		break;
-		case TERMINATE_RECORD_TYPE:
 			break;
 		default:
 			break;
 		}
-	} while (RecordType != TERMINATE_RECORD_TYPE);
-
+	}
 
 	if (!xd) {
 		xd = g_new0 (TrackerXmpData, 1);
@@ -619,16 +488,13 @@ G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo *info)
 {
 	TrackerSparqlBuilder *preupdate, *metadata;
+	TrackerSegmentScanner *scanner;
 	goffset size;
-	GifFileType *gifFile = NULL;
 	GString *where;
 	const gchar *graph;
 	gchar *filename, *uri;
 	GFile *file;
-	int fd;
-#if GIFLIB_MAJOR >= 5
-	int err;
-#endif
+	GError *error = NULL;
 
 	preupdate = tracker_extract_info_get_preupdate_builder (info);
 	metadata = tracker_extract_info_get_metadata_builder (info);
@@ -643,25 +509,21 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 		return FALSE;
 	}
 
-	fd = tracker_file_open_fd (filename);
+	scanner = tracker_segment_scanner_new (filename, &error);
 
-	if (fd == -1) {
+	if (!scanner) {
 		g_warning ("Could not open GIF file '%s': %s\n",
 		           filename,
-		           g_strerror (errno));
+		           error->message);
+		g_error_free (error);
 		g_free (filename);
 		return FALSE;
-	}	
-
-#if GIFLIB_MAJOR < 5
-	if ((gifFile = DGifOpenFileHandle (fd)) == NULL) {
-		print_gif_error ();
-#else   /* GIFLIB_MAJOR < 5 */
-	if ((gifFile = DGifOpenFileHandle (fd, &err)) == NULL) {
-		gif_error ("Could not open GIF file with handle", err);
-#endif /* GIFLIB_MAJOR < 5 */
+	}
+
+	if (tracker_segment_scanner_get_format (scanner) != TRACKER_SEGMENT_FORMAT_GIF) {
+		g_message ("Could not open GIF file '%s': Not a GIF file", filename);
+		tracker_segment_scanner_free (scanner);
 		g_free (filename);
-		close (fd);
 		return FALSE;
 	}
 
@@ -674,19 +536,12 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 	where = g_string_new ("");
 	uri = g_file_get_uri (file);
 
-	read_metadata (preupdate, metadata, where, gifFile, uri, graph);
+	read_metadata (preupdate, metadata, where, scanner, uri, graph);
 	tracker_extract_info_set_where_clause (info, where->str);
 	g_string_free (where, TRUE);
 
 	g_free (uri);
-
-	if (DGifCloseFile (gifFile) != GIF_OK) {
-#if GIFLIB_MAJOR < 5
-		print_gif_error ();
-#else  /* GIFLIB_MAJOR < 5 */
-		gif_error ("Could not close GIF file", gifFile->Error);
-#endif /* GIFLIB_MAJOR < 5 */
-	}
+	tracker_segment_scanner_free (scanner);
 
 	return TRUE;
 }
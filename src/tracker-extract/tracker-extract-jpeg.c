@@ -20,10 +20,7 @@
 
 #include "config.h"
 
-#include <stdio.h>
-#include <setjmp.h>
-
-#include <jpeglib.h>
+#include <string.h>
 
 #include <libtracker-common/tracker-common.h>
 #include <libtracker-extract/tracker-extract.h>
@@ -33,6 +30,9 @@
 
 #define CM_TO_INCH              0.393700787
 
+#define JFIF_NAMESPACE          "JFIF\0"
+#define JFIF_NAMESPACE_LENGTH   5
+
 #ifdef HAVE_LIBEXIF
 #define EXIF_NAMESPACE          "Exif"
 #define EXIF_NAMESPACE_LENGTH   4
@@ -77,17 +77,29 @@ typedef struct {
 	const gchar *gps_direction;
 } MergeData;
 
-struct tej_error_mgr {
-	struct jpeg_error_mgr jpeg;
-	jmp_buf setjmp_buffer;
-};
+typedef struct {
+	guint width;
+	guint height;
+	guint density_unit;
+	guint x_density;
+	guint y_density;
+} JpegData;
+
+static inline guint
+read_uint16 (const guchar *data)
+{
+	return data[0] << 8 | data[1];
+}
 
-static void
-extract_jpeg_error_exit (j_common_ptr cinfo)
+static gboolean
+is_sof_marker (guint marker)
 {
-	struct tej_error_mgr *h = (struct tej_error_mgr *) cinfo->err;
-	(*cinfo->err->output_message)(cinfo);
-	longjmp (h->setjmp_buffer, 1);
+	/* DHT, JPG and DAC share the range of SOFn markers */
+	return (marker >= TRACKER_SEGMENT_JPEG_SOF0 &&
+	        marker <= TRACKER_SEGMENT_JPEG_SOF15 &&
+	        marker != TRACKER_SEGMENT_JPEG_DHT &&
+	        marker != TRACKER_SEGMENT_JPEG_JPG &&
+	        marker != TRACKER_SEGMENT_JPEG_DAC);
 }
 
 static gboolean
@@ -132,22 +144,21 @@ guess_dlna_profile (gint          width,
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo *info)
 {
-	struct jpeg_decompress_struct cinfo;
-	struct tej_error_mgr tejerr;
-	struct jpeg_marker_struct *marker;
+	TrackerSegmentScanner *scanner;
+	TrackerSegment segment;
 	TrackerSparqlBuilder *preupdate, *metadata;
 	TrackerXmpData *xd = NULL;
 	TrackerExifData *ed = NULL;
 	TrackerIptcData *id = NULL;
 	MergeData md = { 0 };
+	JpegData jd = { 0 };
 	GFile *file;
-	FILE *f;
 	goffset size;
 	gchar *filename, *uri;
 	gchar *comment = NULL;
 	const gchar *dlna_profile, *dlna_mimetype, *graph;
 	GPtrArray *keywords;
-	gboolean success = TRUE;
+	gboolean has_sof = FALSE;
 	GString *where;
 	guint i;
 
@@ -165,74 +176,75 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 		return FALSE;
 	}
 
-	f = tracker_file_open (filename);
+	/* Only the pages holding the markers before the first scan
+	 * are read, the image data is never touched.
+	 */
+	scanner = tracker_segment_scanner_new (filename, NULL);
 	g_free (filename);
 
-	if (!f) {
+	if (!scanner) {
 		return FALSE;
 	}
 
-	uri = g_file_get_uri (file);
-
-	tracker_sparql_builder_predicate (metadata, "a");
-	tracker_sparql_builder_object (metadata, "nfo:Image");
-	tracker_sparql_builder_predicate (metadata, "a");
-	tracker_sparql_builder_object (metadata, "nmm:Photo");
-
-	cinfo.err = jpeg_std_error (&tejerr.jpeg);
-	tejerr.jpeg.error_exit = extract_jpeg_error_exit;
-	if (setjmp (tejerr.setjmp_buffer)) {
-		success = FALSE;
-		goto fail;
+	if (tracker_segment_scanner_get_format (scanner) != TRACKER_SEGMENT_FORMAT_JPEG) {
+		tracker_segment_scanner_free (scanner);
+		return FALSE;
 	}
 
-	jpeg_create_decompress (&cinfo);
-
-	jpeg_save_markers (&cinfo, JPEG_COM, 0xFFFF);
-	jpeg_save_markers (&cinfo, JPEG_APP0 + 1, 0xFFFF);
-	jpeg_save_markers (&cinfo, JPEG_APP0 + 13, 0xFFFF);
-
-	jpeg_stdio_src (&cinfo, f);
-
-	jpeg_read_header (&cinfo, TRUE);
-
-	/* FIXME? It is possible that there are markers after SOS,
-	 * but there shouldn't be. Should we decompress the whole file?
-	 *
-	 * jpeg_start_decompress(&cinfo);
-	 * jpeg_finish_decompress(&cinfo);
-	 *
-	 * jpeg_calc_output_dimensions(&cinfo);
-	 */
-
-	marker = (struct jpeg_marker_struct *) &cinfo.marker_list;
+	uri = g_file_get_uri (file);
 
-	while (marker) {
-		gchar *str;
+	while (tracker_segment_scanner_next (scanner, &segment)) {
+		const gchar *str;
 		gsize len;
 #ifdef HAVE_LIBIPTCDATA
 		gsize offset;
 		guint sublen;
 #endif /* HAVE_LIBIPTCDATA */
 
-		switch (marker->marker) {
-		case JPEG_COM:
+		str = (const gchar *) segment.data;
+		len = segment.length;
+
+		if (is_sof_marker (segment.type)) {
+			/* Precision, then height and width */
+			if (len >= 5) {
+				jd.height = read_uint16 (&segment.data[1]);
+				jd.width = read_uint16 (&segment.data[3]);
+				has_sof = TRUE;
+			}
+
+			continue;
+		}
+
+		switch (segment.type) {
+		case TRACKER_SEGMENT_JPEG_COM:
 			g_free (comment);
-			comment = g_strndup ((gchar*) marker->data, marker->data_length);
+			comment = g_strndup (str, len);
 			break;
 
-		case JPEG_APP0 + 1:
-			str = (gchar*) marker->data;
-			len = marker->data_length;
+		case TRACKER_SEGMENT_JPEG_APP0:
+			/* Version, units, then X and Y densities */
+			if (len >= JFIF_NAMESPACE_LENGTH + 7 &&
+			    memcmp (JFIF_NAMESPACE, str, JFIF_NAMESPACE_LENGTH) == 0) {
+				jd.density_unit = segment.data[JFIF_NAMESPACE_LENGTH + 2];
+				jd.x_density = read_uint16 (&segment.data[JFIF_NAMESPACE_LENGTH + 3]);
+				jd.y_density = read_uint16 (&segment.data[JFIF_NAMESPACE_LENGTH + 5]);
+			}
 
+			break;
+
+		case TRACKER_SEGMENT_JPEG_APP0 + 1:
 #ifdef HAVE_LIBEXIF
-			if (strncmp (EXIF_NAMESPACE, str, EXIF_NAMESPACE_LENGTH) == 0) {
-				ed = tracker_exif_new ((guchar *) marker->data, len, uri);
+			if (!ed &&
+			    len >= EXIF_NAMESPACE_LENGTH &&
+			    strncmp (EXIF_NAMESPACE, str, EXIF_NAMESPACE_LENGTH) == 0) {
+				ed = tracker_exif_new (segment.data, len, uri);
 			}
 #endif /* HAVE_LIBEXIF */
 
 #ifdef HAVE_EXEMPI
-			if (strncmp (XMP_NAMESPACE, str, XMP_NAMESPACE_LENGTH) == 0) {
+			if (!xd &&
+			    len > XMP_NAMESPACE_LENGTH &&
+			    memcmp (XMP_NAMESPACE, str, XMP_NAMESPACE_LENGTH) == 0) {
 				xd = tracker_xmp_new (str + XMP_NAMESPACE_LENGTH,
 				                      len - XMP_NAMESPACE_LENGTH,
 				                      uri);
@@ -241,14 +253,14 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 
 			break;
 
-		case JPEG_APP0 + 13:
-			str = (gchar*) marker->data;
-			len = marker->data_length;
+		case TRACKER_SEGMENT_JPEG_APP0 + 13:
 #ifdef HAVE_LIBIPTCDATA
-			if (len > 0 && strncmp (PS3_NAMESPACE, str, PS3_NAMESPACE_LENGTH) == 0) {
-				offset = iptc_jpeg_ps3_find_iptc (str, len, &sublen);
+			if (!id &&
+			    len >= PS3_NAMESPACE_LENGTH &&
+			    memcmp (PS3_NAMESPACE, str, PS3_NAMESPACE_LENGTH) == 0) {
+				offset = iptc_jpeg_ps3_find_iptc (segment.data, len, &sublen);
 				if (offset > 0 && sublen > 0) {
-					id = tracker_iptc_new (str + offset, sublen, uri);
+					id = tracker_iptc_new (segment.data + offset, sublen, uri);
 				}
 			}
 #endif /* HAVE_LIBIPTCDATA */
@@ -256,13 +268,39 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 			break;
 
 		default:
-			marker = marker->next;
-			continue;
+			break;
 		}
+	}
+
+	/* The exif, xmp and iptc parsers copy what they need, so
+	 * nothing refers to the mapped file anymore.
+	 */
+	tracker_segment_scanner_free (scanner);
 
-		marker = marker->next;
+	if (!has_sof) {
+		/* Not a valid JPEG image, libjpeg would have failed too */
+		if (ed) {
+			tracker_exif_free (ed);
+		}
+
+		if (xd) {
+			tracker_xmp_free (xd);
+		}
+
+		if (id) {
+			tracker_iptc_free (id);
+		}
+
+		g_free (comment);
+		g_free (uri);
+		return FALSE;
 	}
 
+	tracker_sparql_builder_predicate (metadata, "a");
+	tracker_sparql_builder_object (metadata, "nfo:Image");
+	tracker_sparql_builder_predicate (metadata, "a");
+	tracker_sparql_builder_object (metadata, "nmm:Photo");
+
 	if (!ed) {
 		ed = g_new0 (TrackerExifData, 1);
 	}
@@ -305,14 +343,14 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 
 	/* Prioritize on native dimention in all cases */
 	tracker_sparql_builder_predicate (metadata, "nfo:width");
-	tracker_sparql_builder_object_int64 (metadata, cinfo.image_width);
+	tracker_sparql_builder_object_int64 (metadata, jd.width);
 
 	/* TODO: add ontology and store ed->software */
 
 	tracker_sparql_builder_predicate (metadata, "nfo:height");
-	tracker_sparql_builder_object_int64 (metadata, cinfo.image_height);
+	tracker_sparql_builder_object_int64 (metadata, jd.height);
 
-	if (guess_dlna_profile (cinfo.image_width, cinfo.image_height, &dlna_profile, &dlna_mimetype)) {
+	if (guess_dlna_profile (jd.width, jd.height, &dlna_profile, &dlna_mimetype)) {
 		tracker_sparql_builder_predicate (metadata, "nmm:dlnaProfile");
 		tracker_sparql_builder_object_string (metadata, dlna_profile);
 		tracker_sparql_builder_predicate (metadata, "nmm:dlnaMime");
@@ -746,54 +784,49 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 		tracker_sparql_builder_object_unvalidated (metadata, md.gps_direction);
 	}
 
-	if (cinfo.density_unit != 0 || ed->x_resolution) {
+	if (jd.density_unit != 0 || ed->x_resolution) {
 		gdouble value;
 
-		if (cinfo.density_unit == 0) {
+		if (jd.density_unit == 0) {
 			if (ed->resolution_unit != 3)
 				value = g_strtod (ed->x_resolution, NULL);
 			else
 				value = g_strtod (ed->x_resolution, NULL) * CM_TO_INCH;
 		} else {
-			if (cinfo.density_unit == 1)
-				value = cinfo.X_density;
+			if (jd.density_unit == 1)
+				value = jd.x_density;
 			else
-				value = cinfo.X_density * CM_TO_INCH;
+				value = jd.x_density * CM_TO_INCH;
 		}
 
 		tracker_sparql_builder_predicate (metadata, "nfo:horizontalResolution");
 		tracker_sparql_builder_object_double (metadata, value);
 	}
 
-	if (cinfo.density_unit != 0 || ed->y_resolution) {
+	if (jd.density_unit != 0 || ed->y_resolution) {
 		gdouble value;
 
-		if (cinfo.density_unit == 0) {
+		if (jd.density_unit == 0) {
 			if (ed->resolution_unit != 3)
 				value = g_strtod (ed->y_resolution, NULL);
 			else
 				value = g_strtod (ed->y_resolution, NULL) * CM_TO_INCH;
 		} else {
-			if (cinfo.density_unit == 1)
-				value = cinfo.Y_density;
+			if (jd.density_unit == 1)
+				value = jd.y_density;
 			else
-				value = cinfo.Y_density * CM_TO_INCH;
+				value = jd.y_density * CM_TO_INCH;
 		}
 
 		tracker_sparql_builder_predicate (metadata, "nfo:verticalResolution");
 		tracker_sparql_builder_object_double (metadata, value);
 	}
 
-	jpeg_destroy_decompress (&cinfo);
-
 	tracker_exif_free (ed);
 	tracker_xmp_free (xd);
 	tracker_iptc_free (id);
 	g_free (comment);
-
-fail:
-	tracker_file_close (f, FALSE);
 	g_free (uri);
 
-	return success;
+	return TRUE;
 }
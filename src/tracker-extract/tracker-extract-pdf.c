@@ -51,6 +51,17 @@
 /* Time in seconds before we stop processing content */
 #define EXTRACTION_PROCESS_TIMEOUT 10
 
+/* Text is extracted in chunks of pages, which are appended in order
+ * to the content as soon as all previous chunks are done, until the
+ * max bytes are reached. Chunks of big documents are extracted by
+ * several threads, each with its own PopplerDocument, as these
+ * are not thread safe.
+ */
+#define PAGES_PER_CHUNK    16
+#define PARALLEL_MIN_PAGES 128
+#define MAX_TEXT_THREADS   4
+#define MAX_CHUNKS_AHEAD   (2 * MAX_TEXT_THREADS)
+
 typedef struct {
 	gchar *title;
 	gchar *subject;
@@ -60,9 +71,30 @@ typedef struct {
 	gchar *keywords;
 } PDFData;
 
+typedef struct {
+	/* Document data, for the extraction threads */
+	gchar *contents;
+	gsize len;
+
+	gint n_pages;
+	gint n_chunks;
+	gsize n_bytes;
+	GCancellable *cancellable;
+	GTimer *timer;
+
+	GMutex mutex;
+	GCond cond;
+	gint next_chunk;
+	gint n_appended;
+	GString **chunks; /* Done, but not yet appended */
+	GString *content;
+	gsize remaining_bytes;
+} TextExtraction;
+
 static void
 read_toc (PopplerIndexIter  *index,
-          GString          **toc)
+          GString          **toc,
+          gsize              max_length)
 {
 	if (!index) {
 		return;
@@ -72,6 +104,11 @@ read_toc (PopplerIndexIter  *index,
 		*toc = g_string_new ("");
 	}
 
+	if ((*toc)->len >= max_length) {
+		poppler_index_iter_free (index);
+		return;
+	}
+
 	do {
 		PopplerAction *action;
 		PopplerIndexIter *iter;
@@ -162,15 +199,16 @@ read_toc (PopplerIndexIter  *index,
 
 		poppler_action_free (action);
 		iter = poppler_index_iter_get_child (index);
-		read_toc (iter, toc);
-	} while (poppler_index_iter_next (index));
+		read_toc (iter, toc, max_length);
+	} while ((*toc)->len < max_length && poppler_index_iter_next (index));
 
 	poppler_index_iter_free (index);
 }
 
 static void
 read_outline (PopplerDocument      *document,
-              TrackerSparqlBuilder *metadata)
+              TrackerSparqlBuilder *metadata,
+              gsize                 max_length)
 {
 	PopplerIndexIter *index;
 	GString *toc = NULL;
@@ -181,7 +219,7 @@ read_outline (PopplerDocument      *document,
 		return;
 	}
 
-	read_toc (index, &toc);
+	read_toc (index, &toc, max_length);
 
 	if (toc) {
 		if (toc->len > 0) {
@@ -193,66 +231,234 @@ read_outline (PopplerDocument      *document,
 	}
 }
 
-static gchar *
-extract_content_text (PopplerDocument *document,
-                      gsize            n_bytes)
+/* Scanned documents usually have no fonts at all, the pages
+ * resources are looked up until one is found, which is way
+ * cheaper than running text extraction on every page.
+ */
+static gboolean
+document_has_fonts (PopplerDocument *document,
+                    gint             n_pages)
+{
+	PopplerFontInfo *font_info;
+	PopplerFontsIter *fonts_iter = NULL;
+	gboolean has_fonts = FALSE;
+	gint scanned;
+
+	font_info = poppler_font_info_new (document);
+
+	/* Scanning returns FALSE for batches of pages without
+	 * fonts, it doesn't mean there are no pages left.
+	 */
+	for (scanned = 0; scanned < n_pages && !has_fonts; scanned += PAGES_PER_CHUNK) {
+		poppler_font_info_scan (font_info, PAGES_PER_CHUNK, &fonts_iter);
+
+		if (fonts_iter) {
+			poppler_fonts_iter_free (fonts_iter);
+			fonts_iter = NULL;
+			has_fonts = TRUE;
+		}
+	}
+
+	g_object_unref (font_info);
+
+	return has_fonts;
+}
+
+static gboolean
+text_extraction_expired (TextExtraction *te)
+{
+	return (g_timer_elapsed (te->timer, NULL) >= EXTRACTION_PROCESS_TIMEOUT ||
+	        g_cancellable_is_cancelled (te->cancellable));
+}
+
+static GString *
+extract_chunk_text (TextExtraction  *te,
+                    PopplerDocument *document,
+                    gint             chunk)
 {
 	GString *string;
-	GTimer *timer;
-	gsize remaining_bytes;
-	gint n_pages, i;
-	gdouble elapsed;
+	gint i, last;
 
-	n_pages = poppler_document_get_n_pages (document);
 	string = g_string_new ("");
-	timer = g_timer_new ();
+	i = chunk * PAGES_PER_CHUNK;
+	last = MIN (i + PAGES_PER_CHUNK, te->n_pages);
 
-	for (i = 0, remaining_bytes = n_bytes, elapsed = g_timer_elapsed (timer, NULL);
-	     i < n_pages && remaining_bytes > 0 && elapsed < EXTRACTION_PROCESS_TIMEOUT;
-	     i++, elapsed = g_timer_elapsed (timer, NULL)) {
+	/* Chunks never need more than the whole content */
+	for (; i < last && string->len < te->n_bytes && !text_extraction_expired (te); i++) {
 		PopplerPage *page;
-		gsize written_bytes = 0;
 		gchar *text;
 
 		page = poppler_document_get_page (document, i);
 		text = poppler_page_get_text (page);
 
-		if (!text) {
-			g_object_unref (page);
-			continue;
-		}
-
-		if (tracker_text_validate_utf8 (text,
-		                                MIN (strlen (text), remaining_bytes),
+		if (text &&
+		    tracker_text_validate_utf8 (text,
+		                                MIN (strlen (text), te->n_bytes - string->len),
 		                                &string,
-		                                &written_bytes)) {
+		                                NULL)) {
 			g_string_append_c (string, ' ');
 		}
 
-		remaining_bytes -= written_bytes;
-
-		g_debug ("Extracted %" G_GSIZE_FORMAT " bytes from page %d, "
-		         "%" G_GSIZE_FORMAT " bytes remaining",
-		         written_bytes, i, remaining_bytes);
-
 		g_free (text);
 		g_object_unref (page);
 	}
 
-	if (elapsed >= EXTRACTION_PROCESS_TIMEOUT) {
+	return string;
+}
+
+/* Must be called with the mutex held */
+static void
+text_extraction_append (TextExtraction *te,
+                        gint            chunk,
+                        GString        *text)
+{
+	te->chunks[chunk] = text;
+
+	/* Appends all chunks whose previous ones are done */
+	while (te->n_appended < te->n_chunks && te->chunks[te->n_appended]) {
+		GString *next = te->chunks[te->n_appended];
+		gsize written_bytes = 0;
+
+		if (te->remaining_bytes > 0 && next->len > 0) {
+			tracker_text_validate_utf8 (next->str,
+			                            MIN (next->len, te->remaining_bytes),
+			                            &te->content,
+			                            &written_bytes);
+			te->remaining_bytes -= written_bytes;
+		}
+
+		g_string_free (next, TRUE);
+		te->chunks[te->n_appended] = NULL;
+		te->n_appended++;
+	}
+
+	g_cond_broadcast (&te->cond);
+}
+
+static void
+text_extraction_run (TextExtraction  *te,
+                     PopplerDocument *document)
+{
+	g_mutex_lock (&te->mutex);
+
+	while (te->next_chunk < te->n_chunks &&
+	       te->remaining_bytes > 0 &&
+	       !text_extraction_expired (te)) {
+		GString *text;
+		gint chunk;
+
+		/* Don't get too far ahead of the content, the
+		 * chunk being waited for is always in progress.
+		 */
+		if (te->next_chunk >= te->n_appended + MAX_CHUNKS_AHEAD) {
+			g_cond_wait (&te->cond, &te->mutex);
+			continue;
+		}
+
+		chunk = te->next_chunk++;
+		g_mutex_unlock (&te->mutex);
+
+		text = extract_chunk_text (te, document, chunk);
+
+		g_mutex_lock (&te->mutex);
+		text_extraction_append (te, chunk, text);
+	}
+
+	g_mutex_unlock (&te->mutex);
+}
+
+static gpointer
+text_extraction_thread_func (TextExtraction *te)
+{
+	PopplerDocument *document;
+
+	document = poppler_document_new_from_data (te->contents, te->len, NULL, NULL);
+
+	if (document) {
+		text_extraction_run (te, document);
+		g_object_unref (document);
+	}
+
+	return NULL;
+}
+
+static gchar *
+extract_content_text (PopplerDocument *document,
+                      gchar           *contents,
+                      gsize            len,
+                      gsize            n_bytes,
+                      GCancellable    *cancellable)
+{
+	TextExtraction te = { 0 };
+	GThread *threads[MAX_TEXT_THREADS - 1];
+	guint n_threads = 0, i;
+
+	te.n_pages = poppler_document_get_n_pages (document);
+
+	if (n_bytes == 0 || !document_has_fonts (document, te.n_pages)) {
+		g_debug ("Content extraction skipped, no text in document");
+		return NULL;
+	}
+
+	te.contents = contents;
+	te.len = len;
+	te.n_bytes = te.remaining_bytes = n_bytes;
+	te.cancellable = cancellable;
+	te.timer = g_timer_new ();
+	te.n_chunks = (te.n_pages + PAGES_PER_CHUNK - 1) / PAGES_PER_CHUNK;
+	te.chunks = g_new0 (GString *, te.n_chunks);
+	te.content = g_string_new ("");
+	g_mutex_init (&te.mutex);
+	g_cond_init (&te.cond);
+
+	if (te.n_pages >= PARALLEL_MIN_PAGES) {
+		n_threads = MIN (g_get_num_processors (), MAX_TEXT_THREADS) - 1;
+
+		for (i = 0; i < n_threads; i++) {
+			threads[i] = g_thread_try_new ("pdf-text",
+			                               (GThreadFunc) text_extraction_thread_func,
+			                               &te, NULL);
+
+			if (!threads[i]) {
+				n_threads = i;
+				break;
+			}
+		}
+	}
+
+	text_extraction_run (&te, document);
+
+	for (i = 0; i < n_threads; i++) {
+		g_thread_join (threads[i]);
+	}
+
+	if (g_timer_elapsed (te.timer, NULL) >= EXTRACTION_PROCESS_TIMEOUT) {
 		g_debug ("Extraction timed out, %d seconds reached", EXTRACTION_PROCESS_TIMEOUT);
+	} else if (g_cancellable_is_cancelled (cancellable)) {
+		g_debug ("Extraction deadline reached");
 	}
 
-	g_debug ("Content extraction finished: %d/%d pages indexed in %2.2f seconds, "
-	         "%" G_GSIZE_FORMAT " bytes extracted",
-	         i,
-	         n_pages,
-	         g_timer_elapsed (timer, NULL),
-	         (n_bytes - remaining_bytes));
+	g_debug ("Content extraction finished: %d/%d pages indexed in %2.2f seconds "
+	         "using %u threads, %" G_GSIZE_FORMAT " bytes extracted",
+	         MIN (te.n_appended * PAGES_PER_CHUNK, te.n_pages),
+	         te.n_pages,
+	         g_timer_elapsed (te.timer, NULL),
+	         n_threads + 1,
+	         n_bytes - te.remaining_bytes);
+
+	/* Chunks done after one that was not */
+	for (i = te.n_appended; i < (guint) te.n_chunks; i++) {
+		if (te.chunks[i]) {
+			g_string_free (te.chunks[i], TRUE);
+		}
+	}
 
-	g_timer_destroy (timer);
+	g_free (te.chunks);
+	g_mutex_clear (&te.mutex);
+	g_cond_clear (&te.cond);
+	g_timer_destroy (te.timer);
 
-	return g_string_free (string, FALSE);
+	return g_string_free (te.content, FALSE);
 }
 
 static void
@@ -735,7 +941,8 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 
 	config = tracker_main_get_config ();
 	n_bytes = tracker_config_get_max_bytes (config);
-	content = extract_content_text (document, n_bytes);
+	content = extract_content_text (document, contents, len, n_bytes,
+	                                tracker_extract_info_get_cancellable (info));
 
 	if (content) {
 		tracker_sparql_builder_predicate (metadata, "nie:plainTextContent");
@@ -743,7 +950,7 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 		g_free (content);
 	}
 
-	read_outline (document, metadata);
+	read_outline (document, metadata, n_bytes);
 
 	g_free (xml);
 	g_free (pd.keywords);
@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <png.h>
 
 #include <libtracker-common/tracker-file-utils.h>
@@ -29,6 +31,15 @@
 #define RFC1123_DATE_FORMAT "%d %B %Y %H:%M:%S %z"
 #define CM_TO_INCH          0.393700787
 
+#define PNG_SIGNATURE_SIZE      8
+#define PNG_CHUNK_HEADER_SIZE   8
+#define PNG_CHUNK_CRC_SIZE      4
+
+/* Ancillary chunks bigger than this are skipped, files with
+ * critical chunks bigger than this are not extracted.
+ */
+#define MAX_CHUNK_SIZE (16 * 1024 * 1024)
+
 typedef struct {
 	const gchar *title;
 	const gchar *copyright;
@@ -67,6 +78,11 @@ typedef struct {
 	const gchar *software;
 } PngData;
 
+typedef struct {
+	GByteArray *data;
+	gsize pos;
+} PngChunks;
+
 static gchar *
 rfc1123_to_iso8601_date (const gchar *date)
 {
@@ -188,7 +204,6 @@ read_metadata (TrackerSparqlBuilder *preupdate,
                GString              *where,
                png_structp           png_ptr,
                png_infop             info_ptr,
-               png_infop             end_ptr,
                const gchar          *uri,
                const gchar          *graph)
 {
@@ -196,144 +211,157 @@ read_metadata (TrackerSparqlBuilder *preupdate,
 	PngData pd = { 0 };
 	TrackerExifData *ed = NULL;
 	TrackerXmpData *xd = NULL;
-	png_infop info_ptrs[2];
 	png_textp text_ptr;
-	gint info_index;
 	gint num_text;
 	gint i;
 	gint found;
 	GPtrArray *keywords;
 
-	info_ptrs[0] = info_ptr;
-	info_ptrs[1] = end_ptr;
+	if ((found = png_get_text (png_ptr, info_ptr, &text_ptr, &num_text)) < 1) {
+		g_debug ("Calling png_get_text() returned %d (< 1)", found);
+		num_text = 0;
+	}
 
-	for (info_index = 0; info_index < 2; info_index++) {
-		if ((found = png_get_text (png_ptr, info_ptrs[info_index], &text_ptr, &num_text)) < 1) {
-			g_debug ("Calling png_get_text() returned %d (< 1)", found);
+	for (i = 0; i < num_text; i++) {
+		if (!text_ptr[i].key || !text_ptr[i].text || text_ptr[i].text[0] == '\0') {
 			continue;
 		}
 
-		for (i = 0; i < num_text; i++) {
-			if (!text_ptr[i].key || !text_ptr[i].text || text_ptr[i].text[0] == '\0') {
-				continue;
-			}
-
 #if defined(HAVE_EXEMPI) && defined(PNG_iTXt_SUPPORTED)
-			if (g_strcmp0 ("XML:com.adobe.xmp", text_ptr[i].key) == 0) {
-				/* ATM tracker_extract_xmp_read supports setting xd
-				 * multiple times, keep it that way as here it's
-				 * theoretically possible that the function gets
-				 * called multiple times
-				 */
-				xd = tracker_xmp_new (text_ptr[i].text,
-				                      text_ptr[i].itxt_length,
-				                      uri);
+		if (g_strcmp0 ("XML:com.adobe.xmp", text_ptr[i].key) == 0) {
+			/* ATM tracker_extract_xmp_read supports setting xd
+			 * multiple times, keep it that way as here it's
+			 * theoretically possible that the function gets
+			 * called multiple times
+			 */
+			xd = tracker_xmp_new (text_ptr[i].text,
+			                      text_ptr[i].itxt_length,
+			                      uri);
 
-				continue;
-			}
+			continue;
+		}
 
-			if (g_strcmp0 ("Raw profile type xmp", text_ptr[i].key) == 0) {
-				gchar *xmp_buffer;
-				guint xmp_buffer_length = 0;
-				guint input_len;
+		if (g_strcmp0 ("Raw profile type xmp", text_ptr[i].key) == 0) {
+			gchar *xmp_buffer;
+			guint xmp_buffer_length = 0;
+			guint input_len;
 
-				if (text_ptr[i].text_length) {
-					input_len = text_ptr[i].text_length;
-				} else {
-					input_len = text_ptr[i].itxt_length;
-				}
+			if (text_ptr[i].text_length) {
+				input_len = text_ptr[i].text_length;
+			} else {
+				input_len = text_ptr[i].itxt_length;
+			}
 
-				xmp_buffer = raw_profile_new (text_ptr[i].text,
-				                              input_len,
-				                              &xmp_buffer_length);
+			xmp_buffer = raw_profile_new (text_ptr[i].text,
+			                              input_len,
+			                              &xmp_buffer_length);
 
-				if (xmp_buffer) {
-					xd = tracker_xmp_new (xmp_buffer,
-					                      xmp_buffer_length,
-					                      uri);
-				}
+			if (xmp_buffer) {
+				xd = tracker_xmp_new (xmp_buffer,
+				                      xmp_buffer_length,
+				                      uri);
+			}
 
-				g_free (xmp_buffer);
+			g_free (xmp_buffer);
 
-				continue;
-			}
+			continue;
+		}
 #endif /*HAVE_EXEMPI && PNG_iTXt_SUPPORTED */
 
 #if defined(HAVE_LIBEXIF) && defined(PNG_iTXt_SUPPORTED)
-			if (g_strcmp0 ("Raw profile type exif", text_ptr[i].key) == 0) {
-				gchar *exif_buffer;
-				guint exif_buffer_length = 0;
-				guint input_len;
-
-				if (text_ptr[i].text_length) {
-					input_len = text_ptr[i].text_length;
-				} else {
-					input_len = text_ptr[i].itxt_length;
-				}
-
-				exif_buffer = raw_profile_new (text_ptr[i].text,
-				                               input_len,
-				                               &exif_buffer_length);
-
-				if (exif_buffer) {
-					ed = tracker_exif_new (exif_buffer,
-					                       exif_buffer_length,
-					                       uri);
-				}
-
-				g_free (exif_buffer);
-
-				continue;
+		if (g_strcmp0 ("Raw profile type exif", text_ptr[i].key) == 0) {
+			gchar *exif_buffer;
+			guint exif_buffer_length = 0;
+			guint input_len;
+
+			if (text_ptr[i].text_length) {
+				input_len = text_ptr[i].text_length;
+			} else {
+				input_len = text_ptr[i].itxt_length;
 			}
-#endif /* HAVE_LIBEXIF && PNG_iTXt_SUPPORTED */
 
-			if (g_strcmp0 (text_ptr[i].key, "Author") == 0) {
-				pd.author = text_ptr[i].text;
-				continue;
-			}
+			exif_buffer = raw_profile_new (text_ptr[i].text,
+			                               input_len,
+			                               &exif_buffer_length);
 
-			if (g_strcmp0 (text_ptr[i].key, "Creator") == 0) {
-				pd.creator = text_ptr[i].text;
-				continue;
+			if (exif_buffer) {
+				ed = tracker_exif_new (exif_buffer,
+				                       exif_buffer_length,
+				                       uri);
 			}
 
-			if (g_strcmp0 (text_ptr[i].key, "Description") == 0) {
-				pd.description = text_ptr[i].text;
-				continue;
-			}
+			g_free (exif_buffer);
 
-			if (g_strcmp0 (text_ptr[i].key, "Comment") == 0) {
-				pd.comment = text_ptr[i].text;
-				continue;
-			}
+			continue;
+		}
+#endif /* HAVE_LIBEXIF && PNG_iTXt_SUPPORTED */
 
-			if (g_strcmp0 (text_ptr[i].key, "Copyright") == 0) {
-				pd.copyright = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Author") == 0) {
+			pd.author = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Creation Time") == 0) {
-				pd.creation_time = rfc1123_to_iso8601_date (text_ptr[i].text);
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Creator") == 0) {
+			pd.creator = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Title") == 0) {
-				pd.title = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Description") == 0) {
+			pd.description = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Disclaimer") == 0) {
-				pd.disclaimer = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Comment") == 0) {
+			pd.comment = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0(text_ptr[i].key, "Software") == 0) {
-				pd.software = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Copyright") == 0) {
+			pd.copyright = text_ptr[i].text;
+			continue;
+		}
+
+		if (g_strcmp0 (text_ptr[i].key, "Creation Time") == 0) {
+			pd.creation_time = rfc1123_to_iso8601_date (text_ptr[i].text);
+			continue;
+		}
+
+		if (g_strcmp0 (text_ptr[i].key, "Title") == 0) {
+			pd.title = text_ptr[i].text;
+			continue;
+		}
+
+		if (g_strcmp0 (text_ptr[i].key, "Disclaimer") == 0) {
+			pd.disclaimer = text_ptr[i].text;
+			continue;
+		}
+
+		if (g_strcmp0(text_ptr[i].key, "Software") == 0) {
+			pd.software = text_ptr[i].text;
+			continue;
 		}
 	}
 
+#if defined(HAVE_LIBEXIF) && defined(PNG_eXIf_SUPPORTED)
+	if (!ed) {
+		png_uint_32 exif_length;
+		png_bytep exif;
+
+		if (png_get_eXIf_1 (png_ptr, info_ptr, &exif_length, &exif) != 0 &&
+		    exif_length > 0) {
+			GByteArray *exif_buffer;
+
+			/* libexif expects the header of the JPEG APP1 segment */
+			exif_buffer = g_byte_array_sized_new (exif_length + 6);
+			g_byte_array_append (exif_buffer, (const guint8 *) "Exif\0\0", 6);
+			g_byte_array_append (exif_buffer, exif, exif_length);
+
+			ed = tracker_exif_new (exif_buffer->data, exif_buffer->len, uri);
+			g_byte_array_unref (exif_buffer);
+		}
+	}
+#endif /* HAVE_LIBEXIF && PNG_eXIf_SUPPORTED */
+
 	if (!ed) {
 		ed = g_new0 (TrackerExifData, 1);
 	}
@@ -783,6 +811,119 @@ guess_dlna_profile (gint          depth,
 	return FALSE;
 }
 
+static gboolean
+chunk_is_metadata (const guchar *type)
+{
+	/* Ancillary chunks allowed after the image data */
+	return (memcmp (type, "tEXt", 4) == 0 ||
+	        memcmp (type, "zTXt", 4) == 0 ||
+	        memcmp (type, "iTXt", 4) == 0 ||
+	        memcmp (type, "tIME", 4) == 0 ||
+	        memcmp (type, "eXIf", 4) == 0);
+}
+
+/* Reads the chunks of a PNG file without the image data, so libpng
+ * finds all metadata without inflating the image. IDAT chunks are
+ * seeked over, and the metadata chunks after them are moved before
+ * an empty IDAT chunk, which is where png_read_info() stops reading.
+ * Chunks are copied verbatim, so their CRC is still checked.
+ */
+static GByteArray *
+read_chunks (FILE *f)
+{
+	guchar header[PNG_CHUNK_HEADER_SIZE];
+	static const guchar idat[] = { 0, 0, 0, 0, 'I', 'D', 'A', 'T' };
+	gboolean seen_idat = FALSE;
+	GByteArray *chunks;
+	png_uint_32 length;
+	gboolean copy;
+	guint len;
+
+	chunks = g_byte_array_new ();
+
+	if (fread (header, 1, PNG_SIGNATURE_SIZE, f) != PNG_SIGNATURE_SIZE ||
+	    png_sig_cmp (header, 0, PNG_SIGNATURE_SIZE) != 0) {
+		g_byte_array_unref (chunks);
+		return NULL;
+	}
+
+	g_byte_array_append (chunks, header, PNG_SIGNATURE_SIZE);
+
+	while (fread (header, 1, PNG_CHUNK_HEADER_SIZE, f) == PNG_CHUNK_HEADER_SIZE) {
+		length = ((png_uint_32) header[0] << 24 | (png_uint_32) header[1] << 16 |
+		          (png_uint_32) header[2] << 8 | (png_uint_32) header[3]);
+
+		if (length > PNG_UINT_31_MAX ||
+		    memcmp (&header[4], "IEND", 4) == 0) {
+			break;
+		}
+
+		if (memcmp (&header[4], "IDAT", 4) == 0) {
+			seen_idat = TRUE;
+			copy = FALSE;
+		} else if (g_ascii_isupper (header[4])) {
+			if (!seen_idat && length > MAX_CHUNK_SIZE) {
+				/* Can't be skipped, and it's no image
+				 * libpng would handle either.
+				 */
+				g_byte_array_unref (chunks);
+				return NULL;
+			}
+
+			/* Critical chunks are only meaningful before IDAT */
+			copy = !seen_idat;
+		} else {
+			copy = (length <= MAX_CHUNK_SIZE &&
+			        (!seen_idat || chunk_is_metadata (&header[4])));
+		}
+
+		if (!copy) {
+			if (fseeko (f, (off_t) length + PNG_CHUNK_CRC_SIZE, SEEK_CUR) != 0) {
+				break;
+			}
+
+			continue;
+		}
+
+		len = chunks->len;
+		g_byte_array_append (chunks, header, PNG_CHUNK_HEADER_SIZE);
+		g_byte_array_set_size (chunks, chunks->len + length + PNG_CHUNK_CRC_SIZE);
+
+		if (fread (&chunks->data[len + PNG_CHUNK_HEADER_SIZE], 1,
+		           length + PNG_CHUNK_CRC_SIZE, f) != length + PNG_CHUNK_CRC_SIZE) {
+			/* Truncated file, drop the incomplete chunk */
+			g_byte_array_set_size (chunks, len);
+			break;
+		}
+	}
+
+	if (!seen_idat) {
+		g_byte_array_unref (chunks);
+		return NULL;
+	}
+
+	g_byte_array_append (chunks, idat, sizeof (idat));
+
+	return chunks;
+}
+
+static void
+read_chunks_data (png_structp png_ptr,
+                  png_bytep   data,
+                  png_size_t  length)
+{
+	PngChunks *chunks;
+
+	chunks = png_get_io_ptr (png_ptr);
+
+	if (length > chunks->data->len - chunks->pos) {
+		png_error (png_ptr, "Read past the end of the chunks");
+	}
+
+	memcpy (data, &chunks->data->data[chunks->pos], length);
+	chunks->pos += length;
+}
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo *info)
 {
@@ -790,9 +931,7 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 	FILE *f;
 	png_structp png_ptr;
 	png_infop info_ptr;
-	png_infop end_ptr;
-	png_bytepp row_pointers;
-	guint row;
+	PngChunks chunks;
 	png_uint_32 width, height;
 	gint bit_depth, color_type;
 	gint interlace_type, compression_type, filter_type;
@@ -821,36 +960,37 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 		return FALSE;
 	}
 
+	chunks.data = read_chunks (f);
+	chunks.pos = 0;
+	tracker_file_close (f, FALSE);
+
+	if (!chunks.data) {
+		return FALSE;
+	}
+
 	png_ptr = png_create_read_struct (PNG_LIBPNG_VER_STRING,
 	                                  NULL,
 	                                  NULL,
 	                                  NULL);
 	if (!png_ptr) {
-		tracker_file_close (f, FALSE);
+		g_byte_array_unref (chunks.data);
 		return FALSE;
 	}
 
 	info_ptr = png_create_info_struct (png_ptr);
 	if (!info_ptr) {
 		png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
-		tracker_file_close (f, FALSE);
-		return FALSE;
-	}
-
-	end_ptr = png_create_info_struct (png_ptr);
-	if (!end_ptr) {
-		png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
-		tracker_file_close (f, FALSE);
+		g_byte_array_unref (chunks.data);
 		return FALSE;
 	}
 
 	if (setjmp (png_jmpbuf (png_ptr))) {
-		png_destroy_read_struct (&png_ptr, &info_ptr, &end_ptr);
-		tracker_file_close (f, FALSE);
+		png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
+		g_byte_array_unref (chunks.data);
 		return FALSE;
 	}
 
-	png_init_io (png_ptr, f);
+	png_set_read_fn (png_ptr, &chunks, read_chunks_data);
 	png_read_info (png_ptr, info_ptr);
 
 	if (!png_get_IHDR (png_ptr,
@@ -862,31 +1002,11 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 	                   &interlace_type,
 	                   &compression_type,
 	                   &filter_type)) {
-		png_destroy_read_struct (&png_ptr, &info_ptr, &end_ptr);
-		tracker_file_close (f, FALSE);
+		png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
+		g_byte_array_unref (chunks.data);
 		return FALSE;
 	}
 
-	/* Read the image. FIXME We should be able to skip this step and
-	 * just get the info from the end. This causes some errors atm.
-	 */
-	row_pointers = g_new0 (png_bytep, height);
-
-	for (row = 0; row < height; row++) {
-		row_pointers[row] = png_malloc (png_ptr,
-		                                png_get_rowbytes (png_ptr,info_ptr));
-	}
-
-	png_read_image (png_ptr, row_pointers);
-
-	for (row = 0; row < height; row++) {
-		png_free (png_ptr, row_pointers[row]);
-	}
-
-	g_free (row_pointers);
-
-	png_read_end (png_ptr, end_ptr);
-
 	tracker_sparql_builder_predicate (metadata, "a");
 	tracker_sparql_builder_object (metadata, "nfo:Image");
 	tracker_sparql_builder_object (metadata, "nmm:Photo");
@@ -894,7 +1014,7 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 	uri = g_file_get_uri (file);
 	where = g_string_new ("");
 
-	read_metadata (preupdate, metadata, where, png_ptr, info_ptr, end_ptr, uri, graph);
+	read_metadata (preupdate, metadata, where, png_ptr, info_ptr, uri, graph);
 	tracker_extract_info_set_where_clause (info, where->str);
 	g_string_free (where, TRUE);
 	g_free (uri);
@@ -912,8 +1032,8 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 		tracker_sparql_builder_object_string (metadata, dlna_mimetype);
 	}
 
-	png_destroy_read_struct (&png_ptr, &info_ptr, &end_ptr);
-	tracker_file_close (f, FALSE);
+	png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
+	g_byte_array_unref (chunks.data);
 
 	return TRUE;
 }
@@ -0,0 +1,1057 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include <glib/gstdio.h>
+#include <glib-unix.h>
+
+#include <libtracker-common/tracker-common.h>
+#include <libtracker-extract/tracker-extract.h>
+
+#include "tracker-extract-worker.h"
+#include "tracker-extract-channel.h"
+
+/* Extractors run in long lived worker processes, which the extractor
+ * process supervises. Each worker extracts one file at a time, so if
+ * a worker crashes or hangs, the file it was working on is known for
+ * sure. That file is blacklisted so it's not tried again until it
+ * changes, and only that worker is restarted.
+ */
+
+/* Seconds a worker is given to extract a file before it is killed */
+#define EXTRACT_WORKER_TIMEOUT 30
+
+/* Seconds given on top of module deadlines, so modules have time
+ * to return their partial results before the worker is killed.
+ */
+#define EXTRACT_WORKER_GRACE_PERIOD 15
+
+/* Milliseconds to wait before restarting workers that keep failing */
+#define RESPAWN_MIN_DELAY 100
+#define RESPAWN_MAX_DELAY 10000
+
+/* Timeouts on a file before it is blacklisted, a single
+ * timeout may just be the result of a loaded system.
+ */
+#define MAX_TIMEOUTS 2
+
+/* uri, mimetype, graph */
+#define REQUEST_TYPE G_VARIANT_TYPE ("(ayayay)")
+/* success, error message, mimetype, preupdate, metadata, postupdate, where clause */
+#define REPLY_TYPE G_VARIANT_TYPE ("(bayayayayayay)")
+
+typedef struct {
+	gchar *uri;
+	gchar *mimetype;
+	gchar *graph;
+	GCancellable *cancellable;
+	GSimpleAsyncResult *res;
+} WorkerRequest;
+
+/* The file is identified by its mtime and size too, so it
+ * is tried again if it changes.
+ */
+typedef struct {
+	guint64 mtime;
+	guint64 size;
+	guint n_crashes;
+	guint n_timeouts;
+} BlacklistEntry;
+
+typedef struct {
+	TrackerExtractWorkerPool *pool;
+	TrackerExtractChannel *channel;
+	GPid pid;
+
+	guint child_watch_id;
+	guint fd_watch_id;
+	guint timeout_id;
+	guint respawn_id;
+
+	/* The file being extracted, and the seconds it's given */
+	WorkerRequest *request;
+	guint timeout;
+
+	guint n_failures;
+	guint timed_out : 1;
+} Worker;
+
+struct _TrackerExtractWorkerPool {
+	GPtrArray *workers;
+	GQueue requests;
+
+	/* URI -> BlacklistEntry, files that made a worker crash or hang */
+	GHashTable *blacklist;
+	gchar *blacklist_path;
+
+	gchar **argv;
+};
+
+typedef struct {
+	gint memory_fd;
+	gint socket_fd;
+} ChildSetupData;
+
+static gboolean worker_start (Worker  *worker,
+                              GError **error);
+static void     pool_dispatch (TrackerExtractWorkerPool *pool);
+
+static void
+worker_request_free (WorkerRequest *request)
+{
+	if (request->cancellable) {
+		g_object_unref (request->cancellable);
+	}
+
+	g_object_unref (request->res);
+	g_free (request->uri);
+	g_free (request->mimetype);
+	g_free (request->graph);
+	g_slice_free (WorkerRequest, request);
+}
+
+static void
+worker_request_fail (WorkerRequest *request,
+                     const gchar   *format,
+                     ...)
+{
+	gchar *message;
+	va_list args;
+
+	va_start (args, format);
+	message = g_strdup_vprintf (format, args);
+	va_end (args);
+
+	g_simple_async_result_set_error (request->res,
+	                                 TRACKER_DBUS_ERROR, 0,
+	                                 "%s", message);
+	g_simple_async_result_complete_in_idle (request->res);
+	worker_request_free (request);
+	g_free (message);
+}
+
+static gboolean
+get_file_stamp (const gchar *uri,
+                guint64     *mtime,
+                guint64     *size)
+{
+	GStatBuf st;
+	gchar *path;
+	gint retval;
+
+	path = g_filename_from_uri (uri, NULL, NULL);
+
+	if (!path) {
+		return FALSE;
+	}
+
+	retval = g_stat (path, &st);
+	g_free (path);
+
+	if (retval != 0) {
+		return FALSE;
+	}
+
+	*mtime = (guint64) st.st_mtime;
+	*size = (guint64) st.st_size;
+
+	return TRUE;
+}
+
+static void
+blacklist_entry_free (BlacklistEntry *entry)
+{
+	g_slice_free (BlacklistEntry, entry);
+}
+
+static gboolean
+blacklist_entry_is_current (BlacklistEntry *entry,
+                            const gchar    *uri)
+{
+	guint64 mtime, size;
+
+	return (get_file_stamp (uri, &mtime, &size) &&
+	        mtime == entry->mtime &&
+	        size == entry->size);
+}
+
+static void
+pool_save_blacklist (TrackerExtractWorkerPool *pool)
+{
+	BlacklistEntry *entry;
+	GHashTableIter iter;
+	GError *error = NULL;
+	GString *contents;
+	gchar *dirname;
+	gchar *uri;
+
+	contents = g_string_new (NULL);
+	g_hash_table_iter_init (&iter, pool->blacklist);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *) &uri, (gpointer *) &entry)) {
+		g_string_append_printf (contents,
+		                        "%" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %u %u %s\n",
+		                        entry->mtime, entry->size,
+		                        entry->n_crashes, entry->n_timeouts, uri);
+	}
+
+	dirname = g_path_get_dirname (pool->blacklist_path);
+	g_mkdir_with_parents (dirname, 0700);
+	g_free (dirname);
+
+	if (!g_file_set_contents (pool->blacklist_path, contents->str,
+	                          contents->len, &error)) {
+		g_warning ("Could not save blacklist '%s': %s",
+		           pool->blacklist_path, error->message);
+		g_error_free (error);
+	}
+
+	g_string_free (contents, TRUE);
+}
+
+/* Entries for files that changed or went away are dropped */
+static void
+pool_load_blacklist (TrackerExtractWorkerPool *pool)
+{
+	gchar *contents, **lines;
+	gboolean changed = FALSE;
+	gint i;
+
+	if (!g_file_get_contents (pool->blacklist_path, &contents, NULL, NULL)) {
+		return;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+
+	for (i = 0; lines[i]; i++) {
+		BlacklistEntry *entry;
+		gchar **fields;
+
+		if (!*lines[i]) {
+			continue;
+		}
+
+		fields = g_strsplit (lines[i], " ", 5);
+
+		if (g_strv_length (fields) != 5) {
+			changed = TRUE;
+			g_strfreev (fields);
+			continue;
+		}
+
+		entry = g_slice_new0 (BlacklistEntry);
+		entry->mtime = g_ascii_strtoull (fields[0], NULL, 10);
+		entry->size = g_ascii_strtoull (fields[1], NULL, 10);
+		entry->n_crashes = (guint) g_ascii_strtoull (fields[2], NULL, 10);
+		entry->n_timeouts = (guint) g_ascii_strtoull (fields[3], NULL, 10);
+
+		if (blacklist_entry_is_current (entry, fields[4])) {
+			g_hash_table_insert (pool->blacklist,
+			                     g_strdup (fields[4]), entry);
+		} else {
+			blacklist_entry_free (entry);
+			changed = TRUE;
+		}
+
+		g_strfreev (fields);
+	}
+
+	g_strfreev (lines);
+	g_free (contents);
+
+	if (changed) {
+		pool_save_blacklist (pool);
+	}
+}
+
+static void
+pool_blacklist_add (TrackerExtractWorkerPool *pool,
+                    const gchar              *uri,
+                    gboolean                  timed_out)
+{
+	BlacklistEntry *entry;
+	guint64 mtime, size;
+
+	if (!get_file_stamp (uri, &mtime, &size)) {
+		/* The file is gone, nothing to blacklist */
+		return;
+	}
+
+	entry = g_hash_table_lookup (pool->blacklist, uri);
+
+	if (!entry) {
+		entry = g_slice_new0 (BlacklistEntry);
+		g_hash_table_insert (pool->blacklist, g_strdup (uri), entry);
+	} else if (entry->mtime != mtime || entry->size != size) {
+		/* Failures on earlier versions of the file don't count */
+		entry->n_crashes = entry->n_timeouts = 0;
+	}
+
+	entry->mtime = mtime;
+	entry->size = size;
+
+	if (timed_out) {
+		entry->n_timeouts++;
+	} else {
+		entry->n_crashes++;
+	}
+
+	pool_save_blacklist (pool);
+}
+
+static gboolean
+pool_is_blacklisted (TrackerExtractWorkerPool *pool,
+                     const gchar              *uri)
+{
+	BlacklistEntry *entry;
+
+	entry = g_hash_table_lookup (pool->blacklist, uri);
+
+	if (!entry) {
+		return FALSE;
+	}
+
+	if (!blacklist_entry_is_current (entry, uri)) {
+		/* The file changed, give it another chance */
+		g_hash_table_remove (pool->blacklist, uri);
+		pool_save_blacklist (pool);
+		return FALSE;
+	}
+
+	return entry->n_crashes > 0 || entry->n_timeouts >= MAX_TIMEOUTS;
+}
+
+/* Runs in the child between fork() and exec(), so only
+ * async-signal-safe functions may be called here.
+ */
+static void
+worker_child_setup (gpointer user_data)
+{
+	ChildSetupData *data = user_data;
+	gint memory_fd, socket_fd;
+
+	/* Move the descriptors out of the way first, in case these
+	 * already are the ones expected. dup2() also clears the
+	 * close-on-exec flag GLib sets on every other descriptor.
+	 */
+	memory_fd = fcntl (data->memory_fd, F_DUPFD, 10);
+	socket_fd = fcntl (data->socket_fd, F_DUPFD, 10);
+
+	if (memory_fd < 0 || socket_fd < 0 ||
+	    dup2 (memory_fd, TRACKER_EXTRACT_WORKER_MEMORY_FD) < 0 ||
+	    dup2 (socket_fd, TRACKER_EXTRACT_WORKER_SOCKET_FD) < 0) {
+		_exit (EXIT_FAILURE);
+	}
+
+	close (memory_fd);
+	close (socket_fd);
+
+#ifdef __linux__
+	/* Workers must not outlive the extractor */
+	prctl (PR_SET_PDEATHSIG, SIGKILL);
+
+#ifdef PR_SET_NO_NEW_PRIVS
+	/* Nor gain any privileges through setuid executables */
+	prctl (PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
+#endif
+#endif /* __linux__ */
+}
+
+static void
+worker_stop (Worker *worker)
+{
+	if (worker->fd_watch_id) {
+		g_source_remove (worker->fd_watch_id);
+		worker->fd_watch_id = 0;
+	}
+
+	if (worker->timeout_id) {
+		g_source_remove (worker->timeout_id);
+		worker->timeout_id = 0;
+	}
+
+	if (worker->child_watch_id) {
+		g_source_remove (worker->child_watch_id);
+		worker->child_watch_id = 0;
+	}
+
+	if (worker->channel) {
+		tracker_extract_channel_free (worker->channel);
+		worker->channel = NULL;
+	}
+
+	if (worker->pid) {
+		g_spawn_close_pid (worker->pid);
+		worker->pid = 0;
+	}
+
+	worker->timed_out = FALSE;
+}
+
+static void
+worker_handle_reply (Worker   *worker,
+                     GVariant *reply)
+{
+	WorkerRequest *request;
+	const gchar *message, *mimetype, *preupdate, *metadata, *postupdate, *where;
+	gboolean success;
+
+	request = worker->request;
+	worker->request = NULL;
+
+	if (worker->timeout_id) {
+		g_source_remove (worker->timeout_id);
+		worker->timeout_id = 0;
+	}
+
+	/* The worker is in working order */
+	worker->n_failures = 0;
+
+	if (!request) {
+		g_warning ("Unexpected reply from worker %d, ignoring",
+		           (gint) worker->pid);
+		return;
+	}
+
+	g_variant_get (reply, "(b^&ay^&ay^&ay^&ay^&ay^&ay)",
+	               &success, &message, &mimetype,
+	               &preupdate, &metadata, &postupdate, &where);
+
+	if (success) {
+		TrackerExtractInfo *info;
+		GFile *file;
+
+		file = g_file_new_for_uri (request->uri);
+		info = tracker_extract_info_new (file, mimetype, request->graph);
+		g_object_unref (file);
+
+		tracker_sparql_builder_append (tracker_extract_info_get_preupdate_builder (info),
+		                               preupdate);
+		tracker_sparql_builder_append (tracker_extract_info_get_metadata_builder (info),
+		                               metadata);
+		tracker_sparql_builder_append (tracker_extract_info_get_postupdate_builder (info),
+		                               postupdate);
+
+		if (*where) {
+			tracker_extract_info_set_where_clause (info, where);
+		}
+
+		g_simple_async_result_set_op_res_gpointer (request->res,
+		                                           info,
+		                                           (GDestroyNotify) tracker_extract_info_unref);
+		g_simple_async_result_complete_in_idle (request->res);
+		worker_request_free (request);
+	} else {
+		worker_request_fail (request, "%s", message);
+	}
+}
+
+/* Returns FALSE if the channel is broken */
+static gboolean
+worker_receive_replies (Worker *worker)
+{
+	GVariant *reply;
+	GError *error = NULL;
+
+	while ((reply = tracker_extract_channel_receive (worker->channel,
+	                                                 REPLY_TYPE,
+	                                                 &error)) != NULL) {
+		worker_handle_reply (worker, reply);
+		g_variant_unref (reply);
+	}
+
+	if (error) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CLOSED)) {
+			g_warning ("Could not read from worker %d: %s",
+			           (gint) worker->pid, error->message);
+		}
+
+		g_error_free (error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+worker_channel_cb (gint         fd,
+                   GIOCondition condition,
+                   gpointer     user_data)
+{
+	Worker *worker = user_data;
+
+	if (!worker_receive_replies (worker)) {
+		/* The child watch takes care of the rest */
+		kill (worker->pid, SIGKILL);
+		worker->fd_watch_id = 0;
+		return FALSE;
+	}
+
+	pool_dispatch (worker->pool);
+
+	return TRUE;
+}
+
+static gboolean
+worker_timeout_cb (gpointer user_data)
+{
+	Worker *worker = user_data;
+
+	g_warning ("Worker %d took more than %u seconds extracting '%s', killing it",
+	           (gint) worker->pid, worker->timeout,
+	           worker->request->uri);
+
+	worker->timed_out = TRUE;
+	worker->timeout_id = 0;
+	kill (worker->pid, SIGKILL);
+
+	return FALSE;
+}
+
+static gboolean
+worker_respawn_cb (gpointer user_data)
+{
+	Worker *worker = user_data;
+	GError *error = NULL;
+
+	worker->respawn_id = 0;
+
+	if (!worker_start (worker, &error)) {
+		g_warning ("Could not restart worker: %s", error->message);
+		g_error_free (error);
+	}
+
+	pool_dispatch (worker->pool);
+
+	return FALSE;
+}
+
+static void
+worker_schedule_respawn (Worker *worker)
+{
+	guint delay;
+
+	if (worker->n_failures <= 1) {
+		/* Crashes are expected every now and then, restart
+		 * right away unless the worker is unable to start.
+		 */
+		worker->respawn_id = g_idle_add (worker_respawn_cb, worker);
+		return;
+	}
+
+	delay = RESPAWN_MIN_DELAY << MIN (worker->n_failures - 2, 10);
+	worker->respawn_id = g_timeout_add (MIN (delay, RESPAWN_MAX_DELAY),
+	                                    worker_respawn_cb, worker);
+}
+
+static void
+worker_exited_cb (GPid     pid,
+                  gint     status,
+                  gpointer user_data)
+{
+	Worker *worker = user_data;
+	WorkerRequest *request;
+
+	worker->child_watch_id = 0;
+
+	/* A reply might have been sent right before exiting */
+	if (worker->fd_watch_id) {
+		worker_receive_replies (worker);
+	}
+
+	request = worker->request;
+	worker->request = NULL;
+
+	if (request) {
+		const gchar *reason;
+
+		reason = worker->timed_out ? "hung" : "crashed";
+
+		g_warning ("Worker %d %s while extracting '%s'",
+		           (gint) pid, reason, request->uri);
+
+		pool_blacklist_add (worker->pool, request->uri, worker->timed_out);
+		worker_request_fail (request,
+		                     "Extraction of '%s' %s the worker process",
+		                     request->uri, reason);
+	} else {
+		g_warning ("Worker %d exited unexpectedly", (gint) pid);
+	}
+
+	worker_stop (worker);
+	worker->n_failures++;
+	worker_schedule_respawn (worker);
+}
+
+static gboolean
+worker_start (Worker  *worker,
+              GError **error)
+{
+	ChildSetupData data;
+	gboolean success;
+
+	worker->channel = tracker_extract_channel_new (&data.memory_fd,
+	                                               &data.socket_fd,
+	                                               error);
+
+	if (!worker->channel) {
+		worker->n_failures++;
+		worker_schedule_respawn (worker);
+		return FALSE;
+	}
+
+	success = g_spawn_async (NULL,
+	                         worker->pool->argv,
+	                         NULL,
+	                         G_SPAWN_DO_NOT_REAP_CHILD,
+	                         worker_child_setup,
+	                         &data,
+	                         &worker->pid,
+	                         error);
+
+	/* The worker has its own copies */
+	close (data.memory_fd);
+	close (data.socket_fd);
+
+	if (!success) {
+		worker_stop (worker);
+		worker->n_failures++;
+		worker_schedule_respawn (worker);
+		return FALSE;
+	}
+
+	g_debug ("Started worker %d", (gint) worker->pid);
+
+	worker->child_watch_id = g_child_watch_add (worker->pid,
+	                                            worker_exited_cb,
+	                                            worker);
+	worker->fd_watch_id = g_unix_fd_add (tracker_extract_channel_get_fd (worker->channel),
+	                                     G_IO_IN | G_IO_HUP | G_IO_ERR,
+	                                     worker_channel_cb,
+	                                     worker);
+	return TRUE;
+}
+
+static void
+worker_free (Worker *worker)
+{
+	GPid pid;
+
+	if (worker->respawn_id) {
+		g_source_remove (worker->respawn_id);
+	}
+
+	pid = worker->pid;
+
+	if (pid) {
+		kill (pid, SIGKILL);
+	}
+
+	/* Keeps the pid, so it can be reaped below */
+	worker->pid = 0;
+	worker_stop (worker);
+
+	if (pid) {
+		waitpid (pid, NULL, 0);
+		g_spawn_close_pid (pid);
+	}
+
+	if (worker->request) {
+		worker_request_free (worker->request);
+	}
+
+	g_slice_free (Worker, worker);
+}
+
+/* Modules with a deadline may use it all, and then the next
+ * modules handling the mimetype may be tried too. Only rules
+ * are looked at, modules are loaded by the workers alone.
+ */
+static guint
+request_get_timeout (WorkerRequest *request)
+{
+	guint timeout;
+
+	if (!request->mimetype) {
+		return EXTRACT_WORKER_TIMEOUT;
+	}
+
+	timeout = tracker_extract_module_manager_get_timeout (request->mimetype);
+
+	if (timeout == 0) {
+		return EXTRACT_WORKER_TIMEOUT;
+	}
+
+	return MAX (timeout + EXTRACT_WORKER_GRACE_PERIOD, EXTRACT_WORKER_TIMEOUT);
+}
+
+static void
+worker_send_request (Worker        *worker,
+                     WorkerRequest *request)
+{
+	GVariant *message;
+	GError *error = NULL;
+
+	message = g_variant_new ("(^ay^ay^ay)",
+	                         request->uri,
+	                         request->mimetype ? request->mimetype : "",
+	                         request->graph ? request->graph : "");
+	g_variant_ref_sink (message);
+
+	if (!tracker_extract_channel_send (worker->channel, message, FALSE, &error)) {
+		worker_request_fail (request,
+		                     "Could not send '%s' to worker: %s",
+		                     request->uri, error->message);
+		g_error_free (error);
+	} else {
+		worker->request = request;
+		worker->timeout = request_get_timeout (request);
+		worker->timeout_id = g_timeout_add_seconds (worker->timeout,
+		                                            worker_timeout_cb,
+		                                            worker);
+	}
+
+	g_variant_unref (message);
+}
+
+static void
+pool_dispatch (TrackerExtractWorkerPool *pool)
+{
+	WorkerRequest *request;
+	Worker *worker;
+	guint i;
+
+	for (i = 0; i < pool->workers->len; i++) {
+		worker = g_ptr_array_index (pool->workers, i);
+
+		/* Only one file at a time, so crashes can be blamed */
+		if (!worker->fd_watch_id || worker->request) {
+			continue;
+		}
+
+		while (!worker->request &&
+		       (request = g_queue_pop_head (&pool->requests)) != NULL) {
+			if (request->cancellable &&
+			    g_cancellable_is_cancelled (request->cancellable)) {
+				worker_request_fail (request,
+				                     "Extraction of '%s' was cancelled",
+				                     request->uri);
+				continue;
+			}
+
+			worker_send_request (worker, request);
+		}
+
+		if (g_queue_is_empty (&pool->requests)) {
+			break;
+		}
+	}
+}
+
+static gchar *
+get_executable_path (void)
+{
+	gchar *path;
+
+	/* Workers are the very same binary */
+	path = g_file_read_link ("/proc/self/exe", NULL);
+
+	if (!path) {
+		path = g_build_filename (LIBEXECDIR, "tracker-extract", NULL);
+	}
+
+	return path;
+}
+
+/**
+ * tracker_extract_worker_pool_new:
+ * @n_workers: number of worker processes to run
+ * @worker_args: (allow-none): arguments to pass to the workers
+ * @error: return location for a #GError
+ *
+ * Starts @n_workers worker processes. Their command line is made of
+ * @worker_args, these must include the option that makes the process
+ * call tracker_extract_worker_run().
+ *
+ * Returns: a new #TrackerExtractWorkerPool, or %NULL on error.
+ **/
+TrackerExtractWorkerPool *
+tracker_extract_worker_pool_new (guint                n_workers,
+                                 const gchar * const *worker_args,
+                                 GError             **error)
+{
+	TrackerExtractWorkerPool *pool;
+	GPtrArray *argv;
+	guint i;
+
+	g_return_val_if_fail (n_workers > 0, NULL);
+
+	pool = g_slice_new0 (TrackerExtractWorkerPool);
+	pool->workers = g_ptr_array_new_with_free_func ((GDestroyNotify) worker_free);
+	g_queue_init (&pool->requests);
+
+	pool->blacklist = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                         (GDestroyNotify) blacklist_entry_free);
+	pool->blacklist_path = g_build_filename (g_get_user_cache_dir (),
+	                                         "tracker",
+	                                         "extract-blacklist",
+	                                         NULL);
+	pool_load_blacklist (pool);
+
+	argv = g_ptr_array_new ();
+	g_ptr_array_add (argv, get_executable_path ());
+
+	for (i = 0; worker_args && worker_args[i]; i++) {
+		g_ptr_array_add (argv, g_strdup (worker_args[i]));
+	}
+
+	g_ptr_array_add (argv, NULL);
+	pool->argv = (gchar **) g_ptr_array_free (argv, FALSE);
+
+	for (i = 0; i < n_workers; i++) {
+		Worker *worker;
+
+		worker = g_slice_new0 (Worker);
+		worker->pool = pool;
+		g_ptr_array_add (pool->workers, worker);
+
+		if (!worker_start (worker, error)) {
+			tracker_extract_worker_pool_free (pool);
+			return NULL;
+		}
+	}
+
+	g_message ("Started %u extractor worker processes, %u files blacklisted",
+	           n_workers, g_hash_table_size (pool->blacklist));
+
+	return pool;
+}
+
+/**
+ * tracker_extract_worker_pool_free:
+ * @pool: a #TrackerExtractWorkerPool
+ *
+ * Kills all worker processes and frees @pool.
+ **/
+void
+tracker_extract_worker_pool_free (TrackerExtractWorkerPool *pool)
+{
+	g_return_if_fail (pool != NULL);
+
+	g_ptr_array_unref (pool->workers);
+	g_queue_foreach (&pool->requests, (GFunc) worker_request_free, NULL);
+	g_queue_clear (&pool->requests);
+
+	g_hash_table_unref (pool->blacklist);
+	g_free (pool->blacklist_path);
+	g_strfreev (pool->argv);
+
+	g_slice_free (TrackerExtractWorkerPool, pool);
+}
+
+/**
+ * tracker_extract_worker_pool_extract:
+ * @pool: a #TrackerExtractWorkerPool
+ * @uri: URI of the file to extract
+ * @mimetype: (allow-none): mimetype of the file
+ * @graph: (allow-none): graph to insert the metadata into
+ * @cancellable: (allow-none): a #GCancellable
+ * @res: result to complete with a #TrackerExtractInfo
+ *
+ * Queues @uri for extraction in the first available worker, files
+ * blacklisted after crashing or hanging a worker fail right away.
+ * Cancelling @cancellable only has effect on files not yet handed
+ * to a worker.
+ **/
+void
+tracker_extract_worker_pool_extract (TrackerExtractWorkerPool *pool,
+                                     const gchar              *uri,
+                                     const gchar              *mimetype,
+                                     const gchar              *graph,
+                                     GCancellable             *cancellable,
+                                     GSimpleAsyncResult       *res)
+{
+	WorkerRequest *request;
+
+	g_return_if_fail (pool != NULL);
+	g_return_if_fail (uri != NULL);
+
+	request = g_slice_new0 (WorkerRequest);
+	request->uri = g_strdup (uri);
+	request->mimetype = g_strdup (mimetype);
+	request->graph = g_strdup (graph);
+	request->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	request->res = g_object_ref (res);
+
+	if (pool_is_blacklisted (pool, uri)) {
+		worker_request_fail (request,
+		                     "Extraction of '%s' was skipped, it made a worker fail before",
+		                     uri);
+		return;
+	}
+
+	g_queue_push_tail (&pool->requests, request);
+	pool_dispatch (pool);
+}
+
+/* Worker side */
+
+typedef struct {
+	TrackerExtract *extract;
+	TrackerExtractChannel *channel;
+	GMainLoop *main_loop;
+	guint watch_id;
+} WorkerData;
+
+static void
+worker_extract_cb (GObject      *object,
+                   GAsyncResult *res,
+                   gpointer      user_data)
+{
+	WorkerData *data = user_data;
+	TrackerExtractInfo *info;
+	GVariant *reply;
+	GError *error = NULL;
+
+	info = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (res));
+
+	if (info) {
+		const gchar *where;
+
+		where = tracker_extract_info_get_where_clause (info);
+		reply = g_variant_new ("(b^ay^ay^ay^ay^ay^ay)", TRUE, "",
+		                       tracker_extract_info_get_mimetype (info),
+		                       tracker_sparql_builder_get_result (tracker_extract_info_get_preupdate_builder (info)),
+		                       tracker_sparql_builder_get_result (tracker_extract_info_get_metadata_builder (info)),
+		                       tracker_sparql_builder_get_result (tracker_extract_info_get_postupdate_builder (info)),
+		                       where ? where : "");
+	} else {
+		g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (res), &error);
+		reply = g_variant_new ("(b^ay^ay^ay^ay^ay^ay)", FALSE,
+		                       error ? error->message : "No metadata extracted",
+		                       "", "", "", "", "");
+		g_clear_error (&error);
+	}
+
+	g_variant_ref_sink (reply);
+
+	if (!tracker_extract_channel_send (data->channel, reply, TRUE, &error)) {
+		g_critical ("Could not send reply to the extractor: %s", error->message);
+		g_error_free (error);
+		g_main_loop_quit (data->main_loop);
+	}
+
+	g_variant_unref (reply);
+}
+
+static gboolean
+worker_request_cb (gint         fd,
+                   GIOCondition condition,
+                   gpointer     user_data)
+{
+	WorkerData *data = user_data;
+	const gchar *uri, *mimetype, *graph;
+	GVariant *request;
+	GError *error = NULL;
+
+	while ((request = tracker_extract_channel_receive (data->channel,
+	                                                   REQUEST_TYPE,
+	                                                   &error)) != NULL) {
+		g_variant_get (request, "(^&ay^&ay^&ay)", &uri, &mimetype, &graph);
+
+		tracker_extract_file (data->extract, uri,
+		                      *mimetype ? mimetype : NULL,
+		                      *graph ? graph : NULL,
+		                      NULL,
+		                      worker_extract_cb,
+		                      data);
+
+		g_variant_unref (request);
+	}
+
+	if (error) {
+		/* The extractor went away */
+		g_error_free (error);
+		g_main_loop_quit (data->main_loop);
+		data->watch_id = 0;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * tracker_extract_worker_run:
+ * @extract: a #TrackerExtract
+ *
+ * Runs the worker side, extracting the files requested by the
+ * extractor process through the inherited file descriptors,
+ * until the extractor goes away.
+ *
+ * Returns: the process exit status.
+ **/
+gint
+tracker_extract_worker_run (TrackerExtract *extract)
+{
+	WorkerData data;
+	GError *error = NULL;
+
+	g_return_val_if_fail (TRACKER_IS_EXTRACT (extract), EXIT_FAILURE);
+
+	data.extract = extract;
+	data.channel = tracker_extract_channel_new_for_fds (TRACKER_EXTRACT_WORKER_MEMORY_FD,
+	                                                    TRACKER_EXTRACT_WORKER_SOCKET_FD,
+	                                                    &error);
+
+	if (!data.channel) {
+		g_critical ("Could not set up worker channel: %s", error->message);
+		g_error_free (error);
+		return EXIT_FAILURE;
+	}
+
+	data.main_loop = g_main_loop_new (NULL, FALSE);
+	data.watch_id = g_unix_fd_add (tracker_extract_channel_get_fd (data.channel),
+	                               G_IO_IN | G_IO_HUP | G_IO_ERR,
+	                               worker_request_cb,
+	                               &data);
+
+	g_main_loop_run (data.main_loop);
+
+	if (data.watch_id) {
+		g_source_remove (data.watch_id);
+	}
+
+	g_main_loop_unref (data.main_loop);
+	tracker_extract_channel_free (data.channel);
+
+	return EXIT_SUCCESS;
+}
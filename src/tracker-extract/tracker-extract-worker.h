@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_EXTRACT_WORKER_H__
+#define __TRACKER_EXTRACT_WORKER_H__
+
+#include <gio/gio.h>
+
+#include "tracker-extract.h"
+
+G_BEGIN_DECLS
+
+/* File descriptors the channel is handed on in worker processes */
+#define TRACKER_EXTRACT_WORKER_MEMORY_FD 3
+#define TRACKER_EXTRACT_WORKER_SOCKET_FD 4
+
+typedef struct _TrackerExtractWorkerPool TrackerExtractWorkerPool;
+
+TrackerExtractWorkerPool *tracker_extract_worker_pool_new     (guint                      n_workers,
+                                                               const gchar * const       *worker_args,
+                                                               GError                   **error);
+void                      tracker_extract_worker_pool_free    (TrackerExtractWorkerPool  *pool);
+
+void                      tracker_extract_worker_pool_extract (TrackerExtractWorkerPool  *pool,
+                                                               const gchar               *uri,
+                                                               const gchar               *mimetype,
+                                                               const gchar               *graph,
+                                                               GCancellable              *cancellable,
+                                                               GSimpleAsyncResult        *res);
+
+gint                      tracker_extract_worker_run          (TrackerExtract            *extract);
+
+G_END_DECLS
+
+#endif /* __TRACKER_EXTRACT_WORKER_H__ */
@@ -35,6 +35,7 @@
 #include <libtracker-extract/tracker-extract.h>
 
 #include "tracker-extract.h"
+#include "tracker-extract-worker.h"
 #include "tracker-main.h"
 
 #ifdef THREAD_ENABLE_TRACE
@@ -45,9 +46,17 @@
 
 extern gboolean debug;
 
+/* Buckets of the extraction time histogram, each one
+ * covers module runs up to 10 times longer than the
+ * previous one, starting at 10ms.
+ */
+#define N_LATENCY_BUCKETS 5
+
 typedef struct {
 	gint extracted_count;
 	gint failed_count;
+	gint deadline_count;
+	guint latency[N_LATENCY_BUCKETS];
 } StatisticsData;
 
 typedef struct {
@@ -73,6 +82,20 @@ typedef struct {
 	gchar *force_module;
 
 	gint unhandled_count;
+	gint cache_hit_count;
+
+	/* Results of previous extractions, by file content */
+	TrackerExtractCache *cache;
+
+	/* Thread where module deadlines expire, so these
+	 * do even when modules block the main thread.
+	 */
+	GMainLoop *deadline_loop;
+	GThread *deadline_thread;
+
+	/* Worker processes, if extraction happens out of process */
+	TrackerExtractWorkerPool *worker_pool;
+	guint n_workers;
 
 #ifdef HAVE_LIBMEDIAART
 	MediaArtProcess *media_art_process;
@@ -93,14 +116,23 @@ typedef struct {
 	TrackerExtractMetadataFunc cur_func;
 	GModule *cur_module;
 
+	/* deadline of cur_module, in seconds */
+	guint timeout;
+
+	/* key of the file in the result cache, if any */
+	gchar *cache_key;
+
 	guint signal_id;
 	guint success : 1;
+	guint timed_out : 1;
+	guint cache_checked : 1;
 } TrackerExtractTask;
 
 static void tracker_extract_finalize (GObject *object);
 static void report_statistics        (GObject *object);
 static gboolean get_metadata         (TrackerExtractTask *task);
 static gboolean dispatch_task_cb     (TrackerExtractTask *task);
+static gboolean deadline_loop_quit_cb (GMainLoop         *loop);
 
 
 G_DEFINE_TYPE(TrackerExtract, tracker_extract, G_TYPE_OBJECT)
@@ -158,15 +190,32 @@ tracker_extract_finalize (GObject *object)
 
 	/* FIXME: Shutdown modules? */
 
+	if (priv->worker_pool) {
+		tracker_extract_worker_pool_free (priv->worker_pool);
+	}
+
 	g_hash_table_destroy (priv->single_thread_extractors);
 	g_thread_pool_free (priv->thread_pool, TRUE, FALSE);
 
+	if (priv->deadline_loop) {
+		/* Quits the loop even if it did not start running yet */
+		g_main_context_invoke (g_main_loop_get_context (priv->deadline_loop),
+		                       (GSourceFunc) deadline_loop_quit_cb,
+		                       priv->deadline_loop);
+		g_thread_join (priv->deadline_thread);
+		g_main_loop_unref (priv->deadline_loop);
+	}
+
 	if (!priv->disable_summary_on_finalize) {
 		report_statistics (object);
 	}
 
 	g_hash_table_destroy (priv->statistics_data);
 
+	if (priv->cache) {
+		tracker_extract_cache_free (priv->cache);
+	}
+
 #ifdef HAVE_LIBMEDIAART
 	if (priv->media_art_process) {
 		g_object_unref (priv->media_art_process);
@@ -204,15 +253,26 @@ report_statistics (GObject *object)
 			name = g_module_name (module);
 			name_without_path = strrchr (name, G_DIR_SEPARATOR) + 1;
 
-			g_message ("    Module:'%s', extracted:%d, failures:%d",
+			g_message ("    Module:'%s', extracted:%d, failures:%d, deadlines reached:%d",
 			           name_without_path,
 			           data->extracted_count,
-			           data->failed_count);
+			           data->failed_count,
+			           data->deadline_count);
+			g_message ("      Extraction times: <10ms:%u, <100ms:%u, <1s:%u, <10s:%u, >=10s:%u",
+			           data->latency[0],
+			           data->latency[1],
+			           data->latency[2],
+			           data->latency[3],
+			           data->latency[4]);
 		}
 	}
 
 	g_message ("Unhandled files: %d", priv->unhandled_count);
 
+	if (priv->cache) {
+		g_message ("Files found in the result cache: %d", priv->cache_hit_count);
+	}
+
 	if (priv->unhandled_count == 0 &&
 	    g_hash_table_size (priv->statistics_data) < 1) {
 		g_message ("    No files handled");
@@ -245,6 +305,52 @@ tracker_extract_new (gboolean     disable_shutdown,
 	return object;
 }
 
+/* Must be called with the task mutex held */
+static StatisticsData *
+lookup_statistics_data (TrackerExtractPrivate *priv,
+                        GModule               *module)
+{
+	StatisticsData *stats_data;
+
+	stats_data = g_hash_table_lookup (priv->statistics_data, module);
+
+	if (!stats_data) {
+		stats_data = g_slice_new0 (StatisticsData);
+		g_hash_table_insert (priv->statistics_data, module, stats_data);
+	}
+
+	return stats_data;
+}
+
+static void
+notify_module_run (TrackerExtractTask *task,
+                   gint64              elapsed)
+{
+	TrackerExtractPrivate *priv;
+	StatisticsData *stats_data;
+	gint64 limit;
+	guint bucket;
+
+	priv = TRACKER_EXTRACT_GET_PRIVATE (task->extract);
+
+	/* Microseconds */
+	for (bucket = 0, limit = 10000;
+	     bucket < N_LATENCY_BUCKETS - 1 && elapsed >= limit;
+	     bucket++, limit *= 10)
+		;
+
+	g_mutex_lock (&priv->task_mutex);
+
+	stats_data = lookup_statistics_data (priv, task->cur_module);
+	stats_data->latency[bucket]++;
+
+	if (task->timed_out) {
+		stats_data->deadline_count++;
+	}
+
+	g_mutex_unlock (&priv->task_mutex);
+}
+
 static void
 notify_task_finish (TrackerExtractTask *task,
                     gboolean            success)
@@ -262,16 +368,7 @@ notify_task_finish (TrackerExtractTask *task,
 	g_mutex_lock (&priv->task_mutex);
 
 	if (task->cur_module) {
-		stats_data = g_hash_table_lookup (priv->statistics_data,
-						  task->cur_module);
-
-		if (!stats_data) {
-			stats_data = g_slice_new0 (StatisticsData);
-			g_hash_table_insert (priv->statistics_data,
-					     task->cur_module,
-					     stats_data);
-		}
-
+		stats_data = lookup_statistics_data (priv, task->cur_module);
 		stats_data->extracted_count++;
 
 		if (!success) {
@@ -286,6 +383,76 @@ notify_task_finish (TrackerExtractTask *task,
 	g_mutex_unlock (&priv->task_mutex);
 }
 
+static gpointer
+deadline_thread_func (GMainLoop *loop)
+{
+	g_main_context_push_thread_default (g_main_loop_get_context (loop));
+	g_main_loop_run (loop);
+	g_main_context_pop_thread_default (g_main_loop_get_context (loop));
+
+	return NULL;
+}
+
+static gboolean
+deadline_loop_quit_cb (GMainLoop *loop)
+{
+	g_main_loop_quit (loop);
+	return FALSE;
+}
+
+static gboolean
+deadline_expired_cb (GCancellable *cancellable)
+{
+	g_cancellable_cancel (cancellable);
+	return FALSE;
+}
+
+/* Also stops the module if the task is cancelled */
+static void
+task_cancelled_cb (GCancellable *cancellable,
+                   GCancellable *deadline_cancellable)
+{
+	g_cancellable_cancel (deadline_cancellable);
+}
+
+/* Cancels @cancellable after @timeout seconds, unless
+ * the returned source is destroyed before.
+ */
+static GSource *
+deadline_add (TrackerExtract *extract,
+              guint           timeout,
+              GCancellable   *cancellable)
+{
+	TrackerExtractPrivate *priv;
+	GSource *source;
+
+	priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	g_mutex_lock (&priv->task_mutex);
+
+	if (!priv->deadline_loop) {
+		GMainContext *context;
+
+		context = g_main_context_new ();
+		priv->deadline_loop = g_main_loop_new (context, FALSE);
+		priv->deadline_thread = g_thread_new ("deadlines",
+		                                      (GThreadFunc) deadline_thread_func,
+		                                      priv->deadline_loop);
+		g_main_context_unref (context);
+	}
+
+	g_mutex_unlock (&priv->task_mutex);
+
+	source = g_timeout_source_new_seconds (timeout);
+	g_source_set_callback (source,
+	                       (GSourceFunc) deadline_expired_cb,
+	                       g_object_ref (cancellable),
+	                       g_object_unref);
+	g_source_attach (source, g_main_loop_get_context (priv->deadline_loop));
+
+	return source;
+}
+
 static gboolean
 get_file_metadata (TrackerExtractTask  *task,
                    TrackerExtractInfo **info_out)
@@ -319,14 +486,67 @@ get_file_metadata (TrackerExtractTask  *task,
 	if (mime_used) {
 		if (task->cur_func) {
 			TrackerSparqlBuilder *statements;
+			GCancellable *deadline_cancellable = NULL;
+			GSource *deadline = NULL;
+			gulong cancelled_id = 0;
+			gint64 start;
 
 			g_debug ("Using %s...", g_module_name (task->cur_module));
 
+			task->timeout = tracker_mimetype_info_get_timeout (task->mimetype_handlers);
+			task->timed_out = FALSE;
+
+			if (task->timeout > 0 || task->cancellable) {
+				/* Modules are expected to check the cancellable
+				 * and return what they got so far when cancelled.
+				 */
+				deadline_cancellable = g_cancellable_new ();
+
+				if (task->timeout > 0) {
+					deadline = deadline_add (task->extract, task->timeout,
+					                         deadline_cancellable);
+				}
+
+				if (task->cancellable) {
+					cancelled_id = g_cancellable_connect (task->cancellable,
+					                                      G_CALLBACK (task_cancelled_cb),
+					                                      deadline_cancellable,
+					                                      NULL);
+				}
+
+				tracker_extract_info_set_cancellable (info, deadline_cancellable);
+			}
+
+			start = g_get_monotonic_time ();
 			(task->cur_func) (info);
 
+			if (deadline_cancellable) {
+				if (deadline) {
+					g_source_destroy (deadline);
+					g_source_unref (deadline);
+				}
+
+				g_cancellable_disconnect (task->cancellable, cancelled_id);
+
+				task->timed_out = (deadline != NULL &&
+				                   g_cancellable_is_cancelled (deadline_cancellable) &&
+				                   !g_cancellable_is_cancelled (task->cancellable));
+				g_object_unref (deadline_cancellable);
+			}
+
+			notify_module_run (task, g_get_monotonic_time () - start);
+
 			statements = tracker_extract_info_get_metadata_builder (info);
 			items = tracker_sparql_builder_get_length (statements);
 
+			if (task->timed_out) {
+				g_message ("Deadline of %u seconds reached by %s on '%s', %s",
+				           task->timeout,
+				           g_module_name (task->cur_module),
+				           task->file,
+				           items > 0 ? "keeping partial metadata" : "skipping file");
+			}
+
 			if (items > 0) {
 				tracker_sparql_builder_insert_close (statements);
 				task->success = TRUE;
@@ -448,6 +668,7 @@ extract_task_free (TrackerExtractTask *task)
 		tracker_mimetype_info_free (task->mimetype_handlers);
 	}
 
+	g_free (task->cache_key);
 	g_free (task->graph);
 	g_free (task->mimetype);
 	g_free (task->file);
@@ -498,9 +719,52 @@ filter_module (TrackerExtract *extract,
 	return filter;
 }
 
+static gboolean
+lookup_cached_metadata (TrackerExtractTask  *task,
+                        TrackerExtractInfo **info_out)
+{
+	TrackerExtractPrivate *priv;
+
+	priv = TRACKER_EXTRACT_GET_PRIVATE (task->extract);
+	*info_out = NULL;
+
+	/* Only before the first module runs */
+	if (!priv->cache || task->cache_checked) {
+		return FALSE;
+	}
+
+	task->cache_checked = TRUE;
+	task->cache_key = tracker_extract_cache_get_key (priv->cache,
+	                                                 task->file,
+	                                                 task->mimetype,
+	                                                 task->graph);
+	if (!task->cache_key) {
+		return FALSE;
+	}
+
+	*info_out = tracker_extract_cache_lookup (priv->cache,
+	                                          task->cache_key,
+	                                          task->file,
+	                                          task->mimetype,
+	                                          task->graph);
+	if (!*info_out) {
+		return FALSE;
+	}
+
+	g_debug ("Using cached result for '%s'", task->file);
+	task->success = TRUE;
+
+	g_mutex_lock (&priv->task_mutex);
+	priv->cache_hit_count++;
+	g_mutex_unlock (&priv->task_mutex);
+
+	return TRUE;
+}
+
 static gboolean
 get_metadata (TrackerExtractTask *task)
 {
+	TrackerExtractPrivate *priv;
 	TrackerExtractInfo *info;
 
 #ifdef THREAD_ENABLE_TRACE
@@ -521,12 +785,37 @@ get_metadata (TrackerExtractTask *task)
 		return FALSE;
 	}
 
-	if (!filter_module (task->extract, task->cur_module) &&
-	    get_file_metadata (task, &info)) {
+	priv = TRACKER_EXTRACT_GET_PRIVATE (task->extract);
+
+	if (lookup_cached_metadata (task, &info)) {
+		g_simple_async_result_set_op_res_gpointer ((GSimpleAsyncResult *) task->res,
+		                                           info,
+		                                           (GDestroyNotify) tracker_extract_info_unref);
+
+		g_simple_async_result_complete_in_idle ((GSimpleAsyncResult *) task->res);
+		extract_task_free (task);
+	} else if (!filter_module (task->extract, task->cur_module) &&
+	           get_file_metadata (task, &info)) {
+		/* Partial results from modules reaching
+		 * their deadline are not worth keeping.
+		 */
+		if (task->cache_key && !task->timed_out) {
+			tracker_extract_cache_store (priv->cache, task->cache_key, info);
+		}
+
 		g_simple_async_result_set_op_res_gpointer ((GSimpleAsyncResult *) task->res,
 		                                           info,
 		                                           (GDestroyNotify) tracker_extract_info_unref);
 
+		g_simple_async_result_complete_in_idle ((GSimpleAsyncResult *) task->res);
+		extract_task_free (task);
+	} else if (task->timed_out) {
+		/* Files this slow are not handed to further modules */
+		g_simple_async_result_set_error ((GSimpleAsyncResult *) task->res,
+		                                 TRACKER_DBUS_ERROR, 0,
+		                                 "Extraction of '%s' took longer than %u seconds",
+		                                 task->file, task->timeout);
+
 		g_simple_async_result_complete_in_idle ((GSimpleAsyncResult *) task->res);
 		extract_task_free (task);
 	} else {
@@ -705,6 +994,7 @@ tracker_extract_file (TrackerExtract      *extract,
                       GAsyncReadyCallback  cb,
                       gpointer             user_data)
 {
+	TrackerExtractPrivate *priv;
 	GSimpleAsyncResult *res;
 	GError *error = NULL;
 	TrackerExtractTask *task;
@@ -721,6 +1011,17 @@ tracker_extract_file (TrackerExtract      *extract,
 
 	res = g_simple_async_result_new (G_OBJECT (extract), cb, user_data, NULL);
 
+	priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	if (priv->worker_pool) {
+		/* Workers run the extractors themselves */
+		tracker_extract_worker_pool_extract (priv->worker_pool,
+		                                     file, mimetype, graph,
+		                                     cancellable, res);
+		g_object_unref (res);
+		return;
+	}
+
 	task = extract_task_new (extract, file, mimetype, graph,
 	                         cancellable, G_ASYNC_RESULT (res), &error);
 
@@ -730,10 +1031,6 @@ tracker_extract_file (TrackerExtract      *extract,
 		g_simple_async_result_complete_in_idle (res);
 		g_error_free (error);
 	} else {
-		TrackerExtractPrivate *priv;
-
-		priv = TRACKER_EXTRACT_GET_PRIVATE (task->extract);
-
 		g_mutex_lock (&priv->task_mutex);
 		priv->running_tasks = g_list_prepend (priv->running_tasks, task);
 		g_mutex_unlock (&priv->task_mutex);
@@ -745,6 +1042,152 @@ tracker_extract_file (TrackerExtract      *extract,
 	g_object_unref (res);
 }
 
+/**
+ * tracker_extract_get_module:
+ * @extract: a #TrackerExtract
+ * @mimetype: (allow-none): a mimetype string
+ * @thread_awareness: (out): (allow-none): thread awareness of the module
+ *
+ * Returns the module that will be tried first on files of @mimetype,
+ * this is the module whose threading strategy determines how the file
+ * will be dispatched.
+ *
+ * Returns: the #GModule, or %NULL if there's none for @mimetype.
+ **/
+GModule *
+tracker_extract_get_module (TrackerExtract               *extract,
+                            const gchar                  *mimetype,
+                            TrackerModuleThreadAwareness *thread_awareness)
+{
+	TrackerMimetypeInfo *info;
+	GModule *module;
+
+	g_return_val_if_fail (TRACKER_IS_EXTRACT (extract), NULL);
+
+	if (!mimetype || !*mimetype) {
+		return NULL;
+	}
+
+	info = tracker_extract_module_manager_get_mimetype_handlers (mimetype);
+
+	if (!info) {
+		return NULL;
+	}
+
+	/* Modules are never unloaded, so it is fine to keep the GModule */
+	module = tracker_mimetype_info_get_module (info, NULL, thread_awareness);
+	tracker_mimetype_info_free (info);
+
+	return module;
+}
+
+/**
+ * tracker_extract_set_max_threads:
+ * @extract: a #TrackerExtract
+ * @max_threads: maximum number of threads
+ *
+ * Sets the maximum number of threads used to run extractors
+ * that can be run concurrently (%TRACKER_MODULE_MULTI_THREAD).
+ **/
+void
+tracker_extract_set_max_threads (TrackerExtract *extract,
+                                 guint           max_threads)
+{
+	TrackerExtractPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_EXTRACT (extract));
+	g_return_if_fail (max_threads > 0);
+
+	priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+	g_thread_pool_set_max_threads (priv->thread_pool, max_threads, NULL);
+}
+
+/**
+ * tracker_extract_start_workers:
+ * @extract: a #TrackerExtract
+ * @n_workers: number of worker processes
+ * @worker_args: arguments making tracker-extract run as a worker
+ * @error: return location for a #GError
+ *
+ * Makes @extract hand all files to @n_workers worker processes
+ * instead of running the extractors itself, so a crashing or
+ * hanging extractor does not bring the whole process down.
+ *
+ * Returns: %TRUE if the workers were started.
+ **/
+gboolean
+tracker_extract_start_workers (TrackerExtract  *extract,
+                               guint            n_workers,
+                               gchar          **worker_args,
+                               GError         **error)
+{
+	TrackerExtractPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_EXTRACT (extract), FALSE);
+	g_return_val_if_fail (n_workers > 0, FALSE);
+
+	priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+	g_return_val_if_fail (priv->worker_pool == NULL, FALSE);
+
+	priv->worker_pool = tracker_extract_worker_pool_new (n_workers,
+	                                                     (const gchar * const *) worker_args,
+	                                                     error);
+
+	if (!priv->worker_pool) {
+		return FALSE;
+	}
+
+	priv->n_workers = n_workers;
+
+	return TRUE;
+}
+
+/**
+ * tracker_extract_get_n_workers:
+ * @extract: a #TrackerExtract
+ *
+ * Returns the number of worker processes extracting files, if
+ * tracker_extract_start_workers() was called.
+ *
+ * Returns: the number of workers, or 0 if extraction happens
+ * in process.
+ **/
+guint
+tracker_extract_get_n_workers (TrackerExtract *extract)
+{
+	TrackerExtractPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_EXTRACT (extract), 0);
+
+	priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	return priv->n_workers;
+}
+
+/**
+ * tracker_extract_set_cache:
+ * @extract: a #TrackerExtract
+ * @cache: (transfer full): a #TrackerExtractCache
+ *
+ * Makes @extract look up files in @cache before running the
+ * extractors on them, and store there what these extract, so
+ * copies of the same file are only extracted once.
+ **/
+void
+tracker_extract_set_cache (TrackerExtract      *extract,
+                           TrackerExtractCache *cache)
+{
+	TrackerExtractPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_EXTRACT (extract));
+	g_return_if_fail (cache != NULL);
+
+	priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+	g_return_if_fail (priv->cache == NULL);
+
+	priv->cache = cache;
+}
+
 #ifdef HAVE_LIBMEDIAART
 
 MediaArtProcess *
@@ -24,6 +24,8 @@
 #include <libtracker-common/tracker-common.h>
 #include <libtracker-extract/tracker-extract.h>
 
+#include "tracker-extract-cache.h"
+
 #define TRACKER_EXTRACT_SERVICE        "org.freedesktop.Tracker1.Extract"
 #define TRACKER_EXTRACT_PATH           "/org/freedesktop/Tracker1/Extract"
 #define TRACKER_EXTRACT_INTERFACE      "org.freedesktop.Tracker1.Extract"
@@ -60,6 +62,20 @@ void            tracker_extract_file                    (TrackerExtract
                                                          GAsyncReadyCallback     cb,
                                                          gpointer                user_data);
 
+GModule *       tracker_extract_get_module              (TrackerExtract               *extract,
+                                                         const gchar                  *mimetype,
+                                                         TrackerModuleThreadAwareness *thread_awareness);
+void            tracker_extract_set_max_threads         (TrackerExtract         *extract,
+                                                         guint                   max_threads);
+
+gboolean        tracker_extract_start_workers           (TrackerExtract         *extract,
+                                                         guint                   n_workers,
+                                                         gchar                 **worker_args,
+                                                         GError                **error);
+guint           tracker_extract_get_n_workers           (TrackerExtract         *extract);
+void            tracker_extract_set_cache               (TrackerExtract         *extract,
+                                                         TrackerExtractCache    *cache);
+
 #ifdef HAVE_LIBMEDIAART
 MediaArtProcess *
                 tracker_extract_get_media_art_process   (TrackerExtract         *extract);
@@ -56,6 +56,7 @@
 #include "tracker-extract.h"
 #include "tracker-extract-controller.h"
 #include "tracker-extract-decorator.h"
+#include "tracker-extract-worker.h"
 
 #ifdef THREAD_ENABLE_TRACE
 #warning Main thread traces enabled
@@ -78,6 +79,7 @@ static gchar *filename;
 static gchar *mime_type;
 static gchar *force_module;
 static gboolean version;
+static gboolean worker;
 
 static TrackerConfig *config;
 
@@ -103,6 +105,11 @@ static GOptionEntry entries[] = {
 	  G_OPTION_ARG_NONE, &version,
 	  N_("Displays version information"),
 	  NULL },
+	/* Only used by the extractor to start its worker processes */
+	{ "worker", 0, G_OPTION_FLAG_HIDDEN,
+	  G_OPTION_ARG_NONE, &worker,
+	  NULL,
+	  NULL },
 	{ NULL }
 };
 
@@ -251,6 +258,26 @@ tracker_main_get_config (void)
 	return config;
 }
 
+static void
+initialize_cache (TrackerExtract *extract)
+{
+	TrackerExtractCache *cache;
+	guint64 max_size;
+	gchar *path;
+
+	max_size = tracker_config_get_extract_cache_size (config);
+
+	if (max_size == 0) {
+		return;
+	}
+
+	/* Shared by all extractor processes */
+	path = g_build_filename (g_get_user_cache_dir (), "tracker", "extract-cache", NULL);
+	cache = tracker_extract_cache_new (path, max_size * 1024 * 1024);
+	tracker_extract_set_cache (extract, cache);
+	g_free (path);
+}
+
 static int
 run_standalone (TrackerConfig *config)
 {
@@ -297,6 +324,85 @@ run_standalone (TrackerConfig *config)
 	return EXIT_SUCCESS;
 }
 
+static int
+run_worker (TrackerConfig *config)
+{
+	TrackerExtract *object;
+	gint retval;
+
+	/* Extractor command line arguments are passed along */
+	if (verbosity > -1) {
+		tracker_config_set_verbosity (config, verbosity);
+	}
+
+	tracker_log_init (tracker_config_get_verbosity (config), NULL);
+	tracker_locale_init ();
+
+	initialize_priority_and_scheduling (tracker_config_get_sched_idle (config),
+	                                    tracker_db_manager_get_first_index_done () == FALSE);
+	tracker_memory_setrlimits ();
+
+	object = tracker_extract_new (TRUE, force_module);
+
+	if (!object) {
+		tracker_locale_shutdown ();
+		tracker_log_shutdown ();
+		return EXIT_FAILURE;
+	}
+
+	initialize_cache (object);
+
+	retval = tracker_extract_worker_run (object);
+
+	g_object_unref (object);
+
+	tracker_locale_shutdown ();
+	tracker_log_shutdown ();
+
+	return retval;
+}
+
+static gboolean
+start_workers (TrackerExtract *extract)
+{
+	GPtrArray *args;
+	GError *error = NULL;
+	guint n_workers;
+	gboolean started;
+
+	n_workers = tracker_config_get_max_extracting_files (config);
+
+	if (n_workers == 0) {
+		n_workers = g_get_num_processors ();
+	}
+
+	args = g_ptr_array_new_with_free_func (g_free);
+	g_ptr_array_add (args, g_strdup ("--worker"));
+
+	if (force_module) {
+		g_ptr_array_add (args, g_strdup_printf ("--force-module=%s", force_module));
+	}
+
+	if (verbosity > -1) {
+		g_ptr_array_add (args, g_strdup_printf ("--verbosity=%d", verbosity));
+	}
+
+	g_ptr_array_add (args, NULL);
+
+	started = tracker_extract_start_workers (extract, n_workers,
+	                                         (gchar **) args->pdata,
+	                                         &error);
+
+	if (!started) {
+		g_critical ("Could not start worker processes: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_ptr_array_unref (args);
+
+	return started;
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -340,7 +446,10 @@ main (int argc, char *argv[])
 		return EXIT_SUCCESS;
 	}
 
-	initialize_signal_handler ();
+	/* Workers are managed by the extractor process */
+	if (!worker) {
+		initialize_signal_handler ();
+	}
 
 	g_set_application_name ("tracker-extract");
 
@@ -353,6 +462,10 @@ main (int argc, char *argv[])
 		return run_standalone (config);
 	}
 
+	if (worker) {
+		return run_worker (config);
+	}
+
 	/* Initialize subsystems */
 	initialize_directories ();
 
@@ -382,6 +495,18 @@ main (int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	if (tracker_config_get_use_worker_processes (config)) {
+		if (!start_workers (extract)) {
+			g_object_unref (extract);
+			g_object_unref (config);
+			tracker_log_shutdown ();
+			return EXIT_FAILURE;
+		}
+	} else {
+		/* Workers look up the cache themselves */
+		initialize_cache (extract);
+	}
+
 	decorator = tracker_extract_decorator_new (extract, NULL, &error);
 
 	if (error) {
@@ -177,6 +177,20 @@ public class Tracker.Resources : Object {
 		request.end ();
 	}
 
+	public async void optimize_fts (BusName sender) throws Error {
+		var request = DBusRequest.begin (sender, "Resources.OptimizeFts");
+		try {
+			yield Tracker.Store.fts_optimize (sender);
+
+			request.end ();
+		} catch (DBInterfaceError.NO_SPACE ie) {
+			throw new Sparql.Error.NO_SPACE (ie.message);
+		} catch (Error e) {
+			request.end (e);
+			throw new Sparql.Error.INTERNAL (e.message);
+		}
+	}
+
 	public async void batch_sparql_update (BusName sender, string update) throws Error {
 		var request = DBusRequest.begin (sender, "Resources.BatchSparqlUpdate");
 		request.debug ("query: %s", update);
@@ -24,6 +24,9 @@ public class Tracker.Store {
 
 	const int MAX_TASK_TIME = 30;
 
+	/* Seconds without updates before merging FTS segments */
+	const int FTS_MERGE_IDLE_TIME = 5;
+
 	static Queue<Task> query_queues[3 /* TRACKER_STORE_N_PRIORITIES */];
 	static Queue<Task> update_queues[3 /* TRACKER_STORE_N_PRIORITIES */];
 	static int n_queries_running;
@@ -35,6 +38,8 @@ public class Tracker.Store {
 	static int max_task_time;
 	static bool active;
 	static SourceFunc active_callback;
+	static uint fts_merge_timeout_id;
+	static bool fts_merging;
 
 	public enum Priority {
 		HIGH,
@@ -48,6 +53,8 @@ public class Tracker.Store {
 		UPDATE,
 		UPDATE_BLANK,
 		TURTLE,
+		FTS_MERGE,
+		FTS_OPTIMIZE,
 	}
 
 	public delegate void SparqlQueryInThread (DBCursor cursor) throws Error;
@@ -82,6 +89,10 @@ public class Tracker.Store {
 		public string path;
 	}
 
+	class FtsTask : Task {
+		public bool more;
+	}
+
 	static void sched () {
 		Task task = null;
 
@@ -125,6 +136,11 @@ public class Tracker.Store {
 					break;
 				}
 			}
+			if (task == null && fts_merging) {
+				// no pending updates, merge some more FTS segments
+				task = new FtsTask ();
+				task.type = TaskType.FTS_MERGE;
+			}
 			if (task != null) {
 				update_running = true;
 				try {
@@ -136,6 +152,25 @@ public class Tracker.Store {
 		}
 	}
 
+	static void schedule_fts_merge () {
+		if (!Tracker.Data.fts_merge_pending ()) {
+			return;
+		}
+
+		// restart the timeout, so merging only starts after
+		// a while without updates
+		if (fts_merge_timeout_id != 0) {
+			Source.remove (fts_merge_timeout_id);
+		}
+
+		fts_merge_timeout_id = Timeout.add_seconds (FTS_MERGE_IDLE_TIME, () => {
+			fts_merge_timeout_id = 0;
+			fts_merging = true;
+			sched ();
+			return false;
+		});
+	}
+
 	static Tracker.Data.CommitType commit_type (Task task) {
 		switch (task.type) {
 			case TaskType.UPDATE:
@@ -178,7 +213,13 @@ public class Tracker.Store {
 			n_queries_running--;
 		} else if (task.type == TaskType.UPDATE || task.type == TaskType.UPDATE_BLANK) {
 			if (task.error == null) {
-				Tracker.Data.notify_transaction (commit_type (task));
+				var type = commit_type (task);
+
+				Tracker.Data.notify_transaction (type);
+
+				if (type != Tracker.Data.CommitType.BATCH) {
+					schedule_fts_merge ();
+				}
 			}
 
 			task.callback ();
@@ -187,12 +228,31 @@ public class Tracker.Store {
 			update_running = false;
 		} else if (task.type == TaskType.TURTLE) {
 			if (task.error == null) {
-				Tracker.Data.notify_transaction (commit_type (task));
+				var type = commit_type (task);
+
+				Tracker.Data.notify_transaction (type);
+
+				if (type != Tracker.Data.CommitType.BATCH) {
+					schedule_fts_merge ();
+				}
 			}
 
 			task.callback ();
 			task.error = null;
 
+			update_running = false;
+		} else if (task.type == TaskType.FTS_MERGE || task.type == TaskType.FTS_OPTIMIZE) {
+			if (task.error != null) {
+				warning ("Could not merge FTS segments: %s", task.error.message);
+			}
+
+			fts_merging = ((FtsTask) task).more;
+
+			if (task.callback != null) {
+				task.callback ();
+			}
+			task.error = null;
+
 			update_running = false;
 		}
 
@@ -225,6 +285,12 @@ public class Tracker.Store {
 					var update_task = (UpdateTask) task;
 
 					update_task.blank_nodes = Tracker.Data.update_sparql_blank (update_task.query);
+				} else if (task.type == TaskType.FTS_MERGE) {
+					var fts_task = (FtsTask) task;
+
+					fts_task.more = Tracker.Data.fts_merge_step ();
+				} else if (task.type == TaskType.FTS_OPTIMIZE) {
+					Tracker.Data.fts_optimize ();
 				} else if (task.type == TaskType.TURTLE) {
 					var turtle_task = (TurtleTask) task;
 
@@ -321,6 +387,11 @@ public class Tracker.Store {
 	}
 
 	public static void shutdown () {
+		if (fts_merge_timeout_id != 0) {
+			Source.remove (fts_merge_timeout_id);
+			fts_merge_timeout_id = 0;
+		}
+
 		query_pool = null;
 		update_pool = null;
 		checkpoint_pool = null;
@@ -409,6 +480,23 @@ public class Tracker.Store {
 		}
 	}
 
+	public static async void fts_optimize (string client_id) throws Error {
+		var task = new FtsTask ();
+		task.type = TaskType.FTS_OPTIMIZE;
+		task.callback = fts_optimize.callback;
+		task.client_id = client_id;
+
+		update_queues[Priority.HIGH].push_tail (task);
+
+		sched ();
+
+		yield;
+
+		if (task.error != null) {
+			throw task.error;
+		}
+	}
+
 	public uint get_queue_size () {
 		uint result = 0;
 
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <libtracker-common/tracker-mime-cache.h>
+
+typedef struct {
+	gchar *dir;
+	gchar *cache_file;
+} MimeCacheFixture;
+
+static void
+fixture_setup (MimeCacheFixture *fixture,
+               gconstpointer     data)
+{
+	fixture->dir = g_dir_make_tmp ("tracker-mime-cache-test-XXXXXX", NULL);
+	g_assert (fixture->dir != NULL);
+	fixture->cache_file = g_build_filename (fixture->dir, "cache", "mime-cache", NULL);
+}
+
+static void
+fixture_teardown (MimeCacheFixture *fixture,
+                  gconstpointer     data)
+{
+	gchar *cache_dir;
+	const gchar *name;
+	GDir *dir;
+
+	g_unlink (fixture->cache_file);
+	cache_dir = g_path_get_dirname (fixture->cache_file);
+	g_rmdir (cache_dir);
+	g_free (cache_dir);
+
+	dir = g_dir_open (fixture->dir, 0, NULL);
+
+	while (dir && (name = g_dir_read_name (dir)) != NULL) {
+		gchar *path;
+
+		path = g_build_filename (fixture->dir, name, NULL);
+		g_unlink (path);
+		g_free (path);
+	}
+
+	if (dir) {
+		g_dir_close (dir);
+	}
+
+	g_rmdir (fixture->dir);
+	g_free (fixture->cache_file);
+	g_free (fixture->dir);
+}
+
+static const gchar *
+get_content_type (TrackerMimeCache *cache,
+                  MimeCacheFixture *fixture,
+                  const gchar      *name,
+                  const gchar      *contents)
+{
+	const gchar *content_type;
+	GError *error = NULL;
+	GFileInfo *info;
+	GFile *file;
+	gchar *path;
+
+	path = g_build_filename (fixture->dir, name, NULL);
+
+	if (contents) {
+		g_file_set_contents (path, contents, -1, &error);
+		g_assert_no_error (error);
+	}
+
+	file = g_file_new_for_path (path);
+	info = g_file_query_info (file, TRACKER_MIME_CACHE_FILE_ATTRIBUTES,
+	                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                          NULL, &error);
+	g_assert_no_error (error);
+
+	content_type = tracker_mime_cache_get_content_type (cache, file, info,
+	                                                    NULL, &error);
+	g_assert_no_error (error);
+
+	g_object_unref (info);
+	g_object_unref (file);
+	g_free (path);
+
+	return content_type;
+}
+
+static gchar *
+get_gio_content_type (MimeCacheFixture *fixture,
+                      const gchar      *name)
+{
+	gchar *path, *content_type;
+	GFileInfo *info;
+	GFile *file;
+
+	path = g_build_filename (fixture->dir, name, NULL);
+	file = g_file_new_for_path (path);
+	info = g_file_query_info (file, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE,
+	                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                          NULL, NULL);
+	g_assert (info != NULL);
+
+	content_type = g_strdup (g_file_info_get_content_type (info));
+
+	g_object_unref (info);
+	g_object_unref (file);
+	g_free (path);
+
+	return content_type;
+}
+
+static void
+assert_stats (TrackerMimeCache *cache,
+              guint             guessed,
+              guint             cached,
+              guint             sniffed)
+{
+	guint n_guessed, n_cached, n_sniffed;
+
+	tracker_mime_cache_get_stats (cache, &n_guessed, &n_cached, &n_sniffed);
+	g_assert_cmpuint (n_guessed, ==, guessed);
+	g_assert_cmpuint (n_cached, ==, cached);
+	g_assert_cmpuint (n_sniffed, ==, sniffed);
+}
+
+static void
+test_mime_cache_guess (MimeCacheFixture *fixture,
+                       gconstpointer     data)
+{
+	TrackerMimeCache *cache;
+	const gchar *content_type;
+	gchar *expected;
+
+	cache = tracker_mime_cache_new (fixture->cache_file);
+
+	content_type = get_content_type (cache, fixture, "file.png", "not a png");
+	expected = get_gio_content_type (fixture, "file.png");
+	g_assert_cmpstr (content_type, ==, expected);
+	g_free (expected);
+
+	/* Resolved by name, the contents are not read */
+	assert_stats (cache, 1, 0, 0);
+
+	tracker_mime_cache_free (cache);
+}
+
+static void
+test_mime_cache_sniff (MimeCacheFixture *fixture,
+                       gconstpointer     data)
+{
+	TrackerMimeCache *cache;
+	const gchar *content_type;
+	GError *error = NULL;
+	gchar *expected;
+
+	cache = tracker_mime_cache_new (fixture->cache_file);
+
+	content_type = get_content_type (cache, fixture, "noext", "%PDF-1.4\n");
+	expected = get_gio_content_type (fixture, "noext");
+	g_assert_cmpstr (content_type, ==, expected);
+	assert_stats (cache, 0, 0, 1);
+
+	/* Unchanged files are looked up in the cache */
+	content_type = get_content_type (cache, fixture, "noext", NULL);
+	g_assert_cmpstr (content_type, ==, expected);
+	assert_stats (cache, 0, 1, 1);
+
+	/* Also after being saved and loaded again */
+	tracker_mime_cache_save (cache, &error);
+	g_assert_no_error (error);
+	tracker_mime_cache_free (cache);
+
+	g_assert (g_file_test (fixture->cache_file, G_FILE_TEST_EXISTS));
+	cache = tracker_mime_cache_new (fixture->cache_file);
+
+	content_type = get_content_type (cache, fixture, "noext", NULL);
+	g_assert_cmpstr (content_type, ==, expected);
+	assert_stats (cache, 0, 1, 0);
+
+	g_free (expected);
+	tracker_mime_cache_free (cache);
+}
+
+static void
+test_mime_cache_expire (MimeCacheFixture *fixture,
+                        gconstpointer     data)
+{
+	TrackerMimeCache *cache;
+	GError *error = NULL;
+	gint i;
+
+	cache = tracker_mime_cache_new (fixture->cache_file);
+	get_content_type (cache, fixture, "noext", "%PDF-1.4\n");
+	tracker_mime_cache_save (cache, &error);
+	g_assert_no_error (error);
+	tracker_mime_cache_free (cache);
+
+	/* Runs not looking the file up */
+	for (i = 0; i < 3; i++) {
+		cache = tracker_mime_cache_new (fixture->cache_file);
+		tracker_mime_cache_save (cache, &error);
+		g_assert_no_error (error);
+		tracker_mime_cache_free (cache);
+	}
+
+	/* The entry is gone after that many runs */
+	cache = tracker_mime_cache_new (fixture->cache_file);
+	get_content_type (cache, fixture, "noext", NULL);
+	assert_stats (cache, 0, 0, 1);
+	tracker_mime_cache_free (cache);
+}
+
+static void
+test_mime_cache_modified (MimeCacheFixture *fixture,
+                          gconstpointer     data)
+{
+	TrackerMimeCache *cache;
+	const gchar *content_type;
+	GError *error = NULL;
+	GFile *file;
+	gchar *path, *expected;
+
+	cache = tracker_mime_cache_new (fixture->cache_file);
+
+	get_content_type (cache, fixture, "noext", "%PDF-1.4\n");
+	assert_stats (cache, 0, 0, 1);
+
+	/* A different mtime invalidates the cached content type */
+	path = g_build_filename (fixture->dir, "noext", NULL);
+	g_file_set_contents (path, "<?xml version=\"1.0\"?>\n", -1, &error);
+	g_assert_no_error (error);
+
+	file = g_file_new_for_path (path);
+	g_file_set_attribute_uint64 (file, G_FILE_ATTRIBUTE_TIME_MODIFIED, 1000,
+	                             G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                             NULL, &error);
+	g_assert_no_error (error);
+
+	content_type = get_content_type (cache, fixture, "noext", NULL);
+	expected = get_gio_content_type (fixture, "noext");
+	g_assert_cmpstr (content_type, ==, expected);
+	assert_stats (cache, 0, 0, 2);
+
+	g_free (expected);
+	g_object_unref (file);
+	g_free (path);
+	tracker_mime_cache_free (cache);
+}
+
+static void
+test_mime_cache_directory (MimeCacheFixture *fixture,
+                           gconstpointer     data)
+{
+	TrackerMimeCache *cache;
+	const gchar *content_type;
+	gchar *path, *expected;
+
+	cache = tracker_mime_cache_new (fixture->cache_file);
+
+	path = g_build_filename (fixture->dir, "subdir", NULL);
+	g_mkdir (path, 0700);
+
+	content_type = get_content_type (cache, fixture, "subdir", NULL);
+	expected = get_gio_content_type (fixture, "subdir");
+	g_assert_cmpstr (content_type, ==, expected);
+
+	/* Only regular files are accounted */
+	assert_stats (cache, 0, 0, 0);
+
+	g_rmdir (path);
+	g_free (expected);
+	g_free (path);
+	tracker_mime_cache_free (cache);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/libtracker-common/mime-cache/guess",
+	            MimeCacheFixture, NULL,
+	            fixture_setup, test_mime_cache_guess, fixture_teardown);
+	g_test_add ("/libtracker-common/mime-cache/sniff",
+	            MimeCacheFixture, NULL,
+	            fixture_setup, test_mime_cache_sniff, fixture_teardown);
+	g_test_add ("/libtracker-common/mime-cache/expire",
+	            MimeCacheFixture, NULL,
+	            fixture_setup, test_mime_cache_expire, fixture_teardown);
+	g_test_add ("/libtracker-common/mime-cache/modified",
+	            MimeCacheFixture, NULL,
+	            fixture_setup, test_mime_cache_modified, fixture_teardown);
+	g_test_add ("/libtracker-common/mime-cache/directory",
+	            MimeCacheFixture, NULL,
+	            fixture_setup, test_mime_cache_directory, fixture_teardown);
+
+	return g_test_run ();
+}
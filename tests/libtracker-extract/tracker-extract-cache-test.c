@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <tracker-extract/tracker-extract-cache.h>
+
+typedef struct {
+	gchar *tmp_dir;
+	TrackerExtractCache *cache;
+} Fixture;
+
+static void
+remove_recursively (const gchar *path)
+{
+	const gchar *name;
+	GDir *dir;
+
+	dir = g_dir_open (path, 0, NULL);
+
+	while (dir && (name = g_dir_read_name (dir)) != NULL) {
+		gchar *child;
+
+		child = g_build_filename (path, name, NULL);
+		remove_recursively (child);
+		g_free (child);
+	}
+
+	if (dir) {
+		g_dir_close (dir);
+	}
+
+	g_remove (path);
+}
+
+static guint64
+get_size_recursively (const gchar *path)
+{
+	const gchar *name;
+	guint64 size = 0;
+	GStatBuf st;
+	GDir *dir;
+
+	dir = g_dir_open (path, 0, NULL);
+
+	if (!dir) {
+		return (g_stat (path, &st) == 0) ? st.st_size : 0;
+	}
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		gchar *child;
+
+		child = g_build_filename (path, name, NULL);
+		size += get_size_recursively (child);
+		g_free (child);
+	}
+
+	g_dir_close (dir);
+
+	return size;
+}
+
+static gchar *
+create_file (Fixture     *fixture,
+             const gchar *dirname,
+             const gchar *basename,
+             const gchar *contents)
+{
+	gchar *dir, *path, *uri;
+
+	dir = g_build_filename (fixture->tmp_dir, dirname, NULL);
+	g_mkdir_with_parents (dir, 0700);
+	path = g_build_filename (dir, basename, NULL);
+	g_assert (g_file_set_contents (path, contents, -1, NULL));
+	uri = g_filename_to_uri (path, NULL, NULL);
+
+	g_free (path);
+	g_free (dir);
+
+	return uri;
+}
+
+static TrackerExtractInfo *
+create_info (const gchar *uri,
+             const gchar *metadata)
+{
+	TrackerExtractInfo *info;
+	GFile *file;
+
+	file = g_file_new_for_uri (uri);
+	info = tracker_extract_info_new (file, "text/plain", NULL);
+	g_object_unref (file);
+
+	tracker_sparql_builder_append (tracker_extract_info_get_metadata_builder (info),
+	                               metadata);
+	tracker_extract_info_set_where_clause (info, "?urn a nfo:Document");
+
+	return info;
+}
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  data)
+{
+	gchar *cache_dir;
+
+	fixture->tmp_dir = g_dir_make_tmp ("tracker-extract-cache-test-XXXXXX", NULL);
+	g_assert (fixture->tmp_dir != NULL);
+
+	cache_dir = g_build_filename (fixture->tmp_dir, "cache", NULL);
+	fixture->cache = tracker_extract_cache_new (cache_dir, GPOINTER_TO_UINT (data));
+	g_free (cache_dir);
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  data)
+{
+	tracker_extract_cache_free (fixture->cache);
+	remove_recursively (fixture->tmp_dir);
+	g_free (fixture->tmp_dir);
+}
+
+static void
+test_extract_cache_keys (Fixture       *fixture,
+                         gconstpointer  data)
+{
+	gchar *uri, *copy_uri, *renamed_uri, *changed_uri;
+	gchar *key, *copy_key, *key2;
+
+	uri = create_file (fixture, "a", "file.txt", "Some text");
+	copy_uri = create_file (fixture, "b", "file.txt", "Some text");
+	renamed_uri = create_file (fixture, "b", "other.txt", "Some text");
+	changed_uri = create_file (fixture, "c", "file.txt", "Some other text");
+
+	key = tracker_extract_cache_get_key (fixture->cache, uri, "text/plain", NULL);
+	g_assert (key != NULL);
+
+	/* Copies in other directories share results */
+	copy_key = tracker_extract_cache_get_key (fixture->cache, copy_uri, "text/plain", NULL);
+	g_assert_cmpstr (key, ==, copy_key);
+	g_free (copy_key);
+
+	key2 = tracker_extract_cache_get_key (fixture->cache, renamed_uri, "text/plain", NULL);
+	g_assert_cmpstr (key, !=, key2);
+	g_free (key2);
+
+	key2 = tracker_extract_cache_get_key (fixture->cache, changed_uri, "text/plain", NULL);
+	g_assert_cmpstr (key, !=, key2);
+	g_free (key2);
+
+	key2 = tracker_extract_cache_get_key (fixture->cache, uri, "text/x-log", NULL);
+	g_assert_cmpstr (key, !=, key2);
+	g_free (key2);
+
+	key2 = tracker_extract_cache_get_key (fixture->cache, uri, "text/plain", "urn:graph");
+	g_assert_cmpstr (key, !=, key2);
+	g_free (key2);
+
+	/* Only local files have keys */
+	g_assert (tracker_extract_cache_get_key (fixture->cache, "http://example.org/file.txt",
+	                                         "text/plain", NULL) == NULL);
+
+	g_free (key);
+	g_free (changed_uri);
+	g_free (renamed_uri);
+	g_free (copy_uri);
+	g_free (uri);
+}
+
+static void
+test_extract_cache_store_lookup (Fixture       *fixture,
+                                 gconstpointer  data)
+{
+	TrackerExtractInfo *info, *cached;
+	gchar *uri, *copy_uri, *key;
+	GFile *file;
+
+	uri = create_file (fixture, "a", "file.txt", "Some text");
+	copy_uri = create_file (fixture, "b", "file.txt", "Some text");
+	key = tracker_extract_cache_get_key (fixture->cache, uri, "text/plain", NULL);
+
+	g_assert (tracker_extract_cache_lookup (fixture->cache, key, uri,
+	                                        "text/plain", NULL) == NULL);
+
+	info = create_info (uri, "a nfo:PlainTextDocument");
+	tracker_extract_cache_store (fixture->cache, key, info);
+	tracker_extract_info_unref (info);
+
+	/* Results not referring to the file location are
+	 * shared with copies in other directories.
+	 */
+	cached = tracker_extract_cache_lookup (fixture->cache, key, copy_uri,
+	                                       "text/plain", NULL);
+	g_assert (cached != NULL);
+
+	/* The result is for the file looked up */
+	file = g_file_new_for_uri (copy_uri);
+	g_assert (g_file_equal (file, tracker_extract_info_get_file (cached)));
+	g_object_unref (file);
+
+	g_assert_cmpstr (tracker_sparql_builder_get_result (tracker_extract_info_get_metadata_builder (cached)),
+	                 ==, "a nfo:PlainTextDocument");
+	g_assert_cmpstr (tracker_extract_info_get_where_clause (cached), ==, "?urn a nfo:Document");
+	g_assert_cmpint (tracker_sparql_builder_get_length (tracker_extract_info_get_preupdate_builder (cached)),
+	                 ==, 0);
+	g_assert_cmpint (tracker_sparql_builder_get_length (tracker_extract_info_get_postupdate_builder (cached)),
+	                 ==, 0);
+
+	tracker_extract_info_unref (cached);
+	g_free (key);
+	g_free (copy_uri);
+	g_free (uri);
+}
+
+static void
+test_extract_cache_location (Fixture       *fixture,
+                             gconstpointer  data)
+{
+	TrackerExtractInfo *info;
+	gchar *uri, *copy_uri, *key, *copy_key, *postupdate;
+
+	uri = create_file (fixture, "a", "album.cue", "FILE \"album.flac\" WAVE");
+	copy_uri = create_file (fixture, "b", "album.cue", "FILE \"album.flac\" WAVE");
+
+	key = tracker_extract_cache_get_key (fixture->cache, uri, "text/plain", NULL);
+	copy_key = tracker_extract_cache_get_key (fixture->cache, copy_uri, "text/plain", NULL);
+	g_assert_cmpstr (key, ==, copy_key);
+
+	/* Like CUE sheet tracks, referring to the file by its URL */
+	info = create_info (uri, "a nfo:PlainTextDocument");
+	postupdate = g_strdup_printf ("?track nie:url \"%s\"", uri);
+	tracker_sparql_builder_append (tracker_extract_info_get_postupdate_builder (info),
+	                               postupdate);
+	tracker_extract_cache_store (fixture->cache, key, info);
+	tracker_extract_info_unref (info);
+
+	/* The copy must not get the location of the original */
+	g_assert (tracker_extract_cache_lookup (fixture->cache, copy_key, copy_uri,
+	                                        "text/plain", NULL) == NULL);
+	g_assert (tracker_extract_cache_lookup (fixture->cache, key, uri,
+	                                        "text/plain", NULL) == NULL);
+
+	g_free (postupdate);
+	g_free (copy_key);
+	g_free (key);
+	g_free (copy_uri);
+	g_free (uri);
+}
+
+static void
+test_extract_cache_eviction (Fixture       *fixture,
+                             gconstpointer  data)
+{
+	TrackerExtractInfo *info;
+	gchar *uri, *cache_dir;
+	gint i;
+
+	uri = create_file (fixture, "a", "file.txt", "Some text");
+	info = create_info (uri, "a nfo:PlainTextDocument");
+
+	for (i = 0; i < 2000; i++) {
+		gchar *key, *str;
+
+		str = g_strdup_printf ("%d", i);
+		key = g_compute_checksum_for_string (G_CHECKSUM_SHA1, str, -1);
+		tracker_extract_cache_store (fixture->cache, key, info);
+		g_free (key);
+		g_free (str);
+	}
+
+	cache_dir = g_build_filename (fixture->tmp_dir, "cache", NULL);
+	g_assert_cmpuint (get_size_recursively (cache_dir), >, 0);
+	g_assert_cmpuint (get_size_recursively (cache_dir), <=, GPOINTER_TO_UINT (data));
+	g_free (cache_dir);
+
+	tracker_extract_info_unref (info);
+	g_free (uri);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/tracker-extract/extract-cache/keys",
+	            Fixture, GUINT_TO_POINTER (1024 * 1024),
+	            fixture_setup, test_extract_cache_keys, fixture_teardown);
+	g_test_add ("/tracker-extract/extract-cache/store-lookup",
+	            Fixture, GUINT_TO_POINTER (1024 * 1024),
+	            fixture_setup, test_extract_cache_store_lookup, fixture_teardown);
+	g_test_add ("/tracker-extract/extract-cache/location",
+	            Fixture, GUINT_TO_POINTER (1024 * 1024),
+	            fixture_setup, test_extract_cache_location, fixture_teardown);
+	g_test_add ("/tracker-extract/extract-cache/eviction",
+	            Fixture, GUINT_TO_POINTER (16 * 1024),
+	            fixture_setup, test_extract_cache_eviction, fixture_teardown);
+
+	return g_test_run ();
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+
+#include <tracker-extract/tracker-extract-channel.h>
+
+/* Sends extraction results of several sizes from a worker thread to
+ * the extractor end of a channel, either copied through the rings or
+ * handed in memory files, and reports the time taken and the bytes
+ * the channel copies for each document.
+ */
+
+#define REPLY_TYPE G_VARIANT_TYPE ("(bayayayayayay)")
+
+static gint n_documents = 100;
+
+static const GOptionEntry options [] = {
+	{
+		"documents", 'n', 0,
+		G_OPTION_ARG_INT, &n_documents,
+		"Number of documents for each size (default: 100)",
+		NULL
+	},
+	{ NULL }
+};
+
+static const gsize text_sizes[] = {
+	4 * 1024,
+	64 * 1024,
+	1024 * 1024,
+	8 * 1024 * 1024
+};
+
+typedef struct {
+	TrackerExtractChannel *channel;
+	gchar *text;
+} SenderData;
+
+static gpointer
+sender_thread (gpointer user_data)
+{
+	SenderData *data = user_data;
+	GError *error = NULL;
+	gint i;
+
+	for (i = 0; i < n_documents; i++) {
+		GVariant *reply;
+
+		/* Building the reply copies the text once */
+		reply = g_variant_new ("(b^ay^ay^ay^ay^ay^ay)", TRUE, "",
+		                       "application/pdf", "",
+		                       data->text, "", "");
+
+		if (!tracker_extract_channel_send (data->channel, reply, TRUE, &error)) {
+			g_printerr ("Could not send reply: %s\n", error->message);
+			g_error_free (error);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static gboolean
+run_benchmark (gsize     text_size,
+               gboolean  out_of_line,
+               gdouble  *elapsed)
+{
+	TrackerExtractChannel *channel, *peer;
+	gint memory_fd, socket_fd, n_received = 0;
+	GError *error = NULL;
+	SenderData data;
+	GThread *thread;
+	GTimer *timer;
+
+	channel = tracker_extract_channel_new (&memory_fd, &socket_fd, &error);
+
+	if (!channel) {
+		g_printerr ("Could not create channel: %s\n", error->message);
+		g_error_free (error);
+		return FALSE;
+	}
+
+	peer = tracker_extract_channel_new_for_fds (memory_fd, socket_fd, &error);
+	close (memory_fd);
+
+	if (!peer) {
+		g_printerr ("Could not create channel: %s\n", error->message);
+		g_error_free (error);
+		tracker_extract_channel_free (channel);
+		return FALSE;
+	}
+
+	tracker_extract_channel_set_out_of_line_size (peer, out_of_line ? 0 : G_MAXSIZE);
+
+	data.channel = peer;
+	data.text = g_malloc (text_size + 1);
+	memset (data.text, 'a', text_size);
+	data.text[text_size] = '\0';
+
+	timer = g_timer_new ();
+	thread = g_thread_new ("sender", sender_thread, &data);
+
+	while (n_received < n_documents) {
+		struct pollfd fd = { 0 };
+		GVariant *reply;
+
+		fd.fd = tracker_extract_channel_get_fd (channel);
+		fd.events = POLLIN;
+		poll (&fd, 1, -1);
+
+		while ((reply = tracker_extract_channel_receive (channel,
+		                                                 REPLY_TYPE,
+		                                                 &error)) != NULL) {
+			const gchar *metadata;
+
+			/* Read as the extractor does */
+			g_variant_get_child (reply, 4, "^&ay", &metadata);
+			g_assert_cmpuint (strlen (metadata), ==, text_size);
+
+			g_variant_unref (reply);
+			n_received++;
+		}
+
+		if (error) {
+			g_printerr ("Could not receive reply: %s\n", error->message);
+			g_error_free (error);
+			break;
+		}
+	}
+
+	*elapsed = g_timer_elapsed (timer, NULL);
+
+	g_thread_join (thread);
+	g_timer_destroy (timer);
+	g_free (data.text);
+	tracker_extract_channel_free (peer);
+	tracker_extract_channel_free (channel);
+
+	return n_received == n_documents;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	guint i;
+
+	context = g_option_context_new ("- Benchmark extractor result transfer");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+
+	g_option_context_free (context);
+
+	g_print ("%10s %12s %14s %14s\n",
+	         "Text size", "Transfer", "ms/document", "Copied bytes");
+
+	for (i = 0; i < G_N_ELEMENTS (text_sizes); i++) {
+		gdouble ring_time, memory_time;
+
+		if (!run_benchmark (text_sizes[i], FALSE, &ring_time) ||
+		    !run_benchmark (text_sizes[i], TRUE, &memory_time)) {
+			return EXIT_FAILURE;
+		}
+
+		/* Serializing, writing to and reading from the ring,
+		 * against only serializing into the memory file.
+		 */
+		g_print ("%10" G_GSIZE_FORMAT " %12s %14.3f %14" G_GSIZE_FORMAT "\n",
+		         text_sizes[i], "ring",
+		         ring_time * 1000 / n_documents, 3 * text_sizes[i]);
+		g_print ("%10" G_GSIZE_FORMAT " %12s %14.3f %14" G_GSIZE_FORMAT "\n",
+		         text_sizes[i], "memory file",
+		         memory_time * 1000 / n_documents, text_sizes[i]);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,439 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include <gio/gio.h>
+
+#include <tracker-extract/tracker-extract-channel.h>
+
+/* Mirrors the shared memory layout in tracker-extract-channel.c,
+ * so tests can write raw data as a misbehaving worker would.
+ */
+#define RING_SIZE (1 << 20)
+
+typedef struct {
+	volatile gint head;
+	volatile gint tail;
+} RingHeader;
+
+#define RING_MEMORY_SIZE (sizeof (RingHeader) + RING_SIZE)
+#define MEMORY_SIZE (2 * RING_MEMORY_SIZE)
+
+#define OUT_OF_LINE_FLAG (G_GUINT64_CONSTANT (1) << 63)
+
+typedef struct {
+	TrackerExtractChannel *channel;
+	TrackerExtractChannel *peer;
+} Fixture;
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  data)
+{
+	gint memory_fd, socket_fd;
+	GError *error = NULL;
+
+	fixture->channel = tracker_extract_channel_new (&memory_fd, &socket_fd, &error);
+	g_assert_no_error (error);
+
+	fixture->peer = tracker_extract_channel_new_for_fds (memory_fd, socket_fd, &error);
+	g_assert_no_error (error);
+	close (memory_fd);
+
+	/* Everything goes through the rings unless told otherwise */
+	tracker_extract_channel_set_out_of_line_size (fixture->channel, G_MAXSIZE);
+	tracker_extract_channel_set_out_of_line_size (fixture->peer, G_MAXSIZE);
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  data)
+{
+	if (fixture->peer) {
+		tracker_extract_channel_free (fixture->peer);
+	}
+
+	tracker_extract_channel_free (fixture->channel);
+}
+
+static GVariant *
+create_message (gsize  size,
+                guchar seed)
+{
+	GVariant *message;
+	guchar *data;
+	gsize i;
+
+	data = g_malloc (size);
+
+	for (i = 0; i < size; i++) {
+		data[i] = (guchar) (seed + i);
+	}
+
+	message = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, data, size, 1);
+	g_free (data);
+
+	return message;
+}
+
+static void
+check_message (GVariant *message,
+               gsize     size,
+               guchar    seed)
+{
+	const guchar *data;
+	gsize i, len;
+
+	g_assert (message != NULL);
+	data = g_variant_get_fixed_array (message, &len, 1);
+	g_assert_cmpuint (len, ==, size);
+
+	for (i = 0; i < size; i++) {
+		g_assert_cmpuint (data[i], ==, (guchar) (seed + i));
+	}
+}
+
+/* Waits until a whole message or an error arrives */
+static GVariant *
+receive_message (TrackerExtractChannel  *channel,
+                 GError                **error)
+{
+	GVariant *message;
+
+	while (TRUE) {
+		struct pollfd fd = { 0 };
+		GError *inner_error = NULL;
+
+		message = tracker_extract_channel_receive (channel,
+		                                           G_VARIANT_TYPE_BYTESTRING,
+		                                           &inner_error);
+
+		if (message || inner_error) {
+			g_propagate_error (error, inner_error);
+			return message;
+		}
+
+		fd.fd = tracker_extract_channel_get_fd (channel);
+		fd.events = POLLIN;
+		poll (&fd, 1, -1);
+	}
+}
+
+static void
+test_channel_wraparound (Fixture       *fixture,
+                         gconstpointer  data)
+{
+	GError *error = NULL;
+	GVariant *message;
+	guint i;
+
+	/* Several times around the ring, with messages
+	 * not dividing its size.
+	 */
+	for (i = 0; i < 12; i++) {
+		gsize size = 300 * 1024 + i;
+
+		g_assert (tracker_extract_channel_send (fixture->peer,
+		                                        create_message (size, i),
+		                                        FALSE, &error));
+		g_assert_no_error (error);
+
+		message = receive_message (fixture->channel, &error);
+		g_assert_no_error (error);
+		check_message (message, size, i);
+		g_variant_unref (message);
+	}
+}
+
+static gpointer
+send_thread (gpointer user_data)
+{
+	TrackerExtractChannel *peer = user_data;
+	GError *error = NULL;
+	gboolean retval;
+
+	retval = tracker_extract_channel_send (peer,
+	                                       create_message (3 * RING_SIZE, 1),
+	                                       TRUE, &error);
+	g_assert_no_error (error);
+
+	return GINT_TO_POINTER (retval);
+}
+
+static void
+test_channel_big_message (Fixture       *fixture,
+                          gconstpointer  data)
+{
+	GError *error = NULL;
+	GVariant *message;
+	GThread *thread;
+
+	/* Copied through the ring in several pieces */
+	thread = g_thread_new ("sender", send_thread, fixture->peer);
+
+	message = receive_message (fixture->channel, &error);
+	g_assert_no_error (error);
+	check_message (message, 3 * RING_SIZE, 1);
+	g_variant_unref (message);
+
+	g_assert (GPOINTER_TO_INT (g_thread_join (thread)));
+
+	/* Handed over in a memory file, only the size goes
+	 * through the ring, so this doesn't block.
+	 */
+	tracker_extract_channel_set_out_of_line_size (fixture->peer, 64 * 1024);
+	g_assert (tracker_extract_channel_send (fixture->peer,
+	                                        create_message (3 * RING_SIZE, 2),
+	                                        FALSE, &error));
+	g_assert_no_error (error);
+
+	message = receive_message (fixture->channel, &error);
+	g_assert_no_error (error);
+	check_message (message, 3 * RING_SIZE, 2);
+	g_variant_unref (message);
+}
+
+static void
+test_channel_would_block (Fixture       *fixture,
+                          gconstpointer  data)
+{
+	GError *error = NULL;
+	GVariant *message;
+
+	g_assert (tracker_extract_channel_send (fixture->peer,
+	                                        create_message (600 * 1024, 1),
+	                                        FALSE, &error));
+	g_assert_no_error (error);
+
+	/* No room left for another one */
+	g_assert (!tracker_extract_channel_send (fixture->peer,
+	                                         create_message (600 * 1024, 2),
+	                                         FALSE, &error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK);
+	g_clear_error (&error);
+
+	message = receive_message (fixture->channel, &error);
+	g_assert_no_error (error);
+	check_message (message, 600 * 1024, 1);
+	g_variant_unref (message);
+
+	/* Nothing of the refused message was sent */
+	g_assert (tracker_extract_channel_receive (fixture->channel,
+	                                           G_VARIANT_TYPE_BYTESTRING,
+	                                           &error) == NULL);
+	g_assert_no_error (error);
+
+	g_assert (tracker_extract_channel_send (fixture->peer,
+	                                        create_message (600 * 1024, 3),
+	                                        FALSE, &error));
+	g_assert_no_error (error);
+
+	message = receive_message (fixture->channel, &error);
+	g_assert_no_error (error);
+	check_message (message, 600 * 1024, 3);
+	g_variant_unref (message);
+}
+
+static void
+test_channel_peer_closed (Fixture       *fixture,
+                          gconstpointer  data)
+{
+	GError *error = NULL;
+	GVariant *message;
+
+	/* Messages sent before closing are still received */
+	g_assert (tracker_extract_channel_send (fixture->peer,
+	                                        create_message (1024, 1),
+	                                        FALSE, &error));
+	g_assert_no_error (error);
+
+	tracker_extract_channel_free (fixture->peer);
+	fixture->peer = NULL;
+
+	message = receive_message (fixture->channel, &error);
+	g_assert_no_error (error);
+	check_message (message, 1024, 1);
+	g_variant_unref (message);
+
+	message = receive_message (fixture->channel, &error);
+	g_assert (message == NULL);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CLOSED);
+	g_clear_error (&error);
+}
+
+/* Writes @len bytes into the worker to extractor ring, then
+ * wakes up the extractor end.
+ */
+static void
+raw_send (gpointer       memory,
+          gint           socket_fd,
+          gconstpointer  data,
+          gsize          len)
+{
+	RingHeader *header;
+	guchar *ring;
+
+	header = (RingHeader *) ((guchar *) memory + RING_MEMORY_SIZE);
+	ring = (guchar *) header + sizeof (RingHeader);
+
+	g_assert_cmpuint (len, <=, RING_SIZE - (header->head & (RING_SIZE - 1)));
+	memcpy (&ring[header->head & (RING_SIZE - 1)], data, len);
+	header->head += len;
+
+	g_assert_cmpint (send (socket_fd, "", 1, 0), ==, 1);
+}
+
+static void
+check_invalid_header (guint64 header)
+{
+	TrackerExtractChannel *channel;
+	gint memory_fd, socket_fd;
+	GError *error = NULL;
+	gpointer memory;
+
+	channel = tracker_extract_channel_new (&memory_fd, &socket_fd, &error);
+	g_assert_no_error (error);
+
+	memory = mmap (NULL, MEMORY_SIZE, PROT_READ | PROT_WRITE,
+	               MAP_SHARED, memory_fd, 0);
+	g_assert (memory != MAP_FAILED);
+
+	raw_send (memory, socket_fd, &header, sizeof (header));
+
+	g_assert (receive_message (channel, &error) == NULL);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_clear_error (&error);
+
+	/* The peer is not trusted any longer */
+	g_assert (receive_message (channel, &error) == NULL);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+
+	munmap (memory, MEMORY_SIZE);
+	close (memory_fd);
+	close (socket_fd);
+	tracker_extract_channel_free (channel);
+}
+
+static void
+check_invalid_positions (void)
+{
+	TrackerExtractChannel *channel;
+	gint memory_fd, socket_fd;
+	GError *error = NULL;
+	RingHeader *header;
+	gpointer memory;
+
+	channel = tracker_extract_channel_new (&memory_fd, &socket_fd, &error);
+	g_assert_no_error (error);
+
+	memory = mmap (NULL, MEMORY_SIZE, PROT_READ | PROT_WRITE,
+	               MAP_SHARED, memory_fd, 0);
+	g_assert (memory != MAP_FAILED);
+
+	/* Claim more data than the worker to extractor ring holds */
+	header = (RingHeader *) ((guchar *) memory + RING_MEMORY_SIZE);
+	header->head = header->tail + RING_SIZE + 1;
+	g_assert_cmpint (send (socket_fd, "", 1, 0), ==, 1);
+
+	g_assert (receive_message (channel, &error) == NULL);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_clear_error (&error);
+
+	g_assert (receive_message (channel, &error) == NULL);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+
+	munmap (memory, MEMORY_SIZE);
+	close (memory_fd);
+	close (socket_fd);
+	tracker_extract_channel_free (channel);
+
+	channel = tracker_extract_channel_new (&memory_fd, &socket_fd, &error);
+	g_assert_no_error (error);
+
+	memory = mmap (NULL, MEMORY_SIZE, PROT_READ | PROT_WRITE,
+	               MAP_SHARED, memory_fd, 0);
+	g_assert (memory != MAP_FAILED);
+
+	/* Move the extractor to worker ring tail past its head */
+	header = (RingHeader *) memory;
+	header->tail = header->head + 1;
+
+	g_assert (!tracker_extract_channel_send (channel,
+	                                         create_message (16, 1),
+	                                         FALSE, &error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_clear_error (&error);
+
+	g_assert (!tracker_extract_channel_send (channel,
+	                                         create_message (16, 1),
+	                                         TRUE, &error));
+	g_assert (error != NULL);
+	g_clear_error (&error);
+
+	munmap (memory, MEMORY_SIZE);
+	close (memory_fd);
+	close (socket_fd);
+	tracker_extract_channel_free (channel);
+}
+
+static void
+test_channel_invalid_header (void)
+{
+	/* Over the maximum message size */
+	check_invalid_header (G_GUINT64_CONSTANT (512) * 1024 * 1024);
+	check_invalid_header ((G_GUINT64_CONSTANT (512) * 1024 * 1024) | OUT_OF_LINE_FLAG);
+
+	/* Out of line, but no memory file was sent */
+	check_invalid_header (1024 | OUT_OF_LINE_FLAG);
+
+	/* Ring positions forged by the peer */
+	check_invalid_positions ();
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/tracker-extract/extract-channel/wraparound",
+	            Fixture, NULL,
+	            fixture_setup, test_channel_wraparound, fixture_teardown);
+	g_test_add ("/tracker-extract/extract-channel/big-message",
+	            Fixture, NULL,
+	            fixture_setup, test_channel_big_message, fixture_teardown);
+	g_test_add ("/tracker-extract/extract-channel/would-block",
+	            Fixture, NULL,
+	            fixture_setup, test_channel_would_block, fixture_teardown);
+	g_test_add ("/tracker-extract/extract-channel/peer-closed",
+	            Fixture, NULL,
+	            fixture_setup, test_channel_peer_closed, fixture_teardown);
+	g_test_add_func ("/tracker-extract/extract-channel/invalid-header",
+	                 test_channel_invalid_header);
+
+	return g_test_run ();
+}
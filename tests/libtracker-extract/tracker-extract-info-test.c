@@ -25,6 +25,7 @@ static void
 test_extract_info_setters (void)
 {
         TrackerExtractInfo *info, *info_ref;
+        GCancellable *cancellable;
         GFile *file;
 
         file = g_file_new_for_path ("./imaginary-file-2");
@@ -44,6 +45,14 @@ test_extract_info_setters (void)
         tracker_extract_info_set_where_clause (info, "where stuff");
         g_assert_cmpstr (tracker_extract_info_get_where_clause (info), ==, "where stuff");
 
+        g_assert (!tracker_extract_info_get_cancellable (info));
+        cancellable = g_cancellable_new ();
+        tracker_extract_info_set_cancellable (info, cancellable);
+        g_assert (tracker_extract_info_get_cancellable (info) == cancellable);
+        g_object_unref (cancellable);
+        tracker_extract_info_set_cancellable (info, NULL);
+        g_assert (!tracker_extract_info_get_cancellable (info));
+
         tracker_extract_info_unref (info_ref);
         tracker_extract_info_unref (info);
 
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+/* Measures how long it takes to find the extractor rules for a
+ * mimetype, both the first time a mimetype is seen and once the
+ * result is cached, and then to resolve the modules handling it as
+ * the extractor does for every file. Lookups mix mimetypes matched
+ * exactly, through wildcards only, and not handled at all.
+ */
+
+static gint n_lookups = 1000000;
+static gint n_mimetypes = 1000;
+static gchar *rules_dir = NULL;
+
+static const GOptionEntry options [] = {
+	{
+		"lookups", 'n', 0,
+		G_OPTION_ARG_INT, &n_lookups,
+		"Number of lookups (default: 1000000)",
+		NULL
+	},
+	{
+		"mimetypes", 't', 0,
+		G_OPTION_ARG_INT, &n_mimetypes,
+		"Number of distinct mimetypes (default: 1000)",
+		NULL
+	},
+	{
+		"rules-dir", 'r', 0,
+		G_OPTION_ARG_FILENAME, &rules_dir,
+		"Directory holding the extractor rules",
+		NULL
+	},
+	{ NULL }
+};
+
+static const gchar *known_mimetypes[] = {
+	"image/png",
+	"image/jpeg",
+	"application/pdf",
+	"audio/mpeg",
+	"text/plain",
+	"video/x-matroska",
+	"audio/x-unknown-codec",
+	"application/x-unknown",
+};
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	GPtrArray *mimetypes;
+	gdouble cold_time, warm_time, handlers_time;
+	gint i, n_handled = 0, n_resolved = 0;
+	GTimer *timer;
+
+	context = g_option_context_new ("- Benchmark extractor rule lookups");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+
+	g_option_context_free (context);
+
+	if (!rules_dir) {
+		rules_dir = g_build_filename (TOP_SRCDIR, "src", "tracker-extract", NULL);
+	}
+
+	g_setenv ("TRACKER_EXTRACTOR_RULES_DIR", rules_dir, TRUE);
+
+	if (!tracker_extract_module_manager_init ()) {
+		g_printerr ("Could not load the extractor rules in '%s'\n", rules_dir);
+		return EXIT_FAILURE;
+	}
+
+	mimetypes = g_ptr_array_new_with_free_func (g_free);
+
+	for (i = 0; i < n_mimetypes; i++) {
+		if (i < G_N_ELEMENTS (known_mimetypes)) {
+			g_ptr_array_add (mimetypes, g_strdup (known_mimetypes[i]));
+		} else {
+			g_ptr_array_add (mimetypes, g_strdup_printf ("%s-%d",
+			                                             known_mimetypes[i % G_N_ELEMENTS (known_mimetypes)],
+			                                             i));
+		}
+	}
+
+	timer = g_timer_new ();
+
+	for (i = 0; i < n_mimetypes; i++) {
+		if (tracker_extract_module_manager_mimetype_is_handled (g_ptr_array_index (mimetypes, i))) {
+			n_handled++;
+		}
+	}
+
+	cold_time = g_timer_elapsed (timer, NULL);
+	g_timer_start (timer);
+
+	for (i = 0; i < n_lookups; i++) {
+		tracker_extract_module_manager_mimetype_is_handled (g_ptr_array_index (mimetypes, i % n_mimetypes));
+	}
+
+	warm_time = g_timer_elapsed (timer, NULL);
+	g_timer_start (timer);
+
+	/* Modules are loaded on the first lookups, and not
+	 * tried again if these can't be loaded.
+	 */
+	for (i = 0; i < n_lookups; i++) {
+		TrackerMimetypeInfo *info;
+
+		info = tracker_extract_module_manager_get_mimetype_handlers (g_ptr_array_index (mimetypes, i % n_mimetypes));
+
+		if (info) {
+			n_resolved++;
+			tracker_mimetype_info_free (info);
+		}
+	}
+
+	handlers_time = g_timer_elapsed (timer, NULL);
+
+	g_print ("Looked up extractor rules for %d mimetypes, %d handled\n",
+	         n_mimetypes, n_handled);
+	g_print ("  First lookups: %8.3f s, %8.3f us/lookup\n",
+	         cold_time, cold_time * G_USEC_PER_SEC / n_mimetypes);
+	g_print ("  %d lookups: %8.3f s, %8.3f us/lookup\n",
+	         n_lookups, warm_time, warm_time * G_USEC_PER_SEC / n_lookups);
+	g_print ("  %d handler lookups: %8.3f s, %8.3f us/lookup, %d with modules\n",
+	         n_lookups, handlers_time, handlers_time * G_USEC_PER_SEC / n_lookups,
+	         n_resolved);
+
+	g_timer_destroy (timer);
+	g_ptr_array_unref (mimetypes);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+#define DUMMY_MODULE_PATH \
+	TOP_BUILDDIR "/tests/libtracker-extract/.libs/libextract-dummy." G_MODULE_SUFFIX
+
+/* Rules are told apart through their timeouts, each one is
+ * a distinct power of 2, so the sum tells which rules match.
+ */
+static const struct {
+	const gchar *name;
+	const gchar *mimetypes;
+	guint timeout;
+} rules[] = {
+	{ "10-png.rule", "image/png;", 1 },
+	/* Matches image/png both exactly and through the wildcard */
+	{ "20-images.rule", "image/*;image/png;", 2 },
+	{ "30-png.rule", "image/x-png;image/png;", 4 },
+	{ "40-all.rule", "*;", 8 },
+};
+
+static gchar *rules_dir = NULL;
+
+static void
+write_rules (void)
+{
+	GError *error = NULL;
+	guint i;
+
+	rules_dir = g_dir_make_tmp ("tracker-module-manager-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	for (i = 0; i < G_N_ELEMENTS (rules); i++) {
+		gchar *path, *contents;
+
+		path = g_build_filename (rules_dir, rules[i].name, NULL);
+		contents = g_strdup_printf ("[ExtractorRule]\n"
+		                            "ModulePath=%s\n"
+		                            "MimeTypes=%s\n"
+		                            "Timeout=%u\n",
+		                            DUMMY_MODULE_PATH,
+		                            rules[i].mimetypes,
+		                            rules[i].timeout);
+
+		g_file_set_contents (path, contents, -1, &error);
+		g_assert_no_error (error);
+
+		g_free (contents);
+		g_free (path);
+	}
+}
+
+static void
+remove_rules (void)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (rules); i++) {
+		gchar *path;
+
+		path = g_build_filename (rules_dir, rules[i].name, NULL);
+		g_unlink (path);
+		g_free (path);
+	}
+
+	g_rmdir (rules_dir);
+	g_free (rules_dir);
+}
+
+/* Checks the rules handling @mimetype, by the timeouts
+ * of each, in the order these are tried.
+ */
+static void
+check_handlers (const gchar *mimetype,
+                const guint *timeouts,
+                guint        n_timeouts)
+{
+	TrackerMimetypeInfo *info;
+	guint i = 0, total = 0;
+
+	info = tracker_extract_module_manager_get_mimetype_handlers (mimetype);
+	g_assert (info != NULL);
+
+	do {
+		g_assert_cmpuint (i, <, n_timeouts);
+		g_assert_cmpuint (tracker_mimetype_info_get_timeout (info), ==, timeouts[i]);
+		total += timeouts[i];
+		i++;
+	} while (tracker_mimetype_info_iter_next (info));
+
+	tracker_mimetype_info_free (info);
+
+	g_assert_cmpuint (i, ==, n_timeouts);
+
+	/* Also computed without loading modules */
+	g_assert_cmpuint (tracker_extract_module_manager_get_timeout (mimetype), ==, total);
+	g_assert_cmpstr (tracker_extract_module_manager_get_module_path (mimetype), ==, DUMMY_MODULE_PATH);
+}
+
+static void
+test_module_manager_rule_order (void)
+{
+	const guint png[] = { 1, 2, 4, 8 };
+	const guint x_png[] = { 2, 4, 8 };
+	const guint jpeg[] = { 2, 8 };
+	const guint text[] = { 8 };
+
+	check_handlers ("image/png", png, G_N_ELEMENTS (png));
+	check_handlers ("image/x-png", x_png, G_N_ELEMENTS (x_png));
+	check_handlers ("image/jpeg", jpeg, G_N_ELEMENTS (jpeg));
+	check_handlers ("text/plain", text, G_N_ELEMENTS (text));
+
+	/* Cached results are the same */
+	check_handlers ("image/png", png, G_N_ELEMENTS (png));
+	check_handlers ("image/jpeg", jpeg, G_N_ELEMENTS (jpeg));
+}
+
+int
+main (int argc, char **argv)
+{
+	gint retval;
+
+	g_test_init (&argc, &argv, NULL);
+
+	write_rules ();
+	g_setenv ("TRACKER_EXTRACTOR_RULES_DIR", rules_dir, TRUE);
+	g_assert (tracker_extract_module_manager_init ());
+
+	g_test_add_func ("/libtracker-extract/module-manager/rule-order",
+	                 test_module_manager_rule_order);
+
+	retval = g_test_run ();
+
+	remove_rules ();
+
+	return retval;
+}
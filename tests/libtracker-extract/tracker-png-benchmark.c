@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <png.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+/* Compares extracting metadata from large PNG files by decoding the
+ * whole image through libpng, as the PNG extractor used to do, against
+ * the PNG extractor module. Metadata is written after the image data,
+ * as most editors do, so it can only be reached past IDAT.
+ */
+
+static gint width = 8000;
+static gint height = 6000;
+static gint n_files = 5;
+static gchar *module_path = NULL;
+
+static const GOptionEntry options [] = {
+	{
+		"width", 'W', 0,
+		G_OPTION_ARG_INT, &width,
+		"Width of the images (default: 8000)",
+		NULL
+	},
+	{
+		"height", 'H', 0,
+		G_OPTION_ARG_INT, &height,
+		"Height of the images (default: 6000)",
+		NULL
+	},
+	{
+		"files", 'n', 0,
+		G_OPTION_ARG_INT, &n_files,
+		"Number of images (default: 5)",
+		NULL
+	},
+	{
+		"module", 'm', 0,
+		G_OPTION_ARG_FILENAME, &module_path,
+		"Path to the PNG extractor module",
+		NULL
+	},
+	{ NULL }
+};
+
+static gboolean
+write_png (const gchar *filename,
+           gint         index)
+{
+	png_structp png_ptr;
+	png_infop info_ptr;
+	png_text text[2];
+	png_bytep row;
+	gchar *title;
+	FILE *f;
+	gint x, y;
+
+	f = g_fopen (filename, "wb");
+
+	if (!f) {
+		return FALSE;
+	}
+
+	png_ptr = png_create_write_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	info_ptr = png_create_info_struct (png_ptr);
+
+	if (setjmp (png_jmpbuf (png_ptr))) {
+		png_destroy_write_struct (&png_ptr, &info_ptr);
+		fclose (f);
+		return FALSE;
+	}
+
+	png_init_io (png_ptr, f);
+	png_set_IHDR (png_ptr, info_ptr, width, height, 8,
+	              PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+	              PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_set_compression_level (png_ptr, 1);
+	png_write_info (png_ptr, info_ptr);
+
+	row = g_malloc (width * 3);
+
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width * 3; x++) {
+			row[x] = (guchar) ((x ^ y) + x * y / 7);
+		}
+
+		png_write_row (png_ptr, row);
+	}
+
+	g_free (row);
+
+	title = g_strdup_printf ("Benchmark image %d", index);
+	memset (text, 0, sizeof (text));
+	text[0].compression = PNG_TEXT_COMPRESSION_NONE;
+	text[0].key = (png_charp) "Title";
+	text[0].text = title;
+	text[1].compression = PNG_TEXT_COMPRESSION_zTXt;
+	text[1].key = (png_charp) "Comment";
+	text[1].text = (png_charp) "Written after the image data";
+
+	/* Text set after png_write_info() goes after IDAT */
+	png_set_text (png_ptr, info_ptr, text, G_N_ELEMENTS (text));
+	png_write_end (png_ptr, info_ptr);
+
+	png_destroy_write_struct (&png_ptr, &info_ptr);
+	g_free (title);
+	fclose (f);
+
+	return TRUE;
+}
+
+static gboolean
+decode_png (const gchar *filename)
+{
+	png_structp png_ptr;
+	png_infop info_ptr, end_ptr;
+	png_bytep row;
+	png_textp text_ptr;
+	gint num_text = 0;
+	guint y;
+	FILE *f;
+
+	f = g_fopen (filename, "rb");
+
+	if (!f) {
+		return FALSE;
+	}
+
+	png_ptr = png_create_read_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	info_ptr = png_create_info_struct (png_ptr);
+	end_ptr = png_create_info_struct (png_ptr);
+
+	if (setjmp (png_jmpbuf (png_ptr))) {
+		png_destroy_read_struct (&png_ptr, &info_ptr, &end_ptr);
+		fclose (f);
+		return FALSE;
+	}
+
+	png_init_io (png_ptr, f);
+	png_read_info (png_ptr, info_ptr);
+
+	row = g_malloc (png_get_rowbytes (png_ptr, info_ptr));
+
+	for (y = 0; y < png_get_image_height (png_ptr, info_ptr); y++) {
+		png_read_row (png_ptr, row, NULL);
+	}
+
+	g_free (row);
+
+	png_read_end (png_ptr, end_ptr);
+	png_get_text (png_ptr, end_ptr, &text_ptr, &num_text);
+
+	png_destroy_read_struct (&png_ptr, &info_ptr, &end_ptr);
+	fclose (f);
+
+	return num_text > 0;
+}
+
+static gboolean
+extract_png (TrackerExtractMetadataFunc  func,
+             const gchar                *filename,
+             gint                        index)
+{
+	TrackerSparqlBuilder *builder;
+	TrackerExtractInfo *info;
+	gboolean retval;
+	gchar *title;
+	GFile *file;
+
+	file = g_file_new_for_path (filename);
+	info = tracker_extract_info_new (file, "image/png", NULL);
+	g_object_unref (file);
+
+	retval = func (info);
+
+	if (retval) {
+		builder = tracker_extract_info_get_metadata_builder (info);
+		title = g_strdup_printf ("Benchmark image %d", index);
+		retval = strstr (tracker_sparql_builder_get_result (builder), title) != NULL;
+		g_free (title);
+	}
+
+	tracker_extract_info_unref (info);
+
+	return retval;
+}
+
+int
+main (int argc, char **argv)
+{
+	TrackerExtractMetadataFunc func;
+	GOptionContext *context;
+	GError *error = NULL;
+	gdouble decode_time, extract_time;
+	GPtrArray *filenames;
+	GModule *module;
+	GTimer *timer;
+	gchar *dir;
+	gint i;
+
+	context = g_option_context_new ("- Benchmark PNG metadata extraction");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+
+	g_option_context_free (context);
+
+	if (!module_path) {
+		module_path = g_build_filename (TOP_BUILDDIR, "src", "tracker-extract",
+		                                ".libs", "libextract-png." G_MODULE_SUFFIX,
+		                                NULL);
+	}
+
+	module = g_module_open (module_path, G_MODULE_BIND_LOCAL);
+
+	if (!module ||
+	    !g_module_symbol (module, "tracker_extract_get_metadata", (gpointer *) &func)) {
+		g_printerr ("Could not load '%s': %s\n", module_path, g_module_error ());
+		return EXIT_FAILURE;
+	}
+
+	dir = g_dir_make_tmp ("tracker-png-benchmark-XXXXXX", &error);
+
+	if (!dir) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return EXIT_FAILURE;
+	}
+
+	filenames = g_ptr_array_new_with_free_func (g_free);
+
+	for (i = 0; i < n_files; i++) {
+		gchar *basename, *filename;
+
+		basename = g_strdup_printf ("image-%d.png", i);
+		filename = g_build_filename (dir, basename, NULL);
+		g_free (basename);
+
+		if (!write_png (filename, i)) {
+			g_printerr ("Could not write '%s'\n", filename);
+			g_free (filename);
+			return EXIT_FAILURE;
+		}
+
+		g_ptr_array_add (filenames, filename);
+	}
+
+	timer = g_timer_new ();
+
+	for (i = 0; i < n_files; i++) {
+		if (!decode_png (g_ptr_array_index (filenames, i))) {
+			g_printerr ("Could not decode '%s'\n",
+			            (gchar *) g_ptr_array_index (filenames, i));
+			return EXIT_FAILURE;
+		}
+	}
+
+	decode_time = g_timer_elapsed (timer, NULL);
+	g_timer_start (timer);
+
+	for (i = 0; i < n_files; i++) {
+		if (!extract_png (func, g_ptr_array_index (filenames, i), i)) {
+			g_printerr ("Could not extract metadata from '%s'\n",
+			            (gchar *) g_ptr_array_index (filenames, i));
+			return EXIT_FAILURE;
+		}
+	}
+
+	extract_time = g_timer_elapsed (timer, NULL);
+
+	g_print ("Extracted metadata from %d %dx%d images\n", n_files, width, height);
+	g_print ("  Decoding image data: %8.3f s, %8.3f s/image\n",
+	         decode_time, decode_time / n_files);
+	g_print ("  PNG extractor:       %8.3f s, %8.3f s/image\n",
+	         extract_time, extract_time / n_files);
+
+	for (i = 0; i < n_files; i++) {
+		g_unlink (g_ptr_array_index (filenames, i));
+	}
+
+	g_rmdir (dir);
+	g_free (dir);
+	g_timer_destroy (timer);
+	g_ptr_array_unref (filenames);
+	g_module_close (module);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+/* 2x1 screen with a global color table, a comment split in
+ * two sub-blocks and a single 3x2 frame.
+ */
+static const guchar gif_data[] = {
+	'G', 'I', 'F', '8', '9', 'a',
+	0x02, 0x00, 0x01, 0x00, 0x80, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF,
+	0x21, 0xFE, 0x05, 'H', 'e', 'l', 'l', 'o',
+	0x06, ' ', 'w', 'o', 'r', 'l', 'd', 0x00,
+	0x2C, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x02, 0x00, 0x00,
+	0x02, 0x02, 0x44, 0x01, 0x00,
+	0x3B
+};
+
+static void
+test_segment_scanner_jpeg_exif (void)
+{
+	TrackerSegmentScanner *scanner;
+	TrackerSegment segment;
+	gboolean found_exif = FALSE, found_sof = FALSE;
+	guint last_type = 0;
+	gchar *filename;
+
+	filename = g_build_filename (TOP_SRCDIR, "tests", "libtracker-extract", "exif-img.jpg", NULL);
+	scanner = tracker_segment_scanner_new (filename, NULL);
+	g_free (filename);
+
+	g_assert (scanner != NULL);
+	g_assert_cmpint (tracker_segment_scanner_get_format (scanner), ==, TRACKER_SEGMENT_FORMAT_JPEG);
+
+	while (tracker_segment_scanner_next (scanner, &segment)) {
+		if (segment.type == TRACKER_SEGMENT_JPEG_APP0 + 1) {
+			g_assert_cmpuint (segment.length, ==, 794);
+			g_assert (memcmp (segment.data, "Exif\0\0", 6) == 0);
+			found_exif = TRUE;
+		} else if (segment.type == TRACKER_SEGMENT_JPEG_SOF0) {
+			/* Height and width, after the precision */
+			g_assert_cmpuint (segment.data[1] << 8 | segment.data[2], ==, 64);
+			g_assert_cmpuint (segment.data[3] << 8 | segment.data[4], ==, 64);
+			found_sof = TRUE;
+		}
+
+		last_type = segment.type;
+	}
+
+	g_assert (found_exif);
+	g_assert (found_sof);
+	g_assert_cmpuint (last_type, ==, TRACKER_SEGMENT_JPEG_SOS);
+
+	tracker_segment_scanner_free (scanner);
+}
+
+static void
+test_segment_scanner_jpeg_iptc (void)
+{
+	TrackerSegmentScanner *scanner;
+	TrackerSegment segment;
+	gboolean found_jfif = FALSE, found_ps3 = FALSE;
+	gchar *filename;
+
+	filename = g_build_filename (TOP_SRCDIR, "tests", "libtracker-extract", "iptc-img.jpg", NULL);
+	scanner = tracker_segment_scanner_new (filename, NULL);
+	g_free (filename);
+
+	g_assert (scanner != NULL);
+
+	while (tracker_segment_scanner_next (scanner, &segment)) {
+		if (segment.type == TRACKER_SEGMENT_JPEG_APP0) {
+			g_assert (memcmp (segment.data, "JFIF\0", 5) == 0);
+			found_jfif = TRUE;
+		} else if (segment.type == TRACKER_SEGMENT_JPEG_APP0 + 13) {
+			g_assert (memcmp (segment.data, "Photoshop 3.0\0", 14) == 0);
+			found_ps3 = TRUE;
+		}
+	}
+
+	g_assert (found_jfif);
+	g_assert (found_ps3);
+
+	tracker_segment_scanner_free (scanner);
+}
+
+static void
+test_segment_scanner_gif (void)
+{
+	TrackerSegmentScanner *scanner;
+	TrackerSegment segment;
+	GError *error = NULL;
+	gchar *filename, *comment;
+	gsize length;
+	gint fd;
+
+	fd = g_file_open_tmp ("tracker-segment-scanner-test-XXXXXX.gif", &filename, &error);
+	g_assert_no_error (error);
+	close (fd);
+
+	g_file_set_contents (filename, (const gchar *) gif_data, sizeof (gif_data), &error);
+	g_assert_no_error (error);
+
+	scanner = tracker_segment_scanner_new (filename, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (tracker_segment_scanner_get_format (scanner), ==, TRACKER_SEGMENT_FORMAT_GIF);
+
+	g_assert (tracker_segment_scanner_next (scanner, &segment));
+	g_assert_cmpuint (segment.type, ==, TRACKER_SEGMENT_GIF_EXTENSION);
+	g_assert_cmpuint (segment.data[0], ==, 0xFE);
+
+	comment = tracker_segment_gif_get_data (&segment, &length);
+	g_assert_cmpstr (comment, ==, "Hello world");
+	g_assert_cmpuint (length, ==, 11);
+	g_free (comment);
+
+	g_assert (tracker_segment_scanner_next (scanner, &segment));
+	g_assert_cmpuint (segment.type, ==, TRACKER_SEGMENT_GIF_IMAGE);
+	g_assert_cmpuint (segment.length, ==, 9);
+	g_assert_cmpuint (segment.data[4] | segment.data[5] << 8, ==, 3);
+	g_assert_cmpuint (segment.data[6] | segment.data[7] << 8, ==, 2);
+
+	g_assert (!tracker_segment_scanner_next (scanner, &segment));
+
+	tracker_segment_scanner_free (scanner);
+
+	/* Truncated in the middle of the image data */
+	g_file_set_contents (filename, (const gchar *) gif_data, sizeof (gif_data) - 4, &error);
+	g_assert_no_error (error);
+
+	scanner = tracker_segment_scanner_new (filename, &error);
+	g_assert_no_error (error);
+
+	g_assert (tracker_segment_scanner_next (scanner, &segment));
+	g_assert_cmpuint (segment.type, ==, TRACKER_SEGMENT_GIF_EXTENSION);
+	g_assert (!tracker_segment_scanner_next (scanner, &segment));
+
+	tracker_segment_scanner_free (scanner);
+
+	g_unlink (filename);
+	g_free (filename);
+}
+
+static void
+test_segment_scanner_unknown (void)
+{
+	TrackerSegmentScanner *scanner;
+	TrackerSegment segment;
+	gchar *filename;
+
+	filename = g_build_filename (TOP_SRCDIR, "tests", "libtracker-extract", "getline-test.txt", NULL);
+	scanner = tracker_segment_scanner_new (filename, NULL);
+	g_free (filename);
+
+	g_assert (scanner != NULL);
+	g_assert_cmpint (tracker_segment_scanner_get_format (scanner), ==, TRACKER_SEGMENT_FORMAT_UNKNOWN);
+	g_assert (!tracker_segment_scanner_next (scanner, &segment));
+
+	tracker_segment_scanner_free (scanner);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-extract/tracker-segment-scanner/jpeg_exif",
+	                 test_segment_scanner_jpeg_exif);
+	g_test_add_func ("/libtracker-extract/tracker-segment-scanner/jpeg_iptc",
+	                 test_segment_scanner_jpeg_iptc);
+	g_test_add_func ("/libtracker-extract/tracker-segment-scanner/gif",
+	                 test_segment_scanner_gif);
+	g_test_add_func ("/libtracker-extract/tracker-segment-scanner/unknown",
+	                 test_segment_scanner_unknown);
+
+	return g_test_run ();
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <libtracker-fts/tracker-fts-config.h>
+#include <libtracker-data/tracker-data.h>
+
+/* Measures FTS query latency on an index built through many small
+ * transactions, as the miners do, before and after merging the
+ * index segments, and the latency of prefix queries as issued
+ * by search-as-you-type UIs. */
+
+static gint n_documents = 20000;
+static gint n_words = 50;
+static gint n_queries = 200;
+static gchar *prefix_index;
+
+static const GOptionEntry options [] = {
+	{
+		"documents", 'd', 0,
+		G_OPTION_ARG_INT, &n_documents,
+		"Number of documents to index (default: 20000)",
+		NULL
+	},
+	{
+		"words", 'w', 0,
+		G_OPTION_ARG_INT, &n_words,
+		"Number of words per document (default: 50)",
+		NULL
+	},
+	{
+		"queries", 'q', 0,
+		G_OPTION_ARG_INT, &n_queries,
+		"Number of queries to run on each pass (default: 200)",
+		NULL
+	},
+	{
+		"prefix-index", 'p', 0,
+		G_OPTION_ARG_STRING, &prefix_index,
+		"Prefix index lengths, e.g. \"2,3,4\" (default: none)",
+		NULL
+	},
+	{ NULL }
+};
+
+/* A small vocabulary, so terms have long doclists */
+static gchar *
+random_word (GRand *rand)
+{
+	return g_strdup_printf ("w%c%c%d",
+	                        'a' + g_rand_int_range (rand, 0, 26),
+	                        'a' + g_rand_int_range (rand, 0, 26),
+	                        g_rand_int_range (rand, 0, 20));
+}
+
+static void
+insert_documents (GRand *rand)
+{
+	GError *error = NULL;
+	gint i, j;
+
+	for (i = 0; i < n_documents; i++) {
+		GString *text, *update;
+
+		text = g_string_new ("");
+
+		for (j = 0; j < n_words; j++) {
+			gchar *word = random_word (rand);
+
+			g_string_append_printf (text, "%s ", word);
+			g_free (word);
+		}
+
+		update = g_string_new ("");
+		g_string_append_printf (update,
+		                        "INSERT { <test:doc%d> a test:A ; test:p \"%s\" }",
+		                        i, text->str);
+
+		/* One transaction per document, each one adds a segment */
+		tracker_data_update_sparql (update->str, &error);
+		g_assert_no_error (error);
+
+		g_string_free (update, TRUE);
+		g_string_free (text, TRUE);
+	}
+}
+
+static gdouble
+run_queries (GRand *rand)
+{
+	GError *error = NULL;
+	GTimer *timer;
+	gint i;
+
+	timer = g_timer_new ();
+
+	for (i = 0; i < n_queries; i++) {
+		TrackerDBCursor *cursor;
+		gchar *query, *word1, *word2;
+
+		word1 = random_word (rand);
+		word2 = random_word (rand);
+		query = g_strdup_printf ("SELECT ?u WHERE { ?u fts:match \"%s %s\" }",
+		                         word1, word2);
+
+		cursor = tracker_data_query_sparql_cursor (query, &error);
+		g_assert_no_error (error);
+
+		while (tracker_db_cursor_iter_next (cursor, NULL, &error))
+			;
+
+		g_assert_no_error (error);
+		g_object_unref (cursor);
+		g_free (query);
+		g_free (word1);
+		g_free (word2);
+	}
+
+	g_timer_stop (timer);
+
+	return g_timer_elapsed (timer, NULL) * 1000 / n_queries;
+}
+
+/* Prefixes of 2 to 4 characters, as typed in a search entry */
+static gdouble
+run_prefix_queries (GRand *rand)
+{
+	GError *error = NULL;
+	GTimer *timer;
+	gint i;
+
+	timer = g_timer_new ();
+
+	for (i = 0; i < n_queries; i++) {
+		TrackerDBCursor *cursor;
+		gchar *query, *word;
+
+		word = random_word (rand);
+		word[g_rand_int_range (rand, 2, 5)] = '\0';
+		query = g_strdup_printf ("SELECT ?u WHERE { ?u fts:match \"%s*\" }",
+		                         word);
+
+		cursor = tracker_data_query_sparql_cursor (query, &error);
+		g_assert_no_error (error);
+
+		while (tracker_db_cursor_iter_next (cursor, NULL, &error))
+			;
+
+		g_assert_no_error (error);
+		g_object_unref (cursor);
+		g_free (query);
+		g_free (word);
+	}
+
+	g_timer_stop (timer);
+
+	return g_timer_elapsed (timer, NULL) * 1000 / n_queries;
+}
+
+static void
+print_segments (const gchar *step)
+{
+	TrackerDBInterface *iface;
+	gint n_segments = 0, n_levels = 0;
+
+	iface = tracker_db_manager_get_db_interface ();
+	tracker_db_interface_sqlite_fts_get_segment_count (iface, &n_segments, &n_levels);
+
+	g_print ("%-24s %6d segments, %2d levels", step, n_segments, n_levels);
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	const gchar *test_schemas[2] = { NULL, NULL };
+	gchar *current_dir, *data_prefix;
+	GTimer *timer;
+	GRand *rand;
+	guint n_steps = 0;
+
+	context = g_option_context_new ("- Benchmark FTS segment merging");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+
+	g_option_context_free (context);
+
+	current_dir = g_get_current_dir ();
+	g_setenv ("XDG_DATA_HOME", current_dir, TRUE);
+	g_setenv ("XDG_CACHE_HOME", current_dir, TRUE);
+	g_setenv ("TRACKER_DB_ONTOLOGIES_DIR", TOP_SRCDIR "/data/ontologies/", TRUE);
+	g_setenv ("TRACKER_FTS_STOP_WORDS", "0", TRUE);
+	g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+	g_free (current_dir);
+
+	if (prefix_index) {
+		TrackerFTSConfig *config;
+
+		config = tracker_fts_config_new ();
+		tracker_fts_config_set_prefix_index (config, prefix_index);
+		tracker_fts_config_save (config);
+		g_object_unref (config);
+	}
+
+	data_prefix = g_build_filename (TOP_SRCDIR, "tests", "libtracker-fts", "data", NULL);
+	test_schemas[0] = data_prefix;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           test_schemas,
+	                           NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	rand = g_rand_new_with_seed (42);
+
+	g_print ("Indexing %d documents of %d words...\n", n_documents, n_words);
+	insert_documents (rand);
+
+	print_segments ("Unmerged:");
+	g_print (", %.3f ms/query\n", run_queries (rand));
+
+	/* Incremental merging, as done by tracker-store while idle */
+	timer = g_timer_new ();
+	while (tracker_data_fts_merge_step (&error)) {
+		g_assert_no_error (error);
+		n_steps++;
+	}
+	g_timer_stop (timer);
+
+	print_segments ("Incremental merge:");
+	g_print (", %.3f ms/query (%u steps, %.3f s)\n",
+	         run_queries (rand), n_steps + 1,
+	         g_timer_elapsed (timer, NULL));
+
+	g_timer_start (timer);
+	tracker_data_fts_optimize (&error);
+	g_assert_no_error (error);
+	g_timer_stop (timer);
+
+	print_segments ("Optimized:");
+	g_print (", %.3f ms/query (%.3f s)\n",
+	         run_queries (rand), g_timer_elapsed (timer, NULL));
+
+	g_print ("%-24s %.3f ms/query (prefix index: %s)\n",
+	         "Prefix queries:", run_prefix_queries (rand),
+	         prefix_index ? prefix_index : "none");
+
+	g_timer_destroy (timer);
+	g_rand_free (rand);
+	g_free (data_prefix);
+
+	tracker_data_manager_shutdown ();
+
+	return EXIT_SUCCESS;
+}
@@ -45,6 +45,7 @@ const TestInfo tests[] = {
 	{ "fts3ae", 1 },
 	{ "prefix/fts3prefix", 3 },
 	{ "limits/fts3limits", 4 },
+	{ "snippet/fts3snippet", 2 },
 	{ NULL }
 };
 
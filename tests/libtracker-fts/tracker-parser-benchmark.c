@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <locale.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libtracker-fts/tracker-parser.h>
+#include <libtracker-common/tracker-common.h>
+
+/* Measures parser throughput on ASCII text, with and without the
+ * ASCII fast path of the libicu parser. */
+
+static gchar    *filename;
+static gint      size_mb = 16;
+static gint      iterations = 3;
+
+static const GOptionEntry options [] = {
+	{
+		"file", 'f', 0,
+		G_OPTION_ARG_FILENAME, &filename,
+		"File to parse, instead of generated text",
+		NULL
+	},
+	{
+		"size", 's', 0,
+		G_OPTION_ARG_INT, &size_mb,
+		"Size of the generated text in MB (default: 16)",
+		NULL
+	},
+	{
+		"iterations", 'i', 0,
+		G_OPTION_ARG_INT, &iterations,
+		"Number of times each text is parsed (default: 3)",
+		NULL
+	},
+	{ NULL }
+};
+
+/* Some source code and log like content */
+static const gchar *samples[] = {
+	"static gboolean\nparser_next (TrackerParser *parser, gint *offset)\n{\n",
+	"\tif (parser->cursor >= parser->txt_size) {\n\t\treturn FALSE;\n\t}\n",
+	"2014-03-12 10:42:01,123 INFO [main] Connection established to db01\n",
+	"Error: could not open file '/var/log/messages' (errno=13), retrying\n",
+	"The quick brown fox jumps over the lazy dog, doesn't it? 1,234.5\n",
+	"#define MAX_WORD_LENGTH 30 /* safety limit for the word buffers */\n",
+	NULL
+};
+
+static gchar *
+generate_text (gsize size)
+{
+	GString *str;
+	GRand *rand;
+	guint n_samples;
+
+	n_samples = g_strv_length ((gchar **) samples);
+	rand = g_rand_new_with_seed (42);
+	str = g_string_sized_new (size + 128);
+
+	while (str->len < size) {
+		g_string_append (str, samples[g_rand_int_range (rand, 0, n_samples)]);
+	}
+
+	g_rand_free (rand);
+
+	return g_string_free (str, FALSE);
+}
+
+static gdouble
+run_parser (const gchar *text,
+            gsize        text_size,
+            gboolean     fast_path,
+            guint       *n_words)
+{
+	TrackerLanguage *language;
+	TrackerParser *parser;
+	GTimer *timer;
+	gdouble elapsed;
+	gint i;
+
+	if (!fast_path) {
+		g_setenv ("TRACKER_PARSER_DISABLE_ASCII_FAST_PATH", "1", TRUE);
+	}
+
+	language = tracker_language_new ("en");
+	parser = tracker_parser_new (language);
+	g_unsetenv ("TRACKER_PARSER_DISABLE_ASCII_FAST_PATH");
+
+	timer = g_timer_new ();
+	*n_words = 0;
+
+	for (i = 0; i < iterations; i++) {
+		gint position, byte_offset_start, byte_offset_end, word_length;
+		gboolean stop_word;
+
+		tracker_parser_reset (parser,
+		                      text,
+		                      text_size,
+		                      30,
+		                      TRUE,
+		                      TRUE,
+		                      TRUE,
+		                      TRUE,
+		                      TRUE);
+
+		while (tracker_parser_next (parser,
+		                            &position,
+		                            &byte_offset_start,
+		                            &byte_offset_end,
+		                            &stop_word,
+		                            &word_length)) {
+			(*n_words)++;
+		}
+	}
+
+	elapsed = g_timer_elapsed (timer, NULL);
+
+	g_timer_destroy (timer);
+	tracker_parser_free (parser);
+	g_object_unref (language);
+
+	return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	gchar *text;
+	gsize text_size;
+	gdouble fast, slow;
+	guint fast_words, slow_words;
+	gdouble total_mb;
+
+	setlocale (LC_ALL, "");
+
+	context = g_option_context_new ("- Benchmark the Tracker FTS parser");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+
+	g_option_context_free (context);
+
+	g_setenv ("TRACKER_LANGUAGE_STOP_WORDS_DIR",
+	          TOP_SRCDIR "/data/languages",
+	          FALSE);
+
+	if (filename) {
+		if (!g_file_get_contents (filename, &text, &text_size, &error)) {
+			g_printerr ("Could not read '%s': %s\n",
+			            filename, error->message);
+			g_error_free (error);
+			return EXIT_FAILURE;
+		}
+	} else {
+		text = generate_text ((gsize) size_mb * 1024 * 1024);
+		text_size = strlen (text);
+	}
+
+	total_mb = (gdouble) text_size * iterations / (1024 * 1024);
+
+	slow = run_parser (text, text_size, FALSE, &slow_words);
+	fast = run_parser (text, text_size, TRUE, &fast_words);
+
+	g_print ("Parsed %.1f MB (%u words per pass)\n",
+	         total_mb, fast_words / iterations);
+	g_print ("  libicu:         %8.3f s, %8.2f MB/s\n",
+	         slow, total_mb / slow);
+	g_print ("  ASCII fast path:%8.3f s, %8.2f MB/s (x%.2f)\n",
+	         fast, total_mb / fast, slow / fast);
+
+	if (fast_words != slow_words) {
+		g_printerr ("Word count mismatch: %u (fast path) vs %u (libicu)\n",
+		            fast_words, slow_words);
+		g_free (text);
+		return EXIT_FAILURE;
+	}
+
+	g_free (text);
+
+	return EXIT_SUCCESS;
+}
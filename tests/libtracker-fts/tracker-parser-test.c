@@ -246,6 +246,135 @@ stop_word_check (TrackerParserTestFixture *fixture,
 	g_assert_cmpuint (stop_word, == , testdata->is_expected_stop_word);
 }
 
+/* -------------- ASCII FAST PATH TESTS ----------------- */
+
+/* Test struct for the ASCII fast path tests */
+typedef struct TestDataAsciiFastPath TestDataAsciiFastPath;
+struct TestDataAsciiFastPath {
+	const gchar *str;
+	gboolean ignore_numbers;
+};
+
+/* Dumps all words with their offsets and positions */
+static gchar *
+parse_all_words (TrackerParser *parser,
+                 const gchar   *str,
+                 gint           max_word_length,
+                 gboolean       ignore_numbers)
+{
+	GString *output;
+	const gchar *word;
+	gint position;
+	gint byte_offset_start;
+	gint byte_offset_end;
+	gboolean stop_word;
+	gint word_length;
+
+	output = g_string_new ("");
+
+	tracker_parser_reset (parser,
+	                      str,
+	                      strlen (str),
+	                      max_word_length,
+	                      TRUE,
+	                      TRUE,
+	                      TRUE,
+	                      TRUE,
+	                      ignore_numbers);
+
+	while ((word = tracker_parser_next (parser,
+	                                    &position,
+	                                    &byte_offset_start,
+	                                    &byte_offset_end,
+	                                    &stop_word,
+	                                    &word_length)) != NULL) {
+		g_string_append_printf (output, "%s [%d,%d] %d %d\n",
+		                        word,
+		                        byte_offset_start,
+		                        byte_offset_end,
+		                        position,
+		                        stop_word);
+	}
+
+	return g_string_free (output, FALSE);
+}
+
+/* Words from the ASCII fast path must be the same ones as libicu gives */
+static void
+ascii_fast_path_check (TrackerParserTestFixture *fixture,
+                       gconstpointer data)
+{
+	const TestDataAsciiFastPath *testdata = data;
+	TrackerLanguage *language;
+	TrackerParser *parser;
+	gchar *expected;
+	gchar *output;
+
+	/* Parser with the fast path disabled, as reference */
+	language = tracker_language_new ("en");
+	g_setenv ("TRACKER_PARSER_DISABLE_ASCII_FAST_PATH", "1", TRUE);
+	parser = tracker_parser_new (language);
+	g_unsetenv ("TRACKER_PARSER_DISABLE_ASCII_FAST_PATH");
+	g_object_unref (language);
+
+	expected = parse_all_words (parser,
+	                            testdata->str,
+	                            fixture->max_word_length,
+	                            testdata->ignore_numbers);
+	output = parse_all_words (fixture->parser,
+	                          testdata->str,
+	                          fixture->max_word_length,
+	                          testdata->ignore_numbers);
+
+	g_assert_cmpstr (output, == , expected);
+
+	g_free (expected);
+	g_free (output);
+	tracker_parser_free (parser);
+}
+
+#ifdef HAVE_LIBICU
+/* Words too long to process are dropped by both paths */
+static void
+ascii_fast_path_long_words_check (TrackerParserTestFixture *fixture,
+                                  gconstpointer data)
+{
+	TrackerLanguage *language;
+	TrackerParser *parser;
+	gchar *expected;
+	gchar *output;
+	gchar *fits, *too_long, *str;
+
+	fits = g_strnfill (512, 'a');
+	too_long = g_strnfill (600, 'b');
+	str = g_strdup_printf ("short %s %s end", fits, too_long);
+
+	language = tracker_language_new ("en");
+	g_setenv ("TRACKER_PARSER_DISABLE_ASCII_FAST_PATH", "1", TRUE);
+	parser = tracker_parser_new (language);
+	g_unsetenv ("TRACKER_PARSER_DISABLE_ASCII_FAST_PATH");
+	g_object_unref (language);
+
+	/* libicu can't lowercase the word into its buffer */
+	g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "Error lowercasing*");
+	expected = parse_all_words (parser, str, 1000, FALSE);
+	g_test_assert_expected_messages ();
+
+	output = parse_all_words (fixture->parser, str, 1000, FALSE);
+
+	g_assert_cmpstr (output, ==, expected);
+	g_assert (strstr (output, fits) != NULL);
+	g_assert (strstr (output, too_long) == NULL);
+
+	g_free (expected);
+	g_free (output);
+	g_free (str);
+	g_free (too_long);
+	g_free (fits);
+	tracker_parser_free (parser);
+}
+#endif
+
 /* -------------- LIST OF TESTS ----------------- */
 
 /* Normalization-related tests (unaccenting) */
@@ -317,6 +446,25 @@ static const TestDataExpectedNWords test_data_nwords[] = {
 	{ NULL,                                                     FALSE,  0, 0 }
 };
 
+/* ASCII fast path tests, including mixed ASCII and non-ASCII input */
+static const TestDataAsciiFastPath test_data_ascii_fast_path[] = {
+	{ "The quick (\"brown\") fox can't jump 32.3 feet, right?",    TRUE  },
+	{ "The quick (\"brown\") fox can't jump 32.3 feet, right?",    FALSE },
+	{ "filename.txt .hidden.txt noextension. or OR Or",             TRUE  },
+	{ "snake_case_name CamelCase _private __init__ a_1 1_a",        FALSE },
+	{ "1,000,000.50 3;4 1'2 a,b a;b a'b a''b 'quoted' it's",        FALSE },
+	{ "123abc abc123 0x1F 42 ignored numbers 7",                    TRUE  },
+	{ "http://example.com/path?query=value&other=1#anchor",         TRUE  },
+	{ "key:value a:b 12:30 mailto:someone@example.com",             TRUE  },
+	{ "line one\r\nline two\n\ttabbed\fform feed\vvertical",   TRUE  },
+	{ "tooooooooooooooooooooooooooooooooooooooooooooooooooolong ok", TRUE  },
+	{ "mixed école and ASCII, camión y desagüe; 喂人类 end",        TRUE  },
+	{ "ホモ・サピエンス katakana, chinese, english",                 TRUE  },
+	{ "can’t won't",                                                TRUE  },
+	{ "",                                                           TRUE  },
+	{ NULL,                                                         FALSE }
+};
+
 /* Stop-word tests (for english only) */
 static const TestDataStopWord test_data_stop_words[] = {
 	{ "hello", TRUE,  TRUE  }, /* hello is stop word */
@@ -412,6 +560,29 @@ main (int argc, char **argv)
 		g_free (testpath);
 	}
 
+	/* Add ASCII fast path checks */
+	for (i = 0; test_data_ascii_fast_path[i].str != NULL; i++) {
+		gchar *testpath;
+
+		testpath = g_strdup_printf ("/libtracker-fts/parser/ascii_fast_path_%d", i);
+		g_test_add (testpath,
+		            TrackerParserTestFixture,
+		            &test_data_ascii_fast_path[i],
+		            test_common_setup,
+		            ascii_fast_path_check,
+		            test_common_teardown);
+		g_free (testpath);
+	}
+
+#ifdef HAVE_LIBICU
+	g_test_add ("/libtracker-fts/parser/ascii_fast_path_long_words",
+	            TrackerParserTestFixture,
+	            NULL,
+	            test_common_setup,
+	            ascii_fast_path_long_words_check,
+	            test_common_teardown);
+#endif
+
 	/* Add stop word checks */
 	for (i = 0; test_data_stop_words[i].str != NULL; i++) {
 		gchar *testpath;
@@ -90,6 +90,13 @@ public class TrackerMockConnection : Sparql.Connection {
     }
 
 
+    public async override GenericArray<GLib.Error?>? update_array_async (string[] sparql, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null)
+    throws Sparql.Error, IOError, DBusError {
+        /* Updates always succeed */
+        return null;
+    }
+
+
     public void set_results (TrackerMockResults results) {
         this.results = results;
     }
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <libtracker-miner/tracker-crawler.h>
+
+/* Measures crawling throughput with GIO enumeration and with the
+ * directory listings done on worker threads, on a generated tree or
+ * an existing directory. Directories are crawled one level at a time,
+ * as TrackerFileNotifier does.
+ */
+
+static gchar *path;
+static gint depth = 4;
+static gint directories = 8;
+static gint files = 50;
+
+static const GOptionEntry options [] = {
+	{
+		"path", 'p', 0,
+		G_OPTION_ARG_FILENAME, &path,
+		"Directory to crawl, instead of a generated tree",
+		NULL
+	},
+	{
+		"depth", 'd', 0,
+		G_OPTION_ARG_INT, &depth,
+		"Depth of the generated tree (default: 4)",
+		NULL
+	},
+	{
+		"directories", 'D', 0,
+		G_OPTION_ARG_INT, &directories,
+		"Subdirectories per directory (default: 8)",
+		NULL
+	},
+	{
+		"files", 'f', 0,
+		G_OPTION_ARG_INT, &files,
+		"Files per directory (default: 50)",
+		NULL
+	},
+	{ NULL }
+};
+
+typedef struct {
+	TrackerCrawler *crawler;
+	GMainLoop *main_loop;
+	GQueue *pending;
+	guint directories_found;
+	guint files_found;
+} CrawlData;
+
+static void
+generate_tree (const gchar *dir,
+               gint         level)
+{
+	gint i;
+
+	for (i = 0; i < files; i++) {
+		gchar *name, *file;
+
+		name = g_strdup_printf ("file-%d.txt", i);
+		file = g_build_filename (dir, name, NULL);
+		g_file_set_contents (file, name, -1, NULL);
+		g_free (file);
+		g_free (name);
+	}
+
+	if (level >= depth) {
+		return;
+	}
+
+	for (i = 0; i < directories; i++) {
+		gchar *name, *subdir;
+
+		name = g_strdup_printf ("dir-%d", i);
+		subdir = g_build_filename (dir, name, NULL);
+		g_mkdir (subdir, 0700);
+		generate_tree (subdir, level + 1);
+		g_free (subdir);
+		g_free (name);
+	}
+}
+
+static void
+remove_tree (const gchar *dir)
+{
+	const gchar *name;
+	GDir *d;
+
+	d = g_dir_open (dir, 0, NULL);
+
+	while (d && (name = g_dir_read_name (d)) != NULL) {
+		gchar *file;
+
+		file = g_build_filename (dir, name, NULL);
+
+		if (g_file_test (file, G_FILE_TEST_IS_DIR) &&
+		    !g_file_test (file, G_FILE_TEST_IS_SYMLINK)) {
+			remove_tree (file);
+		} else {
+			g_unlink (file);
+		}
+
+		g_free (file);
+	}
+
+	if (d) {
+		g_dir_close (d);
+	}
+
+	g_rmdir (dir);
+}
+
+static gboolean
+queue_directories_foreach (GNode    *node,
+                           gpointer  user_data)
+{
+	GFileInfo *info;
+	CrawlData *data = user_data;
+
+	info = tracker_crawler_get_file_info (data->crawler, node->data);
+
+	if (info) {
+		/* Queue subdirectories, these weren't iterated */
+		if (g_node_depth (node) == 2 &&
+		    g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+			g_queue_push_tail (data->pending, g_object_ref (node->data));
+		}
+
+		g_object_unref (info);
+	}
+
+	return FALSE;
+}
+
+static void
+crawler_directory_crawled_cb (TrackerCrawler *crawler,
+                              GFile          *directory,
+                              GNode          *tree,
+                              guint           directories_found,
+                              guint           directories_ignored,
+                              guint           files_found,
+                              guint           files_ignored,
+                              gpointer        user_data)
+{
+	CrawlData *data = user_data;
+
+	g_node_traverse (tree, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+	                 queue_directories_foreach, data);
+
+	/* Subdirectories are found again as the root of their own crawl */
+	data->directories_found++;
+	data->files_found += files_found;
+}
+
+static gboolean
+crawl_next (TrackerCrawler *crawler,
+            CrawlData      *data)
+{
+	GFile *directory;
+	gboolean started = FALSE;
+
+	while (!started &&
+	       (directory = g_queue_pop_head (data->pending)) != NULL) {
+		started = tracker_crawler_start (crawler, directory, 1);
+		g_object_unref (directory);
+	}
+
+	return started;
+}
+
+static void
+crawler_finished_cb (TrackerCrawler *crawler,
+                     gboolean        interrupted,
+                     gpointer        user_data)
+{
+	CrawlData *data = user_data;
+
+	if (!crawl_next (crawler, data)) {
+		g_main_loop_quit (data->main_loop);
+	}
+}
+
+static gdouble
+run_crawler (const gchar *dir,
+             gboolean     fast_path,
+             CrawlData   *data)
+{
+	GTimer *timer;
+	gdouble elapsed;
+
+	if (!fast_path) {
+		g_setenv ("TRACKER_CRAWLER_DISABLE_FAST_PATH", "1", TRUE);
+	}
+
+	data->crawler = tracker_crawler_new ();
+	g_unsetenv ("TRACKER_CRAWLER_DISABLE_FAST_PATH");
+
+	/* Same attributes than TrackerFileNotifier */
+	tracker_crawler_set_file_attributes (data->crawler,
+	                                     G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+	                                     G_FILE_ATTRIBUTE_STANDARD_TYPE);
+	g_signal_connect (data->crawler, "directory-crawled",
+	                  G_CALLBACK (crawler_directory_crawled_cb), data);
+	g_signal_connect (data->crawler, "finished",
+	                  G_CALLBACK (crawler_finished_cb), data);
+
+	data->main_loop = g_main_loop_new (NULL, FALSE);
+	data->pending = g_queue_new ();
+	g_queue_push_tail (data->pending, g_file_new_for_path (dir));
+
+	timer = g_timer_new ();
+
+	if (crawl_next (data->crawler, data)) {
+		g_main_loop_run (data->main_loop);
+	}
+
+	elapsed = g_timer_elapsed (timer, NULL);
+
+	g_timer_destroy (timer);
+	g_queue_free_full (data->pending, g_object_unref);
+	g_main_loop_unref (data->main_loop);
+	g_object_unref (data->crawler);
+
+	return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	CrawlData gio = { 0 }, listing = { 0 };
+	gdouble gio_time, listing_time;
+	gchar *dir;
+
+	context = g_option_context_new ("- Benchmark the filesystem crawler");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+
+	g_option_context_free (context);
+
+	if (path) {
+		dir = g_strdup (path);
+	} else {
+		dir = g_dir_make_tmp ("tracker-crawler-benchmark-XXXXXX", &error);
+
+		if (!dir) {
+			g_printerr ("%s\n", error->message);
+			g_error_free (error);
+			return EXIT_FAILURE;
+		}
+
+		g_print ("Generating tree of depth %d, %d directories and %d files per directory...\n",
+		         depth, directories, files);
+		generate_tree (dir, 0);
+	}
+
+	/* Warm up the dentry cache, so both runs are comparable */
+	run_crawler (dir, TRUE, &listing);
+	listing.directories_found = listing.files_found = 0;
+
+	gio_time = run_crawler (dir, FALSE, &gio);
+	listing_time = run_crawler (dir, TRUE, &listing);
+
+	g_print ("Crawled %u directories, %u files\n",
+	         listing.directories_found, listing.files_found);
+	g_print ("  GIO:               %8.3f s, %10.0f files/s\n",
+	         gio_time, (gio.directories_found + gio.files_found) / gio_time);
+	g_print ("  Directory listings:%8.3f s, %10.0f files/s (x%.2f)\n",
+	         listing_time, (listing.directories_found + listing.files_found) / listing_time,
+	         gio_time / listing_time);
+
+	if (!path) {
+		remove_tree (dir);
+	}
+
+	g_free (dir);
+
+	if (gio.directories_found != listing.directories_found ||
+	    gio.files_found != listing.files_found) {
+		g_printerr ("Crawl mismatch: %u/%u (GIO) vs %u/%u (directory listings)\n",
+		            gio.directories_found, gio.files_found,
+		            listing.directories_found, listing.files_found);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -37,6 +37,9 @@ struct CrawlerTest {
 	guint n_check_directory;
 	guint n_check_directory_contents;
 	guint n_check_file;
+
+	TrackerCrawler *crawler;
+	GHashTable *file_infos;
 };
 
 static void
@@ -321,6 +324,104 @@ test_crawler_crawl_n_signals_non_recursive (void)
 	g_object_unref (file);
 }
 
+static gboolean
+collect_file_info_foreach (GNode    *node,
+                           gpointer  user_data)
+{
+	CrawlerTest *test = user_data;
+	GFileInfo *info;
+	gchar *uri;
+
+	info = tracker_crawler_get_file_info (test->crawler, node->data);
+	g_assert (info != NULL);
+
+	uri = g_file_get_uri (node->data);
+	g_hash_table_insert (test->file_infos, uri,
+	                     g_strdup_printf ("%d:%" G_GUINT64_FORMAT,
+	                                      g_file_info_get_file_type (info),
+	                                      g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)));
+	g_object_unref (info);
+
+	return FALSE;
+}
+
+static void
+crawler_directory_crawled_file_info_cb (TrackerCrawler *crawler,
+                                        GFile          *directory,
+                                        GNode          *tree,
+                                        guint           directories_found,
+                                        guint           directories_ignored,
+                                        guint           files_found,
+                                        guint           files_ignored,
+                                        gpointer        user_data)
+{
+	g_node_traverse (tree, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+	                 collect_file_info_foreach, user_data);
+}
+
+static GHashTable *
+crawl_file_infos (gboolean fast_path)
+{
+	CrawlerTest test = { 0 };
+	GFile *file;
+
+	if (!fast_path) {
+		g_setenv ("TRACKER_CRAWLER_DISABLE_FAST_PATH", "1", TRUE);
+	}
+
+	test.main_loop = g_main_loop_new (NULL, FALSE);
+	test.file_infos = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	test.crawler = tracker_crawler_new ();
+	g_unsetenv ("TRACKER_CRAWLER_DISABLE_FAST_PATH");
+
+	tracker_crawler_set_file_attributes (test.crawler,
+	                                     G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+	                                     G_FILE_ATTRIBUTE_STANDARD_TYPE);
+	g_signal_connect (test.crawler, "finished",
+			  G_CALLBACK (crawler_finished_cb), &test);
+	g_signal_connect (test.crawler, "directory-crawled",
+			  G_CALLBACK (crawler_directory_crawled_file_info_cb), &test);
+
+	file = g_file_new_for_path (TEST_DATA_DIR);
+
+	tracker_crawler_start (test.crawler, file, -1);
+
+	g_main_loop_run (test.main_loop);
+
+	g_main_loop_unref (test.main_loop);
+	g_object_unref (test.crawler);
+	g_object_unref (file);
+
+	return test.file_infos;
+}
+
+static void
+test_crawler_crawl_file_info (void)
+{
+	GHashTable *fast, *slow;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	/* Directory listings must provide the
+	 * same information than GIO does.
+	 */
+	fast = crawl_file_infos (TRUE);
+	slow = crawl_file_infos (FALSE);
+
+	/* 4 directories and 5 files */
+	g_assert_cmpint (g_hash_table_size (fast), ==, 9);
+	g_assert_cmpint (g_hash_table_size (fast), ==, g_hash_table_size (slow));
+
+	g_hash_table_iter_init (&iter, slow);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		g_assert_cmpstr (g_hash_table_lookup (fast, key), ==, value);
+	}
+
+	g_hash_table_unref (fast);
+	g_hash_table_unref (slow);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -346,5 +447,8 @@ main (int    argc,
 	g_test_add_func ("/libtracker-miner/tracker-crawler/crawl-n-signals-non-recursive",
 	                 test_crawler_crawl_n_signals_non_recursive);
 
+	g_test_add_func ("/libtracker-miner/tracker-crawler/crawl-file-info",
+	                 test_crawler_crawl_file_info);
+
 	return g_test_run ();
 }
@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <libtracker-miner/tracker-miner.h>
+
+#include "tracker-miner-mock.h"
+
+static TrackerSparqlConnection *mock_connection = NULL;
+
+/* The decorator is built in here, so the backlog state can be
+ * checked, and its queries are answered by the mock connection
+ * instead of a store.
+ */
+#define tracker_miner_get_connection(miner) (mock_connection)
+#include "libtracker-miner/tracker-decorator.c"
+#undef tracker_miner_get_connection
+
+#define RDF_TYPE_ID 1
+#define CLASS_ID 100
+
+typedef TrackerDecorator TestDecorator;
+typedef TrackerDecoratorClass TestDecoratorClass;
+
+G_DEFINE_TYPE (TestDecorator, test_decorator, TRACKER_TYPE_DECORATOR)
+
+static void
+test_decorator_class_init (TestDecoratorClass *klass)
+{
+}
+
+static void
+test_decorator_init (TestDecorator *decorator)
+{
+}
+
+typedef struct {
+	TrackerMockConnection *connection;
+	TrackerDecorator *decorator;
+	TrackerDecoratorInfo *info;
+	guint n_finished;
+} TestCommonContext;
+
+static void
+decorator_finished_cb (TrackerDecorator *decorator,
+                       gpointer          user_data)
+{
+	TestCommonContext *fixture = user_data;
+
+	fixture->n_finished++;
+}
+
+static void
+test_common_context_setup (TestCommonContext *fixture,
+                           gconstpointer      data)
+{
+	gint class_id = CLASS_ID;
+
+	fixture->connection = tracker_mock_connection_new ();
+	mock_connection = TRACKER_SPARQL_CONNECTION (fixture->connection);
+
+	/* Not initialized, as there is no store to resolve IDs from */
+	fixture->decorator = g_object_new (test_decorator_get_type (),
+	                                   "name", "test-decorator",
+	                                   "data-source", "urn:test:data-source",
+	                                   NULL);
+	fixture->decorator->priv->rdf_type_id = RDF_TYPE_ID;
+	g_array_append_val (fixture->decorator->priv->class_name_ids, class_id);
+
+	g_signal_connect (fixture->decorator, "finished",
+	                  G_CALLBACK (decorator_finished_cb), fixture);
+}
+
+static void
+test_common_context_teardown (TestCommonContext *fixture,
+                              gconstpointer      data)
+{
+	/* Let pending callbacks run */
+	while (g_main_context_iteration (NULL, FALSE))
+		;
+
+	g_object_unref (fixture->decorator);
+	g_object_unref (fixture->connection);
+	mock_connection = NULL;
+}
+
+/* Rows for resources @first_id to @first_id + @n_rows - 1, with the
+ * columns of the backlog query, or of the item information query if
+ * @info is %TRUE.
+ */
+static TrackerMockResults *
+mock_results_new (gint     first_id,
+                  gint     n_rows,
+                  gboolean info)
+{
+	TrackerSparqlValueType backlog_types[] = {
+		TRACKER_SPARQL_VALUE_TYPE_INTEGER,
+		TRACKER_SPARQL_VALUE_TYPE_INTEGER
+	};
+	gchar *backlog_names[] = { "id", "type" };
+	TrackerSparqlValueType info_types[] = {
+		TRACKER_SPARQL_VALUE_TYPE_URI,
+		TRACKER_SPARQL_VALUE_TYPE_INTEGER,
+		TRACKER_SPARQL_VALUE_TYPE_STRING,
+		TRACKER_SPARQL_VALUE_TYPE_STRING
+	};
+	gchar *info_names[] = { "urn", "id", "url", "mimetype" };
+	gchar **results;
+	gint i, n_cols;
+
+	n_cols = info ? 4 : 2;
+	results = g_new0 (gchar *, n_rows * n_cols + 1);
+
+	for (i = 0; i < n_rows; i++) {
+		gchar **row = &results[i * n_cols];
+
+		if (info) {
+			row[0] = g_strdup_printf ("urn:test:%d", first_id + i);
+			row[1] = g_strdup_printf ("%d", first_id + i);
+			row[2] = g_strdup_printf ("file:///test/%d", first_id + i);
+			row[3] = g_strdup ("text/plain");
+		} else {
+			row[0] = g_strdup_printf ("%d", first_id + i);
+			row[1] = g_strdup_printf ("%d", CLASS_ID);
+		}
+	}
+
+	if (info) {
+		return tracker_mock_results_new (results, n_rows, n_cols,
+		                                 n_rows, n_cols,
+		                                 info_names, n_cols,
+		                                 info_types, n_cols);
+	} else {
+		return tracker_mock_results_new (results, n_rows, n_cols,
+		                                 n_rows, n_cols,
+		                                 backlog_names, n_cols,
+		                                 backlog_types, n_cols);
+	}
+}
+
+static void
+test_common_context_set_results (TestCommonContext *fixture,
+                                 gint               first_id,
+                                 gint               n_rows,
+                                 gboolean           info)
+{
+	TrackerMockResults *results;
+
+	results = mock_results_new (first_id, n_rows, info);
+	tracker_mock_connection_set_results (fixture->connection, results);
+	g_object_unref (results);
+}
+
+static void
+test_common_context_wait_backlog (TestCommonContext *fixture)
+{
+	while (fixture->decorator->priv->querying_backlog)
+		g_main_context_iteration (NULL, TRUE);
+}
+
+/* Loads the first backlog page, out of @n_backlog pending resources */
+static void
+test_common_context_start_backlog (TestCommonContext *fixture,
+                                   gint               n_backlog)
+{
+	TrackerDecoratorPrivate *priv = fixture->decorator->priv;
+
+	priv->backlog_last_id = 0;
+	priv->n_backlog = n_backlog;
+	priv->backlog_exhausted = FALSE;
+
+	test_common_context_set_results (fixture, 1, BACKLOG_PAGE_SIZE, FALSE);
+	decorator_query_backlog (fixture->decorator);
+	g_assert (priv->querying_backlog);
+
+	test_common_context_wait_backlog (fixture);
+}
+
+/* Emulates a GraphUpdated signal inserting a resource */
+static void
+test_common_context_insert (TestCommonContext *fixture,
+                            gint               id)
+{
+	GVariant *parameters;
+
+	parameters = g_variant_new_parsed ("(%s, @a(iiii) [], [(0, %i, %i, %i)])",
+	                                   "nfo:Document", id,
+	                                   RDF_TYPE_ID, CLASS_ID);
+	g_variant_ref_sink (parameters);
+	class_signal_cb (NULL, NULL, NULL, NULL, "GraphUpdated",
+	                 parameters, fixture->decorator);
+	g_variant_unref (parameters);
+}
+
+static void
+test_decorator_backlog_paging (TestCommonContext *fixture,
+                               gconstpointer      data)
+{
+	TrackerDecoratorPrivate *priv = fixture->decorator->priv;
+	gint id;
+
+	test_common_context_start_backlog (fixture, BACKLOG_PAGE_SIZE + 10);
+
+	/* Only the first page is held */
+	g_assert_cmpuint (tracker_decorator_get_n_items (fixture->decorator), ==, BACKLOG_PAGE_SIZE);
+	g_assert_cmpint (priv->backlog_last_id, ==, BACKLOG_PAGE_SIZE);
+	g_assert_cmpint (priv->n_backlog, ==, 10);
+	g_assert (!priv->backlog_exhausted);
+
+	/* Inserts past the page are left for the next one */
+	g_assert (element_is_in_backlog (fixture->decorator, BACKLOG_PAGE_SIZE + 5));
+	test_common_context_insert (fixture, BACKLOG_PAGE_SIZE + 5);
+	g_assert (!g_hash_table_contains (priv->elems,
+	                                  GINT_TO_POINTER (BACKLOG_PAGE_SIZE + 5)));
+
+	/* The next page is queried below the low watermark */
+	test_common_context_set_results (fixture, BACKLOG_PAGE_SIZE + 1, 10, FALSE);
+
+	for (id = 1; id <= BACKLOG_PAGE_SIZE - BACKLOG_LOW_WATERMARK; id++)
+		tracker_decorator_delete_id (fixture->decorator, id);
+
+	g_assert (!priv->querying_backlog);
+	tracker_decorator_delete_id (fixture->decorator, id++);
+	g_assert (priv->querying_backlog);
+
+	/* An insert arriving while the page is queried is not skipped,
+	 * and is not added twice when the page brings it too.
+	 */
+	g_assert (!element_is_in_backlog (fixture->decorator, BACKLOG_PAGE_SIZE + 5));
+	test_common_context_insert (fixture, BACKLOG_PAGE_SIZE + 5);
+	g_assert (g_hash_table_contains (priv->elems,
+	                                 GINT_TO_POINTER (BACKLOG_PAGE_SIZE + 5)));
+
+	test_common_context_wait_backlog (fixture);
+
+	g_assert (priv->backlog_exhausted);
+	g_assert_cmpint (priv->n_backlog, ==, 0);
+	g_assert_cmpuint (tracker_decorator_get_n_items (fixture->decorator), ==,
+	                  BACKLOG_LOW_WATERMARK - 1 + 10);
+
+	/* ::finished is only emitted once everything is processed */
+	for (; id < BACKLOG_PAGE_SIZE + 10; id++)
+		tracker_decorator_delete_id (fixture->decorator, id);
+
+	g_assert_cmpuint (tracker_decorator_get_n_items (fixture->decorator), ==, 1);
+	g_assert_cmpuint (fixture->n_finished, ==, 0);
+
+	tracker_decorator_delete_id (fixture->decorator, id);
+	g_assert_cmpuint (fixture->n_finished, ==, 1);
+}
+
+static void
+decorator_next_cb (GObject      *object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+	TestCommonContext *fixture = user_data;
+	GError *error = NULL;
+
+	fixture->info = tracker_decorator_next_finish (TRACKER_DECORATOR (object),
+	                                               result, &error);
+	g_assert_no_error (error);
+}
+
+static void
+test_decorator_backlog_next_waits (TestCommonContext *fixture,
+                                   gconstpointer      data)
+{
+	TrackerDecoratorPrivate *priv = fixture->decorator->priv;
+	gint id;
+
+	test_common_context_start_backlog (fixture, BACKLOG_PAGE_SIZE + 10);
+
+	/* Empty the queue while the next page is being queried */
+	test_common_context_set_results (fixture, BACKLOG_PAGE_SIZE + 1, 10, FALSE);
+
+	for (id = 1; id <= BACKLOG_PAGE_SIZE; id++)
+		tracker_decorator_delete_id (fixture->decorator, id);
+
+	g_assert (priv->querying_backlog);
+	g_assert_cmpuint (tracker_decorator_get_n_items (fixture->decorator), ==, 0);
+	g_assert_cmpuint (fixture->n_finished, ==, 0);
+
+	/* Asking for the next item waits for the page */
+	tracker_decorator_next (fixture->decorator, NULL,
+	                        decorator_next_cb, fixture);
+	g_assert (priv->waiting_backlog);
+
+	/* Information about the items in the page */
+	test_common_context_set_results (fixture, BACKLOG_PAGE_SIZE + 1, 10, TRUE);
+
+	while (!fixture->info)
+		g_main_context_iteration (NULL, TRUE);
+
+	g_assert (!priv->waiting_backlog);
+	g_assert (priv->backlog_exhausted);
+	g_assert_cmpstr (tracker_decorator_info_get_url (fixture->info), ==,
+	                 "file:///test/1001");
+
+	/* Process it */
+	g_task_return_pointer (tracker_decorator_info_get_task (fixture->info),
+	                       NULL, NULL);
+	tracker_decorator_info_unref (fixture->info);
+	fixture->info = NULL;
+
+	while (tracker_decorator_get_n_items (fixture->decorator) > 9)
+		g_main_context_iteration (NULL, TRUE);
+
+	g_assert_cmpuint (fixture->n_finished, ==, 0);
+
+	for (id = BACKLOG_PAGE_SIZE + 2; id <= BACKLOG_PAGE_SIZE + 10; id++)
+		tracker_decorator_delete_id (fixture->decorator, id);
+
+	g_assert_cmpuint (fixture->n_finished, ==, 1);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_message ("Testing decorator");
+
+	g_test_add ("/libtracker-miner/decorator/backlog-paging",
+	            TestCommonContext, NULL,
+	            test_common_context_setup,
+	            test_decorator_backlog_paging,
+	            test_common_context_teardown);
+	g_test_add ("/libtracker-miner/decorator/backlog-next-waits",
+	            TestCommonContext, NULL,
+	            test_common_context_setup,
+	            test_decorator_backlog_next_waits,
+	            test_common_context_teardown);
+
+	return g_test_run ();
+}
@@ -29,6 +29,7 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 
+#include <libtracker-sparql/tracker-sparql.h>
 #include <libtracker-miner/tracker-miner-enums.h>
 #include <libtracker-miner/tracker-file-notifier.h>
 
@@ -56,6 +57,9 @@ typedef struct {
 	guint expect_n_results;
 
 	GList *ops;
+
+	/* Set if the test put contents in the store */
+	TrackerSparqlConnection *connection;
 } TestCommonContext;
 
 typedef enum {
@@ -100,7 +104,7 @@ perform_file_operation (TestCommonContext *fixture,
 	path = g_build_filename (fixture->test_path, filename, NULL);
 
 	if (other_filename) {
-		other_path = g_build_filename (fixture->test_path, filename, NULL);
+		other_path = g_build_filename (fixture->test_path, other_filename, NULL);
 		call = g_strdup_printf ("%s %s %s", command, path, other_path);
 		g_free (other_path);
 	} else {
@@ -117,6 +121,7 @@ perform_file_operation (TestCommonContext *fixture,
 #define CREATE_UPDATE_FILE(fixture,p) perform_file_operation((fixture),"touch",(p),NULL)
 #define DELETE_FILE(fixture,p) perform_file_operation((fixture),"rm",(p),NULL)
 #define DELETE_FOLDER(fixture,p) perform_file_operation((fixture),"rm -rf",(p),NULL)
+#define MOVE_FILE(fixture,p,o) perform_file_operation((fixture),"mv",(p),(o))
 
 static void
 file_notifier_file_created_cb (TrackerFileNotifier *notifier,
@@ -257,6 +262,117 @@ test_common_context_remove_dir (TestCommonContext     *fixture,
 	g_object_unref (file);
 }
 
+/* Inserts @paths in the store as if they were indexed in a previous
+ * run, directories are given with a trailing slash. All entries get
+ * an old mtime, so existing directories are reported as updated.
+ */
+static gboolean
+test_common_context_populate_store (TestCommonContext  *fixture,
+                                    const gchar       **paths)
+{
+	GError *error = NULL;
+	GString *sparql;
+	guint i;
+
+	fixture->connection = tracker_sparql_connection_get (NULL, &error);
+
+	if (!fixture->connection) {
+		g_test_skip ("No store available");
+		g_error_free (error);
+		return FALSE;
+	}
+
+	sparql = g_string_new ("INSERT {");
+
+	for (i = 0; paths[i]; i++) {
+		GFile *file, *parent;
+		gchar *name, *path, *uri, *parent_uri;
+		gboolean is_directory;
+
+		is_directory = g_str_has_suffix (paths[i], "/");
+		name = g_strndup (paths[i], strlen (paths[i]) - (is_directory ? 1 : 0));
+		path = g_build_filename (fixture->test_path, name, NULL);
+		file = g_file_new_for_path (path);
+		uri = g_file_get_uri (file);
+
+		g_string_append_printf (sparql,
+		                        " <%s> a nfo:FileDataObject%s ;"
+		                        " nie:url \"%s\" ;"
+		                        " nfo:fileLastModified \"2000-01-01T00:00:00Z\"",
+		                        uri, is_directory ? ", nfo:Folder" : "", uri);
+
+		/* Index roots are not contained in anything stored */
+		if (strchr (name, '/') != NULL) {
+			parent = g_file_get_parent (file);
+			parent_uri = g_file_get_uri (parent);
+			g_string_append_printf (sparql,
+			                        " ; nfo:belongsToContainer <%s>",
+			                        parent_uri);
+			g_object_unref (parent);
+			g_free (parent_uri);
+		}
+
+		g_string_append (sparql, " .");
+
+		g_object_unref (file);
+		g_free (name);
+		g_free (path);
+		g_free (uri);
+	}
+
+	g_string_append (sparql, " }");
+	tracker_sparql_connection_update (fixture->connection, sparql->str,
+	                                  G_PRIORITY_DEFAULT, NULL, &error);
+	g_string_free (sparql, TRUE);
+
+	if (error) {
+		g_test_skip ("Store contents could not be inserted");
+		g_error_free (error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+test_common_context_clear_store (TestCommonContext *fixture)
+{
+	gchar *uri, *sparql;
+
+	uri = g_file_get_uri (fixture->test_file);
+	sparql = g_strdup_printf ("DELETE { ?u a rdfs:Resource } "
+	                          "WHERE { ?u nie:url ?url . "
+	                          "FILTER (tracker:uri-is-descendant (\"%s\", ?url)) }",
+	                          uri);
+
+	tracker_sparql_connection_update (fixture->connection, sparql,
+	                                  G_PRIORITY_DEFAULT, NULL, NULL);
+	g_free (sparql);
+	g_free (uri);
+}
+
+static void
+test_common_context_new_notifier (TestCommonContext *fixture)
+{
+	if (fixture->notifier) {
+		tracker_file_notifier_stop (fixture->notifier);
+		g_object_unref (fixture->notifier);
+	}
+
+	fixture->notifier = tracker_file_notifier_new (fixture->indexing_tree);
+
+	g_signal_connect (fixture->notifier, "file-created",
+	                  G_CALLBACK (file_notifier_file_created_cb), fixture);
+	g_signal_connect (fixture->notifier, "file-updated",
+	                  G_CALLBACK (file_notifier_file_updated_cb), fixture);
+	g_signal_connect (fixture->notifier, "file-deleted",
+	                  G_CALLBACK (file_notifier_file_deleted_cb), fixture);
+	g_signal_connect (fixture->notifier, "file-moved",
+	                  G_CALLBACK (file_notifier_file_moved_cb), fixture);
+	g_signal_connect (fixture->notifier, "finished",
+	                  G_CALLBACK (file_notifier_finished_cb), fixture);
+}
+
 static void
 test_common_context_setup (TestCommonContext *fixture,
                            gconstpointer      data)
@@ -278,18 +394,7 @@ test_common_context_setup (TestCommonContext *fixture,
 	tracker_indexing_tree_set_filter_hidden (fixture->indexing_tree, TRUE);
 
 	fixture->main_loop = g_main_loop_new (NULL, FALSE);
-	fixture->notifier = tracker_file_notifier_new (fixture->indexing_tree);
-
-	g_signal_connect (fixture->notifier, "file-created",
-	                  G_CALLBACK (file_notifier_file_created_cb), fixture);
-	g_signal_connect (fixture->notifier, "file-updated",
-	                  G_CALLBACK (file_notifier_file_updated_cb), fixture);
-	g_signal_connect (fixture->notifier, "file-deleted",
-	                  G_CALLBACK (file_notifier_file_deleted_cb), fixture);
-	g_signal_connect (fixture->notifier, "file-moved",
-	                  G_CALLBACK (file_notifier_file_moved_cb), fixture);
-	g_signal_connect (fixture->notifier, "finished",
-	                  G_CALLBACK (file_notifier_finished_cb), fixture);
+	test_common_context_new_notifier (fixture);
 }
 
 static void
@@ -305,6 +410,11 @@ test_common_context_teardown (TestCommonContext *fixture,
 		g_object_unref (fixture->notifier);
 	}
 
+	if (fixture->connection) {
+		test_common_context_clear_store (fixture);
+		g_object_unref (fixture->connection);
+	}
+
 	if (fixture->indexing_tree) {
 		g_object_unref (fixture->indexing_tree);
 	}
@@ -409,6 +519,103 @@ test_common_context_expect_results (TestCommonContext   *fixture,
 	g_assert_cmpint (g_list_length (fixture->ops), ==, 0);
 }
 
+static guint64
+test_common_context_get_mtime (TestCommonContext *fixture,
+                               const gchar       *filename)
+{
+	GError *error = NULL;
+	GFileInfo *info;
+	GFile *file;
+	gchar *path;
+	guint64 mtime;
+
+	path = g_build_filename (fixture->test_path, filename, NULL);
+	file = g_file_new_for_path (path);
+	g_free (path);
+
+	info = g_file_query_info (file, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+	                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                          NULL, &error);
+	g_assert_no_error (error);
+
+	mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	g_object_unref (info);
+	g_object_unref (file);
+
+	return mtime;
+}
+
+static void
+test_common_context_set_mtime (TestCommonContext *fixture,
+                               const gchar       *filename,
+                               guint64            mtime)
+{
+	GError *error = NULL;
+	GFile *file;
+	gchar *path;
+
+	path = g_build_filename (fixture->test_path, filename, NULL);
+	file = g_file_new_for_path (path);
+	g_free (path);
+
+	g_file_set_attribute_uint64 (file, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime,
+	                             G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                             NULL, &error);
+	g_assert_no_error (error);
+	g_object_unref (file);
+}
+
+/* Crawls the indexed directories, saves the crawl state and
+ * replaces the notifier, as a clean shutdown and restart would.
+ * Operations notified during the crawl are discarded.
+ */
+static void
+test_common_context_crawl_and_save (TestCommonContext *fixture,
+                                    const gchar       *checksum)
+{
+	GError *error = NULL;
+	gchar *path;
+	guint id;
+
+	fixture->expect_finished = TRUE;
+	fixture->expect_n_results = 0;
+	fixture->expect_results = NULL;
+
+	id = g_timeout_add_seconds (2, (GSourceFunc) timeout_expired_cb, fixture);
+	fixture->expire_timeout_id = id;
+
+	tracker_file_notifier_start (fixture->notifier);
+	g_main_loop_run (fixture->main_loop);
+
+	g_assert_cmpuint (fixture->expire_timeout_id, !=, 0);
+	g_source_remove (fixture->expire_timeout_id);
+
+	g_list_foreach (fixture->ops, (GFunc) filesystem_operation_free, NULL);
+	g_list_free (fixture->ops);
+	fixture->ops = NULL;
+
+	path = g_build_filename (fixture->test_path, "crawl-state", NULL);
+	tracker_file_notifier_save_crawl_state (fixture->notifier, path,
+	                                        checksum, &error);
+	g_assert_no_error (error);
+	g_free (path);
+
+	test_common_context_new_notifier (fixture);
+}
+
+static void
+test_common_context_load_state (TestCommonContext  *fixture,
+                                const gchar        *checksum,
+                                GError            **error)
+{
+	gchar *path;
+
+	path = g_build_filename (fixture->test_path, "crawl-state", NULL);
+	tracker_file_notifier_load_crawl_state (fixture->notifier, path,
+	                                        checksum, error);
+	g_free (path);
+}
+
 static void
 test_file_notifier_crawling_non_recursive (TestCommonContext *fixture,
                                            gconstpointer      data)
@@ -743,6 +950,284 @@ test_file_notifier_monitor_updates_recursive (TestCommonContext *fixture,
 	tracker_file_notifier_stop (fixture->notifier);
 }
 
+static void
+test_file_notifier_store_deleted_while_down (TestCommonContext *fixture,
+                                             gconstpointer      data)
+{
+	const gchar *stored[] = {
+		"recursive/",
+		"recursive/folder/",
+		"recursive/folder/aaa",
+		"recursive/ccc",
+		NULL
+	};
+	FilesystemOperation expected_results[] = {
+		{ OPERATION_UPDATE, "recursive", NULL },
+		{ OPERATION_UPDATE, "recursive/folder", NULL },
+		{ OPERATION_CREATE, "recursive/bbb", NULL },
+		{ OPERATION_DELETE, "recursive/folder/aaa", NULL },
+		{ OPERATION_DELETE, "recursive/ccc", NULL }
+	};
+
+	CREATE_FOLDER (fixture, "recursive/folder");
+	CREATE_UPDATE_FILE (fixture, "recursive/bbb");
+
+	if (!test_common_context_populate_store (fixture, stored))
+		return;
+
+	test_common_context_index_dir (fixture, "recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE |
+	                               TRACKER_DIRECTORY_FLAG_CHECK_MTIME);
+
+	tracker_file_notifier_start (fixture->notifier);
+	test_common_context_expect_results (fixture, expected_results,
+	                                    G_N_ELEMENTS (expected_results),
+	                                    2, TRUE);
+	tracker_file_notifier_stop (fixture->notifier);
+}
+
+static void
+test_file_notifier_store_moved_between_roots (TestCommonContext *fixture,
+                                              gconstpointer      data)
+{
+	const gchar *stored[] = {
+		"recursive/",
+		"recursive/folder/",
+		"recursive/folder/aaa",
+		NULL
+	};
+	FilesystemOperation expected_results[] = {
+		{ OPERATION_UPDATE, "recursive", NULL },
+		{ OPERATION_DELETE, "recursive/folder", NULL },
+		{ OPERATION_CREATE, "other-recursive", NULL },
+		{ OPERATION_CREATE, "other-recursive/folder", NULL },
+		{ OPERATION_CREATE, "other-recursive/folder/aaa", NULL }
+	};
+
+	/* The folder was moved to another root while not running */
+	CREATE_FOLDER (fixture, "other-recursive");
+	CREATE_FOLDER (fixture, "other-recursive/folder");
+	CREATE_UPDATE_FILE (fixture, "other-recursive/folder/aaa");
+
+	if (!test_common_context_populate_store (fixture, stored))
+		return;
+
+	test_common_context_index_dir (fixture, "recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE |
+	                               TRACKER_DIRECTORY_FLAG_CHECK_MTIME);
+	test_common_context_index_dir (fixture, "other-recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE |
+	                               TRACKER_DIRECTORY_FLAG_CHECK_MTIME);
+
+	tracker_file_notifier_start (fixture->notifier);
+	test_common_context_expect_results (fixture, expected_results,
+	                                    G_N_ELEMENTS (expected_results),
+	                                    2, TRUE);
+	tracker_file_notifier_stop (fixture->notifier);
+}
+
+static void
+test_file_notifier_store_skipped_group (TestCommonContext *fixture,
+                                        gconstpointer      data)
+{
+	/* The group of the hidden directory sorts before the one
+	 * of "folder", it must be passed over without disturbing
+	 * the merge of the groups after it.
+	 */
+	const gchar *stored[] = {
+		"recursive/",
+		"recursive/.aaa/",
+		"recursive/.aaa/ddd",
+		"recursive/folder/",
+		"recursive/folder/gone",
+		NULL
+	};
+	FilesystemOperation expected_results[] = {
+		{ OPERATION_UPDATE, "recursive", NULL },
+		{ OPERATION_DELETE, "recursive/.aaa", NULL },
+		{ OPERATION_UPDATE, "recursive/folder", NULL },
+		{ OPERATION_CREATE, "recursive/folder/ccc", NULL },
+		{ OPERATION_DELETE, "recursive/folder/gone", NULL }
+	};
+
+	CREATE_FOLDER (fixture, "recursive/.aaa");
+	CREATE_UPDATE_FILE (fixture, "recursive/.aaa/ddd");
+	CREATE_FOLDER (fixture, "recursive/folder");
+	CREATE_UPDATE_FILE (fixture, "recursive/folder/ccc");
+
+	if (!test_common_context_populate_store (fixture, stored))
+		return;
+
+	test_common_context_index_dir (fixture, "recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE |
+	                               TRACKER_DIRECTORY_FLAG_CHECK_MTIME);
+
+	tracker_file_notifier_start (fixture->notifier);
+	test_common_context_expect_results (fixture, expected_results,
+	                                    G_N_ELEMENTS (expected_results),
+	                                    2, TRUE);
+	tracker_file_notifier_stop (fixture->notifier);
+}
+
+static void
+test_file_notifier_monitor_move_between_roots (TestCommonContext *fixture,
+                                               gconstpointer      data)
+{
+	FilesystemOperation expected_results[] = {
+		{ OPERATION_CREATE, "recursive", NULL },
+		{ OPERATION_CREATE, "recursive/folder", NULL },
+		{ OPERATION_CREATE, "recursive/folder/aaa", NULL },
+		{ OPERATION_CREATE, "other-recursive", NULL }
+	};
+	FilesystemOperation expected_results2[] = {
+		{ OPERATION_MOVE, "recursive/folder", "other-recursive/folder" }
+	};
+
+	CREATE_FOLDER (fixture, "recursive/folder");
+	CREATE_UPDATE_FILE (fixture, "recursive/folder/aaa");
+	CREATE_FOLDER (fixture, "other-recursive");
+
+	test_common_context_index_dir (fixture, "recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE |
+	                               TRACKER_DIRECTORY_FLAG_MONITOR |
+	                               TRACKER_DIRECTORY_FLAG_CHECK_MTIME);
+	test_common_context_index_dir (fixture, "other-recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE |
+	                               TRACKER_DIRECTORY_FLAG_MONITOR |
+	                               TRACKER_DIRECTORY_FLAG_CHECK_MTIME);
+
+	tracker_file_notifier_start (fixture->notifier);
+	test_common_context_expect_results (fixture, expected_results,
+					    G_N_ELEMENTS (expected_results),
+					    2, TRUE);
+	tracker_file_notifier_stop (fixture->notifier);
+
+	/* Move the folder across roots */
+	tracker_file_notifier_start (fixture->notifier);
+	MOVE_FILE (fixture, "recursive/folder", "other-recursive/folder");
+	test_common_context_expect_results (fixture, expected_results2,
+					    G_N_ELEMENTS (expected_results2),
+					    5, FALSE);
+	tracker_file_notifier_stop (fixture->notifier);
+}
+
+static void
+test_file_notifier_crawl_state_unchanged (TestCommonContext *fixture,
+                                          gconstpointer      data)
+{
+	FilesystemOperation expected_results[] = {
+		{ OPERATION_CREATE, "recursive/changed/aaa", NULL },
+		{ OPERATION_CREATE, "recursive/changed/bbb", NULL }
+	};
+	GError *error = NULL;
+
+	CREATE_FOLDER (fixture, "recursive/folder");
+	CREATE_UPDATE_FILE (fixture, "recursive/folder/aaa");
+	CREATE_FOLDER (fixture, "recursive/changed");
+	CREATE_UPDATE_FILE (fixture, "recursive/changed/aaa");
+
+	test_common_context_index_dir (fixture, "recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE |
+	                               TRACKER_DIRECTORY_FLAG_MONITOR);
+	test_common_context_crawl_and_save (fixture, "checksum");
+
+	/* Mtimes have a granularity of seconds, set it explicitly */
+	CREATE_UPDATE_FILE (fixture, "recursive/changed/bbb");
+	test_common_context_set_mtime (fixture, "recursive/changed",
+	                               test_common_context_get_mtime (fixture, "recursive/changed") - 10);
+
+	test_common_context_load_state (fixture, "checksum", &error);
+	g_assert_no_error (error);
+
+	/* Only the changed directory is crawled, the
+	 * contents of the other one are not checked.
+	 */
+	tracker_file_notifier_start (fixture->notifier);
+	test_common_context_expect_results (fixture, expected_results,
+	                                    G_N_ELEMENTS (expected_results),
+	                                    2, TRUE);
+	tracker_file_notifier_stop (fixture->notifier);
+}
+
+static void
+test_file_notifier_crawl_state_subdir_gone (TestCommonContext *fixture,
+                                            gconstpointer      data)
+{
+	FilesystemOperation expected_results[] = {
+		{ OPERATION_CREATE, "recursive/folder/aaa", NULL }
+	};
+	GError *error = NULL;
+	guint64 mtime;
+
+	CREATE_FOLDER (fixture, "recursive/folder");
+	CREATE_UPDATE_FILE (fixture, "recursive/folder/aaa");
+	CREATE_FOLDER (fixture, "recursive/folder/sub");
+	CREATE_UPDATE_FILE (fixture, "recursive/folder/sub/bbb");
+
+	test_common_context_index_dir (fixture, "recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE |
+	                               TRACKER_DIRECTORY_FLAG_MONITOR);
+	test_common_context_crawl_and_save (fixture, "checksum");
+
+	/* Remove the subdirectory, but leave the folder mtime as
+	 * saved, so only the subdirectory check finds the change.
+	 */
+	mtime = test_common_context_get_mtime (fixture, "recursive/folder");
+	DELETE_FOLDER (fixture, "recursive/folder/sub");
+	test_common_context_set_mtime (fixture, "recursive/folder", mtime);
+
+	test_common_context_load_state (fixture, "checksum", &error);
+	g_assert_no_error (error);
+
+	/* The folder is crawled after all */
+	tracker_file_notifier_start (fixture->notifier);
+	test_common_context_expect_results (fixture, expected_results,
+	                                    G_N_ELEMENTS (expected_results),
+	                                    2, TRUE);
+	tracker_file_notifier_stop (fixture->notifier);
+}
+
+static void
+test_file_notifier_crawl_state_mismatch (TestCommonContext *fixture,
+                                         gconstpointer      data)
+{
+	FilesystemOperation expected_results[] = {
+		{ OPERATION_CREATE, "recursive/folder/aaa", NULL }
+	};
+	GError *error = NULL;
+	gchar *path;
+
+	CREATE_FOLDER (fixture, "recursive/folder");
+	CREATE_UPDATE_FILE (fixture, "recursive/folder/aaa");
+
+	test_common_context_index_dir (fixture, "recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE |
+	                               TRACKER_DIRECTORY_FLAG_MONITOR);
+	test_common_context_crawl_and_save (fixture, "checksum");
+
+	/* State saved for another configuration */
+	test_common_context_load_state (fixture, "other-checksum", &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_clear_error (&error);
+
+	/* State in an unknown format */
+	path = g_build_filename (fixture->test_path, "crawl-state", NULL);
+	g_file_set_contents (path, "garbage\n", -1, &error);
+	g_assert_no_error (error);
+	g_free (path);
+
+	test_common_context_load_state (fixture, "checksum", &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_clear_error (&error);
+
+	/* Nothing is skipped */
+	tracker_file_notifier_start (fixture->notifier);
+	test_common_context_expect_results (fixture, expected_results,
+	                                    G_N_ELEMENTS (expected_results),
+	                                    2, TRUE);
+	tracker_file_notifier_stop (fixture->notifier);
+}
+
 gint
 main (gint    argc,
       gchar **argv)
@@ -778,6 +1263,24 @@ main (gint    argc,
 		  test_file_notifier_monitor_updates_non_recursive);
 	test_add ("/libtracker-miner/file-notifier/monitor-updates-recursive",
 		  test_file_notifier_monitor_updates_recursive);
+	test_add ("/libtracker-miner/file-notifier/monitor-move-between-roots",
+		  test_file_notifier_monitor_move_between_roots);
+
+	/* Merging store contents */
+	test_add ("/libtracker-miner/file-notifier/store-deleted-while-down",
+		  test_file_notifier_store_deleted_while_down);
+	test_add ("/libtracker-miner/file-notifier/store-moved-between-roots",
+		  test_file_notifier_store_moved_between_roots);
+	test_add ("/libtracker-miner/file-notifier/store-skipped-group",
+		  test_file_notifier_store_skipped_group);
+
+	/* Crawl state */
+	test_add ("/libtracker-miner/file-notifier/crawl-state-unchanged",
+		  test_file_notifier_crawl_state_unchanged);
+	test_add ("/libtracker-miner/file-notifier/crawl-state-subdir-gone",
+		  test_file_notifier_crawl_state_subdir_gone);
+	test_add ("/libtracker-miner/file-notifier/crawl-state-mismatch",
+		  test_file_notifier_crawl_state_mismatch);
 
 	return g_test_run ();
 }
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libtracker-miner/tracker-file-system.h>
+
+/* Measures memory usage and lookup times of TrackerFileSystem on
+ * a synthetic tree, files are added with the same properties than
+ * TrackerFileNotifier sets on crawled files. No files are created
+ * on disk.
+ */
+
+static gint depth = 3;
+static gint directories = 10;
+static gint files = 200;
+
+static const GOptionEntry options [] = {
+	{
+		"depth", 'd', 0,
+		G_OPTION_ARG_INT, &depth,
+		"Depth of the tree (default: 3)",
+		NULL
+	},
+	{
+		"directories", 'D', 0,
+		G_OPTION_ARG_INT, &directories,
+		"Subdirectories per directory (default: 10)",
+		NULL
+	},
+	{
+		"files", 'f', 0,
+		G_OPTION_ARG_INT, &files,
+		"Files per directory (default: 200)",
+		NULL
+	},
+	{ NULL }
+};
+
+static GQuark quark_property_iri = 0;
+static GQuark quark_property_mtime = 0;
+
+static gsize
+get_resident_size (void)
+{
+	gsize size = 0, resident = 0;
+	FILE *f;
+
+	f = fopen ("/proc/self/statm", "r");
+
+	if (f) {
+		if (fscanf (f, "%" G_GSIZE_FORMAT " %" G_GSIZE_FORMAT,
+		            &size, &resident) != 2) {
+			resident = 0;
+		}
+
+		fclose (f);
+	}
+
+	return resident * sysconf (_SC_PAGESIZE);
+}
+
+static void
+add_file (TrackerFileSystem *file_system,
+          GFile             *file,
+          GFileType          file_type,
+          GFile             *parent,
+          guint             *n_files)
+{
+	GFile *canonical;
+	guint64 mtime;
+
+	canonical = tracker_file_system_get_file (file_system, file,
+	                                          file_type, parent);
+
+	mtime = *n_files;
+	tracker_file_system_set_property (file_system, canonical,
+	                                  quark_property_mtime,
+	                                  g_memdup (&mtime, sizeof (guint64)));
+	tracker_file_system_set_property (file_system, canonical,
+	                                  quark_property_iri,
+	                                  g_strdup_printf ("urn:uuid:%08x-0000-0000-0000-000000000000",
+	                                                   *n_files));
+	(*n_files)++;
+}
+
+static void
+add_tree (TrackerFileSystem *file_system,
+          GFile             *dir,
+          gint               level,
+          guint             *n_files)
+{
+	gint i;
+
+	for (i = 0; i < files; i++) {
+		gchar *name;
+		GFile *file;
+
+		name = g_strdup_printf ("file-%d.txt", i);
+		file = g_file_get_child (dir, name);
+		add_file (file_system, file, G_FILE_TYPE_REGULAR, dir, n_files);
+		g_object_unref (file);
+		g_free (name);
+	}
+
+	if (level >= depth) {
+		return;
+	}
+
+	for (i = 0; i < directories; i++) {
+		GFile *file, *canonical;
+		gchar *name;
+
+		name = g_strdup_printf ("dir-%d", i);
+		file = g_file_get_child (dir, name);
+		add_file (file_system, file, G_FILE_TYPE_DIRECTORY, dir, n_files);
+
+		canonical = tracker_file_system_peek_file (file_system, file);
+		add_tree (file_system, canonical, level + 1, n_files);
+
+		g_object_unref (file);
+		g_free (name);
+	}
+}
+
+static gboolean
+lookup_file_foreach (GFile    *file,
+                     gpointer  user_data)
+{
+	GPtrArray *uris = user_data;
+
+	g_ptr_array_add (uris, g_file_get_uri (file));
+
+	return FALSE;
+}
+
+int
+main (int argc, char **argv)
+{
+	TrackerFileSystem *file_system;
+	GOptionContext *context;
+	GError *error = NULL;
+	GFile *root, *canonical;
+	GPtrArray *uris;
+	gsize rss_start, rss_files, rss_dirs;
+	guint n_files = 0, i;
+	gdouble insert_time, lookup_time;
+	GTimer *timer;
+
+	context = g_option_context_new ("- Benchmark the file system cache");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+
+	g_option_context_free (context);
+
+	quark_property_iri = g_quark_from_static_string ("tracker-property-iri");
+	tracker_file_system_register_property (quark_property_iri, g_free);
+	quark_property_mtime = g_quark_from_static_string ("tracker-property-store-mtime");
+	tracker_file_system_register_property (quark_property_mtime, g_free);
+
+	file_system = tracker_file_system_new ();
+	rss_start = get_resident_size ();
+	timer = g_timer_new ();
+
+	root = g_file_new_for_path ("/tracker-file-system-benchmark/root");
+	canonical = tracker_file_system_get_file (file_system, root,
+	                                          G_FILE_TYPE_DIRECTORY, NULL);
+	add_tree (file_system, canonical, 0, &n_files);
+
+	insert_time = g_timer_elapsed (timer, NULL);
+	rss_files = get_resident_size ();
+
+	/* Look up every file through a new GFile */
+	uris = g_ptr_array_new_with_free_func (g_free);
+	tracker_file_system_traverse (file_system, canonical, G_PRE_ORDER,
+	                              lookup_file_foreach, uris);
+
+	g_timer_start (timer);
+
+	for (i = 0; i < uris->len; i++) {
+		GFile *file;
+
+		file = g_file_new_for_uri (g_ptr_array_index (uris, i));
+
+		if (!tracker_file_system_peek_file (file_system, file)) {
+			g_printerr ("File '%s' not found\n",
+			            (gchar *) g_ptr_array_index (uris, i));
+			return EXIT_FAILURE;
+		}
+
+		g_object_unref (file);
+	}
+
+	lookup_time = g_timer_elapsed (timer, NULL);
+	g_ptr_array_unref (uris);
+
+	/* Only directories are kept after crawling */
+	tracker_file_system_forget_files (file_system, canonical,
+	                                  G_FILE_TYPE_REGULAR);
+	rss_dirs = get_resident_size ();
+
+	g_print ("Added %u files\n", n_files);
+	g_print ("  Insertion:  %8.3f s, %10.0f files/s\n",
+	         insert_time, n_files / insert_time);
+	g_print ("  Lookup:     %8.3f s, %10.0f files/s\n",
+	         lookup_time, n_files / lookup_time);
+	g_print ("  Resident:   %8.1f MB, %6.0f bytes/file (GFile included)\n",
+	         (gdouble) (rss_files - rss_start) / (1024 * 1024),
+	         (gdouble) (rss_files - rss_start) / n_files);
+	g_print ("  After forgetting regular files: %8.1f MB\n",
+	         (gdouble) (rss_dirs - rss_start) / (1024 * 1024));
+
+	g_timer_destroy (timer);
+	g_object_unref (root);
+	g_object_unref (file_system);
+
+	return EXIT_SUCCESS;
+}
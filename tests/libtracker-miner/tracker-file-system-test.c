@@ -231,6 +231,140 @@ test_file_system_properties (TestCommonContext *fixture,
 	g_assert (ret_value == NULL);
 }
 
+static void
+test_file_system_forget_files (TestCommonContext *fixture,
+			       gconstpointer      data)
+{
+	GFile *file, *parent, *child, *subdir, *other;
+
+	file = g_file_new_for_uri ("file:///aaa/");
+	parent = tracker_file_system_get_file (fixture->file_system, file,
+					       G_FILE_TYPE_DIRECTORY, NULL);
+	g_object_unref (file);
+
+	file = g_file_new_for_uri ("file:///aaa/bbb");
+	child = tracker_file_system_get_file (fixture->file_system, file,
+					      G_FILE_TYPE_REGULAR, parent);
+	g_object_unref (file);
+
+	file = g_file_new_for_uri ("file:///aaa/ccc");
+	subdir = tracker_file_system_get_file (fixture->file_system, file,
+					       G_FILE_TYPE_DIRECTORY, parent);
+	g_object_unref (file);
+
+	file = g_file_new_for_uri ("file:///aaa/ccc/ddd");
+	tracker_file_system_get_file (fixture->file_system, file,
+				      G_FILE_TYPE_REGULAR, subdir);
+	g_object_unref (file);
+
+	/* Keep a reference on one of the regular files */
+	g_object_ref (child);
+
+	tracker_file_system_forget_files (fixture->file_system, parent,
+					  G_FILE_TYPE_REGULAR);
+
+	/* Directories stay */
+	file = g_file_new_for_uri ("file:///aaa/ccc");
+	other = tracker_file_system_peek_file (fixture->file_system, file);
+	g_assert (other == subdir);
+	g_object_unref (file);
+
+	file = g_file_new_for_uri ("file:///aaa/ccc/ddd");
+	other = tracker_file_system_peek_file (fixture->file_system, file);
+	g_assert (other == NULL);
+	g_object_unref (file);
+
+	/* Referenced files stay until the last reference is dropped */
+	file = g_file_new_for_uri ("file:///aaa/bbb");
+	other = tracker_file_system_peek_file (fixture->file_system, file);
+	g_assert (other == child);
+
+	g_object_unref (child);
+
+	other = tracker_file_system_peek_file (fixture->file_system, file);
+	g_assert (other == NULL);
+	g_object_unref (file);
+}
+
+static gboolean
+forget_files_traverse_func (GFile    *file,
+                            gpointer  user_data)
+{
+	TestCommonContext *fixture = user_data;
+	GFileType file_type;
+
+	file_type = tracker_file_system_get_file_type (fixture->file_system, file);
+
+	/* Regular files are forgotten before being visited */
+	g_assert_cmpint (file_type, ==, G_FILE_TYPE_DIRECTORY);
+
+	/* Drops the last reference on files within this directory */
+	tracker_file_system_forget_files (fixture->file_system, file,
+					  G_FILE_TYPE_REGULAR);
+
+	return FALSE;
+}
+
+static void
+test_file_system_forget_files_traverse (TestCommonContext *fixture,
+					gconstpointer      data)
+{
+	GFile *file, *parent, *subdir, *other;
+
+	file = g_file_new_for_uri ("file:///aaa/");
+	parent = tracker_file_system_get_file (fixture->file_system, file,
+					       G_FILE_TYPE_DIRECTORY, NULL);
+	g_object_unref (file);
+
+	file = g_file_new_for_uri ("file:///aaa/bbb");
+	tracker_file_system_get_file (fixture->file_system, file,
+				      G_FILE_TYPE_REGULAR, parent);
+	g_object_unref (file);
+
+	file = g_file_new_for_uri ("file:///aaa/ccc");
+	subdir = tracker_file_system_get_file (fixture->file_system, file,
+					       G_FILE_TYPE_DIRECTORY, parent);
+	g_object_unref (file);
+
+	file = g_file_new_for_uri ("file:///aaa/ccc/ddd");
+	tracker_file_system_get_file (fixture->file_system, file,
+				      G_FILE_TYPE_REGULAR, subdir);
+	g_object_unref (file);
+
+	file = g_file_new_for_uri ("file:///aaa/eee");
+	tracker_file_system_get_file (fixture->file_system, file,
+				      G_FILE_TYPE_REGULAR, parent);
+	g_object_unref (file);
+
+	tracker_file_system_traverse (fixture->file_system, parent,
+				      G_PRE_ORDER,
+				      forget_files_traverse_func,
+				      fixture);
+
+	file = g_file_new_for_uri ("file:///aaa/ccc");
+	other = tracker_file_system_peek_file (fixture->file_system, file);
+	g_assert (other == subdir);
+	g_object_unref (file);
+
+	file = g_file_new_for_uri ("file:///aaa/bbb");
+	other = tracker_file_system_peek_file (fixture->file_system, file);
+	g_assert (other == NULL);
+	g_object_unref (file);
+
+	file = g_file_new_for_uri ("file:///aaa/ccc/ddd");
+	other = tracker_file_system_peek_file (fixture->file_system, file);
+	g_assert (other == NULL);
+	g_object_unref (file);
+
+	/* Nodes freed after the traversal can be reused */
+	file = g_file_new_for_uri ("file:///aaa/fff");
+	other = tracker_file_system_get_file (fixture->file_system, file,
+					      G_FILE_TYPE_REGULAR, parent);
+	g_assert (other != NULL);
+	g_assert (tracker_file_system_peek_parent (fixture->file_system, other) == parent);
+	g_object_unref (file);
+}
+
 gint
 main (gint    argc,
       gchar **argv)
@@ -249,6 +383,10 @@ main (gint    argc,
 		  test_file_system_reparenting);
 	test_add ("/libtracker-miner/file-system/file-properties",
 	          test_file_system_properties);
+	test_add ("/libtracker-miner/file-system/forget-files",
+	          test_file_system_forget_files);
+	test_add ("/libtracker-miner/file-system/forget-files-traverse",
+	          test_file_system_forget_files_traverse);
 
 	return g_test_run ();
 }
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <libtracker-miner/tracker-glob-matcher.h>
+
+/* Compares filtering basenames through a list of GPatternSpec, as
+ * TrackerIndexingTree used to do, against TrackerGlobMatcher. The
+ * default ignored files of tracker-miner-fs are used, padded with
+ * synthetic globs up to the requested number.
+ */
+
+static gint n_globs = 200;
+static gint n_basenames = 1000000;
+
+static const GOptionEntry options [] = {
+	{
+		"globs", 'g', 0,
+		G_OPTION_ARG_INT, &n_globs,
+		"Number of globs (default: 200)",
+		NULL
+	},
+	{
+		"basenames", 'b', 0,
+		G_OPTION_ARG_INT, &n_basenames,
+		"Number of basenames to filter (default: 1000000)",
+		NULL
+	},
+	{ NULL }
+};
+
+static const gchar *default_globs[] = {
+	"*~", "*.o", "*.la", "*.lo", "*.loT", "*.in", "*.csproj", "*.m4",
+	"*.rej", "*.gmo", "*.orig", "*.pc", "*.omf", "*.aux", "*.tmp",
+	"*.po", "*.vmdk", "*.vm*", "*.nvram", "*.part", "*.rcore", "*.lzo",
+	"autom4te", "conftest", "confstat", "Makefile", "SCCS", "ltmain.sh",
+	"libtool", "config.status", "confdefs.h", "configure", "#*#",
+	"~$*.doc?", "~$*.dot?", "~$*.xls?", "~$*.xlt?", "~$*.xlam",
+	"~$*.ppt?", "~$*.pot?", "~$*.ppam", "~$*.ppsm", "~$*.ppsx",
+	"~$*.vsd?", "~$*.vss?", "~$*.vst?", "*.lock", ".goutputstream-*",
+	NULL
+};
+
+static const gchar *extensions[] = {
+	"txt", "pdf", "jpg", "png", "mp3", "ogg", "c", "h", "o", "html",
+	"odt", "doc", "tmp", "orig", "in", "vmx", "desktop", "xml"
+};
+
+static gchar *
+create_glob (gint i)
+{
+	switch (i % 4) {
+	case 0:
+		return g_strdup_printf ("*.ext%d", i);
+	case 1:
+		return g_strdup_printf ("cache-%d-*", i);
+	case 2:
+		return g_strdup_printf ("name-%d", i);
+	default:
+		return g_strdup_printf ("*backup-%d-?*", i);
+	}
+}
+
+static gchar *
+create_basename (gint i)
+{
+	const gchar *extension;
+
+	extension = extensions[g_random_int_range (0, G_N_ELEMENTS (extensions))];
+
+	switch (g_random_int_range (0, 8)) {
+	case 0:
+		return g_strdup_printf ("name-%d", g_random_int_range (0, n_globs * 2));
+	case 1:
+		return g_strdup_printf ("cache-%d-%d.%s",
+		                        g_random_int_range (0, n_globs * 2), i, extension);
+	case 2:
+		return g_strdup_printf ("file-%d.%s~", i, extension);
+	case 3:
+		return g_strdup_printf ("~$report-%d.docx", i);
+	default:
+		return g_strdup_printf ("file-%d.%s", i, extension);
+	}
+}
+
+int
+main (int argc, char **argv)
+{
+	TrackerGlobMatcher *matcher;
+	GOptionContext *context;
+	GError *error = NULL;
+	GPtrArray *globs, *specs, *basenames;
+	guint n_matches_specs = 0, n_matches_matcher = 0;
+	gdouble specs_time, matcher_time;
+	GTimer *timer;
+	guint i, j;
+
+	context = g_option_context_new ("- Benchmark glob filtering");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+
+	g_option_context_free (context);
+
+	globs = g_ptr_array_new_with_free_func (g_free);
+
+	for (i = 0; default_globs[i] && globs->len < (guint) n_globs; i++) {
+		g_ptr_array_add (globs, g_strdup (default_globs[i]));
+	}
+
+	for (i = 0; globs->len < (guint) n_globs; i++) {
+		g_ptr_array_add (globs, create_glob (i));
+	}
+
+	basenames = g_ptr_array_new_with_free_func (g_free);
+	g_random_set_seed (42);
+
+	for (i = 0; i < (guint) n_basenames; i++) {
+		g_ptr_array_add (basenames, create_basename (i));
+	}
+
+	specs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_pattern_spec_free);
+	matcher = tracker_glob_matcher_new ();
+
+	for (i = 0; i < globs->len; i++) {
+		g_ptr_array_add (specs, g_pattern_spec_new (g_ptr_array_index (globs, i)));
+		tracker_glob_matcher_add (matcher, g_ptr_array_index (globs, i));
+	}
+
+	/* Compile the matcher beforehand */
+	tracker_glob_matcher_match (matcher, "");
+
+	timer = g_timer_new ();
+
+	for (i = 0; i < basenames->len; i++) {
+		const gchar *basename = g_ptr_array_index (basenames, i);
+
+		for (j = 0; j < specs->len; j++) {
+			if (g_pattern_match_string (g_ptr_array_index (specs, j), basename)) {
+				n_matches_specs++;
+				break;
+			}
+		}
+	}
+
+	specs_time = g_timer_elapsed (timer, NULL);
+	g_timer_start (timer);
+
+	for (i = 0; i < basenames->len; i++) {
+		if (tracker_glob_matcher_match (matcher, g_ptr_array_index (basenames, i))) {
+			n_matches_matcher++;
+		}
+	}
+
+	matcher_time = g_timer_elapsed (timer, NULL);
+
+	if (n_matches_specs != n_matches_matcher) {
+		g_printerr ("Results differ: %u matches with GPatternSpec, %u with TrackerGlobMatcher\n",
+		            n_matches_specs, n_matches_matcher);
+		return EXIT_FAILURE;
+	}
+
+	g_print ("Filtered %u basenames through %u globs, %u matched\n",
+	         basenames->len, globs->len, n_matches_matcher);
+	g_print ("  GPatternSpec list:  %8.3f s, %10.0f basenames/s\n",
+	         specs_time, basenames->len / specs_time);
+	g_print ("  TrackerGlobMatcher: %8.3f s, %10.0f basenames/s\n",
+	         matcher_time, basenames->len / matcher_time);
+
+	g_timer_destroy (timer);
+	tracker_glob_matcher_free (matcher);
+	g_ptr_array_unref (specs);
+	g_ptr_array_unref (basenames);
+	g_ptr_array_unref (globs);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <libtracker-miner/tracker-glob-matcher.h>
+
+static const gchar *test_strings[] = {
+	"", "a", "abc", "file.o", "file.oo", ".o", "o", "tmp", "tmpfile",
+	"atmp", "lost+found", "lost+found2", "#draft#", "#", "##",
+	"~$report.docx", "~$report.doc", "~$.docx", "report.vmdk",
+	"report.vmx", "a.b.c", "añb", "ñ", "back-up", "back--up",
+	"with\nnewline", "(parens)", "[brackets]", "dots...", "\xff\xfe",
+	NULL
+};
+
+static void
+check_globs (const gchar **globs)
+{
+	TrackerGlobMatcher *matcher;
+	GPtrArray *specs;
+	gboolean expected;
+	guint i, j;
+
+	matcher = tracker_glob_matcher_new ();
+	specs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_pattern_spec_free);
+
+	for (i = 0; globs[i]; i++) {
+		tracker_glob_matcher_add (matcher, globs[i]);
+		g_ptr_array_add (specs, g_pattern_spec_new (globs[i]));
+	}
+
+	for (i = 0; test_strings[i]; i++) {
+		expected = FALSE;
+
+		for (j = 0; j < specs->len && !expected; j++) {
+			expected = g_pattern_match_string (g_ptr_array_index (specs, j),
+			                                   test_strings[i]);
+		}
+
+		if (tracker_glob_matcher_match (matcher, test_strings[i]) != expected) {
+			g_error ("'%s' %s expected to match", test_strings[i],
+			         expected ? "was" : "was not");
+		}
+	}
+
+	g_ptr_array_unref (specs);
+	tracker_glob_matcher_free (matcher);
+}
+
+static void
+test_glob_matcher_literals (void)
+{
+	const gchar *globs[] = { "lost+found", "a", "(parens)", "", NULL };
+
+	check_globs (globs);
+}
+
+static void
+test_glob_matcher_prefixes (void)
+{
+	const gchar *globs[] = { "tmp*", "lost*", "#*", "~$*", NULL };
+
+	check_globs (globs);
+}
+
+static void
+test_glob_matcher_suffixes (void)
+{
+	const gchar *globs[] = { "*.o", "*~", "*.vmdk", "*#", "*)", "*ñ", NULL };
+
+	check_globs (globs);
+}
+
+static void
+test_glob_matcher_wildcards (void)
+{
+	const gchar *globs[] = { "#*#", "~$*.doc?", "*.vm*", "a?b", "back-?*up",
+	                         "*.*.*", "[*]", "with?newline", "d*s...", NULL };
+
+	check_globs (globs);
+}
+
+static void
+test_glob_matcher_mixed (void)
+{
+	const gchar *globs[] = { "lost+found", "tmp*", "*.o", "#*#", "~$*.doc?",
+	                         "a?b", "*.vm*", "abc", NULL };
+
+	check_globs (globs);
+}
+
+static void
+test_glob_matcher_match_all (void)
+{
+	const gchar *globs[] = { "**", NULL };
+	const gchar *no_globs[] = { NULL };
+
+	check_globs (globs);
+	check_globs (no_globs);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-miner/tracker-glob-matcher/literals",
+	                 test_glob_matcher_literals);
+	g_test_add_func ("/libtracker-miner/tracker-glob-matcher/prefixes",
+	                 test_glob_matcher_prefixes);
+	g_test_add_func ("/libtracker-miner/tracker-glob-matcher/suffixes",
+	                 test_glob_matcher_suffixes);
+	g_test_add_func ("/libtracker-miner/tracker-glob-matcher/wildcards",
+	                 test_glob_matcher_wildcards);
+	g_test_add_func ("/libtracker-miner/tracker-glob-matcher/mixed",
+	                 test_glob_matcher_mixed);
+	g_test_add_func ("/libtracker-miner/tracker-glob-matcher/match_all",
+	                 test_glob_matcher_match_all);
+
+	return g_test_run ();
+}
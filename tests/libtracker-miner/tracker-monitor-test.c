@@ -17,12 +17,19 @@
  * 02110-1301, USA.
  */
 
+#include "config.h"
+
 #include <string.h>
 #include <unistd.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
 
+#ifdef HAVE_SYS_FANOTIFY_H
+#include <fcntl.h>
+#include <sys/fanotify.h>
+#endif
+
 /* Special case, the monitor header is not normally exported */
 #include <libtracker-miner/tracker-monitor.h>
 
@@ -1205,6 +1212,143 @@ test_monitor_file_event_blacklisting_attribute_updated_moved (TrackerMonitorTest
 	g_free (dest_path);
 }
 
+static void
+test_monitor_file_event_blacklisting_deleted_created (TrackerMonitorTestFixture *fixture,
+                                                      gconstpointer              data)
+{
+	GFile *test_file;
+	guint file_events;
+
+	/*
+	 * Event merging:
+	 *  DELETED + CREATED = UPDATED
+	 */
+
+	/* Create file to test with, before setting up environment */
+	set_file_contents (fixture->monitored_directory, "created.txt", "foo", &test_file);
+	g_assert (test_file != NULL);
+
+	/* Set up environment */
+	tracker_monitor_set_enabled (fixture->monitor, TRUE);
+
+	/* Remove the test file, and create it again */
+	g_assert_cmpint (g_file_delete (test_file, NULL, NULL), ==, TRUE);
+	set_file_contents (fixture->monitored_directory, "created.txt", "barrrr", NULL);
+
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (test_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+
+	/* Wait for events */
+	events_wait (fixture);
+
+	/* Get events in the file */
+	file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events, test_file));
+
+	/* Fail if we didn't get the UPDATED signal */
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_UPDATED), >, 0);
+
+	/* Fail if we got a CREATE, DELETE or MOVE signal */
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_CREATED), ==, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_ATTRIBUTE_UPDATED), ==, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_MOVED_FROM), ==, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_MOVED_TO), ==, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_DELETED), ==, 0);
+
+	/* Cleanup environment */
+	tracker_monitor_set_enabled (fixture->monitor, FALSE);
+	g_assert_cmpint (g_file_delete (test_file, NULL, NULL), ==, TRUE);
+	g_object_unref (test_file);
+}
+
+static void
+test_monitor_file_event_blacklisting_moved_moved (TrackerMonitorTestFixture *fixture,
+                                                  gconstpointer              data)
+{
+	GFile *source_file;
+	gchar *source_path;
+	GFile *middle_file;
+	gchar *middle_path;
+	GFile *dest_file;
+	gchar *dest_path;
+	guint file_events;
+
+	/*
+	 * Event merging:
+	 *  MOVED(A->B) + MOVED(B->C) = MOVED(A->C)
+	 */
+
+	/* Create file to test with, before setting up environment */
+	set_file_contents (fixture->monitored_directory, "created.txt", "foo", &source_file);
+	g_assert (source_file != NULL);
+
+	/* Set up environment */
+	tracker_monitor_set_enabled (fixture->monitor, TRUE);
+
+	/* Now, rename the file twice */
+	source_path = g_file_get_path (source_file);
+	middle_path = g_build_filename (fixture->monitored_directory, "renamed.txt", NULL);
+	middle_file = g_file_new_for_path (middle_path);
+	dest_path = g_build_filename (fixture->monitored_directory, "renamed-again.txt", NULL);
+	dest_file = g_file_new_for_path (dest_path);
+
+	g_assert_cmpint (g_rename (source_path, middle_path), ==, 0);
+	g_assert_cmpint (g_rename (middle_path, dest_path), ==, 0);
+
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (source_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (middle_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (dest_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+
+	/* Wait for events */
+	events_wait (fixture);
+
+	/* Get events in the source file */
+	file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events, source_file));
+
+	/* Fail if we didn't get the MOVED_FROM event */
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_MOVED_FROM), >, 0);
+
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_CREATED), ==, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_UPDATED), ==, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_ATTRIBUTE_UPDATED), ==, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_MOVED_TO), ==, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_DELETED), ==, 0);
+
+	/* Fail if we got ANY event on the intermediate file */
+	file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events, middle_file));
+	g_assert_cmpuint (file_events, ==, MONITOR_SIGNAL_NONE);
+
+	/* Get events in the dest file */
+	file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events, dest_file));
+
+	/* Fail if we didn't get the MOVED_TO event */
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_MOVED_TO), >, 0);
+
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_CREATED), ==, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_MOVED_FROM), ==, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_DELETED), ==, 0);
+
+	/* Two moves were received, only one was notified */
+	g_assert_cmpuint (tracker_monitor_get_items_emitted (fixture->monitor), <,
+	                  tracker_monitor_get_events_received (fixture->monitor));
+
+	/* Cleanup environment */
+	tracker_monitor_set_enabled (fixture->monitor, FALSE);
+	g_assert_cmpint (g_file_delete (dest_file, NULL, NULL), ==, TRUE);
+	g_object_unref (source_file);
+	g_object_unref (middle_file);
+	g_object_unref (dest_file);
+	g_free (source_path);
+	g_free (middle_path);
+	g_free (dest_path);
+}
+
 /* ----------------------------- DIRECTORY EVENT TESTS --------------------------------- */
 
 static void
@@ -1790,6 +1934,112 @@ test_monitor_directory_event_moved_from_not_monitored (TrackerMonitorTestFixture
 	g_free (dest_path);
 }
 
+/* ----------------------------- FANOTIFY TESTS --------------------------------- */
+
+#ifdef FAN_REPORT_DFID_NAME
+
+/* Filesystem marks need CAP_SYS_ADMIN, otherwise
+ * the monitor uses per-directory monitors.
+ */
+static gboolean
+fanotify_is_permitted (const gchar *path)
+{
+	gboolean permitted;
+	gint fd;
+
+	if (g_getenv ("TRACKER_MONITOR_DISABLE_FANOTIFY")) {
+		return FALSE;
+	}
+
+	fd = fanotify_init (FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_CLOEXEC,
+	                    O_RDONLY);
+
+	if (fd < 0) {
+		return FALSE;
+	}
+
+	permitted = fanotify_mark (fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+	                           FAN_CREATE | FAN_DELETE | FAN_ONDIR,
+	                           AT_FDCWD, path) == 0;
+	close (fd);
+
+	return permitted;
+}
+
+static void
+test_monitor_fanotify_events (TrackerMonitorTestFixture *fixture,
+                              gconstpointer              data)
+{
+	GFile *created_file, *deleted_file, *source_file, *dest_file;
+	gchar *source_path, *dest_path;
+	guint file_events;
+
+	if (!fanotify_is_permitted (fixture->monitored_directory)) {
+		g_test_skip ("Not permitted to mark filesystems with fanotify");
+		return;
+	}
+
+	/* Create files to test with, before setting up environment */
+	set_file_contents (fixture->monitored_directory, "deleted.txt", "foo", &deleted_file);
+	set_file_contents (fixture->monitored_directory, "moved.txt", "foo", &source_file);
+
+	/* Set up environment, directories are watched through fanotify */
+	tracker_monitor_set_enabled (fixture->monitor, TRUE);
+
+	set_file_contents (fixture->monitored_directory, "created.txt", "foo", &created_file);
+	g_assert_cmpint (g_file_delete (deleted_file, NULL, NULL), ==, TRUE);
+
+	source_path = g_file_get_path (source_file);
+	dest_path = g_build_filename (fixture->monitored_directory, "renamed.txt", NULL);
+	dest_file = g_file_new_for_path (dest_path);
+	g_assert_cmpint (g_rename (source_path, dest_path), ==, 0);
+
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (created_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (deleted_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (source_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (dest_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+
+	/* Wait for events */
+	events_wait (fixture);
+
+	file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events, created_file));
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_CREATED), >, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_DELETED), ==, 0);
+
+	file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events, deleted_file));
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_DELETED), >, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_CREATED), ==, 0);
+
+	file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events, source_file));
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_MOVED_FROM), >, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_DELETED), ==, 0);
+
+	file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events, dest_file));
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_MOVED_TO), >, 0);
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_CREATED), ==, 0);
+
+	/* Cleanup environment */
+	tracker_monitor_set_enabled (fixture->monitor, FALSE);
+	g_assert_cmpint (g_file_delete (created_file, NULL, NULL), ==, TRUE);
+	g_assert_cmpint (g_file_delete (dest_file, NULL, NULL), ==, TRUE);
+	g_object_unref (created_file);
+	g_object_unref (deleted_file);
+	g_object_unref (source_file);
+	g_object_unref (dest_file);
+	g_free (source_path);
+	g_free (dest_path);
+}
+
+#endif /* FAN_REPORT_DFID_NAME */
+
 /* ----------------------------- BASIC API TESTS --------------------------------- */
 
 static void
@@ -1969,6 +2219,18 @@ main (gint    argc,
 	            test_monitor_common_setup,
 	            test_monitor_file_event_blacklisting_attribute_updated_moved,
 	            test_monitor_common_teardown);
+	g_test_add ("/libtracker-miner/tracker-monitor/file-event/blacklisting/deleted-created",
+	            TrackerMonitorTestFixture,
+	            NULL,
+	            test_monitor_common_setup,
+	            test_monitor_file_event_blacklisting_deleted_created,
+	            test_monitor_common_teardown);
+	g_test_add ("/libtracker-miner/tracker-monitor/file-event/blacklisting/moved-moved",
+	            TrackerMonitorTestFixture,
+	            NULL,
+	            test_monitor_common_setup,
+	            test_monitor_file_event_blacklisting_moved_moved,
+	            test_monitor_common_teardown);
 
 	/* Directory Event tests */
 	g_test_add ("/libtracker-miner/tracker-monitor/directory-event/created",
@@ -2014,5 +2276,15 @@ main (gint    argc,
 		    test_monitor_directory_event_moved_from_not_monitored,
 	            test_monitor_common_teardown);
 
+	/* Fanotify tests */
+#ifdef FAN_REPORT_DFID_NAME
+	g_test_add ("/libtracker-miner/tracker-monitor/fanotify/events",
+	            TrackerMonitorTestFixture,
+	            NULL,
+	            test_monitor_common_setup,
+	            test_monitor_fanotify_events,
+	            test_monitor_common_teardown);
+#endif /* FAN_REPORT_DFID_NAME */
+
 	return g_test_run ();
 }
@@ -224,6 +224,203 @@ test_priority_queue_branches (void)
         tracker_priority_queue_unref (queue);
 }
 
+static gboolean
+str_has_prefix (const gchar *str,
+                const gchar *prefix)
+{
+        return g_str_has_prefix (str, prefix);
+}
+
+static void
+test_priority_queue_boost (void)
+{
+        TrackerPriorityQueue *queue;
+        const gchar          *expected[] = { "b1", "b2", "x1", "b1", "a1", "b3", "a2", "a3", NULL };
+        gint                  expected_priorities[] = { 0, 0, 1, 1, 2, 2, 5, 5 };
+        gchar                *result;
+        gint                  i, priority;
+
+        queue = tracker_priority_queue_new ();
+
+        tracker_priority_queue_add (queue, g_strdup ("b3"), 0);
+        tracker_priority_queue_add (queue, g_strdup ("x1"), 1);
+        tracker_priority_queue_add (queue, g_strdup ("b1"), 5);
+        tracker_priority_queue_add (queue, g_strdup ("a2"), 5);
+        tracker_priority_queue_add (queue, g_strdup ("b2"), 5);
+        tracker_priority_queue_add (queue, g_strdup ("a3"), 5);
+        tracker_priority_queue_add (queue, g_strdup ("a1"), 2);
+
+        /* Elements already at a higher priority are left untouched */
+        g_assert_cmpuint (tracker_priority_queue_boost (queue,
+                                                        (GEqualFunc) str_has_prefix,
+                                                        "b", 0), ==, 2);
+        g_assert_cmpuint (tracker_priority_queue_boost (queue,
+                                                        (GEqualFunc) str_has_prefix,
+                                                        "c", 0), ==, 0);
+        g_assert_cmpint (tracker_priority_queue_get_length (queue), ==, 7);
+
+        result = tracker_priority_queue_pop (queue, &priority);
+        g_assert_cmpstr (result, ==, "b3");
+        g_assert_cmpint (priority, ==, 0);
+        g_free (result);
+
+        /* Boosted elements are appended to the segment, in order */
+        tracker_priority_queue_add (queue, g_strdup ("b1"), 5);
+        tracker_priority_queue_boost (queue, (GEqualFunc) str_has_prefix, "b", 1);
+
+        /* Boosting to an intermediate priority */
+        tracker_priority_queue_add (queue, g_strdup ("b3"), 5);
+        tracker_priority_queue_boost (queue, (GEqualFunc) str_has_prefix, "b3", 2);
+
+        for (i = 0; expected[i]; i++) {
+                result = tracker_priority_queue_pop (queue, &priority);
+                g_assert_cmpstr (result, ==, expected[i]);
+                g_assert_cmpint (priority, ==, expected_priorities[i]);
+                g_free (result);
+        }
+
+        g_assert (tracker_priority_queue_is_empty (queue));
+
+        tracker_priority_queue_unref (queue);
+}
+
+static void
+test_priority_queue_boost_segment_end (void)
+{
+        TrackerPriorityQueue *queue;
+        const gchar          *expected[] = { "b1", "b2", "a1", "a2", "c1", NULL };
+        gint                  expected_priorities[] = { 0, 0, 5, 6, 6 };
+        gchar                *result;
+        gint                  i, priority;
+
+        queue = tracker_priority_queue_new ();
+
+        tracker_priority_queue_add (queue, g_strdup ("a1"), 5);
+        tracker_priority_queue_add (queue, g_strdup ("b1"), 5);
+        tracker_priority_queue_add (queue, g_strdup ("b2"), 6);
+        tracker_priority_queue_add (queue, g_strdup ("a2"), 6);
+
+        /* The last element of a segment is boosted, followed
+         * by the first element of the next segment.
+         */
+        g_assert_cmpuint (tracker_priority_queue_boost (queue,
+                                                        (GEqualFunc) str_has_prefix,
+                                                        "b", 0), ==, 2);
+        g_assert_cmpint (tracker_priority_queue_get_length (queue), ==, 4);
+
+        tracker_priority_queue_add (queue, g_strdup ("c1"), 6);
+
+        for (i = 0; expected[i]; i++) {
+                result = tracker_priority_queue_pop (queue, &priority);
+                g_assert_cmpstr (result, ==, expected[i]);
+                g_assert_cmpint (priority, ==, expected_priorities[i]);
+                g_free (result);
+        }
+
+        g_assert (tracker_priority_queue_is_empty (queue));
+
+        tracker_priority_queue_unref (queue);
+}
+
+static void
+test_priority_queue_foreach_remove_segment_end (void)
+{
+        TrackerPriorityQueue *queue;
+        const gchar          *expected[] = { "a1", "a2", "c1", NULL };
+        gint                  expected_priorities[] = { 5, 6, 6 };
+        gchar                *result;
+        gint                  i, priority;
+
+        queue = tracker_priority_queue_new ();
+
+        tracker_priority_queue_add (queue, g_strdup ("a1"), 5);
+        tracker_priority_queue_add (queue, g_strdup ("b1"), 5);
+        tracker_priority_queue_add (queue, g_strdup ("b2"), 6);
+        tracker_priority_queue_add (queue, g_strdup ("a2"), 6);
+
+        /* The last element of a segment is removed, followed
+         * by the first element of the next segment.
+         */
+        g_assert (tracker_priority_queue_foreach_remove (queue,
+                                                         (GEqualFunc) str_has_prefix,
+                                                         "b", g_free));
+        g_assert_cmpint (tracker_priority_queue_get_length (queue), ==, 2);
+
+        tracker_priority_queue_add (queue, g_strdup ("c1"), 6);
+
+        for (i = 0; expected[i]; i++) {
+                result = tracker_priority_queue_pop (queue, &priority);
+                g_assert_cmpstr (result, ==, expected[i]);
+                g_assert_cmpint (priority, ==, expected_priorities[i]);
+                g_free (result);
+        }
+
+        g_assert (tracker_priority_queue_is_empty (queue));
+
+        tracker_priority_queue_unref (queue);
+}
+
+static gboolean
+int_is_boosted (gpointer data,
+                gpointer user_data)
+{
+        return GPOINTER_TO_INT (data) % GPOINTER_TO_INT (user_data) == 0;
+}
+
+static void
+test_priority_queue_boost_under_load (void)
+{
+        TrackerPriorityQueue *queue;
+        gint                  i, n_pops = 0, n_boosted = 0;
+        gdouble               elapsed;
+        gpointer              data;
+
+        queue = tracker_priority_queue_new ();
+
+        /* Lots of items spread through a few priorities, as files
+         * from several indexing roots would be queued.
+         */
+        for (i = 1; i <= 100000; i++) {
+                tracker_priority_queue_add (queue, GINT_TO_POINTER (i),
+                                            (i % 4) * 10 + i / 2000);
+        }
+
+        g_test_timer_start ();
+        g_assert_cmpuint (tracker_priority_queue_boost (queue,
+                                                        (GEqualFunc) int_is_boosted,
+                                                        GINT_TO_POINTER (10000),
+                                                        -100), ==, 10);
+        elapsed = g_test_timer_elapsed ();
+        g_test_message ("Boosted 10 out of 100000 items in %f seconds", elapsed);
+
+        /* The boosted items come out first, regardless of the load */
+        while (n_boosted < 10) {
+                data = tracker_priority_queue_pop (queue, NULL);
+                g_assert (data != NULL);
+                n_pops++;
+
+                if (int_is_boosted (data, GINT_TO_POINTER (10000)))
+                        n_boosted++;
+        }
+
+        g_assert_cmpint (n_pops, ==, 10);
+
+        /* The rest keep their order */
+        i = -1;
+
+        while ((data = tracker_priority_queue_pop (queue, NULL)) != NULL) {
+                gint prio = (GPOINTER_TO_INT (data) % 4) * 10 + GPOINTER_TO_INT (data) / 2000;
+
+                g_assert_cmpint (prio, >=, i);
+                i = prio;
+                n_pops++;
+        }
+
+        g_assert_cmpint (n_pops, ==, 100000);
+
+        tracker_priority_queue_unref (queue);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -247,6 +444,14 @@ main (int    argc,
 
         g_test_add_func ("/libtracker-miner/tracker-priority-queue/branches",
                          test_priority_queue_branches);
+        g_test_add_func ("/libtracker-miner/tracker-priority-queue/boost",
+                         test_priority_queue_boost);
+        g_test_add_func ("/libtracker-miner/tracker-priority-queue/boost_segment_end",
+                         test_priority_queue_boost_segment_end);
+        g_test_add_func ("/libtracker-miner/tracker-priority-queue/foreach_remove_segment_end",
+                         test_priority_queue_foreach_remove_segment_end);
+        g_test_add_func ("/libtracker-miner/tracker-priority-queue/boost_under_load",
+                         test_priority_queue_boost_under_load);
 
 	return g_test_run ();
 }